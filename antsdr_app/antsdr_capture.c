@@ -0,0 +1,440 @@
+/**
+ * @file antsdr_capture.c
+ * @brief ANTSDR capture tool - inspect, seek and replay capture files
+ *
+ * Works on files in the antsdr_capture.h format written by
+ * antsdr_receiver -w or the on-board recorder.
+ *
+ *   info   FILE                      header, rf_config, extent and rate
+ *   dump   FILE [seek] [-n N]        list records from the seek point
+ *   replay FILE HOST PORT [seek] [-n N] [-x SPEED] [-m BYTES]
+ *                                    resend as the driver's v2 UDP stream
+ *
+ * Seek options: -f FRAME (ordinal in the file), -c COUNTER (FPGA frame
+ * counter) or -t NS (timestamp_ns). They binary search the sparse index.
+ *
+ * Replay keeps the original frame spacing scaled by SPEED (default 1.0);
+ * SPEED 0 sends as fast as the link takes it. Datagrams are batched with
+ * sendmmsg() straight out of the mapped file, so line rate is limited by
+ * the NIC rather than by copies. Packets carry a CRC32 per fragment
+ * (checksum mode payload), so antsdr_receiver and udp_receiver.py verify
+ * them as usual.
+ *
+ * Build: gcc -O2 -Wall -o antsdr_capture antsdr_capture.c
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "antsdr_capture.h"
+
+/* Wire format - matches driver */
+#define ANTSDR_PACKET_START_MARKER_V2  0xABCD2234
+#define ANTSDR_PACKET_HEADER_V2_SIZE   44
+#define ANTSDR_HDR_LO_SHIFT            6          /* Fastlock LO tag in v2 header flags */
+#define ANTSDR_HDR_CHAN_SHIFT          10         /* Board channel in v2 header flags */
+#define ANTSDR_MAX_FRAME_V2            65535      /* v2 sizes are 16-bit */
+
+#define DEFAULT_FRAGMENT       1360       /* Driver's ANTSDR_MAX_PAYLOAD_SIZE */
+#define TX_BATCH               64         /* Datagrams per sendmmsg() */
+#define TX_WINDOW              (16 << 20) /* Read-ahead hint while replaying */
+
+static volatile int keep_running = 1;
+static uint32_t crc_table[256];
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    keep_running = 0;
+}
+
+static void crc32_init(void)
+{
+    uint32_t i, j, c;
+
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (j = 0; j < 8; j++)
+            c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+/* Same result as the kernel's crc32(0, p, len) */
+static uint32_t crc32_le(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while (len--)
+        crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+static inline void put_be16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static inline void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static inline void put_be64(uint8_t *p, uint64_t v)
+{
+    put_be32(p, v >> 32);
+    put_be32(p + 4, v);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t t)
+{
+    struct timespec ts = { t / 1000000000ULL, t % 1000000000ULL };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && keep_running)
+        ;
+}
+
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s info FILE\n", prog);
+    printf("       %s dump FILE [seek] [-n N]\n", prog);
+    printf("       %s replay FILE HOST PORT [seek] [-n N] [-x SPEED] [-m BYTES]\n", prog);
+    printf("Seek:\n");
+    printf("  -f <frame>     Start at this record ordinal\n");
+    printf("  -c <counter>   Start at this FPGA frame counter\n");
+    printf("  -t <ns>        Start at this timestamp_ns\n");
+    printf("Options:\n");
+    printf("  -n <count>     Stop after this many records\n");
+    printf("  -x <speed>     Replay speed, 0 = as fast as possible (default: 1.0)\n");
+    printf("  -m <bytes>     Replay fragment payload size (default: %d)\n", DEFAULT_FRAGMENT);
+}
+
+static int cmd_info(const struct antsdr_capture_reader *r)
+{
+    const struct antsdr_capture_header *h = r->hdr;
+    const struct antsdr_capture_meta *m = r->meta;
+    uint64_t pos = h->data_offset, first_ts = 0, last_ts = 0;
+    const struct antsdr_capture_record *rec;
+    double span;
+
+    rec = antsdr_capture_next(r, &pos);
+    if (rec)
+        first_ts = rec->timestamp_ns;
+    if (r->index_count) {
+        /* Last record: scan on from the last index entry */
+        pos = r->index[r->index_count - 1].offset;
+        while ((rec = antsdr_capture_next(r, &pos)))
+            last_ts = rec->timestamp_ns;
+    }
+    span = (last_ts - first_ts) / 1e9;
+
+    printf("Capture:     version %u, %s, written by %s\n", h->version,
+           h->flags & ANTSDR_CAPTURE_COMPLETE ? "complete" : "incomplete (index rebuilt)",
+           h->source == ANTSDR_CAPTURE_SRC_BOARD ? "on-board recorder" : "native receiver");
+    printf("Created:     %" PRIu64 ".%09" PRIu64 " (CLOCK_REALTIME)\n",
+           h->created_ns / 1000000000, h->created_ns % 1000000000);
+    printf("Frames:      %" PRIu64 " (%" PRIu64 " data bytes)\n", r->frame_count,
+           r->data_end - h->data_offset);
+    printf("Index:       %" PRIu64 " entries, every %u frames\n", r->index_count, h->index_interval);
+    printf("Timestamps:  %" PRIu64 " .. %" PRIu64 " (%.3f s", first_ts, last_ts, span);
+    if (span > 0)
+        printf(", %.1f frames/s", (r->frame_count - 1) / span);
+    printf(")\n");
+    if (h->flags & ANTSDR_CAPTURE_COMPLETE)
+        printf("Counters:    %u .. %u\n", h->first_counter, h->last_counter);
+
+    if (m->valid) {
+        printf("RX:          LO=%" PRId64 " Hz FS=%" PRId64 " Hz BW=%" PRId64 " Hz gain=%.2f dB (%s) port=%s\n",
+               m->rx_lo_hz, m->rx_fs_hz, m->rx_bw_hz, m->rx_gain_mdb / 1000.0,
+               m->rx_gain_mode, m->rx_rfport);
+        printf("TX:          LO=%" PRId64 " Hz FS=%" PRId64 " Hz BW=%" PRId64 " Hz gain=%.2f dB port=%s\n",
+               m->tx_lo_hz, m->tx_fs_hz, m->tx_bw_hz, m->tx_gain_mdb / 1000.0, m->tx_rfport);
+        printf("ENSM:        %s\n", m->ensm_mode);
+    } else {
+        printf("RF config:   not recorded\n");
+    }
+    if (m->text[0])
+        printf("Metadata:    %.*s\n", (int)strcspn(m->text, "\r\n"), m->text);
+    return 0;
+}
+
+static int cmd_dump(const struct antsdr_capture_reader *r, uint64_t pos, uint64_t frame, uint64_t count)
+{
+    const struct antsdr_capture_record *rec;
+
+    printf("%12s %12s %12s %20s %8s %6s %3s %2s\n", "frame", "offset", "counter", "timestamp_ns", "length", "flags", "lo", "ch");
+    while (count-- && keep_running) {
+        rec = antsdr_capture_next(r, &pos);
+        if (!rec)
+            break;
+        unsigned int lo = (rec->flags >> ANTSDR_CAPTURE_LO_SHIFT) & 0xf;
+
+        printf("%12" PRIu64 " %12" PRIu64 " %12u %20" PRIu64 " %8u %#6x",
+               frame++, (uint64_t)((const uint8_t *)rec - r->map), rec->frame_counter,
+               rec->timestamp_ns, rec->length, rec->flags);
+        if (lo & ANTSDR_CAPTURE_LO_VALID)
+            printf(" %3u", lo & 0x7);
+        else
+            printf(" %3s", "-");
+        printf(" %2u\n", (rec->flags >> ANTSDR_CAPTURE_CHAN_SHIFT) & 0x3);
+    }
+    return 0;
+}
+
+static int cmd_replay(const struct antsdr_capture_reader *r, const char *host, int port,
+                      uint64_t pos, uint64_t count, double speed, size_t fragment)
+{
+    static uint8_t headers[TX_BATCH][ANTSDR_PACKET_HEADER_V2_SIZE];
+    struct mmsghdr msgs[TX_BATCH];
+    struct iovec iov[TX_BATCH][2];
+    struct sockaddr_in addr;
+    const struct antsdr_capture_record *rec;
+    uint64_t start = 0, first_ts = 0, advised = 0;
+    uint64_t frames = 0, packets = 0, bytes = 0, skipped = 0;
+    uint32_t seq = 0;
+    int sock, n = 0, i;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Invalid address: %s\n", host);
+        return 1;
+    }
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("Failed to create socket");
+        return 1;
+    }
+
+    for (i = 0; i < TX_BATCH; i++) {
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_name = &addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+        msgs[i].msg_hdr.msg_iov = iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 2;
+        iov[i][0].iov_base = headers[i];
+        iov[i][0].iov_len = ANTSDR_PACKET_HEADER_V2_SIZE;
+    }
+
+    while (count-- && keep_running) {
+        const uint8_t *payload;
+        uint32_t frags, f;
+
+        rec = antsdr_capture_next(r, &pos);
+        if (!rec)
+            break;
+        if (rec->length > ANTSDR_MAX_FRAME_V2 || !rec->length) {
+            skipped++;
+            continue;
+        }
+        payload = (const uint8_t *)(rec + 1);
+
+        /* Keep the kernel reading ahead of us */
+        if (pos >= advised) {
+            uint64_t base = pos & ~(uint64_t)(ANTSDR_CAPTURE_PAGE - 1);
+            size_t len = r->size - base < TX_WINDOW ? r->size - base : TX_WINDOW;
+
+            madvise((void *)(r->map + base), len, MADV_WILLNEED);
+            advised = pos + TX_WINDOW / 2;
+        }
+
+        if (!frames) {
+            start = now_ns();
+            first_ts = rec->timestamp_ns;
+        } else if (speed > 0 && rec->timestamp_ns > first_ts) {
+            uint64_t due = start + (uint64_t)((rec->timestamp_ns - first_ts) / speed);
+
+            if (due > now_ns()) {
+                /* Don't hold queued packets back while waiting */
+                if (n && sendmmsg(sock, msgs, n, 0) < 0)
+                    perror("sendmmsg");
+                n = 0;
+                sleep_until_ns(due);
+            }
+        }
+
+        frags = (rec->length + fragment - 1) / fragment;
+        if (frags > 255) {
+            skipped++;
+            continue;
+        }
+        for (f = 0; f < frags; f++) {
+            size_t off = (size_t)f * fragment;
+            size_t len = rec->length - off < fragment ? rec->length - off : fragment;
+            uint8_t *h = headers[n];
+
+            put_be32(h, ANTSDR_PACKET_START_MARKER_V2);
+            put_be32(h + 4, seq++);
+            put_be32(h + 8, rec->frame_id);
+            put_be32(h + 12, rec->frame_counter);
+            put_be64(h + 16, rec->timestamp_ns);
+            put_be16(h + 24, len);
+            put_be16(h + 26, off);
+            h[28] = f;
+            h[29] = frags;
+            /* Monotonic clock, payload CRC, the LO tag and channel as recorded */
+            put_be16(h + 30, ((rec->flags >> ANTSDR_CAPTURE_LO_SHIFT) & 0xf) << ANTSDR_HDR_LO_SHIFT |
+                             ((rec->flags >> ANTSDR_CAPTURE_CHAN_SHIFT) & 0x3) << ANTSDR_HDR_CHAN_SHIFT);
+            put_be16(h + 32, rec->length);
+            put_be16(h + 34, 0);
+            put_be32(h + 36, 0);
+            put_be32(h + 40, crc32_le(0, payload + off, len));
+            iov[n][1].iov_base = (void *)(payload + off);
+            iov[n][1].iov_len = len;
+            bytes += ANTSDR_PACKET_HEADER_V2_SIZE + len;
+            packets++;
+
+            if (++n == TX_BATCH) {
+                int sent = 0;
+
+                while (sent < n) {
+                    int ret = sendmmsg(sock, msgs + sent, n - sent, 0);
+
+                    if (ret < 0) {
+                        if (errno == EINTR || errno == ENOBUFS || errno == EAGAIN)
+                            continue;
+                        perror("sendmmsg");
+                        break;
+                    }
+                    sent += ret;
+                }
+                n = 0;
+            }
+        }
+        frames++;
+    }
+    if (n && sendmmsg(sock, msgs, n, 0) < 0)
+        perror("sendmmsg");
+    close(sock);
+
+    if (frames) {
+        double secs = (now_ns() - start) / 1e9;
+
+        printf("Replayed %" PRIu64 " frames in %" PRIu64 " packets, %.3f s, %.1f Mbit/s",
+               frames, packets, secs, secs > 0 ? bytes * 8.0 / secs / 1e6 : 0.0);
+        if (skipped)
+            printf(", %" PRIu64 " records too large for v2 skipped", skipped);
+        printf("\n");
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct antsdr_capture_reader r;
+    enum antsdr_capture_key key = ANTSDR_CAPTURE_KEY_FRAME;
+    const char *cmd, *path, *host = NULL;
+    uint64_t value = 0, count = UINT64_MAX, pos, frame = 0;
+    size_t fragment = DEFAULT_FRAGMENT;
+    double speed = 1.0;
+    int port = 0, opt, ret;
+
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    cmd = argv[1];
+    path = argv[2];
+    optind = 3;
+    if (strcmp(cmd, "replay") == 0) {
+        if (argc < 5) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        host = argv[3];
+        port = atoi(argv[4]);
+        if (port <= 0 || port > 65535) {
+            fprintf(stderr, "Invalid port: %s\n", argv[4]);
+            return 1;
+        }
+        optind = 5;
+    } else if (strcmp(cmd, "info") != 0 && strcmp(cmd, "dump") != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    while ((opt = getopt(argc, argv, "f:c:t:n:x:m:h")) != -1) {
+        switch (opt) {
+        case 'f':
+            key = ANTSDR_CAPTURE_KEY_FRAME;
+            value = strtoull(optarg, NULL, 0);
+            break;
+        case 'c':
+            key = ANTSDR_CAPTURE_KEY_COUNTER;
+            value = strtoull(optarg, NULL, 0);
+            break;
+        case 't':
+            key = ANTSDR_CAPTURE_KEY_TIME;
+            value = strtoull(optarg, NULL, 0);
+            break;
+        case 'n':
+            count = strtoull(optarg, NULL, 0);
+            break;
+        case 'x':
+            speed = atof(optarg);
+            break;
+        case 'm':
+            fragment = strtoul(optarg, NULL, 0);
+            if (fragment < 64 || fragment > 8972 - ANTSDR_PACKET_HEADER_V2_SIZE) {
+                fprintf(stderr, "Invalid fragment size: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (antsdr_capture_map(&r, path) < 0) {
+        fprintf(stderr, "Failed to open capture %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    crc32_init();
+
+    if (strcmp(cmd, "info") == 0) {
+        ret = cmd_info(&r);
+    } else if (!antsdr_capture_seek(&r, key, value, &pos, &frame)) {
+        fprintf(stderr, "Seek position is past the end of the capture\n");
+        ret = 1;
+    } else if (strcmp(cmd, "dump") == 0) {
+        ret = cmd_dump(&r, pos, frame, count);
+    } else {
+        madvise((void *)r.map, r.size, MADV_SEQUENTIAL);
+        ret = cmd_replay(&r, host, port, pos, count, speed, fragment);
+    }
+
+    antsdr_capture_unmap(&r);
+    return ret;
+}
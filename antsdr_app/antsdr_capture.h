@@ -0,0 +1,585 @@
+/**
+ * @file antsdr_capture.h
+ * @brief ANTSDR capture file format - indexed on-disk recording of frames
+ *
+ * Shared by everything that writes or reads recordings: the native receiver
+ * (antsdr_receiver -w), the on-board recorder and the antsdr_capture tool.
+ * Header only, all helpers are static inline.
+ *
+ * Layout (host byte order, little-endian on every supported target):
+ *
+ *   0x0000  struct antsdr_capture_header, padded to one page
+ *   0x1000  struct antsdr_capture_meta - rf_config in force at capture time
+ *   0x2000  frame records, back to back, each 8-byte aligned:
+ *             struct antsdr_capture_record + payload
+ *   ...     sparse index, page aligned: struct antsdr_capture_index[]
+ *
+ * Every index_interval-th record starts on a page boundary (the gap before
+ * it is zero filled), so an index entry is a valid mmap() offset and a
+ * reader can map just the window it needs. The index lists those records in
+ * file order with their ordinal, frame counter and timestamp; seeking is a
+ * binary search over it plus a scan of at most index_interval records.
+ *
+ * The header is rewritten on every flush, so a recording cut short by a
+ * crash or power loss keeps data_end; without ANTSDR_CAPTURE_COMPLETE the
+ * reader rebuilds the index by walking the records.
+ */
+
+#ifndef ANTSDR_CAPTURE_H
+#define ANTSDR_CAPTURE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ANTSDR_CAPTURE_MAGIC          0x50414341  /* "ACAP" */
+#define ANTSDR_CAPTURE_VERSION        1
+#define ANTSDR_CAPTURE_PAGE           4096
+#define ANTSDR_CAPTURE_META_OFFSET    ANTSDR_CAPTURE_PAGE
+#define ANTSDR_CAPTURE_DATA_OFFSET    (2 * ANTSDR_CAPTURE_PAGE)
+#define ANTSDR_CAPTURE_RECORD_MAGIC   0x4d524641  /* "AFRM" */
+#define ANTSDR_CAPTURE_INTERVAL       1024        /* Records per index entry */
+#define ANTSDR_CAPTURE_BUF_SIZE       (4 << 20)   /* Writer staging buffer */
+#define ANTSDR_CAPTURE_MAX_RECORD     (ANTSDR_CAPTURE_BUF_SIZE - ANTSDR_CAPTURE_PAGE)
+
+/* Header flags */
+#define ANTSDR_CAPTURE_COMPLETE       0x1         /* Closed cleanly, index valid */
+
+/* Who wrote the file */
+#define ANTSDR_CAPTURE_SRC_RECEIVER   0           /* antsdr_receiver on the PC */
+#define ANTSDR_CAPTURE_SRC_BOARD      1           /* On-board recorder */
+
+/* Record flags, same values as the receiver's RX_FRAME_* */
+#define ANTSDR_CAPTURE_CRC_OK         0x1
+#define ANTSDR_CAPTURE_CRC_BAD        0x2
+#define ANTSDR_CAPTURE_DECODED        0x4
+#define ANTSDR_CAPTURE_TRUNCATED      0x8
+#define ANTSDR_CAPTURE_LO_SHIFT       4           /* Bits 4-7: LO tag, 0x8 | fastlock profile, 0 = none */
+#define ANTSDR_CAPTURE_LO_VALID       0x8
+#define ANTSDR_CAPTURE_CHAN_SHIFT     8           /* Bits 8-9: board channel (RX path) */
+
+struct antsdr_capture_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t page_size;
+    uint32_t flags;                       /* ANTSDR_CAPTURE_COMPLETE */
+    uint64_t created_ns;                  /* CLOCK_REALTIME when opened */
+    uint64_t meta_offset;
+    uint64_t meta_length;
+    uint64_t data_offset;
+    uint64_t data_end;                    /* First byte past the last flushed record */
+    uint64_t index_offset;                /* 0 until closed */
+    uint64_t index_count;
+    uint32_t index_interval;
+    uint32_t source;                      /* ANTSDR_CAPTURE_SRC_* */
+    uint64_t frame_count;
+    uint64_t first_timestamp_ns;
+    uint64_t last_timestamp_ns;
+    uint32_t first_counter;
+    uint32_t last_counter;
+};
+
+/* RF configuration at capture time. Gains are in milli-dB so the block has
+ * no floating point layout to agree on. text keeps the configuration as it
+ * was reported (the RF_CONFIG reply of get_rf_config) for anything the
+ * fixed fields don't cover.
+ */
+struct antsdr_capture_meta {
+    uint32_t valid;                       /* Fixed fields below were filled in */
+    uint32_t reserved;
+    int64_t rx_lo_hz;
+    int64_t rx_fs_hz;
+    int64_t rx_bw_hz;
+    int64_t tx_lo_hz;
+    int64_t tx_fs_hz;
+    int64_t tx_bw_hz;
+    int32_t rx_gain_mdb;
+    int32_t tx_gain_mdb;
+    char rx_gain_mode[16];
+    char rx_rfport[16];
+    char tx_rfport[16];
+    char ensm_mode[16];
+    char text[ANTSDR_CAPTURE_PAGE - 128];
+};
+
+struct antsdr_capture_record {
+    uint32_t magic;                       /* ANTSDR_CAPTURE_RECORD_MAGIC */
+    uint32_t length;                      /* Payload bytes that follow */
+    uint64_t timestamp_ns;
+    uint32_t frame_counter;
+    uint32_t frame_id;
+    uint32_t flags;                       /* ANTSDR_CAPTURE_* record flags */
+    uint32_t reserved;
+};
+
+struct antsdr_capture_index {
+    uint64_t offset;                      /* File offset of the record, page aligned */
+    uint64_t frame;                       /* Ordinal of the record in the file */
+    uint64_t timestamp_ns;
+    uint32_t frame_counter;
+    uint32_t reserved;
+};
+
+_Static_assert(sizeof(struct antsdr_capture_header) <= ANTSDR_CAPTURE_PAGE, "capture header");
+_Static_assert(sizeof(struct antsdr_capture_meta) == ANTSDR_CAPTURE_PAGE, "capture meta");
+_Static_assert(sizeof(struct antsdr_capture_record) == 32, "capture record");
+_Static_assert(sizeof(struct antsdr_capture_index) == 32, "capture index");
+
+#define ANTSDR_CAPTURE_ALIGN8(x)      (((x) + 7) & ~(uint64_t)7)
+#define ANTSDR_CAPTURE_PAGE_UP(x)     (((x) + ANTSDR_CAPTURE_PAGE - 1) & ~(uint64_t)(ANTSDR_CAPTURE_PAGE - 1))
+
+/* Fill the fixed fields of meta from an RF_CONFIG reply
+ * ("RF_CONFIG: RX_FREQ=... RX_BW=... ENSM=...") and keep the reply as text.
+ */
+static inline void antsdr_capture_meta_parse(struct antsdr_capture_meta *meta, const char *reply)
+{
+    char buf[sizeof(meta->text)];
+    char *tok, *save = NULL;
+
+    memset(meta, 0, sizeof(*meta));
+    snprintf(meta->text, sizeof(meta->text), "%s", reply);
+    snprintf(buf, sizeof(buf), "%s", reply);
+
+    for (tok = strtok_r(buf, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save)) {
+        char *val = strchr(tok, '=');
+
+        if (!val)
+            continue;
+        *val++ = '\0';
+        if (strcmp(tok, "RX_FREQ") == 0)
+            meta->rx_lo_hz = strtoll(val, NULL, 10);
+        else if (strcmp(tok, "RX_FS") == 0)
+            meta->rx_fs_hz = strtoll(val, NULL, 10);
+        else if (strcmp(tok, "RX_BW") == 0)
+            meta->rx_bw_hz = strtoll(val, NULL, 10);
+        else if (strcmp(tok, "TX_FREQ") == 0)
+            meta->tx_lo_hz = strtoll(val, NULL, 10);
+        else if (strcmp(tok, "TX_FS") == 0)
+            meta->tx_fs_hz = strtoll(val, NULL, 10);
+        else if (strcmp(tok, "TX_BW") == 0)
+            meta->tx_bw_hz = strtoll(val, NULL, 10);
+        else if (strcmp(tok, "RX_GAIN") == 0)
+            meta->rx_gain_mdb = (int32_t)(strtod(val, NULL) * 1000.0);
+        else if (strcmp(tok, "TX_GAIN") == 0)
+            meta->tx_gain_mdb = (int32_t)(strtod(val, NULL) * 1000.0);
+        else if (strcmp(tok, "RX_GAIN_MODE") == 0)
+            snprintf(meta->rx_gain_mode, sizeof(meta->rx_gain_mode), "%s", val);
+        else if (strcmp(tok, "RX_PORT") == 0)
+            snprintf(meta->rx_rfport, sizeof(meta->rx_rfport), "%s", val);
+        else if (strcmp(tok, "TX_PORT") == 0)
+            snprintf(meta->tx_rfport, sizeof(meta->tx_rfport), "%s", val);
+        else if (strcmp(tok, "ENSM") == 0)
+            snprintf(meta->ensm_mode, sizeof(meta->ensm_mode), "%s", val);
+        else
+            continue;
+        meta->valid = 1;
+    }
+}
+
+/*
+ * Writer - single threaded, records are staged in a page-aligned buffer and
+ * written out in large chunks.
+ */
+struct antsdr_capture_writer {
+    int fd;
+    uint8_t *buf;
+    size_t buf_len;                       /* Bytes staged */
+    uint64_t buf_pos;                     /* File offset of buf[0] */
+    struct antsdr_capture_header hdr;
+    struct antsdr_capture_index *index;
+    size_t index_alloc;
+};
+
+static inline int antsdr_capture_write_all(int fd, const void *data, size_t len, uint64_t offset)
+{
+    const uint8_t *p = data;
+
+    while (len) {
+        ssize_t n = pwrite(fd, p, len, offset);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+static inline int antsdr_capture_write_header(struct antsdr_capture_writer *w)
+{
+    uint8_t page[ANTSDR_CAPTURE_PAGE];
+
+    memset(page, 0, sizeof(page));
+    memcpy(page, &w->hdr, sizeof(w->hdr));
+    return antsdr_capture_write_all(w->fd, page, sizeof(page), 0);
+}
+
+static inline int antsdr_capture_flush(struct antsdr_capture_writer *w)
+{
+    if (!w->buf_len)
+        return 0;
+    if (antsdr_capture_write_all(w->fd, w->buf, w->buf_len, w->buf_pos) < 0)
+        return -1;
+    w->buf_pos += w->buf_len;
+    w->buf_len = 0;
+    w->hdr.data_end = w->buf_pos;
+    return antsdr_capture_write_header(w);
+}
+
+/* Returns 0, or -1 with errno set */
+static inline int antsdr_capture_open(struct antsdr_capture_writer *w, const char *path,
+                                      const struct antsdr_capture_meta *meta, uint32_t source,
+                                      uint32_t interval)
+{
+    struct timespec ts;
+
+    memset(w, 0, sizeof(*w));
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0)
+        return -1;
+    if (posix_memalign((void **)&w->buf, ANTSDR_CAPTURE_PAGE, ANTSDR_CAPTURE_BUF_SIZE) != 0) {
+        close(w->fd);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    w->hdr.magic = ANTSDR_CAPTURE_MAGIC;
+    w->hdr.version = ANTSDR_CAPTURE_VERSION;
+    w->hdr.page_size = ANTSDR_CAPTURE_PAGE;
+    w->hdr.created_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    w->hdr.meta_offset = ANTSDR_CAPTURE_META_OFFSET;
+    w->hdr.meta_length = sizeof(*meta);
+    w->hdr.data_offset = ANTSDR_CAPTURE_DATA_OFFSET;
+    w->hdr.data_end = ANTSDR_CAPTURE_DATA_OFFSET;
+    w->hdr.index_interval = interval ? interval : ANTSDR_CAPTURE_INTERVAL;
+    w->hdr.source = source;
+    w->buf_pos = ANTSDR_CAPTURE_DATA_OFFSET;
+
+    if (antsdr_capture_write_header(w) < 0 ||
+        antsdr_capture_write_all(w->fd, meta, sizeof(*meta), ANTSDR_CAPTURE_META_OFFSET) < 0) {
+        int err = errno;
+
+        close(w->fd);
+        free(w->buf);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+static inline int antsdr_capture_append(struct antsdr_capture_writer *w, uint32_t frame_id,
+                                        uint32_t frame_counter, uint64_t timestamp_ns, uint32_t flags,
+                                        const void *payload, size_t len)
+{
+    struct antsdr_capture_record *rec;
+    bool indexed = w->hdr.frame_count % w->hdr.index_interval == 0;
+    size_t pad = 0, need;
+
+    if (sizeof(*rec) + len > ANTSDR_CAPTURE_MAX_RECORD) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    need = ANTSDR_CAPTURE_ALIGN8(sizeof(*rec) + len);
+    if (indexed)
+        pad = ANTSDR_CAPTURE_PAGE_UP(w->buf_pos + w->buf_len) - (w->buf_pos + w->buf_len);
+    if (w->buf_len + pad + need > ANTSDR_CAPTURE_BUF_SIZE) {
+        if (antsdr_capture_flush(w) < 0)
+            return -1;
+        if (indexed)
+            pad = ANTSDR_CAPTURE_PAGE_UP(w->buf_pos) - w->buf_pos;
+    }
+
+    if (indexed) {
+        struct antsdr_capture_index *e;
+
+        if (w->hdr.index_count == w->index_alloc) {
+            size_t n = w->index_alloc ? w->index_alloc * 2 : 1024;
+            void *p = realloc(w->index, n * sizeof(*w->index));
+
+            if (!p) {
+                errno = ENOMEM;
+                return -1;
+            }
+            w->index = p;
+            w->index_alloc = n;
+        }
+        memset(w->buf + w->buf_len, 0, pad);
+        w->buf_len += pad;
+
+        e = &w->index[w->hdr.index_count++];
+        e->offset = w->buf_pos + w->buf_len;
+        e->frame = w->hdr.frame_count;
+        e->timestamp_ns = timestamp_ns;
+        e->frame_counter = frame_counter;
+        e->reserved = 0;
+    }
+
+    rec = (struct antsdr_capture_record *)(w->buf + w->buf_len);
+    rec->magic = ANTSDR_CAPTURE_RECORD_MAGIC;
+    rec->length = len;
+    rec->timestamp_ns = timestamp_ns;
+    rec->frame_counter = frame_counter;
+    rec->frame_id = frame_id;
+    rec->flags = flags;
+    rec->reserved = 0;
+    memcpy(rec + 1, payload, len);
+    memset((uint8_t *)(rec + 1) + len, 0, need - sizeof(*rec) - len);
+    w->buf_len += need;
+
+    if (!w->hdr.frame_count) {
+        w->hdr.first_timestamp_ns = timestamp_ns;
+        w->hdr.first_counter = frame_counter;
+    }
+    w->hdr.last_timestamp_ns = timestamp_ns;
+    w->hdr.last_counter = frame_counter;
+    w->hdr.frame_count++;
+    return 0;
+}
+
+/* Flush, append the index and mark the file complete */
+static inline int antsdr_capture_close(struct antsdr_capture_writer *w)
+{
+    int ret = antsdr_capture_flush(w);
+
+    if (ret == 0) {
+        w->hdr.index_offset = ANTSDR_CAPTURE_PAGE_UP(w->hdr.data_end);
+        ret = antsdr_capture_write_all(w->fd, w->index, w->hdr.index_count * sizeof(*w->index),
+                                       w->hdr.index_offset);
+    }
+    if (ret == 0 && fdatasync(w->fd) < 0)
+        ret = -1;
+    if (ret == 0) {
+        w->hdr.flags |= ANTSDR_CAPTURE_COMPLETE;
+        ret = antsdr_capture_write_header(w);
+    }
+
+    close(w->fd);
+    free(w->buf);
+    free(w->index);
+    w->fd = -1;
+    w->buf = NULL;
+    w->index = NULL;
+    return ret;
+}
+
+/*
+ * Reader - maps the whole file read-only.
+ */
+struct antsdr_capture_reader {
+    const uint8_t *map;
+    size_t size;
+    const struct antsdr_capture_header *hdr;
+    const struct antsdr_capture_meta *meta;
+    const struct antsdr_capture_index *index;
+    uint64_t index_count;
+    uint64_t data_end;
+    uint64_t frame_count;
+    struct antsdr_capture_index *rebuilt; /* Owned when the index was rebuilt */
+};
+
+enum antsdr_capture_key {
+    ANTSDR_CAPTURE_KEY_FRAME,             /* Ordinal in the file */
+    ANTSDR_CAPTURE_KEY_COUNTER,           /* FPGA frame counter, wraps */
+    ANTSDR_CAPTURE_KEY_TIME,              /* timestamp_ns */
+};
+
+/* Record at *pos, advancing *pos past it; NULL at the end of the data.
+ * Zero fill before a page-aligned record is skipped.
+ */
+static inline const struct antsdr_capture_record *
+antsdr_capture_next(const struct antsdr_capture_reader *r, uint64_t *pos)
+{
+    while (*pos + sizeof(struct antsdr_capture_record) <= r->data_end) {
+        const struct antsdr_capture_record *rec = (const void *)(r->map + *pos);
+
+        if (rec->magic == ANTSDR_CAPTURE_RECORD_MAGIC) {
+            if (*pos + sizeof(*rec) + rec->length > r->data_end)
+                return NULL;
+            *pos += ANTSDR_CAPTURE_ALIGN8(sizeof(*rec) + rec->length);
+            return rec;
+        }
+        if (rec->magic != 0)
+            return NULL;  /* Corrupt */
+        *pos = (*pos | (ANTSDR_CAPTURE_PAGE - 1)) + 1;
+    }
+    return NULL;
+}
+
+/* Walk the records of a file that was not closed and index them the way
+ * the writer would have.
+ */
+static inline int antsdr_capture_rebuild_index(struct antsdr_capture_reader *r)
+{
+    uint32_t interval = r->hdr->index_interval ? r->hdr->index_interval : ANTSDR_CAPTURE_INTERVAL;
+    size_t alloc = 0;
+    uint64_t pos = r->hdr->data_offset, frame = 0, at = pos;
+    const struct antsdr_capture_record *rec;
+
+    r->index_count = 0;
+    while ((rec = antsdr_capture_next(r, &pos))) {
+        if (frame % interval == 0) {
+            struct antsdr_capture_index *e;
+
+            if (r->index_count == alloc) {
+                size_t n = alloc ? alloc * 2 : 1024;
+                void *p = realloc(r->rebuilt, n * sizeof(*r->rebuilt));
+
+                if (!p)
+                    return -1;
+                r->rebuilt = p;
+                alloc = n;
+            }
+            e = &r->rebuilt[r->index_count++];
+            e->offset = (const uint8_t *)rec - r->map;
+            e->frame = frame;
+            e->timestamp_ns = rec->timestamp_ns;
+            e->frame_counter = rec->frame_counter;
+            e->reserved = 0;
+        }
+        frame++;
+        at = pos;
+    }
+    r->data_end = at;
+    r->frame_count = frame;
+    r->index = r->rebuilt;
+    return 0;
+}
+
+static inline void antsdr_capture_unmap(struct antsdr_capture_reader *r)
+{
+    if (r->map)
+        munmap((void *)r->map, r->size);
+    free(r->rebuilt);
+    memset(r, 0, sizeof(*r));
+}
+
+/* Returns 0, or -1 with errno set */
+static inline int antsdr_capture_map(struct antsdr_capture_reader *r, const char *path)
+{
+    const struct antsdr_capture_header *hdr;
+    struct stat st;
+    void *map;
+    int fd;
+
+    memset(r, 0, sizeof(*r));
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    if ((uint64_t)st.st_size < ANTSDR_CAPTURE_DATA_OFFSET) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    r->map = map;
+    r->size = st.st_size;
+    hdr = r->hdr = map;
+    if (hdr->magic != ANTSDR_CAPTURE_MAGIC || hdr->version != ANTSDR_CAPTURE_VERSION ||
+        hdr->data_offset < ANTSDR_CAPTURE_DATA_OFFSET || hdr->data_offset > r->size ||
+        hdr->meta_offset + sizeof(*r->meta) > r->size) {
+        antsdr_capture_unmap(r);
+        errno = EINVAL;
+        return -1;
+    }
+    r->meta = (const void *)(r->map + hdr->meta_offset);
+
+    if ((hdr->flags & ANTSDR_CAPTURE_COMPLETE) &&
+        hdr->data_end <= r->size &&
+        hdr->index_offset + hdr->index_count * sizeof(*r->index) <= r->size) {
+        r->index = (const void *)(r->map + hdr->index_offset);
+        r->index_count = hdr->index_count;
+        r->data_end = hdr->data_end;
+        r->frame_count = hdr->frame_count;
+        return 0;
+    }
+
+    /* Crashed or still being written: trust nothing past the file size */
+    r->data_end = hdr->data_end > hdr->data_offset && hdr->data_end <= r->size ?
+                  hdr->data_end : r->size;
+    if (antsdr_capture_rebuild_index(r) < 0) {
+        antsdr_capture_unmap(r);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+/* Index entry ordering against a key: <0 before, 0 at, >0 after */
+static inline int64_t antsdr_capture_cmp(enum antsdr_capture_key key, uint64_t frame, uint32_t counter,
+                                         uint64_t timestamp_ns, uint64_t value)
+{
+    switch (key) {
+    case ANTSDR_CAPTURE_KEY_COUNTER:
+        return (int32_t)(counter - (uint32_t)value);
+    case ANTSDR_CAPTURE_KEY_TIME:
+        return timestamp_ns < value ? -1 : timestamp_ns > value;
+    default:
+        return frame < value ? -1 : frame > value;
+    }
+}
+
+/* Position of the first record at or after value: a binary search of the
+ * index, then a scan within one interval. Returns false past the end.
+ * *frame receives the record's ordinal.
+ */
+static inline bool antsdr_capture_seek(const struct antsdr_capture_reader *r, enum antsdr_capture_key key,
+                                       uint64_t value, uint64_t *pos, uint64_t *frame)
+{
+    const struct antsdr_capture_record *rec;
+    uint64_t lo = 0, hi = r->index_count, at, n;
+
+    if (!r->index_count)
+        return false;
+
+    /* Last entry not after value */
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        const struct antsdr_capture_index *e = &r->index[mid];
+
+        if (antsdr_capture_cmp(key, e->frame, e->frame_counter, e->timestamp_ns, value) <= 0)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    at = r->index[lo].offset;
+    n = r->index[lo].frame;
+    for (;;) {
+        uint64_t next = at;
+
+        rec = antsdr_capture_next(r, &next);
+        if (!rec)
+            return false;
+        if (antsdr_capture_cmp(key, n, rec->frame_counter, rec->timestamp_ns, value) >= 0)
+            break;
+        at = next;
+        n++;
+    }
+    *pos = at;
+    if (frame)
+        *frame = n;
+    return true;
+}
+
+#endif /* ANTSDR_CAPTURE_H */
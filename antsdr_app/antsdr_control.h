@@ -0,0 +1,131 @@
+/**
+ * @file antsdr_control.h
+ * @brief ANTSDR binary control protocol - batched parameter changes over UDP
+ *
+ * Shares the control port with the text commands. One request datagram
+ * carries any number of parameter items and is applied as one transaction:
+ * every item is validated first, nothing changes unless all of them pass,
+ * then the AD9361 is reprogrammed once. The reply is a single datagram with
+ * a status and the value now in force for every item.
+ *
+ *   request: struct antsdr_ctrl_header + count * struct antsdr_ctrl_item
+ *   reply:   struct antsdr_ctrl_header (ANTSDR_CTRL_F_REPLY, overall status)
+ *            + count * struct antsdr_ctrl_item (per-item status and value)
+ *
+ * All fields are in network byte order. Statuses are 0 or a negative errno.
+ *
+ * Sessions make retries safe: a client picks a random session id and numbers
+ * its requests 1, 2, 3... The board keeps the last sequence number and reply
+ * of the ANTSDR_CTRL_SESSIONS most recent sessions. A retransmitted request
+ * (same session and sequence) gets the cached reply and is not applied
+ * again; an older one is refused with -ESTALE.
+ *
+ * The first byte of the magic (0xA5) is not printable, so a binary request
+ * can never be mistaken for a text command.
+ */
+
+#ifndef ANTSDR_CONTROL_H
+#define ANTSDR_CONTROL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+#include <arpa/inet.h>
+
+#define ANTSDR_CTRL_MAGIC           0xA5C7D001
+#define ANTSDR_CTRL_VERSION         1
+#define ANTSDR_CTRL_MAX_DATAGRAM    1472        /* One Ethernet frame */
+#define ANTSDR_CTRL_SESSIONS        8           /* Sessions remembered for retransmits */
+
+/* Header flags */
+#define ANTSDR_CTRL_F_REPLY         0x01
+
+/* Item flags */
+#define ANTSDR_CTRL_ITEM_GET        0x0001      /* Read back only, value ignored */
+
+/* Parameters. Values are integers: Hz, milli-dB, or an index into the
+ * name lists below (same order as the text commands accept).
+ */
+enum antsdr_ctrl_param {
+    ANTSDR_CTRL_RX_LO_HZ = 1,
+    ANTSDR_CTRL_TX_LO_HZ,
+    ANTSDR_CTRL_RX_BW_HZ,
+    ANTSDR_CTRL_TX_BW_HZ,
+    ANTSDR_CTRL_RX_FS_HZ,
+    ANTSDR_CTRL_TX_FS_HZ,
+    ANTSDR_CTRL_RX_GAIN_MDB,     /* Applies in manual gain mode */
+    ANTSDR_CTRL_TX_GAIN_MDB,     /* 0 down to -89750 (attenuation) */
+    ANTSDR_CTRL_RX_GAIN_MODE,    /* manual, slow_attack, fast_attack, hybrid */
+    ANTSDR_CTRL_RX_PORT,         /* A_BALANCED, B_BALANCED, C_BALANCED, A_N, A_P, B_N, B_P, C_N, C_P */
+    ANTSDR_CTRL_TX_PORT,         /* A, B */
+    ANTSDR_CTRL_TX_ENABLE,       /* 0 or 1 */
+    ANTSDR_CTRL_PARAMS,
+};
+
+struct antsdr_ctrl_header {
+    uint32_t magic;              /* ANTSDR_CTRL_MAGIC */
+    uint8_t version;             /* ANTSDR_CTRL_VERSION */
+    uint8_t flags;               /* ANTSDR_CTRL_F_* */
+    uint16_t count;              /* Items that follow */
+    uint32_t session;            /* Client-chosen session id */
+    uint32_t sequence;           /* Request number within the session, from 1 */
+    int32_t status;              /* Reply: 0 if every item was applied */
+} __attribute__((packed));
+
+struct antsdr_ctrl_item {
+    uint16_t param;              /* enum antsdr_ctrl_param */
+    uint16_t flags;              /* ANTSDR_CTRL_ITEM_* */
+    int32_t status;              /* Reply: 0 or -errno */
+    int64_t value;               /* Request: new value, reply: value in force */
+} __attribute__((packed));
+
+#define ANTSDR_CTRL_MAX_ITEMS \
+    ((ANTSDR_CTRL_MAX_DATAGRAM - sizeof(struct antsdr_ctrl_header)) / sizeof(struct antsdr_ctrl_item))
+
+#define antsdr_ctrl_hton64(v) htobe64(v)
+#define antsdr_ctrl_ntoh64(v) be64toh(v)
+
+/* Byte-order helpers - work on unaligned datagram buffers */
+static inline void antsdr_ctrl_get_header(const void *buf, struct antsdr_ctrl_header *hdr)
+{
+    memcpy(hdr, buf, sizeof(*hdr));
+    hdr->magic = ntohl(hdr->magic);
+    hdr->count = ntohs(hdr->count);
+    hdr->session = ntohl(hdr->session);
+    hdr->sequence = ntohl(hdr->sequence);
+    hdr->status = (int32_t)ntohl((uint32_t)hdr->status);
+}
+
+static inline void antsdr_ctrl_put_header(void *buf, const struct antsdr_ctrl_header *hdr)
+{
+    struct antsdr_ctrl_header net = *hdr;
+
+    net.magic = htonl(hdr->magic);
+    net.count = htons(hdr->count);
+    net.session = htonl(hdr->session);
+    net.sequence = htonl(hdr->sequence);
+    net.status = (int32_t)htonl((uint32_t)hdr->status);
+    memcpy(buf, &net, sizeof(net));
+}
+
+static inline void antsdr_ctrl_get_item(const void *buf, struct antsdr_ctrl_item *item)
+{
+    memcpy(item, buf, sizeof(*item));
+    item->param = ntohs(item->param);
+    item->flags = ntohs(item->flags);
+    item->status = (int32_t)ntohl((uint32_t)item->status);
+    item->value = (int64_t)antsdr_ctrl_ntoh64((uint64_t)item->value);
+}
+
+static inline void antsdr_ctrl_put_item(void *buf, const struct antsdr_ctrl_item *item)
+{
+    struct antsdr_ctrl_item net = *item;
+
+    net.param = htons(item->param);
+    net.flags = htons(item->flags);
+    net.status = (int32_t)htonl((uint32_t)item->status);
+    net.value = (int64_t)antsdr_ctrl_hton64((uint64_t)item->value);
+    memcpy(buf, &net, sizeof(net));
+}
+
+#endif /* ANTSDR_CONTROL_H */
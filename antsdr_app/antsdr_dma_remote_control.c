@@ -6,6 +6,7 @@
  * It handles mode changes properly by stopping streaming, changing mode, then restarting.
  */
 
+#define _GNU_SOURCE  /* O_DIRECT for the recorder */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,6 +16,7 @@
 #include <errno.h>
 #include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/select.h>
 #include <sys/time.h>
 #include <arpa/inet.h>
@@ -27,8 +29,12 @@
 // Note: Using sysfs direct access for compatibility
 #include <stdbool.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <math.h>
 
+#include "antsdr_control.h"
+#include "antsdr_capture.h"
+
 /* ANTSDR packet protocol definitions */
 #define ANTSDR_PROTOCOL_VERSION     1
 #define ANTSDR_PACKET_START_MARKER  0xABCD1234
@@ -88,6 +94,8 @@ struct antsdr_packet_header {
 #define FILTER_FIR_TX_PATH AD9361_PHY_PATH "/out_voltage_filter_fir_en"
 #define DCXO_TUNE_COARSE_PATH AD9361_PHY_PATH "/dcxo_tune_coarse"
 #define DCXO_TUNE_FINE_PATH AD9361_PHY_PATH "/dcxo_tune_fine"
+#define RX_LO_FASTLOCK_STORE_PATH AD9361_PHY_PATH "/out_altvoltage0_RX_LO_fastlock_store"
+#define RX_LO_FASTLOCK_RECALL_PATH AD9361_PHY_PATH "/out_altvoltage0_RX_LO_fastlock_recall"
 
 // Available options paths (read-only)
 #define RX_RF_PORT_AVAILABLE_PATH AD9361_PHY_PATH "/in_voltage0_rf_port_select_available"
@@ -101,6 +109,27 @@ struct antsdr_packet_header {
 #define ANTSDR_IOC_START_STREAMING  _IO(ANTSDR_IOC_MAGIC, 1)
 #define ANTSDR_IOC_STOP_STREAMING   _IO(ANTSDR_IOC_MAGIC, 2)
 #define ANTSDR_IOC_SET_UDP_DEST     _IOW(ANTSDR_IOC_MAGIC, 3, struct antsdr_udp_dest)
+#define ANTSDR_IOC_SET_AGGREGATION  _IOW(ANTSDR_IOC_MAGIC, 14, struct antsdr_aggregation)
+#define ANTSDR_IOC_SET_POLL_MODE    _IOW(ANTSDR_IOC_MAGIC, 15, struct antsdr_poll_config)
+#define ANTSDR_IOC_SET_GEOMETRY     _IOW(ANTSDR_IOC_MAGIC, 16, struct antsdr_geometry)
+#define ANTSDR_IOC_GET_GEOMETRY     _IOR(ANTSDR_IOC_MAGIC, 17, struct antsdr_geometry)
+#define ANTSDR_IOC_SET_HEADER       _IOW(ANTSDR_IOC_MAGIC, 18, struct antsdr_header_config)
+#define ANTSDR_IOC_ADD_UDP_DEST     _IOW(ANTSDR_IOC_MAGIC, 19, struct antsdr_udp_dest_cfg)
+#define ANTSDR_IOC_DEL_UDP_DEST     _IOW(ANTSDR_IOC_MAGIC, 20, struct antsdr_udp_dest_cfg)
+#define ANTSDR_IOC_GET_UDP_DESTS    _IOR(ANTSDR_IOC_MAGIC, 21, struct antsdr_udp_dest_list)
+#define ANTSDR_IOC_SET_CHECKSUM     _IOW(ANTSDR_IOC_MAGIC, 22, unsigned int)
+#define ANTSDR_IOC_SET_INTEGRATION  _IOW(ANTSDR_IOC_MAGIC, 23, struct antsdr_integration)
+#define ANTSDR_IOC_SET_COMPRESSION  _IOW(ANTSDR_IOC_MAGIC, 24, unsigned int)
+#define ANTSDR_IOC_GET_LATENCY      _IOR(ANTSDR_IOC_MAGIC, 25, struct antsdr_latency_stats)
+#define ANTSDR_IOC_START_BENCH      _IOW(ANTSDR_IOC_MAGIC, 26, struct antsdr_bench_config)
+#define ANTSDR_IOC_GET_BENCH        _IOR(ANTSDR_IOC_MAGIC, 27, struct antsdr_bench_result)
+#define ANTSDR_IOC_SET_LO_PROFILE   _IOWR(ANTSDR_IOC_MAGIC, 28, struct antsdr_lo_profile)
+#define ANTSDR_IOC_SET_SCHEDULE     _IOW(ANTSDR_IOC_MAGIC, 29, struct antsdr_schedule)
+#define ANTSDR_IOC_GET_SCHEDULE     _IOR(ANTSDR_IOC_MAGIC, 30, struct antsdr_sched_status)
+#define ANTSDR_IOC_SET_PACING       _IOW(ANTSDR_IOC_MAGIC, 31, struct antsdr_pacing)
+#define ANTSDR_IOC_GET_PACING       _IOR(ANTSDR_IOC_MAGIC, 32, struct antsdr_pacing_status)
+#define ANTSDR_IOC_SET_RAW_TX       _IOW(ANTSDR_IOC_MAGIC, 33, struct antsdr_raw_tx)
+#define ANTSDR_IOC_GET_RAW_TX       _IOR(ANTSDR_IOC_MAGIC, 34, struct antsdr_raw_tx_status)
 #define ANTSDR_IOC_GET_STATS        _IOR(ANTSDR_IOC_MAGIC, 4, struct antsdr_dma_stats)
 #define ANTSDR_IOC_SET_BUFFER_SIZE  _IOW(ANTSDR_IOC_MAGIC, 5, unsigned int)
 #define ANTSDR_IOC_GET_BUFFER_SIZE  _IOR(ANTSDR_IOC_MAGIC, 6, unsigned int)
@@ -161,8 +190,6 @@ struct rf_config {
 };
 
 // Function declarations
-static int write_sysfs_string(const char *path, const char *value);
-static int write_sysfs_longlong(const char *path, long long value);
 static int read_sysfs_string(const char *path, char *buffer, size_t size);
 int configure_rf_parameters(struct rf_config *cfg);
 int verify_rf_parameters(struct rf_config *cfg);
@@ -173,15 +200,266 @@ struct antsdr_udp_dest {
     unsigned short port;
 };
 
+/* Fan-out destinations - matches driver */
+#define ANTSDR_MAX_UDP_DESTS 4
+
+struct antsdr_udp_dest_cfg {
+    unsigned int ip;                /* IPv4 address, network order - unicast or multicast */
+    unsigned short port;
+    unsigned char ttl;              /* Multicast TTL, 0 = 1 */
+    unsigned char reserved;
+};
+
+struct antsdr_udp_dest_info {
+    unsigned int ip;
+    unsigned short port;
+    unsigned short multicast;
+    uint32_t sequence;              /* Next sequence number for this destination */
+    uint32_t raw;                   /* On the raw Ethernet path */
+    uint64_t packets;               /* Datagrams sent */
+    uint64_t drops;                 /* Datagrams the socket refused */
+};
+
+struct antsdr_udp_dest_list {
+    unsigned int count;
+    unsigned int reserved;
+    struct antsdr_udp_dest_info dests[ANTSDR_MAX_UDP_DESTS];
+};
+
+/* Frame aggregation settings - matches driver */
+struct antsdr_aggregation {
+    unsigned int enable;            /* 0 = one frame per datagram */
+    unsigned int mtu;               /* Link MTU the datagrams must fit, 0 = 1500 */
+    unsigned int flush_timeout_us;  /* Max time a frame waits for its datagram to fill, up to 1 s */
+};
+
+/* Adaptive completion polling settings - matches driver */
+struct antsdr_poll_config {
+    unsigned int enable;            /* 0 = always interrupt-driven */
+    unsigned int enter_fps;         /* Switch to polling at or above this frame rate */
+    unsigned int exit_fps;          /* Switch back to interrupts below this frame rate */
+    unsigned int poll_interval_us;  /* Time between polls */
+};
+
+/* Buffer geometry - matches driver, zero fields are left unchanged */
+struct antsdr_geometry {
+    unsigned int dma_pool_kb;       /* DMA pool size in KB */
+    unsigned int ring_kb;           /* Ring arena size in KB, power of two */
+    unsigned int raw_fifo_depth;    /* Raw frame FIFO depth in frames, power of two */
+    unsigned int dma_buffers;       /* GET only: pool slots at the current pulse mode */
+};
+
+/* Packet header settings - matches driver */
+struct antsdr_header_config {
+    unsigned int version;           /* 1 or 2 (v2 adds timestamp_ns and the FPGA frame counter) */
+    unsigned int clock;             /* 0 = monotonic, 1 = realtime, 2 = TAI */
+};
+
+/* Pulse integration settings - matches driver */
+struct antsdr_integration {
+    unsigned int mode;              /* 0 = off, 1 = coherent mean I/Q, 2 = incoherent mean power */
+    unsigned int frames;            /* Frames integrated per result (1-256) */
+    unsigned int decimation;        /* Samples averaged per output sample (1-50) */
+    unsigned int reserved;
+};
+
 /* DMA statistics structure - matches driver */
 struct antsdr_dma_stats {
-    unsigned long transfers_completed;
-    unsigned long bytes_transferred;
-    unsigned long udp_packets_sent;
-    unsigned long errors;
-    unsigned long valid_frames;
-    unsigned long invalid_frames;
-    unsigned long extracted_frames;
+    uint64_t transfers_completed;
+    uint64_t bytes_transferred;
+    uint64_t udp_packets_sent;
+    uint64_t errors;
+    uint64_t valid_frames;
+    uint64_t invalid_frames;
+    uint64_t extracted_frames;
+    uint64_t fast_path_frames;
+    uint64_t slow_path_frames;
+    uint64_t resync_events;
+    uint64_t resync_frames;
+    uint64_t resync_dropped_words;
+    uint64_t resync_last_ns;
+    uint64_t resync_max_ns;
+    uint64_t udp_overruns;
+    uint64_t read_overruns;
+    uint64_t mmap_overruns;
+    uint64_t irq_mode_ns;
+    uint64_t poll_mode_ns;
+    uint64_t poll_mode_switches;
+    uint64_t frame_rate;
+    uint64_t pulse_switches;
+    uint64_t pulse_switch_last_ns;
+    uint64_t pulse_switch_max_ns;
+    uint64_t integrated_frames;
+    uint64_t integrated_outputs;
+    uint64_t compress_in_bytes;
+    uint64_t compress_out_bytes;
+    uint64_t compress_ns;
+    uint64_t drops_fifo_full;
+    uint64_t drops_ring_full;
+    uint64_t drops_alloc_fail;
+    uint64_t drops_invalid;
+    uint64_t drops_send_error;
+    uint64_t fifo_high_water;
+    uint64_t ring_high_water;
+    uint64_t ring_bytes_high_water;
+};
+
+/* Latency histograms, must match the driver: log2 ns buckets */
+#define ANTSDR_LAT_BUCKETS  32
+#define ANTSDR_LAT_STAGES   4
+
+struct antsdr_latency_hist {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[ANTSDR_LAT_BUCKETS];
+};
+
+struct antsdr_latency_stats {
+    struct antsdr_latency_hist stage[ANTSDR_LAT_STAGES];
+};
+
+/* Loopback benchmark, must match the driver */
+#define ANTSDR_BENCH_MAX_RATE   2000000
+#define ANTSDR_DROP_REASONS     5   /* fifo_full, ring_full, alloc_fail, invalid, send_error */
+
+struct antsdr_bench_config {
+    uint32_t rate;             /* Frames per second */
+    uint32_t duration_ms;      /* 0 = until stopped */
+};
+
+struct antsdr_bench_result {
+    uint32_t running;
+    uint32_t rate;
+    uint64_t elapsed_ns;
+    uint64_t frames_generated;
+    uint64_t frames_missed;
+    uint64_t frames_valid;
+    uint64_t packets_sent;
+    uint64_t drops[ANTSDR_DROP_REASONS];
+    uint64_t udp_overruns;
+    uint64_t gen_cpu_ns;
+    uint64_t parse_cpu_ns;
+    uint64_t send_cpu_ns;
+};
+
+/* Fastlock LO profile tag, must match the driver */
+#define ANTSDR_LO_PROFILES      8
+#define ANTSDR_LO_TAG_VALID     0x8
+#define ANTSDR_LO_QUERY         0
+#define ANTSDR_LO_BEGIN         1
+#define ANTSDR_LO_END           2
+#define ANTSDR_LO_CLEAR         3
+
+struct antsdr_lo_profile {
+    uint32_t phase;            /* ANTSDR_LO_* */
+    uint32_t profile;          /* END: profile now in force */
+    uint32_t frame_counter;    /* Out: last FPGA frame counter parsed */
+    uint32_t tag;              /* Out: tag for frames captured from now on */
+    uint64_t timestamp_ns;     /* Out: driver capture clock */
+};
+
+/* Pre-armed mode schedule, must match the driver */
+#define ANTSDR_SCHED_MAX_ENTRIES    128
+#define ANTSDR_SCHED_KEEP           0xff
+#define ANTSDR_SCHED_BY_TIME        0x1
+#define ANTSDR_SCHED_REPEAT         0x2
+
+struct antsdr_sched_entry {
+    uint64_t at;               /* Frames or ns into the pass */
+    uint8_t pulse_mode;        /* 0, 1 or ANTSDR_SCHED_KEEP */
+    uint8_t tdd_mode;
+    uint8_t lo_profile;        /* Fastlock slot or ANTSDR_SCHED_KEEP */
+    uint8_t reserved[5];
+};
+
+struct antsdr_schedule {
+    uint32_t flags;
+    uint32_t count;
+    uint64_t period;
+    struct antsdr_sched_entry entries[ANTSDR_SCHED_MAX_ENTRIES];
+};
+
+struct antsdr_sched_status {
+    uint32_t armed;
+    uint32_t flags;
+    uint32_t count;
+    uint32_t next;
+    uint64_t position;
+    uint64_t passes;
+    uint64_t applied;
+    uint64_t late;
+    uint64_t max_late;
+    uint32_t errors;
+    uint32_t pulse_mode;
+    uint32_t lo_profile;
+    uint32_t queue_depth;
+};
+
+// Send pacing and backpressure - zero fields take the driver defaults
+struct antsdr_pacing {
+    uint32_t rate_kbps;          // Egress cap over all destinations, 0 = unlimited
+    uint32_t burst_bytes;
+    uint32_t max_backoff_us;     // Retry budget when the socket or NIC queue is full
+    uint32_t overload_high_pct;  // UDP backlog raising the overload event
+    uint32_t overload_low_pct;   // UDP backlog clearing it
+    uint32_t reserved[3];
+};
+
+struct antsdr_pacing_status {
+    struct antsdr_pacing config;
+    uint32_t overloaded;
+    uint32_t backlog_pct;        // Ring arena, or DMA pool with zero_copy=1
+    uint64_t overload_events;
+    uint64_t paced_ns;
+    uint64_t backoffs;
+    uint64_t backoff_ns;
+    uint64_t backoff_drops;
+};
+
+// Raw Ethernet transmit - pre-built Ethernet/IP/UDP headers, bypassing the kernel UDP stack
+#define ANTSDR_RAW_TX_QDISC_BYPASS  0x1
+
+struct antsdr_raw_tx {
+    uint32_t enable;
+    uint32_t flags;
+};
+
+struct antsdr_raw_tx_status {
+    uint32_t enable;
+    uint32_t flags;
+    uint32_t dests;              // Destinations on the raw path now
+    uint32_t reserved;
+    uint64_t packets;
+    uint64_t fallbacks;          // Sent through the socket instead (unresolved, too large)
+    uint64_t errors;
+};
+
+/* mmap() layout of a channel's ring: this control page, then the record
+ * arena at data_offset (see the driver).
+ */
+#define ANTSDR_RING_CTRL_MAGIC      0x52494E47
+#define ANTSDR_RING_CTRL_VERSION    3   // 3: records carry lo_tag, 2: timestamp_ns only
+#define ANTSDR_RING_REC_PAD         0x1   // Filler up to the end of the arena
+
+struct antsdr_ring_ctrl {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t data_offset;
+    uint32_t data_size;          // Power of two
+    uint32_t record_align;
+    uint32_t head;               // Producer offset, free-running
+    uint32_t user_tail;          // Our offset, free-running
+    uint32_t dropped;
+    uint32_t tail;               // Oldest live record
+};
+
+struct antsdr_ring_record {
+    uint32_t size;
+    uint32_t flags;              // ANTSDR_RING_REC_*
+    uint32_t frame_counter;
+    uint32_t lo_tag;             // 0x8 | fastlock profile, 0 = none (always 0 from a version 2 driver)
+    uint64_t timestamp_ns;
 };
 
 typedef enum {
@@ -209,6 +487,24 @@ static uint32_t current_tdd_mode = 0;
 static struct sockaddr_in current_dest = {0};
 static int dest_configured = 0;
 
+/* Board channels, one device node per RX path (/dev/antsdr_dma,
+ * /dev/antsdr_dma1). Stream commands act on the selected channel; set_channel
+ * parks its stream state here and swaps in the other one's, so both can
+ * stream at once.
+ */
+#define MAX_CHANNELS 2
+
+struct channel_ctx {
+    int fd;                           /* -1 = not on this board */
+    app_state_t state;
+    struct sockaddr_in dest;
+    int dest_configured;
+    uint32_t buffer_size;
+};
+
+static struct channel_ctx channels[MAX_CHANNELS];
+static int current_channel;
+
 // RF configuration via sysfs
 static struct rf_config rf_cfg = {
     .rx_bw_hz = MHZ(15),         // 15 MHz RX bandwidth
@@ -255,257 +551,1253 @@ static void signal_handler(int signo)
     }
     pthread_mutex_unlock(&state_mutex);
     
-    cleanup_rf_context();  // Clean up on signal
+    // main() cleans up the RF context once the other threads are gone
 }
 
-// Function to configure AD9361 RF parameters via sysfs
-int configure_rf_parameters(struct rf_config *cfg) {
-    char value_str[64];
-    
-    printf("Configuring AD9361 RF parameters:\n");
-    
-    // Configure RX LO frequency
-    snprintf(value_str, sizeof(value_str), "%lld", cfg->rx_lo_hz);
-    if (write_sysfs_string(RX_LO_PATH, value_str) < 0) {
-        printf("Failed to set RX LO frequency\n");
-        return -1;
+/* RF control layer: every AD9361 attribute the app drives is opened once
+ * and kept open, values go out with pwrite()/pread() at offset 0, and a
+ * shadow of what the hardware last accepted lets a configure skip every
+ * attribute whose value has not changed. Only the attributes written by a
+ * configure need verifying afterwards.
+ */
+enum rf_attr {
+    RF_RX_LO,
+    RF_TX_LO,
+    RF_RX_BW,
+    RF_RX_FS,
+    RF_RX_PORT,
+    RF_RX_GAIN_MODE,
+    RF_RX_GAIN,
+    RF_TX_BW,
+    RF_TX_FS,
+    RF_TX_PORT,
+    RF_TX_GAIN,
+    RF_ENSM,
+    RF_RX_FASTLOCK_STORE,
+    RF_RX_FASTLOCK_RECALL,
+    RF_ATTRS,
+};
+
+enum rf_kind { RF_KIND_HZ, RF_KIND_DB, RF_KIND_STR, RF_KIND_TRIGGER };
+
+struct rf_attr_desc {
+    const char *name;
+    const char *path;
+    enum rf_kind kind;
+    int mirror;          /* Attribute the driver sets to the same value, or -1 */
+    int invalidates;     /* Attribute left unknown by a write, or -1 */
+};
+
+static const struct rf_attr_desc rf_attrs[RF_ATTRS] = {
+    [RF_RX_LO]        = { "RX LO Frequency", RX_LO_PATH,            RF_KIND_HZ,  -1,       -1 },
+    [RF_TX_LO]        = { "TX LO Frequency", TX_LO_PATH,            RF_KIND_HZ,  -1,       -1 },
+    [RF_RX_BW]        = { "RX Bandwidth",    RX0_RF_BW_PATH,        RF_KIND_HZ,  -1,       -1 },
+    /* RX and TX share one clock chain: setting either rate sets both */
+    [RF_RX_FS]        = { "RX Sample Rate",  RX0_SAMPLE_RATE_PATH,  RF_KIND_HZ,  RF_TX_FS, -1 },
+    [RF_RX_PORT]      = { "RX RF Port",      RX0_RF_PORT_PATH,      RF_KIND_STR, -1,       -1 },
+    /* Leaving an AGC mode keeps whatever gain the AGC had reached */
+    [RF_RX_GAIN_MODE] = { "RX Gain Mode",    RX0_GAIN_CONTROL_PATH, RF_KIND_STR, -1,       RF_RX_GAIN },
+    [RF_RX_GAIN]      = { "RX Gain",         RX0_HARDWAREGAIN_PATH, RF_KIND_DB,  -1,       -1 },
+    [RF_TX_BW]        = { "TX Bandwidth",    TX0_RF_BW_PATH,        RF_KIND_HZ,  -1,       -1 },
+    [RF_TX_FS]        = { "TX Sample Rate",  TX0_SAMPLE_RATE_PATH,  RF_KIND_HZ,  RF_RX_FS, -1 },
+    [RF_TX_PORT]      = { "TX RF Port",      TX0_RF_PORT_PATH,      RF_KIND_STR, -1,       -1 },
+    [RF_TX_GAIN]      = { "TX Gain",         TX0_HARDWAREGAIN_PATH, RF_KIND_DB,  -1,       -1 },
+    [RF_ENSM]         = { "ENSM Mode",       ENSM_MODE_PATH,        RF_KIND_STR, -1,       -1 },
+    /* Write-only actions, never shadowed */
+    [RF_RX_FASTLOCK_STORE]  = { "RX Fastlock Store",  RX_LO_FASTLOCK_STORE_PATH,  RF_KIND_TRIGGER, -1, -1 },
+    [RF_RX_FASTLOCK_RECALL] = { "RX Fastlock Recall", RX_LO_FASTLOCK_RECALL_PATH, RF_KIND_TRIGGER, -1, -1 },
+};
+
+#define RF_ALL_ATTRS ((1u << RF_ATTRS) - 1)
+
+static int rf_fds[RF_ATTRS] = { [0 ... RF_ATTRS - 1] = -1 };
+static char rf_shadow[RF_ATTRS][64];   /* Last value the hardware accepted, "" = unknown */
+static pthread_mutex_t rf_mutex = PTHREAD_MUTEX_INITIALIZER;  /* fds and shadow, shared with the hop thread */
+static int lo_active = -1;             /* Fastlock profile the RX LO is on, -1 = none; under rf_mutex */
+
+/* Outcome of the last configure, reported by configure_rf */
+struct rf_apply_result {
+    unsigned int written;     /* Attribute mask actually written */
+    int writes;
+    int unchanged;            /* Skipped, shadow already held the value */
+    int mismatches;           /* Verified attributes that read back differently */
+    double elapsed_us;        /* Writes plus verification */
+};
+
+static struct rf_apply_result rf_last;
+static struct timespec rf_apply_start;
+
+static int rf_attr_fd(enum rf_attr attr)
+{
+    if (rf_fds[attr] < 0) {
+        rf_fds[attr] = open(rf_attrs[attr].path, O_RDWR | O_CLOEXEC);
+        if (rf_fds[attr] < 0)
+            printf("ERROR: Cannot open %s: %s\n", rf_attrs[attr].path, strerror(errno));
     }
-    printf("Set RX LO frequency: %lld Hz\n", cfg->rx_lo_hz);
-    
-    // Configure TX LO frequency  
-    snprintf(value_str, sizeof(value_str), "%lld", cfg->tx_lo_hz);
-    if (write_sysfs_string(TX_LO_PATH, value_str) < 0) {
-        printf("Failed to set TX LO frequency\n");
-        return -1;
+    return rf_fds[attr];
+}
+
+/* Forget what the hardware holds - the next configure writes everything */
+static void rf_invalidate(void)
+{
+    pthread_mutex_lock(&rf_mutex);
+    memset(rf_shadow, 0, sizeof(rf_shadow));
+    pthread_mutex_unlock(&rf_mutex);
+}
+
+static void rf_close(void)
+{
+    pthread_mutex_lock(&rf_mutex);
+    for (int i = 0; i < RF_ATTRS; i++) {
+        if (rf_fds[i] >= 0) {
+            close(rf_fds[i]);
+            rf_fds[i] = -1;
+        }
     }
-    printf("Set TX LO frequency: %lld Hz\n", cfg->tx_lo_hz);
-    
-    // Configure RX bandwidth
-    snprintf(value_str, sizeof(value_str), "%lld", cfg->rx_bw_hz);
-    if (write_sysfs_string(RX0_RF_BW_PATH, value_str) < 0) {
-        printf("Failed to set RX bandwidth\n");
-        return -1;
+    pthread_mutex_unlock(&rf_mutex);
+    rf_invalidate();
+}
+
+/* Tell the driver where the RX LO stands so frames carry the right profile
+ * tag. Without driver support frames simply stay untagged.
+ */
+static void lo_tag_phase(uint32_t phase, uint32_t profile, struct antsdr_lo_profile *out)
+{
+    struct antsdr_lo_profile lp = { .phase = phase, .profile = profile };
+
+    if (ioctl(device_fd, ANTSDR_IOC_SET_LO_PROFILE, &lp) < 0)
+        memset(&lp, 0, sizeof(lp));
+    if (out)
+        *out = lp;
+
+    // Both RX paths share the RX LO - tag the other channels' frames too
+    for (int i = 0; i < MAX_CHANNELS; i++) {
+        struct antsdr_lo_profile other = { .phase = phase, .profile = profile };
+
+        if (channels[i].fd >= 0 && channels[i].fd != device_fd)
+            ioctl(channels[i].fd, ANTSDR_IOC_SET_LO_PROFILE, &other);
     }
-    printf("Set RX bandwidth: %lld Hz\n", cfg->rx_bw_hz);
-    
-    // Configure RX sample rate
-    snprintf(value_str, sizeof(value_str), "%lld", cfg->rx_fs_hz);
-    if (write_sysfs_string(RX0_SAMPLE_RATE_PATH, value_str) < 0) {
-        printf("Failed to set RX sample rate\n");
+}
+
+/* Caller holds rf_mutex */
+static int rf_pwrite(enum rf_attr attr, const char *value)
+{
+    size_t len = strlen(value);
+    int fd = rf_attr_fd(attr);
+
+    if (fd < 0)
         return -1;
-    }
-    printf("Set RX sample rate: %lld Hz\n", cfg->rx_fs_hz);
-    
-    // Configure RX port
-    if (write_sysfs_string(RX0_RF_PORT_PATH, cfg->rx_rfport) < 0) {
-        printf("Failed to set RX port\n");
+    if (pwrite(fd, value, len, 0) != (ssize_t)len) {
+        printf("ERROR: Failed to write '%s' to %s: %s\n", value, rf_attrs[attr].path, strerror(errno));
         return -1;
     }
-    printf("Set RX port: %s\n", cfg->rx_rfport);
-    
-    // Configure RX gain mode
-    if (write_sysfs_string(RX0_GAIN_CONTROL_PATH, cfg->rx_gain_mode) < 0) {
-        printf("Failed to set RX gain mode\n");
+    return 0;
+}
+
+static int rf_read(enum rf_attr attr, char *buffer, size_t size)
+{
+    ssize_t n = -1;
+    int fd;
+
+    pthread_mutex_lock(&rf_mutex);
+    fd = rf_attr_fd(attr);
+    if (fd >= 0)
+        n = pread(fd, buffer, size - 1, 0);
+    pthread_mutex_unlock(&rf_mutex);
+    if (n < 0) {
+        if (fd >= 0)
+            printf("ERROR: Failed to read from %s: %s\n", rf_attrs[attr].path, strerror(errno));
         return -1;
     }
-    printf("Set RX gain mode: %s\n", cfg->rx_gain_mode);
-    
-    // Configure RX gain (if in manual mode)
-    if (strcmp(cfg->rx_gain_mode, "manual") == 0) {
-        snprintf(value_str, sizeof(value_str), "%.2f", cfg->rx_gain_db);
-        if (write_sysfs_string(RX0_HARDWAREGAIN_PATH, value_str) < 0) {
-            printf("Failed to set RX gain\n");
-            return -1;
-        }
-        printf("Set RX gain: %.2f dB\n", cfg->rx_gain_db);
-    }
-    
-    // Configure TX bandwidth
-    snprintf(value_str, sizeof(value_str), "%lld", cfg->tx_bw_hz);
-    if (write_sysfs_string(TX0_RF_BW_PATH, value_str) < 0) {
-        printf("Failed to set TX bandwidth\n");
-        return -1;
+    while (n > 0 && buffer[n - 1] == '\n')
+        n--;
+    buffer[n] = '\0';
+    return 0;
+}
+
+static int rf_write(enum rf_attr attr, const char *value)
+{
+    int ret;
+
+    pthread_mutex_lock(&rf_mutex);
+    if (strcmp(rf_shadow[attr], value) == 0) {
+        pthread_mutex_unlock(&rf_mutex);
+        rf_last.unchanged++;
+        return 0;
     }
-    printf("Set TX bandwidth: %lld Hz\n", cfg->tx_bw_hz);
-    
-    // Configure TX sample rate
-    snprintf(value_str, sizeof(value_str), "%lld", cfg->tx_fs_hz);
-    if (write_sysfs_string(TX0_SAMPLE_RATE_PATH, value_str) < 0) {
-        printf("Failed to set TX sample rate\n");
-        return -1;
+
+    /* A full relock takes the LO off any fastlock profile */
+    if (attr == RF_RX_LO)
+        lo_tag_phase(ANTSDR_LO_BEGIN, 0, NULL);
+    ret = rf_pwrite(attr, value);
+    if (attr == RF_RX_LO) {
+        lo_tag_phase(ANTSDR_LO_CLEAR, 0, NULL);
+        lo_active = -1;
     }
-    printf("Set TX sample rate: %lld Hz\n", cfg->tx_fs_hz);
-    
-    // Configure TX port
-    if (write_sysfs_string(TX0_RF_PORT_PATH, cfg->tx_rfport) < 0) {
-        printf("Failed to set TX port\n");
+    if (ret < 0) {
+        rf_shadow[attr][0] = '\0';
+        pthread_mutex_unlock(&rf_mutex);
         return -1;
     }
-    printf("Set TX port: %s\n", cfg->tx_rfport);
-    
-    // Configure TX gain
-    snprintf(value_str, sizeof(value_str), "%.2f", cfg->tx_gain_db);
-    if (write_sysfs_string(TX0_HARDWAREGAIN_PATH, value_str) < 0) {
-        printf("Failed to set TX gain\n");
-        return -1;
+
+    snprintf(rf_shadow[attr], sizeof(rf_shadow[attr]), "%s", value);
+    if (rf_attrs[attr].mirror >= 0)
+        snprintf(rf_shadow[rf_attrs[attr].mirror], sizeof(rf_shadow[0]), "%s", value);
+    if (rf_attrs[attr].invalidates >= 0)
+        rf_shadow[rf_attrs[attr].invalidates][0] = '\0';
+    pthread_mutex_unlock(&rf_mutex);
+    rf_last.written |= 1u << attr;
+    rf_last.writes++;
+    return 0;
+}
+
+static int rf_write_longlong(enum rf_attr attr, long long value)
+{
+    char str_value[32];
+    snprintf(str_value, sizeof(str_value), "%lld", value);
+    return rf_write(attr, str_value);
+}
+
+static int rf_write_gain(enum rf_attr attr, double gain_db)
+{
+    char str_value[32];
+    snprintf(str_value, sizeof(str_value), "%.2f", gain_db);
+    return rf_write(attr, str_value);
+}
+
+static void rf_begin(void)
+{
+    memset(&rf_last, 0, sizeof(rf_last));
+    clock_gettime(CLOCK_MONOTONIC, &rf_apply_start);
+}
+
+static void rf_end(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    rf_last.elapsed_us = (now.tv_sec - rf_apply_start.tv_sec) * 1e6 +
+                         (now.tv_nsec - rf_apply_start.tv_nsec) / 1e3;
+}
+
+/* Read back the attributes in mask and compare against what was asked for */
+static int rf_verify(unsigned int mask)
+{
+    char value[256];
+    int mismatches = 0;
+
+    for (int i = 0; i < RF_ATTRS; i++) {
+        char want[sizeof(rf_shadow[0])];
+        bool ok;
+
+        if (!(mask & (1u << i)) || rf_attrs[i].kind == RF_KIND_TRIGGER)
+            continue;
+        pthread_mutex_lock(&rf_mutex);
+        memcpy(want, rf_shadow[i], sizeof(want));
+        pthread_mutex_unlock(&rf_mutex);
+        if (!want[0])
+            continue;
+        if (rf_read(i, value, sizeof(value)) < 0) {
+            mismatches++;
+            continue;
+        }
+
+        switch (rf_attrs[i].kind) {
+        case RF_KIND_HZ:
+            ok = llabs(atoll(value) - atoll(want)) < 1000;
+            break;
+        case RF_KIND_DB:
+            ok = fabs(atof(value) - atof(want)) < 0.5;
+            break;
+        default:
+            ok = strcmp(value, want) == 0;
+            break;
+        }
+
+        printf("%s: Set=%s, Read=%s %s\n", rf_attrs[i].name, want, value, ok ? "✓" : "✗");
+        if (!ok)
+            mismatches++;
     }
-    printf("Set TX gain: %.2f dB\n", cfg->tx_gain_db);
-    
-    // Configure ENSM mode
-    if (write_sysfs_string(ENSM_MODE_PATH, cfg->ensm_mode) < 0) {
-        printf("Failed to set ENSM mode\n");
+    return mismatches;
+}
+
+// Function to configure AD9361 RF parameters via sysfs
+int configure_rf_parameters(struct rf_config *cfg) {
+    rf_begin();
+
+    if (rf_write_longlong(RF_RX_LO, cfg->rx_lo_hz) < 0 ||
+        rf_write_longlong(RF_TX_LO, cfg->tx_lo_hz) < 0 ||
+        rf_write_longlong(RF_RX_BW, cfg->rx_bw_hz) < 0 ||
+        rf_write_longlong(RF_RX_FS, cfg->rx_fs_hz) < 0 ||
+        rf_write(RF_RX_PORT, cfg->rx_rfport) < 0 ||
+        rf_write(RF_RX_GAIN_MODE, cfg->rx_gain_mode) < 0 ||
+        (strcmp(cfg->rx_gain_mode, "manual") == 0 && rf_write_gain(RF_RX_GAIN, cfg->rx_gain_db) < 0) ||
+        rf_write_longlong(RF_TX_BW, cfg->tx_bw_hz) < 0 ||
+        rf_write_longlong(RF_TX_FS, cfg->tx_fs_hz) < 0 ||
+        rf_write(RF_TX_PORT, cfg->tx_rfport) < 0 ||
+        rf_write_gain(RF_TX_GAIN, cfg->tx_gain_db) < 0 ||
+        rf_write(RF_ENSM, cfg->ensm_mode) < 0) {
+        rf_end();
+        printf("Failed to configure AD9361 RF parameters\n");
         return -1;
     }
-    printf("Set ENSM mode: %s\n", cfg->ensm_mode);
-    
-    // Configure FIR filter (if path exists) - Note: Path may not be available
-    // FIR filter control is typically done through device tree or driver initialization
-    
-    printf("RF parameter configuration complete.\n");
+
+    rf_end();
+    printf("AD9361 RF parameters: %d written, %d unchanged (%.0f us)\n",
+           rf_last.writes, rf_last.unchanged, rf_last.elapsed_us);
     return 0;
 }
 
 // Function to read and verify RF parameters from AD9361
 int verify_rf_parameters(struct rf_config *cfg) {
-    char value[256];
-    long long read_value;
-    
+    unsigned int mask = RF_ALL_ATTRS;
+    int mismatches;
+
     printf("Verifying RF parameters:\n");
-    
-    // Verify RX bandwidth
-    if (read_sysfs_string(RX0_RF_BW_PATH, value, sizeof(value)) == 0) {
-        read_value = atoll(value);
-        printf("RX Bandwidth: Set=%lld Hz, Read=%lld Hz %s\n", 
-               cfg->rx_bw_hz, read_value, 
-               (abs(read_value - cfg->rx_bw_hz) < 1000) ? "✓" : "✗");
+
+    /* The AGC owns the gain outside manual mode */
+    if (strcmp(cfg->rx_gain_mode, "manual") != 0)
+        mask &= ~(1u << RF_RX_GAIN);
+    mismatches = rf_verify(mask);
+
+    printf("Parameter verification complete.\n\n");
+    return mismatches ? -1 : 0;
+}
+
+/* Fastlock frequency hopping. Each RX LO frequency is stored once in one of
+ * the AD9361's fastlock profiles (tune, then fastlock_store) and recalled
+ * later without a synthesizer relock. Every recall is bracketed with
+ * ANTSDR_LO_BEGIN/END so the driver tags each frame with the profile it was
+ * captured on. A hop schedule recalls a list of profiles in turn, one every
+ * dwell_frames FPGA frames.
+ */
+#define HOP_MAX_SLOTS   64
+
+struct hop_schedule {
+    pthread_t thread;
+    bool started;                     /* Thread exists and needs joining */
+    volatile bool running;
+    int slots[HOP_MAX_SLOTS];
+    int nr_slots;
+    uint32_t dwell_frames;
+    uint32_t cycles;                  /* Passes through slots, 0 = until hop_stop */
+    uint32_t cycles_done;
+    uint64_t hops;
+    uint64_t late;                    /* Boundaries missed by a whole dwell, hops skipped */
+};
+
+static long long lo_profiles[ANTSDR_LO_PROFILES];   /* Frequency stored per slot, 0 = empty */
+static unsigned int lo_settle_us;                    /* Extra wait before frames count as on profile */
+static double lo_recall_last_us, lo_recall_max_us;
+static struct hop_schedule hop;
+
+static int lo_store(int slot, long long freq_hz)
+{
+    char value[8];
+    int ret;
+
+    if (rf_write_longlong(RF_RX_LO, freq_hz) < 0)
+        return -1;
+    snprintf(value, sizeof(value), "%d", slot);
+    pthread_mutex_lock(&rf_mutex);
+    ret = rf_pwrite(RF_RX_FASTLOCK_STORE, value);
+    pthread_mutex_unlock(&rf_mutex);
+    if (ret == 0)
+        lo_profiles[slot] = freq_hz;
+
+    // Back to the configured LO
+    if (rf_write_longlong(RF_RX_LO, rf_cfg.rx_lo_hz) < 0)
+        ret = -1;
+    return ret;
+}
+
+static int lo_recall(int slot, struct antsdr_lo_profile *state)
+{
+    struct timespec start, end;
+    char value[8];
+    double us;
+    int ret;
+
+    snprintf(value, sizeof(value), "%d", slot);
+    pthread_mutex_lock(&rf_mutex);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    lo_tag_phase(ANTSDR_LO_BEGIN, 0, NULL);
+    ret = rf_pwrite(RF_RX_FASTLOCK_RECALL, value);
+    if (ret == 0) {
+        if (lo_settle_us)
+            usleep(lo_settle_us);
+        lo_tag_phase(ANTSDR_LO_END, slot, state);
+        lo_active = slot;
+        snprintf(rf_shadow[RF_RX_LO], sizeof(rf_shadow[0]), "%lld", lo_profiles[slot]);
+    } else {
+        // Where the LO ended up is unknown
+        lo_tag_phase(ANTSDR_LO_CLEAR, 0, state);
+        lo_active = -1;
+        rf_shadow[RF_RX_LO][0] = '\0';
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    us = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+    lo_recall_last_us = us;
+    if (us > lo_recall_max_us)
+        lo_recall_max_us = us;
+    pthread_mutex_unlock(&rf_mutex);
+    return ret;
+}
+
+/* Hop thread: follows the frame counter through the driver and recalls the
+ * next profile once dwell_frames frames have gone by. It sleeps through most
+ * of each dwell on a running estimate of the frame period and polls the rest.
+ */
+static void *hop_thread_func(void *arg)
+{
+    struct antsdr_lo_profile lp;
+    struct timespec now, last_time;
+    uint32_t next, last_counter;
+    double frame_ns = 0.0;
+    unsigned int index = 0;
+
+    (void)arg;
+
+    // First hop right away, the others every dwell_frames frames from there
+    if (lo_recall(hop.slots[0], &lp) < 0) {
+        hop.running = false;
+        return NULL;
     }
-    
-    // Verify RX sample rate
-    if (read_sysfs_string(RX0_SAMPLE_RATE_PATH, value, sizeof(value)) == 0) {
-        read_value = atoll(value);
-        printf("RX Sample Rate: Set=%lld Hz, Read=%lld Hz %s\n", 
-               cfg->rx_fs_hz, read_value,
-               (abs(read_value - cfg->rx_fs_hz) < 1000) ? "✓" : "✗");
+    hop.hops = 1;
+    next = lp.frame_counter + hop.dwell_frames;
+    last_counter = lp.frame_counter;
+    clock_gettime(CLOCK_MONOTONIC, &last_time);
+
+    while (hop.running && keep_running) {
+        int32_t remaining;
+        long sleep_us;
+
+        lo_tag_phase(ANTSDR_LO_QUERY, 0, &lp);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (lp.frame_counter != last_counter) {
+            double ns = ((now.tv_sec - last_time.tv_sec) * 1e9 + (now.tv_nsec - last_time.tv_nsec)) /
+                        (uint32_t)(lp.frame_counter - last_counter);
+
+            frame_ns = frame_ns > 0.0 ? (frame_ns * 7.0 + ns) / 8.0 : ns;
+            last_counter = lp.frame_counter;
+            last_time = now;
+        }
+
+        remaining = (int32_t)(next - lp.frame_counter);
+        if (remaining <= 0) {
+            index = (index + 1) % hop.nr_slots;
+            if (index == 0 && hop.cycles && ++hop.cycles_done >= hop.cycles)
+                break;
+            if (lo_recall(hop.slots[index], NULL) < 0)
+                break;
+            hop.hops++;
+            if (-remaining >= (int32_t)hop.dwell_frames) {
+                // More than a dwell behind - restart the grid from here
+                hop.late++;
+                next = lp.frame_counter + hop.dwell_frames;
+            } else {
+                next += hop.dwell_frames;
+            }
+            continue;
+        }
+
+        // No frames yet (not streaming): check back every 10 ms
+        sleep_us = frame_ns > 0.0 ? (long)(remaining * frame_ns / 2000.0) : 10000;
+        if (sleep_us > 10000)
+            sleep_us = 10000;
+        if (sleep_us >= 20)
+            usleep(sleep_us);
     }
-    
-    // Verify RX LO frequency
-    if (read_sysfs_string(RX_LO_PATH, value, sizeof(value)) == 0) {
-        read_value = atoll(value);
-        printf("RX LO Frequency: Set=%lld Hz, Read=%lld Hz %s\n", 
-               cfg->rx_lo_hz, read_value,
-               (abs(read_value - cfg->rx_lo_hz) < 1000) ? "✓" : "✗");
+
+    hop.running = false;
+    return NULL;
+}
+
+static void hop_stop(void)
+{
+    if (!hop.started)
+        return;
+    hop.running = false;
+    pthread_join(hop.thread, NULL);
+    hop.started = false;
+
+    // The LO stays on the last profile recalled
+    if (lo_active >= 0)
+        rf_cfg.rx_lo_hz = lo_profiles[lo_active];
+}
+
+/* Parse "slot,slot,..." into hop.slots - every slot must hold a profile */
+static int hop_parse_slots(const char *list, int *slots, int max)
+{
+    char copy[256];
+    char *tok, *save;
+    int n = 0;
+
+    snprintf(copy, sizeof(copy), "%s", list);
+    for (tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *end;
+        long slot = strtol(tok, &end, 10);
+
+        if (*end || slot < 0 || slot >= ANTSDR_LO_PROFILES || !lo_profiles[slot] || n == max)
+            return -1;
+        slots[n++] = (int)slot;
     }
-    
-    // Verify RX port
-    if (read_sysfs_string(RX0_RF_PORT_PATH, value, sizeof(value)) == 0) {
-        printf("RX RF Port: Set=%s, Read=%s %s\n", 
-               cfg->rx_rfport, value,
-               (strcmp(value, cfg->rx_rfport) == 0) ? "✓" : "✗");
+    return n;
+}
+
+static int hop_start(uint32_t dwell_frames, const char *list, uint32_t cycles)
+{
+    int slots[HOP_MAX_SLOTS];
+    int n = hop_parse_slots(list, slots, HOP_MAX_SLOTS);
+
+    if (n <= 0 || !dwell_frames)
+        return -EINVAL;
+
+    hop_stop();
+    memcpy(hop.slots, slots, sizeof(slots));
+    hop.nr_slots = n;
+    hop.dwell_frames = dwell_frames;
+    hop.cycles = cycles;
+    hop.cycles_done = 0;
+    hop.hops = 0;
+    hop.late = 0;
+    hop.running = true;
+    if (pthread_create(&hop.thread, NULL, hop_thread_func, NULL) != 0) {
+        hop.running = false;
+        return -EAGAIN;
+    }
+    hop.started = true;
+    return 0;
+}
+
+static void format_fastlock(char *out, size_t size)
+{
+    size_t len;
+
+    len = snprintf(out, size, "FASTLOCK: active=%d settle=%uus recall_last=%.0fus recall_max=%.0fus profiles=[",
+                   lo_active, lo_settle_us, lo_recall_last_us, lo_recall_max_us);
+    for (int i = 0; i < ANTSDR_LO_PROFILES && len < size; i++) {
+        if (lo_profiles[i])
+            len += snprintf(out + len, size - len, "%s%d:%lld", out[len - 1] == '[' ? "" : " ",
+                            i, lo_profiles[i]);
+    }
+    if (len < size)
+        len += snprintf(out + len, size - len, "] hop=%s", hop.running ? "running" : "stopped");
+    if (hop.nr_slots && len < size) {
+        len += snprintf(out + len, size - len, " dwell=%u slots=", hop.dwell_frames);
+        for (int i = 0; i < hop.nr_slots && len < size; i++)
+            len += snprintf(out + len, size - len, "%s%d", i ? "," : "", hop.slots[i]);
+        if (len < size)
+            len += snprintf(out + len, size - len, " cycles=%u/%u hops=%" PRIu64 " late=%" PRIu64,
+                            hop.cycles_done, hop.cycles, hop.hops, hop.late);
+    }
+    if (len < size)
+        snprintf(out + len, size - len, "\n");
+}
+
+/* Mode schedule: sched_add stages entries, sched_arm hands the list to the
+ * driver, which switches pulse and TDD modes itself at each frame (or time)
+ * position. The driver can't retune the AD9361, so LO entries are followed
+ * from here: a thread watches the schedule and recalls each fastlock
+ * profile as the driver reaches its entry.
+ */
+static struct antsdr_schedule sched_staged;
+
+static struct {
+    pthread_t thread;
+    bool started;
+    volatile bool running;
+    int fd;                           /* Channel the schedule was armed on */
+    uint64_t recalls;
+} sched_lo;
+
+static void *sched_lo_thread_func(void *arg)
+{
+    struct antsdr_sched_status st;
+    uint32_t reached = ANTSDR_SCHED_KEEP;
+
+    (void)arg;
+
+    while (sched_lo.running && keep_running) {
+        if (ioctl(sched_lo.fd, ANTSDR_IOC_GET_SCHEDULE, &st) < 0)
+            break;
+        if (st.lo_profile != ANTSDR_SCHED_KEEP && st.lo_profile != reached) {
+            if (lo_recall((int)st.lo_profile, NULL) < 0)
+                break;
+            reached = st.lo_profile;
+            sched_lo.recalls++;
+        }
+        if (!st.armed)
+            break;
+        usleep(200);
     }
-    
-    // Verify RX gain mode
-    if (read_sysfs_string(RX0_GAIN_CONTROL_PATH, value, sizeof(value)) == 0) {
-        printf("RX Gain Mode: Set=%s, Read=%s %s\n", 
-               cfg->rx_gain_mode, value,
-               (strcmp(value, cfg->rx_gain_mode) == 0) ? "✓" : "✗");
+
+    sched_lo.running = false;
+    return NULL;
+}
+
+static void sched_lo_stop(void)
+{
+    if (!sched_lo.started)
+        return;
+    sched_lo.running = false;
+    pthread_join(sched_lo.thread, NULL);
+    sched_lo.started = false;
+
+    if (lo_active >= 0)
+        rf_cfg.rx_lo_hz = lo_profiles[lo_active];
+}
+
+/* "-" leaves the field as it is */
+static int sched_field(const char *text, unsigned int max, uint8_t *out)
+{
+    char *end;
+    unsigned long v;
+
+    if (strcmp(text, "-") == 0) {
+        *out = ANTSDR_SCHED_KEEP;
+        return 0;
     }
-    
-    // Verify RX gain (if in manual mode)
-    if (strcmp(cfg->rx_gain_mode, "manual") == 0) {
-        if (read_sysfs_string(RX0_HARDWAREGAIN_PATH, value, sizeof(value)) == 0) {
-            double read_gain = atof(value);
-            printf("RX Gain: Set=%.2f dB, Read=%.2f dB %s\n", 
-                   cfg->rx_gain_db, read_gain,
-                   (fabs(read_gain - cfg->rx_gain_db) < 0.5) ? "✓" : "✗");
+    v = strtoul(text, &end, 10);
+    if (*end || v > max)
+        return -1;
+    *out = (uint8_t)v;
+    return 0;
+}
+
+static int sched_add(uint64_t at, const char *pulse, const char *tdd, const char *lo)
+{
+    struct antsdr_sched_entry *entry;
+
+    if (sched_staged.count == ANTSDR_SCHED_MAX_ENTRIES)
+        return -ENOSPC;
+    if (sched_staged.count && at < sched_staged.entries[sched_staged.count - 1].at)
+        return -ERANGE;
+
+    entry = &sched_staged.entries[sched_staged.count];
+    memset(entry, 0, sizeof(*entry));
+    entry->at = at;
+    if (sched_field(pulse, 1, &entry->pulse_mode) < 0 ||
+        sched_field(tdd, 1, &entry->tdd_mode) < 0 ||
+        sched_field(lo, ANTSDR_LO_PROFILES - 1, &entry->lo_profile) < 0)
+        return -EINVAL;
+    sched_staged.count++;
+    return 0;
+}
+
+static int sched_arm(bool by_time, uint64_t period)
+{
+    bool follow_lo = false;
+
+    if (!sched_staged.count)
+        return -EINVAL;
+    for (uint32_t i = 0; i < sched_staged.count; i++) {
+        uint8_t slot = sched_staged.entries[i].lo_profile;
+
+        if (slot == ANTSDR_SCHED_KEEP)
+            continue;
+        if (current_mode != 0 || !rf_configured)
+            return -ENODEV;
+        if (!lo_profiles[slot])
+            return -ENOENT;
+        follow_lo = true;
+    }
+
+    sched_staged.flags = (by_time ? ANTSDR_SCHED_BY_TIME : 0) | (period ? ANTSDR_SCHED_REPEAT : 0);
+    sched_staged.period = period;
+
+    sched_lo_stop();
+    if (follow_lo)
+        hop_stop();
+    if (ioctl(device_fd, ANTSDR_IOC_SET_SCHEDULE, &sched_staged) < 0)
+        return -errno;
+
+    if (follow_lo) {
+        sched_lo.fd = device_fd;
+        sched_lo.recalls = 0;
+        sched_lo.running = true;
+        if (pthread_create(&sched_lo.thread, NULL, sched_lo_thread_func, NULL) != 0) {
+            sched_lo.running = false;
+            return -EAGAIN;
         }
+        sched_lo.started = true;
     }
-    
-    // Verify TX bandwidth
-    if (read_sysfs_string(TX0_RF_BW_PATH, value, sizeof(value)) == 0) {
-        read_value = atoll(value);
-        printf("TX Bandwidth: Set=%lld Hz, Read=%lld Hz %s\n", 
-               cfg->tx_bw_hz, read_value,
-               (abs(read_value - cfg->tx_bw_hz) < 1000) ? "✓" : "✗");
+    return 0;
+}
+
+static int sched_clear(void)
+{
+    struct antsdr_schedule empty;
+
+    sched_lo_stop();
+    sched_staged.count = 0;
+    memset(&empty, 0, sizeof(empty));
+    if (ioctl(device_fd, ANTSDR_IOC_SET_SCHEDULE, &empty) < 0)
+        return -errno;
+    return 0;
+}
+
+/* get_rf_config reply, also stored as a recording's rf_config */
+static void format_rf_config(char *buf, size_t size)
+{
+    snprintf(buf, size,
+             "RF_CONFIG: RX_FREQ=%lld RX_BW=%lld RX_FS=%lld RX_GAIN_MODE=%s RX_GAIN=%.2f RX_PORT=%s "
+             "TX_FREQ=%lld TX_BW=%lld TX_FS=%lld TX_GAIN=%.2f TX_PORT=%s TX_EN=%d ENSM=%s\n",
+             rf_cfg.rx_lo_hz, rf_cfg.rx_bw_hz, rf_cfg.rx_fs_hz, rf_cfg.rx_gain_mode, rf_cfg.rx_gain_db, rf_cfg.rx_rfport,
+             rf_cfg.tx_lo_hz, rf_cfg.tx_bw_hz, rf_cfg.tx_fs_hz, rf_cfg.tx_gain_db, rf_cfg.tx_rfport,
+             rf_cfg.tx_enabled, rf_cfg.ensm_mode);
+}
+
+/* On-board recorder - the selected channel's frames to local storage (SD,
+ * USB, NVMe) in the antsdr_capture.h format, alongside the UDP stream or
+ * without an uplink. A reader thread follows the ring through the device
+ * mmap() and formats records straight into a staging buffer laid out like
+ * the file; a writer thread appends it in aligned REC_CHUNK_SIZE writes with
+ * O_DIRECT, so the page cache never fills up and flushes in bursts. A storage
+ * stall only fills the staging buffer - the ring overruns once that is full.
+ * The ring is only mappable in copy mode, not with zero_copy=1.
+ */
+#define REC_CHUNK_SIZE      (1 << 20)
+#define REC_DEFAULT_MB      64
+#define REC_MIN_MB          4
+#define REC_MAX_MB          512
+#define REC_HEADER_MS       250       /* Header rewrite interval, bounds what a crash loses */
+
+static struct {
+    pthread_t reader, writer;
+    bool started;
+    volatile bool running;            /* Reader keeps following the ring */
+    bool reader_done;                 /* Under lock */
+    bool reader_waiting;              /* Reader blocked on a full staging buffer, under lock */
+    char path[256];
+    int fd;
+    bool direct;                      /* O_DIRECT writes */
+    int channel;
+    int dev_fd;
+    struct antsdr_ring_ctrl *ctrl;
+    void *map;
+    size_t map_size;
+    uint8_t *buf;                     /* Staging, file offset data_offset + n at buf[n % buf_size] */
+    size_t buf_size;
+    uint8_t *hdr_page;                /* Aligned header page for O_DIRECT */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint64_t head;                    /* File offset up to which records are staged, under lock */
+    uint64_t written;                 /* File offset up to which the file is written, under lock */
+    struct antsdr_capture_header hdr; /* Published by the reader, under lock */
+    struct antsdr_capture_index *index;
+    size_t index_alloc;
+    int error;                        /* First write errno */
+    struct timespec start, stop;
+    uint64_t overruns_base;           /* Driver mmap overruns when recording started */
+    uint64_t lost;                    /* Records overrun while recording */
+    uint64_t writes, write_ns, max_write_ns;
+    uint64_t stalls, stall_ns;        /* Reader waiting for staging space */
+    uint64_t max_fill;                /* Staging high water, bytes */
+} rec = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER, .fd = -1 };
+
+static uint64_t rec_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Copy into the staging buffer at a file offset, wrapping at its end */
+static void rec_put(uint64_t offset, const void *data, size_t len)
+{
+    size_t pos = (offset - ANTSDR_CAPTURE_DATA_OFFSET) % rec.buf_size;
+    size_t first = len < rec.buf_size - pos ? len : rec.buf_size - pos;
+
+    if (data) {
+        memcpy(rec.buf + pos, data, first);
+        memcpy(rec.buf, (const uint8_t *)data + first, len - first);
+    } else {
+        memset(rec.buf + pos, 0, first);
+        memset(rec.buf, 0, len - first);
     }
-    
-    // Verify TX sample rate
-    if (read_sysfs_string(TX0_SAMPLE_RATE_PATH, value, sizeof(value)) == 0) {
-        read_value = atoll(value);
-        printf("TX Sample Rate: Set=%lld Hz, Read=%lld Hz %s\n", 
-               cfg->tx_fs_hz, read_value,
-               (abs(read_value - cfg->tx_fs_hz) < 1000) ? "✓" : "✗");
+}
+
+/* Publish staged records to the writer. Caller holds rec.lock. */
+static void rec_publish_locked(uint64_t head, const struct antsdr_capture_header *hdr)
+{
+    rec.head = head;
+    rec.hdr = *hdr;
+    if (head - rec.written > rec.max_fill)
+        rec.max_fill = head - rec.written;
+    pthread_cond_broadcast(&rec.cond);
+}
+
+/* Wait until the staging buffer can take everything up to 'end'. Returns
+ * false if the recording is being stopped.
+ */
+static bool rec_reserve(uint64_t end, uint64_t head, const struct antsdr_capture_header *hdr)
+{
+    uint64_t start;
+
+    if (end - __atomic_load_n(&rec.written, __ATOMIC_ACQUIRE) <= rec.buf_size)
+        return true;
+
+    start = rec_now_ns();
+    pthread_mutex_lock(&rec.lock);
+    rec_publish_locked(head, hdr);
+    rec.stalls++;
+    rec.reader_waiting = true;
+    while (end - rec.written > rec.buf_size && rec.running && keep_running && !rec.error)
+        pthread_cond_wait(&rec.cond, &rec.lock);
+    rec.reader_waiting = false;
+    rec.stall_ns += rec_now_ns() - start;
+    pthread_mutex_unlock(&rec.lock);
+    return end - rec.written <= rec.buf_size;
+}
+
+static void *rec_reader_func(void *arg)
+{
+    const uint8_t *arena = (const uint8_t *)rec.map + rec.ctrl->data_offset;
+    uint32_t size = rec.ctrl->data_size, align = rec.ctrl->record_align;
+    uint32_t tail = __atomic_load_n(&rec.ctrl->user_tail, __ATOMIC_ACQUIRE);
+    struct antsdr_capture_header hdr = rec.hdr;
+    uint64_t head = rec.head;
+    bool ok = true;
+
+    (void)arg;
+
+    while (ok && rec.running && keep_running) {
+        uint32_t khead = __atomic_load_n(&rec.ctrl->head, __ATOMIC_ACQUIRE);
+        unsigned int batch = 0;
+
+        while (tail != khead && batch < 256) {
+            const struct antsdr_ring_record *r = (const void *)(arena + (tail & (size - 1)));
+            struct antsdr_capture_record cr;
+            struct antsdr_ring_record meta = *r;
+            bool indexed = hdr.frame_count % hdr.index_interval == 0;
+            uint64_t at = indexed ? ANTSDR_CAPTURE_PAGE_UP(head) : head;
+            size_t need = ANTSDR_CAPTURE_ALIGN8(sizeof(cr) + meta.size);
+
+            // Overrun before or while copying: resume at the oldest live record
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if ((int32_t)(__atomic_load_n(&rec.ctrl->tail, __ATOMIC_ACQUIRE) - tail) > 0) {
+                tail = __atomic_load_n(&rec.ctrl->tail, __ATOMIC_ACQUIRE);
+                continue;
+            }
+            if (meta.flags & ANTSDR_RING_REC_PAD) {
+                tail += sizeof(*r) + meta.size;
+                continue;
+            }
+            if (!rec_reserve(at + need, head, &hdr)) {
+                ok = false;
+                break;
+            }
+
+            cr.magic = ANTSDR_CAPTURE_RECORD_MAGIC;
+            cr.length = meta.size;
+            cr.timestamp_ns = meta.timestamp_ns;
+            cr.frame_counter = meta.frame_counter;
+            cr.frame_id = (uint32_t)hdr.frame_count;
+            cr.flags = (uint32_t)rec.channel << ANTSDR_CAPTURE_CHAN_SHIFT |
+                       (meta.lo_tag & 0xf) << ANTSDR_CAPTURE_LO_SHIFT;
+            cr.reserved = 0;
+            rec_put(head, NULL, at - head);
+            rec_put(at, &cr, sizeof(cr));
+            rec_put(at + sizeof(cr), r + 1, meta.size);
+            rec_put(at + sizeof(cr) + meta.size, NULL, need - sizeof(cr) - meta.size);
+
+            // The payload may be torn if the producer lapped us meanwhile
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if ((int32_t)(__atomic_load_n(&rec.ctrl->tail, __ATOMIC_ACQUIRE) - tail) > 0) {
+                tail = __atomic_load_n(&rec.ctrl->tail, __ATOMIC_ACQUIRE);
+                continue;
+            }
+
+            if (indexed) {
+                struct antsdr_capture_index *e;
+
+                if (hdr.index_count == rec.index_alloc) {
+                    size_t n = rec.index_alloc ? rec.index_alloc * 2 : 1024;
+                    void *p = realloc(rec.index, n * sizeof(*rec.index));
+
+                    if (!p) {
+                        ok = false;
+                        break;
+                    }
+                    rec.index = p;
+                    rec.index_alloc = n;
+                }
+                e = &rec.index[hdr.index_count++];
+                e->offset = at;
+                e->frame = hdr.frame_count;
+                e->timestamp_ns = meta.timestamp_ns;
+                e->frame_counter = meta.frame_counter;
+                e->reserved = 0;
+            }
+            if (!hdr.frame_count) {
+                hdr.first_timestamp_ns = meta.timestamp_ns;
+                hdr.first_counter = meta.frame_counter;
+            }
+            hdr.last_timestamp_ns = meta.timestamp_ns;
+            hdr.last_counter = meta.frame_counter;
+            hdr.frame_count++;
+            head = at + need;
+            tail += (sizeof(*r) + meta.size + align - 1) & ~(align - 1);
+            batch++;
+        }
+
+        __atomic_store_n(&rec.ctrl->user_tail, tail, __ATOMIC_RELEASE);
+        pthread_mutex_lock(&rec.lock);
+        rec_publish_locked(head, &hdr);
+        pthread_mutex_unlock(&rec.lock);
+        if (!batch)
+            usleep(500);
     }
-    
-    // Verify TX LO frequency
-    if (read_sysfs_string(TX_LO_PATH, value, sizeof(value)) == 0) {
-        read_value = atoll(value);
-        printf("TX LO Frequency: Set=%lld Hz, Read=%lld Hz %s\n", 
-               cfg->tx_lo_hz, read_value,
-               (abs(read_value - cfg->tx_lo_hz) < 1000) ? "✓" : "✗");
+
+    pthread_mutex_lock(&rec.lock);
+    rec_publish_locked(head, &hdr);
+    rec.reader_done = true;
+    pthread_cond_broadcast(&rec.cond);
+    pthread_mutex_unlock(&rec.lock);
+    return NULL;
+}
+
+static int rec_write_header(const struct antsdr_capture_header *hdr)
+{
+    memset(rec.hdr_page, 0, ANTSDR_CAPTURE_PAGE);
+    memcpy(rec.hdr_page, hdr, sizeof(*hdr));
+    return antsdr_capture_write_all(rec.fd, rec.hdr_page, ANTSDR_CAPTURE_PAGE, 0);
+}
+
+/* Writes whole pages only; the partial tail is left to rec_stop() */
+static void *rec_writer_func(void *arg)
+{
+    struct antsdr_capture_header hdr;
+    uint64_t last_hdr = rec_now_ns();
+
+    (void)arg;
+
+    for (;;) {
+        struct timespec deadline;
+        uint64_t written, avail, t0, t1;
+        size_t pos, n;
+        bool done;
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += REC_HEADER_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_mutex_lock(&rec.lock);
+        while (rec.head - rec.written < REC_CHUNK_SIZE && !rec.reader_done && !rec.reader_waiting &&
+               pthread_cond_timedwait(&rec.cond, &rec.lock, &deadline) == 0)
+            ;
+        written = rec.written;
+        avail = (rec.head - written) & ~(uint64_t)(ANTSDR_CAPTURE_PAGE - 1);
+        done = rec.reader_done;
+        hdr = rec.hdr;
+        pthread_mutex_unlock(&rec.lock);
+
+        pos = (written - ANTSDR_CAPTURE_DATA_OFFSET) % rec.buf_size;
+        n = avail < REC_CHUNK_SIZE ? avail : REC_CHUNK_SIZE;
+        if (n > rec.buf_size - pos)
+            n = rec.buf_size - pos;
+
+        if (n) {
+            t0 = rec_now_ns();
+            if (antsdr_capture_write_all(rec.fd, rec.buf + pos, n, written) < 0) {
+                pthread_mutex_lock(&rec.lock);
+                rec.error = errno;
+                pthread_cond_broadcast(&rec.cond);
+                pthread_mutex_unlock(&rec.lock);
+                break;
+            }
+            t1 = rec_now_ns();
+            rec.writes++;
+            rec.write_ns += t1 - t0;
+            if (t1 - t0 > rec.max_write_ns)
+                rec.max_write_ns = t1 - t0;
+
+            pthread_mutex_lock(&rec.lock);
+            __atomic_store_n(&rec.written, written + n, __ATOMIC_RELEASE);
+            pthread_cond_broadcast(&rec.cond);
+            pthread_mutex_unlock(&rec.lock);
+        } else if (done) {
+            break;
+        }
+
+        // Keep data_end current so a crash loses at most REC_HEADER_MS of data
+        if (rec_now_ns() - last_hdr >= REC_HEADER_MS * 1000000ULL) {
+            hdr.data_end = rec.written;
+            hdr.flags = 0;
+            if (rec_write_header(&hdr) < 0) {
+                rec.error = errno;
+                break;
+            }
+            last_hdr = rec_now_ns();
+        }
     }
-    
-    // Verify TX port
-    if (read_sysfs_string(TX0_RF_PORT_PATH, value, sizeof(value)) == 0) {
-        printf("TX RF Port: Set=%s, Read=%s %s\n", 
-               cfg->tx_rfport, value,
-               (strcmp(value, cfg->tx_rfport) == 0) ? "✓" : "✗");
+    return NULL;
+}
+
+static void rec_release(void)
+{
+    if (rec.map)
+        munmap(rec.map, rec.map_size);
+    if (rec.fd >= 0)
+        close(rec.fd);
+    if (rec.buf)
+        munlock(rec.buf, rec.buf_size);
+    free(rec.buf);
+    free(rec.hdr_page);
+    free(rec.index);
+    rec.map = NULL;
+    rec.fd = -1;
+    rec.buf = NULL;
+    rec.hdr_page = NULL;
+    rec.index = NULL;
+    rec.index_alloc = 0;
+}
+
+static int rec_start(const char *path, unsigned int buffer_mb)
+{
+    struct antsdr_capture_meta meta;
+    struct antsdr_geometry geo;
+    struct antsdr_dma_stats stats;
+    char reply[sizeof(meta.text)];
+    long page = sysconf(_SC_PAGESIZE);
+    struct timespec ts;
+    void *map;
+    int err;
+
+    if (rec.started)
+        return -EBUSY;
+    if (buffer_mb < REC_MIN_MB || buffer_mb > REC_MAX_MB)
+        return -EINVAL;
+
+    if (ioctl(device_fd, ANTSDR_IOC_GET_GEOMETRY, &geo) < 0 ||
+        ioctl(device_fd, ANTSDR_IOC_GET_STATS, &stats) < 0)
+        return -errno;
+
+    // The ring: control page, then the arena - EOPNOTSUPP in zero-copy mode
+    map = mmap(NULL, page + (size_t)geo.ring_kb * 1024, PROT_READ | PROT_WRITE, MAP_SHARED, device_fd, 0);
+    if (map == MAP_FAILED)
+        return -errno;
+
+    // The last recording's figures stay readable until now
+    memset(&rec.hdr, 0, sizeof(rec.hdr));
+    rec.map = map;
+    rec.map_size = page + (size_t)geo.ring_kb * 1024;
+    rec.ctrl = rec.map;
+    rec.dev_fd = device_fd;
+    rec.channel = current_channel;
+    rec.buf_size = (size_t)buffer_mb << 20;
+    rec.head = rec.written = ANTSDR_CAPTURE_DATA_OFFSET;
+    rec.overruns_base = stats.mmap_overruns;
+    rec.error = 0;
+    rec.reader_done = rec.reader_waiting = false;
+    rec.lost = rec.writes = rec.write_ns = rec.max_write_ns = 0;
+    rec.stalls = rec.stall_ns = rec.max_fill = 0;
+    snprintf(rec.path, sizeof(rec.path), "%s", path);
+
+    if (rec.ctrl->magic != ANTSDR_RING_CTRL_MAGIC || rec.ctrl->version < 2 ||
+        rec.ctrl->version > ANTSDR_RING_CTRL_VERSION) {
+        rec_release();
+        return -EPROTO;
     }
-    
-    // Verify TX gain
-    if (read_sysfs_string(TX0_HARDWAREGAIN_PATH, value, sizeof(value)) == 0) {
-        double read_gain = atof(value);
-        printf("TX Gain: Set=%.2f dB, Read=%.2f dB %s\n", 
-               cfg->tx_gain_db, read_gain,
-               (fabs(read_gain - cfg->tx_gain_db) < 0.5) ? "✓" : "✗");
+
+    if (posix_memalign((void **)&rec.buf, ANTSDR_CAPTURE_PAGE, rec.buf_size) != 0 ||
+        posix_memalign((void **)&rec.hdr_page, ANTSDR_CAPTURE_PAGE, ANTSDR_CAPTURE_PAGE) != 0) {
+        rec_release();
+        return -ENOMEM;
+    }
+    // Fault the staging buffer in now, not in the middle of a burst
+    if (mlock(rec.buf, rec.buf_size) < 0)
+        memset(rec.buf, 0, rec.buf_size);
+
+    rec.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (rec.fd < 0) {
+        err = -errno;
+        rec_release();
+        return err;
     }
-    
-    // Verify ENSM mode
-    if (read_sysfs_string(ENSM_MODE_PATH, value, sizeof(value)) == 0) {
-        printf("ENSM Mode: Set=%s, Read=%s %s\n", 
-               cfg->ensm_mode, value,
-               (strcmp(value, cfg->ensm_mode) == 0) ? "✓" : "✗");
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    rec.hdr.magic = ANTSDR_CAPTURE_MAGIC;
+    rec.hdr.version = ANTSDR_CAPTURE_VERSION;
+    rec.hdr.page_size = ANTSDR_CAPTURE_PAGE;
+    rec.hdr.created_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    rec.hdr.meta_offset = ANTSDR_CAPTURE_META_OFFSET;
+    rec.hdr.meta_length = sizeof(meta);
+    rec.hdr.data_offset = ANTSDR_CAPTURE_DATA_OFFSET;
+    rec.hdr.data_end = ANTSDR_CAPTURE_DATA_OFFSET;
+    rec.hdr.index_interval = ANTSDR_CAPTURE_INTERVAL;
+    rec.hdr.source = ANTSDR_CAPTURE_SRC_BOARD;
+
+    format_rf_config(reply, sizeof(reply));
+    antsdr_capture_meta_parse(&meta, reply);
+    if (rec_write_header(&rec.hdr) < 0 ||
+        antsdr_capture_write_all(rec.fd, &meta, sizeof(meta), ANTSDR_CAPTURE_META_OFFSET) < 0) {
+        err = -errno;
+        rec_release();
+        return err;
     }
-    
-    printf("Parameter verification complete.\n\n");
+
+    // Data goes straight to the device where the filesystem allows it
+    rec.direct = fcntl(rec.fd, F_SETFL, fcntl(rec.fd, F_GETFL) | O_DIRECT) == 0;
+
+    rec.running = true;
+    if (pthread_create(&rec.writer, NULL, rec_writer_func, NULL) != 0) {
+        rec_release();
+        return -EAGAIN;
+    }
+    if (pthread_create(&rec.reader, NULL, rec_reader_func, NULL) != 0) {
+        pthread_mutex_lock(&rec.lock);
+        rec.reader_done = true;
+        pthread_cond_broadcast(&rec.cond);
+        pthread_mutex_unlock(&rec.lock);
+        pthread_join(rec.writer, NULL);
+        rec_release();
+        return -EAGAIN;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &rec.start);
+    rec.started = true;
     return 0;
 }
 
-static const char* state_to_string(app_state_t state)
+/* Stop, write the partial last page, the index and the final header */
+static int rec_stop(void)
 {
-    switch (state) {
-        case STATE_STANDBY: return "STANDBY";
-        case STATE_STREAMING: return "STREAMING";
-        case STATE_STOPPING: return "STOPPING";
-        case STATE_CHANGING_MODE: return "CHANGING_MODE";
-        default: return "UNKNOWN";
+    struct antsdr_dma_stats stats;
+    struct antsdr_capture_header hdr;
+    uint64_t tail;
+    int ret = 0;
+
+    if (!rec.started)
+        return -ENOENT;
+
+    rec.running = false;
+    pthread_mutex_lock(&rec.lock);
+    pthread_cond_broadcast(&rec.cond);
+    pthread_mutex_unlock(&rec.lock);
+    pthread_join(rec.reader, NULL);
+    pthread_join(rec.writer, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &rec.stop);
+    rec.started = false;
+
+    if (ioctl(rec.dev_fd, ANTSDR_IOC_GET_STATS, &stats) == 0)
+        rec.lost = stats.mmap_overruns - rec.overruns_base;
+
+    // The rest is small and unaligned - finish through the page cache
+    hdr = rec.hdr;
+    if (rec.direct)
+        fcntl(rec.fd, F_SETFL, fcntl(rec.fd, F_GETFL) & ~O_DIRECT);
+    if (rec.error) {
+        ret = -rec.error;
+    } else {
+        tail = rec.head - rec.written;
+        if (tail) {
+            size_t pos = (rec.written - ANTSDR_CAPTURE_DATA_OFFSET) % rec.buf_size;
+
+            // Never crosses the wrap: the buffer is a whole number of pages
+            if (antsdr_capture_write_all(rec.fd, rec.buf + pos, tail, rec.written) < 0)
+                ret = -errno;
+            else
+                rec.written += tail;
+        }
     }
+
+    hdr.data_end = rec.written;
+    if (ret == 0) {
+        hdr.index_offset = ANTSDR_CAPTURE_PAGE_UP(hdr.data_end);
+        if (antsdr_capture_write_all(rec.fd, rec.index, hdr.index_count * sizeof(*rec.index),
+                                     hdr.index_offset) < 0 || fdatasync(rec.fd) < 0)
+            ret = -errno;
+        else
+            hdr.flags |= ANTSDR_CAPTURE_COMPLETE;
+    }
+    if (rec_write_header(&hdr) < 0 && ret == 0)
+        ret = -errno;
+    rec.hdr = hdr;
+    rec_release();
+    return ret;
 }
 
-// Helper functions for AD9361 control via sysfs
-static int write_sysfs_string(const char *path, const char *value)
+static void format_record(char *out, size_t size)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp) {
-        printf("ERROR: Cannot open %s for writing\n", path);
-        return -1;
-    }
-    
-    if (fprintf(fp, "%s", value) < 0) {
-        printf("ERROR: Failed to write '%s' to %s\n", value, path);
-        fclose(fp);
-        return -1;
+    struct timespec now;
+    struct antsdr_dma_stats stats;
+    uint64_t head, written, frames, lost = rec.lost;
+    double elapsed, mbytes;
+
+    if (rec.started) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (ioctl(rec.dev_fd, ANTSDR_IOC_GET_STATS, &stats) == 0)
+            lost = stats.mmap_overruns - rec.overruns_base;
+    } else {
+        now = rec.stop;
     }
-    
-    fclose(fp);
-    printf("DEBUG: Wrote '%s' to %s\n", value, path);
+    pthread_mutex_lock(&rec.lock);
+    head = rec.head;
+    written = rec.written;
+    frames = rec.hdr.frame_count;
+    pthread_mutex_unlock(&rec.lock);
+
+    elapsed = (now.tv_sec - rec.start.tv_sec) + (now.tv_nsec - rec.start.tv_nsec) / 1e9;
+    mbytes = (written - ANTSDR_CAPTURE_DATA_OFFSET) / 1e6;
+    snprintf(out, size,
+             "RECORD: %s path=%s channel=%d direct=%d frames=%" PRIu64 " mbytes=%.1f seconds=%.1f"
+             " mbytes_per_s=%.1f write_mbytes_per_s=%.1f max_write_ms=%.1f staging=%.1f/%zu MB"
+             " staging_max=%.1f MB stalls=%" PRIu64 " stall_ms=%.1f lost=%" PRIu64 " error=%s\n",
+             rec.started ? "active" : "stopped", rec.path[0] ? rec.path : "-", rec.channel, rec.direct,
+             frames, mbytes, elapsed, elapsed > 0 ? mbytes / elapsed : 0.0,
+             rec.write_ns ? mbytes / (rec.write_ns / 1e9) : 0.0, rec.max_write_ns / 1e6,
+             (head - written) / 1e6, rec.buf_size >> 20, rec.max_fill / 1e6, rec.stalls,
+             rec.stall_ns / 1e6, lost, rec.error ? strerror(rec.error) : "none");
+}
+
+static void channel_path(int channel, char *path, size_t size)
+{
+    if (channel)
+        snprintf(path, size, "%s%d", DEVICE_NAME, channel);
+    else
+        snprintf(path, size, "%s", DEVICE_NAME);
+}
+
+/* Park the selected channel's stream state and switch to another one */
+static int select_channel(int channel)
+{
+    struct channel_ctx *ctx;
+
+    if (channel < 0 || channel >= MAX_CHANNELS || channels[channel].fd < 0)
+        return -ENODEV;
+
+    pthread_mutex_lock(&state_mutex);
+    ctx = &channels[current_channel];
+    ctx->state = current_state;
+    ctx->dest = current_dest;
+    ctx->dest_configured = dest_configured;
+    ctx->buffer_size = current_buffer_size;
+
+    ctx = &channels[channel];
+    device_fd = ctx->fd;
+    current_state = ctx->state;
+    current_dest = ctx->dest;
+    dest_configured = ctx->dest_configured;
+    current_buffer_size = ctx->buffer_size;
+    current_channel = channel;
+    pthread_mutex_unlock(&state_mutex);
     return 0;
 }
 
-static int write_sysfs_longlong(const char *path, long long value)
+static const char* state_to_string(app_state_t state)
 {
-    char str_value[32];
-    snprintf(str_value, sizeof(str_value), "%lld", value);
-    return write_sysfs_string(path, str_value);
+    switch (state) {
+        case STATE_STANDBY: return "STANDBY";
+        case STATE_STREAMING: return "STREAMING";
+        case STATE_STOPPING: return "STOPPING";
+        case STATE_CHANGING_MODE: return "CHANGING_MODE";
+        default: return "UNKNOWN";
+    }
 }
 
 static int read_sysfs_string(const char *path, char *buffer, size_t size)
@@ -531,38 +1823,25 @@ static int read_sysfs_string(const char *path, char *buffer, size_t size)
     }
     
     return 0;
-}
-
-static int configure_ad9361_rx(void)
-{
-    printf("DEBUG: Configuring AD9361 RX\n");
-    
-    // Set RX LO frequency
-    if (write_sysfs_longlong(RX_LO_PATH, rf_cfg.rx_lo_hz) < 0) {
-        printf("ERROR: Failed to set RX LO frequency\n");
-        return -1;
-    }
-    
-    // Set RX bandwidth
-    if (write_sysfs_longlong(RX0_RF_BW_PATH, rf_cfg.rx_bw_hz) < 0) {
-        printf("ERROR: Failed to set RX bandwidth\n");
-        return -1;
-    }
-    
-    // Set RX sample rate
-    if (write_sysfs_longlong(RX0_SAMPLE_RATE_PATH, rf_cfg.rx_fs_hz) < 0) {
-        printf("ERROR: Failed to set RX sample rate\n");
-        return -1;
-    }
-    
-    // Set RX port
-    if (write_sysfs_string(RX0_RF_PORT_PATH, rf_cfg.rx_rfport) < 0) {
-        printf("ERROR: Failed to set RX port\n");
+}
+
+static int configure_ad9361_rx(void)
+{
+    rf_begin();
+    
+    if (rf_write_longlong(RF_RX_LO, rf_cfg.rx_lo_hz) < 0 ||
+        rf_write_longlong(RF_RX_BW, rf_cfg.rx_bw_hz) < 0 ||
+        rf_write_longlong(RF_RX_FS, rf_cfg.rx_fs_hz) < 0 ||
+        rf_write(RF_RX_PORT, rf_cfg.rx_rfport) < 0) {
+        rf_end();
+        printf("ERROR: Failed to configure AD9361 RX\n");
         return -1;
     }
     
-    printf("DEBUG: RX configured: LO=%lld Hz, BW=%lld Hz, FS=%lld Hz, Port=%s\n",
-           rf_cfg.rx_lo_hz, rf_cfg.rx_bw_hz, rf_cfg.rx_fs_hz, rf_cfg.rx_rfport);
+    rf_end();
+    printf("DEBUG: RX configured: LO=%lld Hz, BW=%lld Hz, FS=%lld Hz, Port=%s (%d written, %.0f us)\n",
+           rf_cfg.rx_lo_hz, rf_cfg.rx_bw_hz, rf_cfg.rx_fs_hz, rf_cfg.rx_rfport,
+           rf_last.writes, rf_last.elapsed_us);
     
     return 0;
 }
@@ -574,34 +1853,21 @@ static int configure_ad9361_tx(void)
         return 0;
     }
     
-    printf("DEBUG: Configuring AD9361 TX\n");
-    
-    // Set TX LO frequency
-    if (write_sysfs_longlong(TX_LO_PATH, rf_cfg.tx_lo_hz) < 0) {
-        printf("ERROR: Failed to set TX LO frequency\n");
-        return -1;
-    }
-    
-    // Set TX bandwidth
-    if (write_sysfs_longlong(TX0_RF_BW_PATH, rf_cfg.tx_bw_hz) < 0) {
-        printf("ERROR: Failed to set TX bandwidth\n");
-        return -1;
-    }
-    
-    // Set TX sample rate
-    if (write_sysfs_longlong(TX0_SAMPLE_RATE_PATH, rf_cfg.tx_fs_hz) < 0) {
-        printf("ERROR: Failed to set TX sample rate\n");
-        return -1;
-    }
+    rf_begin();
     
-    // Set TX port
-    if (write_sysfs_string(TX0_RF_PORT_PATH, rf_cfg.tx_rfport) < 0) {
-        printf("ERROR: Failed to set TX port\n");
+    if (rf_write_longlong(RF_TX_LO, rf_cfg.tx_lo_hz) < 0 ||
+        rf_write_longlong(RF_TX_BW, rf_cfg.tx_bw_hz) < 0 ||
+        rf_write_longlong(RF_TX_FS, rf_cfg.tx_fs_hz) < 0 ||
+        rf_write(RF_TX_PORT, rf_cfg.tx_rfport) < 0) {
+        rf_end();
+        printf("ERROR: Failed to configure AD9361 TX\n");
         return -1;
     }
     
-    printf("DEBUG: TX configured: LO=%lld Hz, BW=%lld Hz, FS=%lld Hz, Port=%s\n",
-           rf_cfg.tx_lo_hz, rf_cfg.tx_bw_hz, rf_cfg.tx_fs_hz, rf_cfg.tx_rfport);
+    rf_end();
+    printf("DEBUG: TX configured: LO=%lld Hz, BW=%lld Hz, FS=%lld Hz, Port=%s (%d written, %.0f us)\n",
+           rf_cfg.tx_lo_hz, rf_cfg.tx_bw_hz, rf_cfg.tx_fs_hz, rf_cfg.tx_rfport,
+           rf_last.writes, rf_last.elapsed_us);
     
     return 0;
 }
@@ -649,6 +1915,9 @@ static int configure_rf_for_real_data(void)
 static void cleanup_rf_context(void)
 {
     printf("DEBUG: RF context cleanup\n");
+    sched_lo_stop();
+    hop_stop();
+    rf_close();
     rf_configured = 0;
 }
 
@@ -662,16 +1931,31 @@ static void print_usage(const char *progname)
     printf("  -v              Enable verbose logging\n");
     printf("  -h              Show this help\n");
     printf("\nRemote Control Commands (send as UDP packets):\n");
+    printf("  set_channel <n>                        - Direct stream commands to RX channel n (0 = %s)\n", DEVICE_NAME);
+    printf("  get_channels                           - Channels on the board and their stream state\n");
     printf("  setup_stream <ip> <port> <buffer_size> - Setup streaming parameters (buffer_size=2048)\n");
     printf("  start_stream                           - Enable data generation and start streaming\n");
     printf("  stop_stream                            - Stop streaming and disable data generation\n");
     printf("  set_mode <mode>                        - Change mode (0=real, 1=simulation)\n");
     printf("  get_mode                               - Get current operation mode\n");
-    printf("  set_pulse_mode <0|1>                   - Enable/disable pulse mode (fixed 2048-byte transfers)\n");
+    printf("  set_pulse_mode <0|1>                   - Enable/disable pulse mode (switches live while streaming)\n");
     printf("  get_pulse_mode                         - Get current pulse mode status\n");
     printf("  set_tdd_mode <0|1>                     - Enable/disable TDD mode (fixed 2048-byte transfers)\n");
     printf("  get_tdd_mode                           - Get current TDD mode status\n");
+    printf("  set_aggregation <0|1> [mtu] [flush_us] - Pack several frames per datagram (default mtu 1500, flush 1000us)\n");
+    printf("  set_poll_mode <0|1> [enter] [exit] [us] - Poll for completions above enter frames/s (default 20000/10000 fps, 200us)\n");
+    printf("  set_geometry <pool_kb> [ring_kb] [fifo] - Resize DMA pool, ring and raw FIFO while stopped (0 = keep)\n");
+    printf("  get_geometry                           - Get DMA pool, ring and raw FIFO sizes\n");
+    printf("  set_header <1|2> [clock]               - Packet header version, timestamp clock (0=mono, 1=realtime, 2=TAI)\n");
+    printf("  set_integration <0|1|2> [n] [k]        - Integrate n frames (1=coherent, 2=incoherent), decimate by k, while stopped\n");
+    printf("  set_compression <0|1>                  - Delta + bit-pack frames of aggregated datagrams (needs set_aggregation 1)\n");
+    printf("  set_checksum <0-3>                     - Checksum field: 0=CRC32 per datagram, 1=none, 2=header only, 3=CRC32 per frame\n");
+    printf("  add_dest <ip> <port> [ttl]             - Add a unicast or multicast destination (up to 4, ttl for multicast)\n");
+    printf("  del_dest <ip> <port>                   - Remove a destination\n");
+    printf("  list_dests                             - List destinations with per-destination counters\n");
     printf("  get_stats                              - Get streaming statistics\n");
+    printf("  get_latency                            - Per-stage latency (parse, ring, send, sendmsg) in us\n");
+    printf("  bench [auto|fps] [ms] [max_fps]        - Loopback benchmark with synthetic frames (no FPGA/DMA), while stopped\n");
     printf("  get_status                             - Get current device status\n");
     printf("  reset                                  - Reset device to standby state\n");
     printf("  ping                                   - Simple connectivity test\n");
@@ -683,7 +1967,29 @@ static void print_usage(const char *progname)
     printf("  set_rx_fs <fs_hz>                      - Set RX sample rate in Hz\n");
     printf("  set_tx_fs <fs_hz>                      - Set TX sample rate in Hz\n");
     printf("  set_tx_enable <0|1>                    - Enable/disable TX transmission\n");
+    printf("  configure_rf [force]                   - Apply changed RF parameters, verify them, report time taken\n");
+    printf("  verify_rf_params                       - Read back and check every RF parameter\n");
     printf("  get_rf_config                          - Get current RF configuration\n");
+    printf("  fastlock_store <slot> <freq_hz>        - Store an RX LO frequency in fastlock profile 0-7\n");
+    printf("  fastlock_recall <slot>                 - Retune the RX LO to a stored profile without a relock\n");
+    printf("  fastlock_settle <us>                   - Wait after a recall before frames count as on the profile\n");
+    printf("  hop_start <dwell_frames> <s,s,...> [n] - Hop through profiles every dwell_frames frames (n passes)\n");
+    printf("  hop_stop                               - Stop hopping, the LO stays on the last profile\n");
+    printf("  get_fastlock                           - Stored profiles, active profile, recall times, hop state\n");
+    printf("\nMode Schedule Commands (applied by the driver at frame boundaries):\n");
+    printf("  sched_add <at> <pulse> <tdd> <lo>      - Stage an entry: modes 0/1, fastlock slot, '-' = unchanged\n");
+    printf("  sched_arm [frames|time] [period]       - Upload and arm; 'at' in frames or ns, period > 0 repeats\n");
+    printf("  sched_clear                            - Disarm and drop the staged entries\n");
+    printf("  get_schedule                           - Position, passes, entries applied, late, errors\n");
+    printf("\nSend Path Commands:\n");
+    printf("  set_pacing <kbps> [burst] [backoff_us] [high%%] [low%%] - Cap egress (0 = off), retry budget, overload marks\n");
+    printf("  get_pacing                             - Pacing settings, ring fill, overload events, backoffs\n");
+    printf("  set_raw_tx <on|off> [bypass]           - Send pre-built Ethernet frames, optionally skipping the qdisc\n");
+    printf("  get_raw_tx                             - Raw transmit state, destinations resolved, frames, fallbacks\n");
+    printf("\nOn-board Recording Commands (current channel, antsdr_capture file format):\n");
+    printf("  record_start <path> [buffer_mb]        - Record to local storage with O_DIRECT, buffer absorbs stalls (64 MB)\n");
+    printf("  record_stop                            - Finish the file: tail, index, complete header\n");
+    printf("  get_record                             - Frames, MB/s, write latency, stall time, buffer fill, lost\n");
     printf("\nMode Change Protocol:\n");
     printf("  1. System automatically stops streaming when changing mode\n");
     printf("  2. Changes the operation mode\n");
@@ -821,7 +2127,7 @@ static int stop_streaming(void)
 static int change_mode(uint32_t new_mode)
 {
     int ret;
-    int was_streaming = 0;
+    app_state_t prev_state;
     
     if (new_mode > 1) {
         printf("ERROR: Invalid mode %u (must be 0 or 1)\n", new_mode);
@@ -833,37 +2139,18 @@ static int change_mode(uint32_t new_mode)
         return 0;
     }
     
+    // The driver applies the mode GPIO while streaming - no stop/start needed
     pthread_mutex_lock(&state_mutex);
-    
-    // Check if we were streaming
-    if (current_state == STATE_STREAMING) {
-        was_streaming = 1;
-        current_state = STATE_CHANGING_MODE;
-        pthread_mutex_unlock(&state_mutex);
-        
-        // Stop streaming first
-        printf("Stopping streaming to change mode...\n");
-        ret = ioctl(device_fd, ANTSDR_IOC_STOP_STREAMING, 0);
-        if (ret < 0) {
-            perror("Failed to stop streaming for mode change");
-            pthread_mutex_lock(&state_mutex);
-            current_state = STATE_STANDBY;
-            pthread_mutex_unlock(&state_mutex);
-            return ret;
-        }
-        
-        // Brief delay to ensure clean stop
-        usleep(100000); // 100ms
-    } else {
-        pthread_mutex_unlock(&state_mutex);
-    }
+    prev_state = current_state;
+    current_state = STATE_CHANGING_MODE;
+    pthread_mutex_unlock(&state_mutex);
     
     // Change the mode
     ret = ioctl(device_fd, ANTSDR_IOC_SET_MODE, &new_mode);
     if (ret < 0) {
         perror("Failed to set operation mode");
         pthread_mutex_lock(&state_mutex);
-        current_state = was_streaming ? STATE_STANDBY : current_state;
+        current_state = prev_state;
         pthread_mutex_unlock(&state_mutex);
         return ret;
     }
@@ -883,38 +2170,382 @@ static int change_mode(uint32_t new_mode)
         cleanup_rf_context();
     }
     
-    // Restart streaming if we were streaming before
-    if (was_streaming) {
-        printf("Restarting streaming with new mode...\n");
-        // Brief delay to ensure mode change is applied
-        usleep(100000); // 100ms
-        
-        ret = ioctl(device_fd, ANTSDR_IOC_START_STREAMING, 0);
-        if (ret < 0) {
-            perror("Failed to restart streaming after mode change");
-            pthread_mutex_lock(&state_mutex);
-            current_state = STATE_STANDBY;
-            pthread_mutex_unlock(&state_mutex);
-            return ret;
+    pthread_mutex_lock(&state_mutex);
+    current_state = prev_state;
+    pthread_mutex_unlock(&state_mutex);
+    
+    return 0;
+}
+
+/* Upper bound (ns) of the histogram bucket holding quantile q */
+static double latency_percentile(const struct antsdr_latency_hist *h, double q)
+{
+    uint64_t target = (uint64_t)(h->count * q + 0.5), seen = 0;
+    int b;
+    
+    if (!h->count)
+        return 0.0;
+    if (!target)
+        target = 1;
+    for (b = 0; b < ANTSDR_LAT_BUCKETS - 1; b++) {
+        seen += h->buckets[b];
+        if (seen >= target)
+            return (double)(2ULL << b);
+    }
+    return (double)h->max_ns;
+}
+
+/* One loopback benchmark run: the driver generates frames for duration_ms,
+ * the pipeline drains, then the run is stopped and its result read back
+ */
+static int run_bench(uint32_t rate, uint32_t duration_ms, struct antsdr_bench_result *res)
+{
+    struct antsdr_bench_config cfg = { .rate = rate, .duration_ms = duration_ms };
+    int tries = 100;
+    
+    if (ioctl(device_fd, ANTSDR_IOC_START_BENCH, &cfg) < 0)
+        return -1;
+    usleep((useconds_t)duration_ms * 1000);
+    do {
+        usleep(20000);
+        if (ioctl(device_fd, ANTSDR_IOC_GET_BENCH, res) < 0)
+            break;
+    } while (res->running && --tries);
+    
+    if (ioctl(device_fd, ANTSDR_IOC_STOP_STREAMING) < 0)
+        return -1;
+    return ioctl(device_fd, ANTSDR_IOC_GET_BENCH, res);
+}
+
+/* Sustained: every generated frame made it through, nothing dropped anywhere */
+static bool bench_sustained(const struct antsdr_bench_result *res)
+{
+    uint64_t dropped = res->frames_missed + res->udp_overruns;
+    int i;
+    
+    for (i = 0; i < ANTSDR_DROP_REASONS; i++)
+        dropped += res->drops[i];
+    return res->frames_generated && !dropped && res->frames_valid == res->frames_generated;
+}
+
+static int format_bench(char *buf, size_t size, const struct antsdr_bench_result *res)
+{
+    double elapsed = res->elapsed_ns ? (double)res->elapsed_ns : 1.0;
+    
+    return snprintf(buf, size,
+                    " rate=%u fps=%.0f generated=%" PRIu64 " valid=%" PRIu64 " sent=%" PRIu64
+                    " missed=%" PRIu64 " drops_fifo_full=%" PRIu64 " drops_ring_full=%" PRIu64
+                    " drops_alloc_fail=%" PRIu64 " drops_invalid=%" PRIu64 " drops_send_error=%" PRIu64
+                    " overruns_udp=%" PRIu64 " cpu_gen=%.1f%% cpu_parse=%.1f%% cpu_send=%.1f%%",
+                    res->rate, res->frames_valid * 1e9 / elapsed,
+                    res->frames_generated, res->frames_valid, res->packets_sent, res->frames_missed,
+                    res->drops[0], res->drops[1], res->drops[2], res->drops[3], res->drops[4],
+                    res->udp_overruns,
+                    res->gen_cpu_ns * 100.0 / elapsed, res->parse_cpu_ns * 100.0 / elapsed,
+                    res->send_cpu_ns * 100.0 / elapsed);
+}
+
+/* Find the highest sustained rate: double from 10k frames/s until a run
+ * loses frames, then bisect down to 2%
+ */
+static void bench_search(char *response, size_t size, uint32_t duration_ms, uint32_t max_rate)
+{
+    struct antsdr_bench_result res, best, limit;
+    uint32_t lo = 0, hi = 0, rate = max_rate < 10000 ? max_rate : 10000;
+    int runs = 0, len;
+    
+    while (!hi) {
+        if (run_bench(rate, duration_ms, &res) < 0)
+            goto failed;
+        runs++;
+        if (!bench_sustained(&res)) {
+            hi = rate;
+            limit = res;
+        } else {
+            lo = rate;
+            best = res;
+            if (rate >= max_rate)
+                break;
+            rate = rate > max_rate / 2 ? max_rate : rate * 2;
         }
-        
-        pthread_mutex_lock(&state_mutex);
-        current_state = STATE_STREAMING;
-        pthread_mutex_unlock(&state_mutex);
-        
-        printf("Streaming restarted with mode %u\n", new_mode);
-    } else {
-        pthread_mutex_lock(&state_mutex);
-        current_state = STATE_STANDBY;
-        pthread_mutex_unlock(&state_mutex);
     }
+    while (hi && hi - lo > hi / 50) {
+        rate = lo + (hi - lo) / 2;
+        if (run_bench(rate, duration_ms, &res) < 0)
+            goto failed;
+        runs++;
+        if (bench_sustained(&res)) {
+            lo = rate;
+            best = res;
+        } else {
+            hi = rate;
+            limit = res;
+        }
+    }
+    
+    len = snprintf(response, size, "BENCH: max_sustained_fps=%u runs=%d%s", lo, runs,
+                   lo == max_rate ? " (max_fps reached)" : "");
+    if (lo && len < (int)size)
+        len += format_bench(response + len, size - len, &best);
+    if (hi && len < (int)size) {
+        len += snprintf(response + len, size - len, " | limit:");
+        if (len < (int)size)
+            len += format_bench(response + len, size - len, &limit);
+    }
+    if (len < (int)size)
+        snprintf(response + len, size - len, "\n");
+    return;
+    
+failed:
+    snprintf(response, size, "BENCH: FAILED at %u fps (%s)\n", rate, strerror(errno));
+}
+
+/* Binary batched control (antsdr_control.h) */
+static const char *const ctrl_gain_modes[] = { "manual", "slow_attack", "fast_attack", "hybrid" };
+static const char *const ctrl_rx_ports[] = {
+    "A_BALANCED", "B_BALANCED", "C_BALANCED", "A_N", "A_P", "B_N", "B_P", "C_N", "C_P"
+};
+static const char *const ctrl_tx_ports[] = { "A", "B" };
+
+#define CTRL_NAMES(names) (int)(sizeof(names) / sizeof((names)[0]))
+
+/* What a parameter change needs reprogrammed */
+#define CTRL_APPLY_RX   0x1   /* configure_ad9361_rx() */
+#define CTRL_APPLY_TX   0x2   /* configure_ad9361_tx() */
+#define CTRL_APPLY_ALL  0x4   /* configure_rf_parameters() - gains, gain mode, ports */
+
+struct ctrl_session {
+    uint32_t id;
+    uint32_t sequence;        /* Last request handled */
+    uint64_t last_used;       /* Request count when last used, for eviction */
+    size_t reply_len;
+    uint8_t reply[ANTSDR_CTRL_MAX_DATAGRAM];
+};
+
+static struct ctrl_session ctrl_sessions[ANTSDR_CTRL_SESSIONS];
+static uint64_t ctrl_requests;
+
+static int ctrl_name_index(const char *const *names, int count, const char *name)
+{
+    int i;
     
+    for (i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/* AD9361 limits, so a bad item fails the batch before anything is written */
+static int ctrl_check_item(const struct antsdr_ctrl_item *item)
+{
+    int64_t v = item->value;
+    
+    switch (item->param) {
+    case ANTSDR_CTRL_RX_LO_HZ:
+        return v >= MHZ(70) && v <= GHZ(6) ? 0 : -ERANGE;
+    case ANTSDR_CTRL_TX_LO_HZ:
+        return v >= MHZ(47) && v <= GHZ(6) ? 0 : -ERANGE;
+    case ANTSDR_CTRL_RX_BW_HZ:
+    case ANTSDR_CTRL_TX_BW_HZ:
+        return v >= 200000 && v <= MHZ(56) ? 0 : -ERANGE;
+    case ANTSDR_CTRL_RX_FS_HZ:
+    case ANTSDR_CTRL_TX_FS_HZ:
+        return v >= 520833 && v <= MHZ(61.44) ? 0 : -ERANGE;
+    case ANTSDR_CTRL_RX_GAIN_MDB:
+        return v >= -3000 && v <= 71000 ? 0 : -ERANGE;
+    case ANTSDR_CTRL_TX_GAIN_MDB:
+        return v >= -89750 && v <= 0 ? 0 : -ERANGE;
+    case ANTSDR_CTRL_RX_GAIN_MODE:
+        return v >= 0 && v < CTRL_NAMES(ctrl_gain_modes) ? 0 : -EINVAL;
+    case ANTSDR_CTRL_RX_PORT:
+        return v >= 0 && v < CTRL_NAMES(ctrl_rx_ports) ? 0 : -EINVAL;
+    case ANTSDR_CTRL_TX_PORT:
+        return v >= 0 && v < CTRL_NAMES(ctrl_tx_ports) ? 0 : -EINVAL;
+    case ANTSDR_CTRL_TX_ENABLE:
+        return v == 0 || v == 1 ? 0 : -EINVAL;
+    default:
+        return -ENOENT;
+    }
+}
+
+/* Round to milli-dB without pulling in llround() from libm. */
+static int64_t ctrl_mdb(double db)
+{
+    return (int64_t)(db * 1000.0 + (db < 0 ? -0.5 : 0.5));
+}
+
+static int64_t ctrl_get_param(const struct rf_config *cfg, uint16_t param)
+{
+    switch (param) {
+    case ANTSDR_CTRL_RX_LO_HZ:     return cfg->rx_lo_hz;
+    case ANTSDR_CTRL_TX_LO_HZ:     return cfg->tx_lo_hz;
+    case ANTSDR_CTRL_RX_BW_HZ:     return cfg->rx_bw_hz;
+    case ANTSDR_CTRL_TX_BW_HZ:     return cfg->tx_bw_hz;
+    case ANTSDR_CTRL_RX_FS_HZ:     return cfg->rx_fs_hz;
+    case ANTSDR_CTRL_TX_FS_HZ:     return cfg->tx_fs_hz;
+    case ANTSDR_CTRL_RX_GAIN_MDB:  return ctrl_mdb(cfg->rx_gain_db);
+    case ANTSDR_CTRL_TX_GAIN_MDB:  return ctrl_mdb(cfg->tx_gain_db);
+    case ANTSDR_CTRL_RX_GAIN_MODE: return ctrl_name_index(ctrl_gain_modes, CTRL_NAMES(ctrl_gain_modes), cfg->rx_gain_mode);
+    case ANTSDR_CTRL_RX_PORT:      return ctrl_name_index(ctrl_rx_ports, CTRL_NAMES(ctrl_rx_ports), cfg->rx_rfport);
+    case ANTSDR_CTRL_TX_PORT:      return ctrl_name_index(ctrl_tx_ports, CTRL_NAMES(ctrl_tx_ports), cfg->tx_rfport);
+    case ANTSDR_CTRL_TX_ENABLE:    return cfg->tx_enabled;
+    default:                       return 0;
+    }
+}
+
+/* Store one validated item, returns the CTRL_APPLY_* it needs */
+static unsigned int ctrl_set_param(struct rf_config *cfg, uint16_t param, int64_t value)
+{
+    switch (param) {
+    case ANTSDR_CTRL_RX_LO_HZ:     cfg->rx_lo_hz = value; return CTRL_APPLY_RX;
+    case ANTSDR_CTRL_TX_LO_HZ:     cfg->tx_lo_hz = value; return CTRL_APPLY_TX;
+    case ANTSDR_CTRL_RX_BW_HZ:     cfg->rx_bw_hz = value; return CTRL_APPLY_RX;
+    case ANTSDR_CTRL_TX_BW_HZ:     cfg->tx_bw_hz = value; return CTRL_APPLY_TX;
+    case ANTSDR_CTRL_RX_FS_HZ:     cfg->rx_fs_hz = value; return CTRL_APPLY_RX;
+    case ANTSDR_CTRL_TX_FS_HZ:     cfg->tx_fs_hz = value; return CTRL_APPLY_TX;
+    case ANTSDR_CTRL_RX_GAIN_MDB:  cfg->rx_gain_db = value / 1000.0; return CTRL_APPLY_ALL;
+    case ANTSDR_CTRL_TX_GAIN_MDB:  cfg->tx_gain_db = value / 1000.0; return CTRL_APPLY_ALL;
+    case ANTSDR_CTRL_RX_GAIN_MODE: cfg->rx_gain_mode = ctrl_gain_modes[value]; return CTRL_APPLY_ALL;
+    case ANTSDR_CTRL_RX_PORT:      cfg->rx_rfport = ctrl_rx_ports[value]; return CTRL_APPLY_ALL;
+    case ANTSDR_CTRL_TX_PORT:      cfg->tx_rfport = ctrl_tx_ports[value]; return CTRL_APPLY_ALL;
+    case ANTSDR_CTRL_TX_ENABLE:    cfg->tx_enabled = (int)value; return CTRL_APPLY_TX;
+    default:                       return 0;
+    }
+}
+
+/* Program the AD9361 once for a whole batch - outside real data mode the
+ * values are only stored, as with the text commands
+ */
+static int ctrl_apply_rf(unsigned int changed)
+{
+    if (current_mode != 0 || !rf_configured)
+        return 0;
+    if (changed & CTRL_APPLY_ALL)
+        return configure_rf_parameters(&rf_cfg);
+    if ((changed & CTRL_APPLY_RX) && configure_ad9361_rx() < 0)
+        return -1;
+    if ((changed & CTRL_APPLY_TX) && configure_ad9361_tx() < 0)
+        return -1;
     return 0;
 }
 
+static struct ctrl_session *ctrl_find_session(uint32_t id, bool create)
+{
+    struct ctrl_session *oldest = &ctrl_sessions[0];
+    int i;
+    
+    for (i = 0; i < ANTSDR_CTRL_SESSIONS; i++) {
+        if (ctrl_sessions[i].last_used && ctrl_sessions[i].id == id)
+            return &ctrl_sessions[i];
+        if (ctrl_sessions[i].last_used < oldest->last_used)
+            oldest = &ctrl_sessions[i];
+    }
+    if (!create)
+        return NULL;
+    
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->id = id;
+    return oldest;
+}
+
+static void ctrl_send_status(const struct antsdr_ctrl_header *req, int status, struct sockaddr_in *client_addr)
+{
+    struct antsdr_ctrl_header hdr = *req;
+    uint8_t reply[sizeof(hdr)];
+    
+    hdr.flags = ANTSDR_CTRL_F_REPLY;
+    hdr.count = 0;
+    hdr.status = status;
+    antsdr_ctrl_put_header(reply, &hdr);
+    sendto(control_sock, reply, sizeof(reply), 0, (struct sockaddr *)client_addr, sizeof(*client_addr));
+}
+
+/* One binary request: validate every item, apply them all or none, reply
+ * once. Retransmits of the last request of a session get the same reply.
+ */
+static void process_binary_command(const uint8_t *buf, size_t len, struct sockaddr_in *client_addr)
+{
+    struct antsdr_ctrl_header hdr;
+    struct antsdr_ctrl_item item;
+    struct ctrl_session *sess;
+    struct rf_config saved;
+    unsigned int changed = 0;
+    int status = 0, i;
+    uint8_t *out;
+    
+    antsdr_ctrl_get_header(buf, &hdr);
+    if (hdr.version != ANTSDR_CTRL_VERSION || (hdr.flags & ANTSDR_CTRL_F_REPLY)) {
+        ctrl_send_status(&hdr, -EPROTO, client_addr);
+        return;
+    }
+    if (hdr.count > ANTSDR_CTRL_MAX_ITEMS || len < sizeof(hdr) + hdr.count * sizeof(item)) {
+        ctrl_send_status(&hdr, -EMSGSIZE, client_addr);
+        return;
+    }
+    
+    sess = ctrl_find_session(hdr.session, true);
+    sess->last_used = ++ctrl_requests;
+    if (sess->reply_len && hdr.sequence == sess->sequence) {
+        printf("Binary request: session %08x seq %u retransmitted, resending reply\n", hdr.session, hdr.sequence);
+        sendto(control_sock, sess->reply, sess->reply_len, 0, (struct sockaddr *)client_addr, sizeof(*client_addr));
+        return;
+    }
+    if (sess->reply_len && (int32_t)(hdr.sequence - sess->sequence) < 0) {
+        ctrl_send_status(&hdr, -ESTALE, client_addr);
+        return;
+    }
+    printf("Binary request: session %08x seq %u, %u items\n", hdr.session, hdr.sequence, hdr.count);
+    
+    /* Pass 1: validate, replies carry the per-item status so far */
+    out = sess->reply + sizeof(hdr);
+    for (i = 0; i < hdr.count; i++) {
+        antsdr_ctrl_get_item(buf + sizeof(hdr) + i * sizeof(item), &item);
+        item.status = ctrl_check_item(&item);
+        
+        /* A GET ignores the value, but still needs a parameter that exists */
+        if ((item.flags & ANTSDR_CTRL_ITEM_GET) && item.status != -ENOENT)
+            item.status = 0;
+        if (item.status && !status)
+            status = item.status;
+        antsdr_ctrl_put_item(out + i * sizeof(item), &item);
+    }
+    
+    /* Pass 2: store everything, then reprogram the AD9361 once */
+    saved = rf_cfg;
+    for (i = 0; !status && i < hdr.count; i++) {
+        antsdr_ctrl_get_item(out + i * sizeof(item), &item);
+        if (!(item.flags & ANTSDR_CTRL_ITEM_GET))
+            changed |= ctrl_set_param(&rf_cfg, item.param, item.value);
+    }
+    if (!status && changed && ctrl_apply_rf(changed) < 0) {
+        /* Roll back - best effort, the board keeps the old configuration */
+        rf_cfg = saved;
+        ctrl_apply_rf(changed);
+        status = -EIO;
+    }
+    
+    /* Pass 3: final statuses and the values in force */
+    for (i = 0; i < hdr.count; i++) {
+        antsdr_ctrl_get_item(out + i * sizeof(item), &item);
+        if (!item.status && status && !(item.flags & ANTSDR_CTRL_ITEM_GET))
+            item.status = status == -EIO ? -EIO : -ECANCELED;
+        if (item.status != -ENOENT)
+            item.value = ctrl_get_param(&rf_cfg, item.param);
+        antsdr_ctrl_put_item(out + i * sizeof(item), &item);
+    }
+    
+    hdr.flags = ANTSDR_CTRL_F_REPLY;
+    hdr.status = status;
+    antsdr_ctrl_put_header(sess->reply, &hdr);
+    sess->sequence = hdr.sequence;
+    sess->reply_len = sizeof(hdr) + hdr.count * sizeof(item);
+    sendto(control_sock, sess->reply, sess->reply_len, 0, (struct sockaddr *)client_addr, sizeof(*client_addr));
+}
+
 static void process_control_command(const char *command, struct sockaddr_in *client_addr)
 {
-    char response[512];
+    char response[2048];
     char action[32];
     char dest_ip[16];
     uint16_t dest_port;
@@ -933,6 +2564,28 @@ static void process_control_command(const char *command, struct sockaddr_in *cli
     if (strcmp(action, "ping") == 0) {
         snprintf(response, sizeof(response), "PONG: Device ready, state=%s\n", state_to_string(current_state));
         
+    } else if (strcmp(action, "set_channel") == 0) {
+        int channel;
+        if (sscanf(command, "%31s %d", action, &channel) == 2 && select_channel(channel) == 0) {
+            snprintf(response, sizeof(response), "SET_CHANNEL: OK (channel %d, state=%s)\n",
+                     channel, state_to_string(current_state));
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_channel requires a channel present on the board (get_channels)\n");
+        }
+        
+    } else if (strcmp(action, "get_channels") == 0) {
+        size_t len = snprintf(response, sizeof(response), "CHANNELS: selected=%d", current_channel);
+        for (int i = 0; i < MAX_CHANNELS && len < sizeof(response); i++) {
+            char path[64];
+            app_state_t state = i == current_channel ? current_state : channels[i].state;
+
+            channel_path(i, path, sizeof(path));
+            if (channels[i].fd >= 0)
+                len += snprintf(response + len, sizeof(response) - len, " %d:%s:%s", i, path, state_to_string(state));
+        }
+        if (len < sizeof(response))
+            snprintf(response + len, sizeof(response) - len, "\n");
+        
     } else if (strcmp(action, "setup_stream") == 0) {
         if (sscanf(command, "%31s %15s %hu %u", action, dest_ip, &dest_port, &buffer_size) == 4) {
             ret = setup_streaming_params(dest_ip, dest_port, buffer_size);
@@ -963,18 +2616,262 @@ static void process_control_command(const char *command, struct sockaddr_in *cli
         snprintf(response, sizeof(response), "MODE: %u (%s)\n", current_mode, 
                  current_mode ? "simulation" : "real_data");
         
+    } else if (strcmp(action, "set_aggregation") == 0) {
+        struct antsdr_aggregation agg = { .enable = 0, .mtu = 1500, .flush_timeout_us = 1000 };
+        if (sscanf(command, "%31s %u %u %u", action, &agg.enable, &agg.mtu, &agg.flush_timeout_us) >= 2) {
+            ret = ioctl(device_fd, ANTSDR_IOC_SET_AGGREGATION, &agg);
+            if (ret == 0) {
+                snprintf(response, sizeof(response), "SET_AGGREGATION: OK (enable=%u mtu=%u flush_us=%u)\n",
+                         agg.enable, agg.mtu, agg.flush_timeout_us);
+            } else {
+                snprintf(response, sizeof(response), "SET_AGGREGATION: FAILED (%s)\n", strerror(errno));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_aggregation requires <0|1> [mtu] [flush_timeout_us]\n");
+        }
+        
+    } else if (strcmp(action, "set_poll_mode") == 0) {
+        struct antsdr_poll_config poll = { .enable = 0, .enter_fps = 20000, .exit_fps = 10000, .poll_interval_us = 200 };
+        if (sscanf(command, "%31s %u %u %u %u", action, &poll.enable, &poll.enter_fps,
+                   &poll.exit_fps, &poll.poll_interval_us) >= 2) {
+            ret = ioctl(device_fd, ANTSDR_IOC_SET_POLL_MODE, &poll);
+            if (ret == 0) {
+                snprintf(response, sizeof(response), "SET_POLL_MODE: OK (enable=%u enter=%u exit=%u interval_us=%u)\n",
+                         poll.enable, poll.enter_fps, poll.exit_fps, poll.poll_interval_us);
+            } else {
+                snprintf(response, sizeof(response), "SET_POLL_MODE: FAILED (%s)\n", strerror(errno));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_poll_mode requires <0|1> [enter_fps] [exit_fps] [interval_us]\n");
+        }
+        
+    } else if (strcmp(action, "set_geometry") == 0) {
+        struct antsdr_geometry geo = { 0 };
+        if (sscanf(command, "%31s %u %u %u", action, &geo.dma_pool_kb, &geo.ring_kb,
+                   &geo.raw_fifo_depth) >= 2) {
+            ret = ioctl(device_fd, ANTSDR_IOC_SET_GEOMETRY, &geo);
+            if (ret == 0 && ioctl(device_fd, ANTSDR_IOC_GET_GEOMETRY, &geo) == 0) {
+                snprintf(response, sizeof(response), "SET_GEOMETRY: OK (pool_kb=%u buffers=%u ring_kb=%u fifo=%u)\n",
+                         geo.dma_pool_kb, geo.dma_buffers, geo.ring_kb, geo.raw_fifo_depth);
+            } else {
+                snprintf(response, sizeof(response), "SET_GEOMETRY: FAILED (%s)\n", strerror(errno));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_geometry requires <pool_kb> [ring_kb] [fifo_depth]\n");
+        }
+        
+    } else if (strcmp(action, "get_geometry") == 0) {
+        struct antsdr_geometry geo;
+        ret = ioctl(device_fd, ANTSDR_IOC_GET_GEOMETRY, &geo);
+        if (ret == 0) {
+            snprintf(response, sizeof(response), "GEOMETRY: pool_kb=%u buffers=%u ring_kb=%u fifo=%u\n",
+                     geo.dma_pool_kb, geo.dma_buffers, geo.ring_kb, geo.raw_fifo_depth);
+        } else {
+            snprintf(response, sizeof(response), "GET_GEOMETRY: FAILED (%s)\n", strerror(errno));
+        }
+        
+    } else if (strcmp(action, "set_header") == 0) {
+        struct antsdr_header_config hdr = { .version = 1, .clock = 0 };
+        if (sscanf(command, "%31s %u %u", action, &hdr.version, &hdr.clock) >= 2) {
+            ret = ioctl(device_fd, ANTSDR_IOC_SET_HEADER, &hdr);
+            if (ret == 0) {
+                snprintf(response, sizeof(response), "SET_HEADER: OK (version=%u clock=%u)\n",
+                         hdr.version, hdr.clock);
+            } else {
+                snprintf(response, sizeof(response), "SET_HEADER: FAILED (%s)\n", strerror(errno));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_header requires <1|2> [clock]\n");
+        }
+        
+    } else if (strcmp(action, "set_integration") == 0) {
+        struct antsdr_integration integ = { .frames = 1, .decimation = 1 };
+        if (sscanf(command, "%31s %u %u %u", action, &integ.mode, &integ.frames, &integ.decimation) >= 2) {
+            ret = ioctl(device_fd, ANTSDR_IOC_SET_INTEGRATION, &integ);
+            if (ret == 0) {
+                snprintf(response, sizeof(response), "SET_INTEGRATION: OK (mode=%u frames=%u decimation=%u)\n",
+                         integ.mode, integ.frames, integ.decimation);
+            } else {
+                snprintf(response, sizeof(response), "SET_INTEGRATION: FAILED (%s)\n", strerror(errno));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_integration requires <0|1|2> [frames] [decimation]\n");
+        }
+        
+    } else if (strcmp(action, "set_compression") == 0) {
+        unsigned int compress_mode;
+        if (sscanf(command, "%31s %u", action, &compress_mode) == 2) {
+            ret = ioctl(device_fd, ANTSDR_IOC_SET_COMPRESSION, &compress_mode);
+            if (ret == 0) {
+                snprintf(response, sizeof(response), "SET_COMPRESSION: OK (mode=%u)\n", compress_mode);
+            } else {
+                snprintf(response, sizeof(response), "SET_COMPRESSION: FAILED (%s)\n", strerror(errno));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_compression requires <0|1>\n");
+        }
+        
+    } else if (strcmp(action, "set_checksum") == 0) {
+        unsigned int csum_mode;
+        if (sscanf(command, "%31s %u", action, &csum_mode) == 2) {
+            ret = ioctl(device_fd, ANTSDR_IOC_SET_CHECKSUM, &csum_mode);
+            if (ret == 0) {
+                snprintf(response, sizeof(response), "SET_CHECKSUM: OK (mode=%u)\n", csum_mode);
+            } else {
+                snprintf(response, sizeof(response), "SET_CHECKSUM: FAILED (%s)\n", strerror(errno));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_checksum requires <0-3>\n");
+        }
+        
+    } else if (strcmp(action, "add_dest") == 0 || strcmp(action, "del_dest") == 0) {
+        struct antsdr_udp_dest_cfg cfg;
+        struct in_addr addr;
+        char ip_str[32];
+        unsigned int port, ttl = 0;
+        int add = strcmp(action, "add_dest") == 0;
+        
+        if (sscanf(command, "%31s %31s %u %u", action, ip_str, &port, &ttl) >= 3 &&
+            port > 0 && port <= 65535 && ttl <= 255 &&
+            inet_pton(AF_INET, ip_str, &addr) == 1) {
+            memset(&cfg, 0, sizeof(cfg));
+            cfg.ip = addr.s_addr;
+            cfg.port = port;
+            cfg.ttl = ttl;
+            ret = ioctl(device_fd, add ? ANTSDR_IOC_ADD_UDP_DEST : ANTSDR_IOC_DEL_UDP_DEST, &cfg);
+            if (ret == 0) {
+                if (add)
+                    dest_configured = 1;
+                snprintf(response, sizeof(response), "%s: OK (%s:%u)\n",
+                         add ? "ADD_DEST" : "DEL_DEST", ip_str, port);
+            } else {
+                snprintf(response, sizeof(response), "%s: FAILED (%s)\n",
+                         add ? "ADD_DEST" : "DEL_DEST", strerror(errno));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: %s requires <ip> <port>%s\n",
+                     action, add ? " [ttl]" : "");
+        }
+        
+    } else if (strcmp(action, "list_dests") == 0) {
+        struct antsdr_udp_dest_list list;
+        
+        memset(&list, 0, sizeof(list));
+        ret = ioctl(device_fd, ANTSDR_IOC_GET_UDP_DESTS, &list);
+        if (ret == 0) {
+            size_t len = snprintf(response, sizeof(response), "DESTS: count=%u\n", list.count);
+            unsigned int i;
+            
+            for (i = 0; i < list.count && i < ANTSDR_MAX_UDP_DESTS && len < sizeof(response); i++) {
+                struct in_addr addr = { .s_addr = list.dests[i].ip };
+                char ip_str[INET_ADDRSTRLEN];
+                
+                inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+                len += snprintf(response + len, sizeof(response) - len,
+                                "  %s:%u%s%s packets=%" PRIu64 " drops=%" PRIu64 " seq=%u\n",
+                                ip_str, list.dests[i].port,
+                                list.dests[i].multicast ? " (multicast)" : "",
+                                list.dests[i].raw ? " (raw)" : "",
+                                list.dests[i].packets, list.dests[i].drops,
+                                list.dests[i].sequence);
+            }
+        } else {
+            snprintf(response, sizeof(response), "LIST_DESTS: FAILED (%s)\n", strerror(errno));
+        }
+        
     } else if (strcmp(action, "get_stats") == 0) {
         ret = ioctl(device_fd, ANTSDR_IOC_GET_STATS, &stats);
         if (ret == 0) {
             snprintf(response, sizeof(response), 
-                     "STATS: bytes=%lu packets=%lu completions=%lu errors=%lu valid=%lu invalid=%lu extracted=%lu\n",
+                     "STATS: bytes=%" PRIu64 " packets=%" PRIu64 " completions=%" PRIu64 " errors=%" PRIu64
+                     " valid=%" PRIu64 " invalid=%" PRIu64 " extracted=%" PRIu64
+                     " fast_path=%" PRIu64 " slow_path=%" PRIu64
+                     " resync_events=%" PRIu64 " resync_frames=%" PRIu64 " resync_dropped=%" PRIu64
+                     " resync_last_ns=%" PRIu64 " resync_max_ns=%" PRIu64
+                     " overruns_udp=%" PRIu64 " overruns_read=%" PRIu64 " overruns_mmap=%" PRIu64
+                     " irq_ms=%" PRIu64 " poll_ms=%" PRIu64 " mode_switches=%" PRIu64 " fps=%" PRIu64
+                     " pulse_switches=%" PRIu64 " pulse_switch_last_us=%" PRIu64 " pulse_switch_max_us=%" PRIu64
+                     " integrated_frames=%" PRIu64 " integrated_outputs=%" PRIu64
+                     " compress_in=%" PRIu64 " compress_out=%" PRIu64 " compress_ratio=%.2f"
+                     " compress_ns_per_kb=%" PRIu64
+                     " drops_fifo_full=%" PRIu64 " drops_ring_full=%" PRIu64 " drops_alloc_fail=%" PRIu64
+                     " drops_invalid=%" PRIu64 " drops_send_error=%" PRIu64
+                     " fifo_high_water=%" PRIu64 " ring_high_water=%" PRIu64 " ring_bytes_high_water=%" PRIu64 "\n",
                      stats.bytes_transferred, stats.udp_packets_sent,
                      stats.transfers_completed, stats.errors,
-                     stats.valid_frames, stats.invalid_frames, stats.extracted_frames);
+                     stats.valid_frames, stats.invalid_frames, stats.extracted_frames,
+                     stats.fast_path_frames, stats.slow_path_frames,
+                     stats.resync_events, stats.resync_frames, stats.resync_dropped_words,
+                     stats.resync_last_ns, stats.resync_max_ns,
+                     stats.udp_overruns, stats.read_overruns, stats.mmap_overruns,
+                     stats.irq_mode_ns / 1000000, stats.poll_mode_ns / 1000000,
+                     stats.poll_mode_switches, stats.frame_rate,
+                     stats.pulse_switches, stats.pulse_switch_last_ns / 1000, stats.pulse_switch_max_ns / 1000,
+                     stats.integrated_frames, stats.integrated_outputs,
+                     stats.compress_in_bytes, stats.compress_out_bytes,
+                     stats.compress_out_bytes ? (double)stats.compress_in_bytes / stats.compress_out_bytes : 0.0,
+                     stats.compress_in_bytes ? stats.compress_ns * 1024 / stats.compress_in_bytes : 0,
+                     stats.drops_fifo_full, stats.drops_ring_full, stats.drops_alloc_fail,
+                     stats.drops_invalid, stats.drops_send_error,
+                     stats.fifo_high_water, stats.ring_high_water, stats.ring_bytes_high_water);
         } else {
             snprintf(response, sizeof(response), "ERROR: Failed to get statistics\n");
         }
         
+    } else if (strcmp(action, "bench") == 0) {
+        char bench_arg[16] = "auto";
+        uint32_t duration_ms = 1000, max_rate = ANTSDR_BENCH_MAX_RATE;
+        struct antsdr_bench_result res;
+        int len;
+        
+        sscanf(command, "%31s %15s %u %u", action, bench_arg, &duration_ms, &max_rate);
+        if (max_rate > ANTSDR_BENCH_MAX_RATE)
+            max_rate = ANTSDR_BENCH_MAX_RATE;
+        
+        pthread_mutex_lock(&state_mutex);
+        app_state_t state = current_state;
+        pthread_mutex_unlock(&state_mutex);
+        
+        if (state != STATE_STANDBY) {
+            snprintf(response, sizeof(response), "BENCH: FAILED (device is %s, stop streaming first)\n",
+                     state_to_string(state));
+        } else if (!duration_ms || !max_rate) {
+            snprintf(response, sizeof(response), "ERROR: bench requires [auto|fps] [duration_ms > 0] [max_fps > 0]\n");
+        } else if (strcmp(bench_arg, "auto") == 0) {
+            bench_search(response, sizeof(response), duration_ms, max_rate);
+        } else if (run_bench((uint32_t)strtoul(bench_arg, NULL, 0), duration_ms, &res) == 0) {
+            len = snprintf(response, sizeof(response), "BENCH: %s", bench_sustained(&res) ? "SUSTAINED" : "DROPPING");
+            len += format_bench(response + len, sizeof(response) - len, &res);
+            snprintf(response + len, sizeof(response) - len, "\n");
+        } else {
+            snprintf(response, sizeof(response), "BENCH: FAILED (%s)\n", strerror(errno));
+        }
+        
+    } else if (strcmp(action, "get_latency") == 0) {
+        static const char * const stage_names[ANTSDR_LAT_STAGES] = { "parse", "ring", "send", "sendmsg" };
+        struct antsdr_latency_stats lat;
+        int len, i;
+        
+        ret = ioctl(device_fd, ANTSDR_IOC_GET_LATENCY, &lat);
+        if (ret == 0) {
+            len = snprintf(response, sizeof(response), "LATENCY:");
+            for (i = 0; i < ANTSDR_LAT_STAGES && len < (int)sizeof(response); i++) {
+                const struct antsdr_latency_hist *h = &lat.stage[i];
+                
+                len += snprintf(response + len, sizeof(response) - len,
+                                " %s=count:%" PRIu64 ",avg_us:%.1f,p50_us:%.1f,p99_us:%.1f,max_us:%.1f",
+                                stage_names[i], h->count,
+                                h->count ? (double)h->sum_ns / h->count / 1000.0 : 0.0,
+                                latency_percentile(h, 0.50) / 1000.0,
+                                latency_percentile(h, 0.99) / 1000.0,
+                                h->max_ns / 1000.0);
+            }
+            if (len < (int)sizeof(response))
+                snprintf(response + len, sizeof(response) - len, "\n");
+        } else {
+            snprintf(response, sizeof(response), "ERROR: Failed to get latency (%s)\n", strerror(errno));
+        }
+        
     } else if (strcmp(action, "get_status") == 0) {
         pthread_mutex_lock(&state_mutex);
         app_state_t state = current_state;
@@ -1197,6 +3094,223 @@ static void process_control_command(const char *command, struct sockaddr_in *cli
             snprintf(response, sizeof(response), "ERROR: set_ensm_mode requires mode parameter\n");
         }
         
+    } else if (strcmp(action, "fastlock_store") == 0) {
+        int slot;
+        long long freq_hz;
+        if (sscanf(command, "%31s %d %lld", action, &slot, &freq_hz) == 3 &&
+            slot >= 0 && slot < ANTSDR_LO_PROFILES && freq_hz > 0) {
+            if (current_mode != 0 || !rf_configured) {
+                snprintf(response, sizeof(response), "FASTLOCK_STORE: Not available (real data mode not active)\n");
+            } else if (hop.running) {
+                snprintf(response, sizeof(response), "FASTLOCK_STORE: BUSY (hop schedule running, hop_stop first)\n");
+            } else {
+                ret = lo_store(slot, freq_hz);
+                snprintf(response, sizeof(response), "FASTLOCK_STORE: %s (slot %d, %lld Hz)\n",
+                         ret == 0 ? "OK" : "FAILED", slot, freq_hz);
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: fastlock_store requires slot (0-%d) and frequency in Hz\n",
+                     ANTSDR_LO_PROFILES - 1);
+        }
+        
+    } else if (strcmp(action, "fastlock_recall") == 0) {
+        struct antsdr_lo_profile lp;
+        int slot;
+        if (sscanf(command, "%31s %d", action, &slot) == 2 &&
+            slot >= 0 && slot < ANTSDR_LO_PROFILES && lo_profiles[slot]) {
+            if (current_mode != 0 || !rf_configured) {
+                snprintf(response, sizeof(response), "FASTLOCK_RECALL: Not available (real data mode not active)\n");
+            } else if (hop.running) {
+                snprintf(response, sizeof(response), "FASTLOCK_RECALL: BUSY (hop schedule running, hop_stop first)\n");
+            } else {
+                ret = lo_recall(slot, &lp);
+                if (ret == 0)
+                    rf_cfg.rx_lo_hz = lo_profiles[slot];
+                snprintf(response, sizeof(response), "FASTLOCK_RECALL: %s (slot %d, %lld Hz, %.0f us, frame_counter %u)\n",
+                         ret == 0 ? "OK" : "FAILED", slot, lo_profiles[slot], lo_recall_last_us, lp.frame_counter);
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: fastlock_recall requires a stored slot (fastlock_store first)\n");
+        }
+        
+    } else if (strcmp(action, "fastlock_settle") == 0) {
+        unsigned int settle_us;
+        if (sscanf(command, "%31s %u", action, &settle_us) == 2 && settle_us <= 100000) {
+            lo_settle_us = settle_us;
+            snprintf(response, sizeof(response), "FASTLOCK_SETTLE: OK (%u us)\n", settle_us);
+        } else {
+            snprintf(response, sizeof(response), "ERROR: fastlock_settle requires microseconds (0-100000)\n");
+        }
+        
+    } else if (strcmp(action, "hop_start") == 0) {
+        uint32_t dwell_frames, cycles = 0;
+        char slots[256];
+        if (sscanf(command, "%31s %u %255s %u", action, &dwell_frames, slots, &cycles) >= 3) {
+            if (current_mode != 0 || !rf_configured) {
+                snprintf(response, sizeof(response), "HOP_START: Not available (real data mode not active)\n");
+            } else {
+                ret = hop_start(dwell_frames, slots, cycles);
+                if (ret == 0)
+                    snprintf(response, sizeof(response), "HOP_START: OK (%d slots, %u frames each, %s)\n",
+                             hop.nr_slots, dwell_frames, cycles ? "bounded" : "until hop_stop");
+                else
+                    snprintf(response, sizeof(response), "HOP_START: FAILED (%s)\n",
+                             ret == -EINVAL ? "every slot must be stored, dwell > 0" : strerror(-ret));
+            }
+        } else {
+            snprintf(response, sizeof(response), "ERROR: hop_start requires dwell_frames and slot list (e.g. 0,1,2)\n");
+        }
+        
+    } else if (strcmp(action, "hop_stop") == 0) {
+        hop_stop();
+        snprintf(response, sizeof(response), "HOP_STOP: OK (%" PRIu64 " hops, %" PRIu64 " late, LO on slot %d)\n",
+                 hop.hops, hop.late, lo_active);
+        
+    } else if (strcmp(action, "get_fastlock") == 0) {
+        format_fastlock(response, sizeof(response));
+        
+    } else if (strcmp(action, "sched_add") == 0) {
+        unsigned long long at;
+        char pulse[8], tdd[8], lo[8];
+        if (sscanf(command, "%31s %llu %7s %7s %7s", action, &at, pulse, tdd, lo) == 5) {
+            ret = sched_add(at, pulse, tdd, lo);
+            if (ret == 0)
+                snprintf(response, sizeof(response), "SCHED_ADD: OK (%u staged)\n", sched_staged.count);
+            else
+                snprintf(response, sizeof(response), "SCHED_ADD: FAILED (%s)\n",
+                         ret == -ENOSPC ? "schedule full" :
+                         ret == -ERANGE ? "entries must be added in order" : "modes 0/1, slot 0-7 or -");
+        } else {
+            snprintf(response, sizeof(response), "ERROR: sched_add requires at, pulse mode, TDD mode and LO slot ('-' = unchanged)\n");
+        }
+        
+    } else if (strcmp(action, "sched_arm") == 0) {
+        char unit[16] = "frames";
+        unsigned long long period = 0;
+        sscanf(command, "%*s %15s %llu", unit, &period);
+        if (strcmp(unit, "frames") != 0 && strcmp(unit, "time") != 0) {
+            snprintf(response, sizeof(response), "ERROR: sched_arm takes 'frames' or 'time' and an optional repeat period\n");
+        } else {
+            ret = sched_arm(strcmp(unit, "time") == 0, period);
+            if (ret == 0)
+                snprintf(response, sizeof(response), "SCHED_ARM: OK (%u entries by %s, %s%s)\n",
+                         sched_staged.count, unit, period ? "repeating" : "once",
+                         sched_lo.running ? ", following LO entries" : "");
+            else
+                snprintf(response, sizeof(response), "SCHED_ARM: FAILED (%s)\n",
+                         ret == -EINVAL ? "no entries staged, or refused by the driver" :
+                         ret == -ENODEV ? "LO entries need real data mode with RF configured" :
+                         ret == -ENOENT ? "LO entry names an empty fastlock slot" : strerror(-ret));
+        }
+        
+    } else if (strcmp(action, "sched_clear") == 0) {
+        ret = sched_clear();
+        snprintf(response, sizeof(response), "SCHED_CLEAR: %s\n", ret == 0 ? "OK" : strerror(-ret));
+        
+    } else if (strcmp(action, "get_schedule") == 0) {
+        struct antsdr_sched_status st;
+        if (ioctl(device_fd, ANTSDR_IOC_GET_SCHEDULE, &st) == 0) {
+            snprintf(response, sizeof(response),
+                     "SCHEDULE: staged=%u armed=%u by=%s%s entries=%u next=%u position=%" PRIu64
+                     " passes=%" PRIu64 " applied=%" PRIu64 " late=%" PRIu64 " max_late=%" PRIu64
+                     " errors=%u pulse_mode=%u lo=%d lo_recalls=%" PRIu64 " pulse_offset=%u frames\n",
+                     sched_staged.count, st.armed, (st.flags & ANTSDR_SCHED_BY_TIME) ? "time" : "frames",
+                     (st.flags & ANTSDR_SCHED_REPEAT) ? ",repeat" : "", st.count, st.next, st.position,
+                     st.passes, st.applied, st.late, st.max_late, st.errors, st.pulse_mode,
+                     st.lo_profile == ANTSDR_SCHED_KEEP ? -1 : (int)st.lo_profile,
+                     sched_lo.recalls, st.queue_depth);
+        } else {
+            snprintf(response, sizeof(response), "ERROR: Failed to read schedule: %s\n", strerror(errno));
+        }
+        
+    } else if (strcmp(action, "set_pacing") == 0) {
+        struct antsdr_pacing pacing;
+        memset(&pacing, 0, sizeof(pacing));
+        if (sscanf(command, "%*s %u %u %u %u %u", &pacing.rate_kbps, &pacing.burst_bytes, &pacing.max_backoff_us,
+                   &pacing.overload_high_pct, &pacing.overload_low_pct) >= 1) {
+            if (ioctl(device_fd, ANTSDR_IOC_SET_PACING, &pacing) == 0)
+                snprintf(response, sizeof(response), "SET_PACING: OK (%s)\n", pacing.rate_kbps ? "rate capped" : "unlimited");
+            else
+                snprintf(response, sizeof(response), "SET_PACING: FAILED (%s)\n",
+                         errno == EINVAL ? "backoff up to 1000000 us, 2 <= high <= 100, low < high" : strerror(errno));
+        } else {
+            snprintf(response, sizeof(response), "ERROR: set_pacing requires a rate in kbit/s (0 = unlimited)\n");
+        }
+        
+    } else if (strcmp(action, "get_pacing") == 0) {
+        struct antsdr_pacing_status st;
+        if (ioctl(device_fd, ANTSDR_IOC_GET_PACING, &st) == 0) {
+            snprintf(response, sizeof(response),
+                     "PACING: rate_kbps=%u burst=%u max_backoff_us=%u overload=%u%%/%u%% overloaded=%u backlog=%u%%"
+                     " overload_events=%" PRIu64 " paced_ms=%.1f backoffs=%" PRIu64 " backoff_ms=%.1f"
+                     " backoff_drops=%" PRIu64 "\n",
+                     st.config.rate_kbps, st.config.burst_bytes, st.config.max_backoff_us,
+                     st.config.overload_high_pct, st.config.overload_low_pct, st.overloaded, st.backlog_pct,
+                     st.overload_events, st.paced_ns / 1e6, st.backoffs, st.backoff_ns / 1e6, st.backoff_drops);
+        } else {
+            snprintf(response, sizeof(response), "ERROR: Failed to read pacing: %s\n", strerror(errno));
+        }
+        
+    } else if (strcmp(action, "set_raw_tx") == 0) {
+        char state[8] = "", option[16] = "";
+        struct antsdr_raw_tx raw = { 0 };
+        sscanf(command, "%*s %7s %15s", state, option);
+        if ((strcmp(state, "on") != 0 && strcmp(state, "off") != 0) ||
+            (option[0] && strcmp(option, "bypass") != 0)) {
+            snprintf(response, sizeof(response), "ERROR: set_raw_tx requires on|off and optionally 'bypass'\n");
+        } else {
+            raw.enable = strcmp(state, "on") == 0;
+            raw.flags = option[0] ? ANTSDR_RAW_TX_QDISC_BYPASS : 0;
+            if (ioctl(device_fd, ANTSDR_IOC_SET_RAW_TX, &raw) == 0)
+                snprintf(response, sizeof(response), "SET_RAW_TX: OK (%s%s)\n", state,
+                         raw.flags ? ", qdisc bypass" : "");
+            else
+                snprintf(response, sizeof(response), "SET_RAW_TX: FAILED (%s)\n", strerror(errno));
+        }
+        
+    } else if (strcmp(action, "get_raw_tx") == 0) {
+        struct antsdr_raw_tx_status st;
+        if (ioctl(device_fd, ANTSDR_IOC_GET_RAW_TX, &st) == 0) {
+            snprintf(response, sizeof(response),
+                     "RAW_TX: enable=%u qdisc_bypass=%u dests=%u packets=%" PRIu64 " fallbacks=%" PRIu64
+                     " errors=%" PRIu64 "\n",
+                     st.enable, !!(st.flags & ANTSDR_RAW_TX_QDISC_BYPASS), st.dests, st.packets,
+                     st.fallbacks, st.errors);
+        } else {
+            snprintf(response, sizeof(response), "ERROR: Failed to read raw transmit state: %s\n", strerror(errno));
+        }
+        
+    } else if (strcmp(action, "record_start") == 0) {
+        char path[256];
+        unsigned int buffer_mb = REC_DEFAULT_MB;
+        if (sscanf(command, "%*s %255s %u", path, &buffer_mb) < 1) {
+            snprintf(response, sizeof(response), "ERROR: record_start requires <path> [buffer_mb]\n");
+        } else if ((ret = rec_start(path, buffer_mb)) == 0) {
+            snprintf(response, sizeof(response), "RECORD_START: OK (%s, channel %d, %u MB buffer, %s)\n",
+                     path, rec.channel, buffer_mb, rec.direct ? "O_DIRECT" : "buffered");
+        } else if (ret == -EBUSY) {
+            snprintf(response, sizeof(response), "RECORD_START: FAILED (already recording to %s)\n", rec.path);
+        } else if (ret == -EINVAL) {
+            snprintf(response, sizeof(response), "RECORD_START: FAILED (buffer_mb must be %d..%d)\n",
+                     REC_MIN_MB, REC_MAX_MB);
+        } else if (ret == -EOPNOTSUPP) {
+            snprintf(response, sizeof(response), "RECORD_START: FAILED (ring not mappable - driver loaded with zero_copy=1)\n");
+        } else {
+            snprintf(response, sizeof(response), "RECORD_START: FAILED (%s)\n", strerror(-ret));
+        }
+        
+    } else if (strcmp(action, "record_stop") == 0) {
+        if ((ret = rec_stop()) == -ENOENT) {
+            snprintf(response, sizeof(response), "RECORD_STOP: FAILED (not recording)\n");
+        } else {
+            format_record(response, sizeof(response));
+            if (ret < 0)
+                printf("WARNING: recording %s not completed: %s\n", rec.path, strerror(-ret));
+        }
+        
+    } else if (strcmp(action, "get_record") == 0) {
+        format_record(response, sizeof(response));
+        
     } else if (strcmp(action, "verify_rf_params") == 0) {
         if (current_mode == 0 && rf_configured) {
             ret = verify_rf_parameters(&rf_cfg);
@@ -1208,26 +3322,32 @@ static void process_control_command(const char *command, struct sockaddr_in *cli
         
     } else if (strcmp(action, "configure_rf") == 0) {
         if (current_mode == 0) {
+            char option[16] = "";
+            
+            // "configure_rf force" rewrites every attribute, e.g. after another tool touched the AD9361
+            sscanf(command, "%*s %15s", option);
+            if (strcmp(option, "force") == 0)
+                rf_invalidate();
+            
             ret = configure_rf_parameters(&rf_cfg);
             if (ret == 0) {
                 rf_configured = 1;
-                // Also verify the parameters after configuration
-                verify_rf_parameters(&rf_cfg);
-                snprintf(response, sizeof(response), "CONFIGURE_RF: OK (all parameters applied and verified)\n");
+                // Verify only what this configure changed
+                rf_last.mismatches = rf_verify(rf_last.written);
+                rf_end();
+                snprintf(response, sizeof(response),
+                         "CONFIGURE_RF: %s (%d written, %d unchanged, %d mismatched, %.0f us)\n",
+                         rf_last.mismatches ? "MISMATCH" : "OK", rf_last.writes, rf_last.unchanged,
+                         rf_last.mismatches, rf_last.elapsed_us);
             } else {
-                snprintf(response, sizeof(response), "CONFIGURE_RF: FAILED\n");
+                snprintf(response, sizeof(response), "CONFIGURE_RF: FAILED (%.0f us)\n", rf_last.elapsed_us);
             }
         } else {
             snprintf(response, sizeof(response), "CONFIGURE_RF: Not available (only in real data mode)\n");
         }
         
     } else if (strcmp(action, "get_rf_config") == 0) {
-        snprintf(response, sizeof(response), 
-                 "RF_CONFIG: RX_FREQ=%lld RX_BW=%lld RX_FS=%lld RX_GAIN_MODE=%s RX_GAIN=%.2f RX_PORT=%s "
-                 "TX_FREQ=%lld TX_BW=%lld TX_FS=%lld TX_GAIN=%.2f TX_PORT=%s TX_EN=%d ENSM=%s\n",
-                 rf_cfg.rx_lo_hz, rf_cfg.rx_bw_hz, rf_cfg.rx_fs_hz, rf_cfg.rx_gain_mode, rf_cfg.rx_gain_db, rf_cfg.rx_rfport,
-                 rf_cfg.tx_lo_hz, rf_cfg.tx_bw_hz, rf_cfg.tx_fs_hz, rf_cfg.tx_gain_db, rf_cfg.tx_rfport, 
-                 rf_cfg.tx_enabled, rf_cfg.ensm_mode);
+        format_rf_config(response, sizeof(response));
         
     } else if (strcmp(action, "set_pulse_mode") == 0) {
         uint32_t pulse_mode;
@@ -1296,7 +3416,8 @@ static void *control_thread_func(void *arg)
     int control_port = *(int *)arg;
     struct sockaddr_in server_addr, client_addr;
     socklen_t client_len = sizeof(client_addr);
-    char buffer[MAX_COMMAND_LEN];
+    char buffer[ANTSDR_CTRL_MAX_DATAGRAM];
+    uint32_t magic;
     int ret;
     
     control_sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -1342,6 +3463,13 @@ static void *control_thread_func(void *arg)
         if (ret > 0 && FD_ISSET(control_sock, &readfds)) {
             ssize_t received = recvfrom(control_sock, buffer, sizeof(buffer) - 1, 0,
                                       (struct sockaddr *)&client_addr, &client_len);
+            if (received >= (ssize_t)sizeof(struct antsdr_ctrl_header)) {
+                memcpy(&magic, buffer, sizeof(magic));
+                if (ntohl(magic) == ANTSDR_CTRL_MAGIC) {
+                    process_binary_command((const uint8_t *)buffer, received, &client_addr);
+                    continue;
+                }
+            }
             if (received > 0) {
                 buffer[received] = '\0';
                 // Remove trailing newline if present
@@ -1395,15 +3523,23 @@ int main(int argc, char *argv[])
     printf("Verbose Mode: %s\n", verbose ? "enabled" : "disabled");
     printf("\n");
     
-    // Open device
-    device_fd = open(DEVICE_NAME, O_RDWR);
+    // Open every channel's device - the first one must be there
+    for (int i = 0; i < MAX_CHANNELS; i++) {
+        char path[64];
+
+        channel_path(i, path, sizeof(path));
+        channels[i].fd = open(path, O_RDWR);
+        channels[i].state = STATE_STANDBY;
+        channels[i].buffer_size = current_buffer_size;
+        if (channels[i].fd >= 0)
+            printf("Device %s opened successfully\n", path);
+    }
+    device_fd = channels[0].fd;
     if (device_fd < 0) {
         perror("Failed to open device");
         return 1;
     }
     
-    printf("Device %s opened successfully\n", DEVICE_NAME);
-    
     // Initialize device to known state
     current_mode = 0;
     ioctl(device_fd, ANTSDR_IOC_SET_MODE, &current_mode);
@@ -1441,8 +3577,13 @@ int main(int argc, char *argv[])
     }
     
     pthread_join(control_thread, NULL);
+    rec_stop();            // Before the channel fds it maps go away
     cleanup_rf_context();  // Clean up RF resources
-    close(device_fd);
+    // Closing a channel stops its stream
+    for (int i = 0; i < MAX_CHANNELS; i++) {
+        if (channels[i].fd >= 0)
+            close(channels[i].fd);
+    }
     
     printf("Application terminated\n");
     return 0;
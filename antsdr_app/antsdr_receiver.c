@@ -0,0 +1,987 @@
+/**
+ * @file antsdr_receiver.c
+ * @brief ANTSDR DMA native UDP receiver - runs on the PC side
+ *
+ * Receives the driver's UDP stream with recvmmsg() into a preallocated pool,
+ * reassembles fragmented frames by frame_id, and hands complete frames and
+ * aggregated datagrams to a worker thread that verifies checksums, decodes
+ * compressed aggregates and writes frames to an mmap'd output ring.
+ *
+ * Drops are reported split by where they happened:
+ *   net     - datagrams lost between the board and this host (sequence gaps)
+ *   device  - frames the driver saw missing from the FPGA (missing_frame_count)
+ *   partial - frames whose fragments never all arrived
+ *   overload- datagrams this receiver had no buffer for
+ *
+ * Build: gcc -O2 -Wall -o antsdr_receiver antsdr_receiver.c -lpthread
+ *
+ * Output ring (-o FILE, use /dev/shm/NAME for shared memory): a
+ * struct rx_ring_header page followed by nr_slots fixed-size slots, each a
+ * struct rx_slot_header and the frame payload. The writer stores the slot,
+ * then publishes it by bumping head (frames written, free-running); a reader
+ * owns nothing and re-checks a slot's seq after copying it to detect that
+ * the writer lapped it.
+ *
+ * Capture (-w FILE): the same frames are also recorded in the indexed
+ * antsdr_capture.h format for antsdr_capture to seek in and replay. With
+ * -c HOST[:PORT] the board's get_rf_config reply is stored as the capture's
+ * rf_config metadata.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <endian.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "antsdr_capture.h"
+
+/* Packet protocol - matches driver */
+#define ANTSDR_PACKET_START_MARKER     0xABCD1234
+#define ANTSDR_AGG_START_MARKER        0xABCD1235
+#define ANTSDR_AGG_START_MARKER_Z      0xABCD1236
+#define ANTSDR_PACKET_START_MARKER_V2  0xABCD2234
+#define ANTSDR_AGG_START_MARKER_V2     0xABCD2235
+#define ANTSDR_AGG_START_MARKER_Z_V2   0xABCD2236
+#define ANTSDR_PACKET_HEADER_SIZE      48
+#define ANTSDR_PACKET_HEADER_V2_SIZE   44
+#define ANTSDR_AGG_FRAME_HEADER_SIZE   8
+#define ANTSDR_AGG_FRAME_HEADER_V2_SIZE 12
+#define ANTSDR_AGG_FRAME_COMPRESSED    0x1
+#define ANTSDR_HDR_CSUM_SHIFT          2
+#define ANTSDR_HDR_LO_SHIFT            6          /* Fastlock LO tag, v2 header flags */
+#define ANTSDR_AGG_FRAME_LO_SHIFT      1          /* ...and aggregate per-frame flags */
+#define ANTSDR_LO_TAG_MASK             0xf
+#define ANTSDR_HDR_CHAN_SHIFT          10         /* Board channel (RX path), v2 header flags */
+#define ANTSDR_CHAN_MASK               0x3
+#define ANTSDR_CSUM_PAYLOAD            0
+#define ANTSDR_CSUM_NONE               1
+#define ANTSDR_CSUM_HEADER             2
+#define ANTSDR_CSUM_FRAME              3
+#define ANTSDR_ZPACK_BLOCK             32
+
+/* Receiver geometry */
+#define DEFAULT_PORT           12288
+#define DEFAULT_CONTROL_PORT   12346
+#define DEFAULT_RCVBUF_MB      64
+#define DEFAULT_SLOT_SIZE      2048       /* Output slot, header included */
+#define DEFAULT_RING_SLOTS     65536
+#define RX_BATCH               64         /* Datagrams per recvmmsg() */
+#define RX_DATAGRAM_MAX        9216       /* Jumbo frames */
+#define RX_MAX_FRAME           65536      /* v2 sizes are 16-bit */
+#define RX_MAX_FRAGMENTS       64
+#define RX_POOL_SIZE           256        /* Jobs in flight, power of two */
+#define RX_REASM_SLOTS         64         /* Frames reassembled at once */
+
+enum rx_job_type {
+    RX_JOB_FRAME,       /* Frame reassembled from fragments */
+    RX_JOB_AGGREGATE,   /* Whole aggregated datagram, split by the worker */
+};
+
+/* One unit of work for the CRC worker - a reassembled frame or an aggregate */
+struct rx_job {
+    enum rx_job_type type;
+    int version;
+    unsigned int csum_mode;
+    unsigned int lo_tag;                  /* Frame: LO tag from the header flags */
+    unsigned int channel;                 /* Board channel from the header flags */
+    uint32_t frame_id;
+    uint32_t frame_counter;
+    uint64_t timestamp_ns;
+    uint32_t length;                      /* Bytes in data */
+    uint32_t header_checksum;             /* Aggregate: checksum field of the datagram */
+    unsigned int nr_frags;
+    unsigned int received;
+    uint64_t frag_mask;
+    uint64_t header_bad;                  /* ANTSDR_CSUM_HEADER: fragments (aggregate: bit 0) that failed */
+    uint32_t frag_crc[RX_MAX_FRAGMENTS];
+    uint32_t frag_off[RX_MAX_FRAGMENTS];
+    uint32_t frag_len[RX_MAX_FRAGMENTS];
+    uint8_t data[RX_MAX_FRAME];
+};
+
+/* Single-producer single-consumer queue of job indices */
+struct rx_queue {
+    _Atomic unsigned int head;
+    _Atomic unsigned int tail;
+    unsigned int slots[RX_POOL_SIZE];
+};
+
+/* Output ring layout */
+#define RX_RING_MAGIC          0x52585241  /* "ARXR" */
+#define RX_RING_VERSION        1
+#define RX_RING_HEADER_SIZE    4096
+
+#define RX_FRAME_CRC_OK        0x1         /* Checksum verified */
+#define RX_FRAME_CRC_BAD       0x2         /* Checksum mismatch, payload kept */
+#define RX_FRAME_DECODED       0x4         /* Was compressed on the wire */
+#define RX_FRAME_TRUNCATED     0x8         /* Longer than a slot */
+#define RX_FRAME_LO_SHIFT      4           /* Bits 4-7: LO tag, 0x8 | fastlock profile, 0 = none */
+#define RX_FRAME_CHAN_SHIFT    8           /* Bits 8-9: board channel (version 2 headers) */
+
+struct rx_ring_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_size;                   /* Bytes per slot, header included */
+    uint32_t nr_slots;
+    _Atomic uint64_t head;                /* Frames written, free-running */
+};
+
+struct rx_slot_header {
+    uint64_t seq;                         /* head value this slot was written for */
+    uint64_t timestamp_ns;
+    uint32_t frame_id;
+    uint32_t frame_counter;
+    uint32_t length;                      /* Payload bytes that follow */
+    uint32_t flags;                       /* RX_FRAME_* */
+};
+
+struct rx_stats {
+    _Atomic uint64_t packets;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t frames;
+    _Atomic uint64_t net_lost;
+    _Atomic uint64_t reordered;
+    _Atomic uint64_t partial;
+    _Atomic uint64_t overload;
+    _Atomic uint64_t crc_errors;
+    _Atomic uint64_t bad_packets;
+    _Atomic uint64_t device_missing;
+};
+
+/* Global state */
+static volatile int keep_running = 1;
+static struct rx_job *job_pool;
+static struct rx_queue ready_queue;       /* RX thread -> worker */
+static struct rx_queue free_queue;        /* Worker -> RX thread */
+static struct rx_stats stats;
+static uint8_t *ring_map;
+static size_t ring_map_size;
+static struct rx_ring_header *ring_hdr;
+static uint32_t crc_table[256];
+static struct antsdr_capture_writer capture;
+static bool capturing;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    keep_running = 0;
+}
+
+/* Kernel crc32(0, ...) - reflected 0xEDB88320, no pre/post inversion */
+static void crc32_init(void)
+{
+    uint32_t i, j, c;
+
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (j = 0; j < 8; j++)
+            c = (c >> 1) ^ (c & 1 ? 0xEDB88320 : 0);
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32_le(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while (len--)
+        crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static inline uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint16_t get_be16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint64_t get_be64(const uint8_t *p)
+{
+    return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
+static bool queue_push(struct rx_queue *q, unsigned int v)
+{
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+    if (head - tail == RX_POOL_SIZE)
+        return false;
+    q->slots[head & (RX_POOL_SIZE - 1)] = v;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+static bool queue_pop(struct rx_queue *q, unsigned int *v)
+{
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_acquire);
+
+    if (head == tail)
+        return false;
+    *v = q->slots[tail & (RX_POOL_SIZE - 1)];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/* ANTSDR_CSUM_HEADER: CRC32 of the header with sequence and checksum as 0 */
+static bool header_crc_ok(const uint8_t *pkt, size_t header_size)
+{
+    uint8_t header[ANTSDR_PACKET_HEADER_SIZE];
+
+    memcpy(header, pkt, header_size);
+    memset(header + 4, 0, 4);
+    memset(header + 40, 0, 4);
+    return crc32_le(0, header, header_size) == get_be32(pkt + 40);
+}
+
+/* Inverse of the driver's antsdr_zpack(). Returns the raw length, 0 if malformed. */
+static size_t zpack_decode(const uint8_t *in, size_t in_len, const uint8_t *ref, size_t ref_len,
+                           uint8_t *out, size_t out_max)
+{
+    size_t raw_len, lanes, pos = 3, b, i;
+    uint16_t *lane = (uint16_t *)out;
+    int inter;
+
+    if (in_len < 3)
+        return 0;
+    raw_len = get_be16(in);
+    inter = in[2];
+    lanes = raw_len / 2;
+    if (raw_len > out_max || (inter && (!ref || ref_len != raw_len)))
+        return 0;
+
+    for (b = 0; b < lanes; b += ANTSDR_ZPACK_BLOCK) {
+        size_t cnt = lanes - b < ANTSDR_ZPACK_BLOCK ? lanes - b : ANTSDR_ZPACK_BLOCK;
+        unsigned int width, bits = 0;
+        uint64_t acc = 0;
+
+        if (pos >= in_len)
+            return 0;
+        width = in[pos++];
+        if (width > 16 || pos + (cnt * width + 7) / 8 > in_len)
+            return 0;
+
+        for (i = 0; i < cnt; i++) {
+            size_t n = b + i;
+            uint16_t z, pred;
+            int16_t r;
+
+            while (bits < width) {
+                acc |= (uint64_t)in[pos++] << bits;
+                bits += 8;
+            }
+            z = acc & ((1u << width) - 1);
+            acc >>= width;
+            bits -= width;
+
+            r = (int16_t)((z >> 1) ^ -(z & 1));
+            if (inter)
+                pred = (uint16_t)(ref[2 * n] | (ref[2 * n + 1] << 8));
+            else
+                pred = n >= 2 ? le16toh(lane[n - 2]) : 0;
+            lane[n] = htole16((uint16_t)(pred + r));
+        }
+    }
+    return raw_len;
+}
+
+/* Worker: store one frame in the output ring */
+static void ring_write(uint32_t frame_id, uint32_t frame_counter, uint64_t timestamp_ns,
+                       const uint8_t *payload, size_t len, uint32_t flags)
+{
+    struct rx_slot_header *slot;
+    uint64_t head;
+    size_t room;
+
+    atomic_fetch_add_explicit(&stats.frames, 1, memory_order_relaxed);
+    if (capturing &&
+        antsdr_capture_append(&capture, frame_id, frame_counter, timestamp_ns, flags, payload, len) < 0) {
+        fprintf(stderr, "\nCapture write failed, recording stopped: %s\n", strerror(errno));
+        capturing = false;
+    }
+    if (!ring_hdr)
+        return;
+
+    head = atomic_load_explicit(&ring_hdr->head, memory_order_relaxed);
+    slot = (struct rx_slot_header *)(ring_map + RX_RING_HEADER_SIZE +
+                                     (size_t)(head % ring_hdr->nr_slots) * ring_hdr->slot_size);
+    room = ring_hdr->slot_size - sizeof(*slot);
+    if (len > room) {
+        len = room;
+        flags |= RX_FRAME_TRUNCATED;
+    }
+
+    slot->seq = head;
+    slot->timestamp_ns = timestamp_ns;
+    slot->frame_id = frame_id;
+    slot->frame_counter = frame_counter;
+    slot->length = len;
+    slot->flags = flags;
+    memcpy(slot + 1, payload, len);
+    atomic_store_explicit(&ring_hdr->head, head + 1, memory_order_release);
+}
+
+/* Worker: verify a reassembled frame */
+static void process_frame_job(struct rx_job *job)
+{
+    uint32_t flags = 0;
+    unsigned int i;
+    bool ok = true;
+
+    switch (job->csum_mode) {
+    case ANTSDR_CSUM_PAYLOAD:
+        for (i = 0; i < job->nr_frags; i++)
+            ok &= crc32_le(0, job->data + job->frag_off[i], job->frag_len[i]) == job->frag_crc[i];
+        flags = ok ? RX_FRAME_CRC_OK : RX_FRAME_CRC_BAD;
+        break;
+    case ANTSDR_CSUM_FRAME:
+        ok = crc32_le(0, job->data, job->length) == job->frag_crc[0];
+        flags = ok ? RX_FRAME_CRC_OK : RX_FRAME_CRC_BAD;
+        break;
+    case ANTSDR_CSUM_HEADER:
+        /* Checked and counted per packet on the RX thread */
+        flags = job->header_bad ? RX_FRAME_CRC_BAD : RX_FRAME_CRC_OK;
+        break;
+    default:
+        break;
+    }
+    if (!ok)
+        atomic_fetch_add_explicit(&stats.crc_errors, 1, memory_order_relaxed);
+
+    flags |= job->lo_tag << RX_FRAME_LO_SHIFT | job->channel << RX_FRAME_CHAN_SHIFT;
+    ring_write(job->frame_id, job->frame_counter, job->timestamp_ns, job->data, job->length, flags);
+}
+
+/* Worker: verify an aggregated datagram and split it into frames */
+static void process_aggregate_job(struct rx_job *job)
+{
+    static uint8_t decoded[2][RX_MAX_FRAME];
+    size_t header_size = job->version == 2 ? ANTSDR_PACKET_HEADER_V2_SIZE : ANTSDR_PACKET_HEADER_SIZE;
+    size_t frame_header_size = job->version == 2 ? ANTSDR_AGG_FRAME_HEADER_V2_SIZE : ANTSDR_AGG_FRAME_HEADER_SIZE;
+    const uint8_t *ref = NULL;
+    size_t ref_len = 0, pos = header_size;
+    uint32_t flags = 0, index = 0;
+    int cur = 0;
+
+    if (job->csum_mode == ANTSDR_CSUM_PAYLOAD || job->csum_mode == ANTSDR_CSUM_FRAME) {
+        if (crc32_le(0, job->data + header_size, job->length - header_size) == job->header_checksum) {
+            flags = RX_FRAME_CRC_OK;
+        } else {
+            flags = RX_FRAME_CRC_BAD;
+            atomic_fetch_add_explicit(&stats.crc_errors, 1, memory_order_relaxed);
+        }
+    } else if (job->csum_mode == ANTSDR_CSUM_HEADER) {
+        flags = job->header_bad ? RX_FRAME_CRC_BAD : RX_FRAME_CRC_OK;
+    }
+    flags |= job->channel << RX_FRAME_CHAN_SHIFT;
+
+    while (pos + frame_header_size <= job->length) {
+        const uint8_t *fh = job->data + pos;
+        uint32_t frame_counter = get_be32(fh);
+        size_t len = get_be16(fh + 4);
+        uint16_t frame_flags = get_be16(fh + 6);
+        uint64_t ts = job->timestamp_ns;
+        const uint8_t *payload = fh + frame_header_size;
+        uint32_t out_flags = flags | ((frame_flags >> ANTSDR_AGG_FRAME_LO_SHIFT) & ANTSDR_LO_TAG_MASK) << RX_FRAME_LO_SHIFT;
+
+        if (job->version == 2)
+            ts += get_be32(fh + 8);
+        pos += frame_header_size;
+        if (pos + len > job->length) {
+            atomic_fetch_add_explicit(&stats.bad_packets, 1, memory_order_relaxed);
+            break;
+        }
+        pos += len;
+
+        if (frame_flags & ANTSDR_AGG_FRAME_COMPRESSED) {
+            size_t raw = zpack_decode(payload, len, ref, ref_len, decoded[cur], sizeof(decoded[cur]));
+
+            if (!raw) {
+                atomic_fetch_add_explicit(&stats.bad_packets, 1, memory_order_relaxed);
+                break;
+            }
+            payload = decoded[cur];
+            len = raw;
+            cur ^= 1;
+            out_flags |= RX_FRAME_DECODED;
+        }
+
+        ring_write(job->frame_id + index++, frame_counter, ts, payload, len, out_flags);
+        ref = payload;
+        ref_len = len;
+    }
+}
+
+static void *worker_thread_func(void *arg)
+{
+    struct timespec idle = { 0, 100000 };
+    unsigned int idx;
+
+    (void)arg;
+    while (keep_running || atomic_load(&ready_queue.head) != atomic_load(&ready_queue.tail)) {
+        if (!queue_pop(&ready_queue, &idx)) {
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        if (job_pool[idx].type == RX_JOB_FRAME)
+            process_frame_job(&job_pool[idx]);
+        else
+            process_aggregate_job(&job_pool[idx]);
+        queue_push(&free_queue, idx);
+    }
+    return NULL;
+}
+
+/* RX thread state */
+struct rx_reasm_slot {
+    int job;                              /* Job index, -1 = empty */
+    uint32_t frame_id;
+};
+
+static struct rx_reasm_slot reasm[RX_REASM_SLOTS];
+static int reclaimed[RX_POOL_SIZE];       /* Jobs taken back from reassembly */
+static unsigned int nr_reclaimed;
+static bool seq_valid;
+static uint32_t seq_expected;
+static bool missing_valid;
+static uint32_t missing_first;
+
+static int job_get(void)
+{
+    unsigned int idx;
+
+    if (nr_reclaimed)
+        return reclaimed[--nr_reclaimed];
+    if (!queue_pop(&free_queue, &idx)) {
+        atomic_fetch_add_explicit(&stats.overload, 1, memory_order_relaxed);
+        return -1;
+    }
+    return idx;
+}
+
+static void job_submit(int idx)
+{
+    /* Never fails: at most RX_POOL_SIZE jobs exist */
+    queue_push(&ready_queue, idx);
+}
+
+static void track_sequence(uint32_t seq)
+{
+    int32_t diff;
+
+    if (!seq_valid) {
+        seq_valid = true;
+        seq_expected = seq + 1;
+        return;
+    }
+    diff = (int32_t)(seq - seq_expected);
+    if (diff >= 0) {
+        atomic_fetch_add_explicit(&stats.net_lost, diff, memory_order_relaxed);
+        seq_expected = seq + 1;
+    } else {
+        /* Late arrival - it was counted lost when the gap opened */
+        atomic_fetch_add_explicit(&stats.reordered, 1, memory_order_relaxed);
+        if (atomic_load_explicit(&stats.net_lost, memory_order_relaxed))
+            atomic_fetch_sub_explicit(&stats.net_lost, 1, memory_order_relaxed);
+    }
+}
+
+static void track_missing(uint32_t missing)
+{
+    if (!missing_valid) {
+        missing_valid = true;
+        missing_first = missing;
+    }
+    atomic_store_explicit(&stats.device_missing, missing - missing_first, memory_order_relaxed);
+}
+
+/* Parsed common header fields */
+struct rx_header {
+    int version;
+    bool aggregate;
+    uint32_t frame_id;
+    uint32_t frame_counter;
+    uint64_t timestamp_ns;
+    uint32_t payload_len;
+    uint32_t frag_off;
+    uint32_t frag_idx;
+    uint32_t frag_count;
+    uint32_t frame_total;
+    unsigned int csum_mode;
+    unsigned int lo_tag;
+    unsigned int channel;
+    uint32_t checksum;
+    size_t size;
+};
+
+static bool parse_header(const uint8_t *pkt, size_t len, struct rx_header *h)
+{
+    uint32_t marker;
+
+    if (len < 4)
+        return false;
+    marker = get_be32(pkt);
+    memset(h, 0, sizeof(*h));
+
+    switch (marker) {
+    case ANTSDR_PACKET_START_MARKER:
+    case ANTSDR_AGG_START_MARKER:
+    case ANTSDR_AGG_START_MARKER_Z:
+        if (len < ANTSDR_PACKET_HEADER_SIZE)
+            return false;
+        h->version = 1;
+        h->size = ANTSDR_PACKET_HEADER_SIZE;
+        h->aggregate = marker != ANTSDR_PACKET_START_MARKER;
+        h->payload_len = get_be32(pkt + 12);
+        h->frame_id = get_be32(pkt + 16);
+        h->frag_off = get_be32(pkt + 20);
+        h->frag_count = get_be32(pkt + 24);
+        h->frag_idx = get_be32(pkt + 28);
+        h->frame_total = get_be32(pkt + 32);
+        h->csum_mode = ANTSDR_CSUM_PAYLOAD;  /* v1 can't advertise it */
+        break;
+    case ANTSDR_PACKET_START_MARKER_V2:
+    case ANTSDR_AGG_START_MARKER_V2:
+    case ANTSDR_AGG_START_MARKER_Z_V2:
+        if (len < ANTSDR_PACKET_HEADER_V2_SIZE)
+            return false;
+        h->version = 2;
+        h->size = ANTSDR_PACKET_HEADER_V2_SIZE;
+        h->aggregate = marker != ANTSDR_PACKET_START_MARKER_V2;
+        h->frame_id = get_be32(pkt + 8);
+        h->frame_counter = get_be32(pkt + 12);
+        h->timestamp_ns = get_be64(pkt + 16);
+        h->payload_len = get_be16(pkt + 24);
+        h->frag_off = get_be16(pkt + 26);
+        h->frag_idx = pkt[28];
+        h->frag_count = pkt[29];
+        h->csum_mode = (get_be16(pkt + 30) >> ANTSDR_HDR_CSUM_SHIFT) & 0x3;
+        h->lo_tag = (get_be16(pkt + 30) >> ANTSDR_HDR_LO_SHIFT) & ANTSDR_LO_TAG_MASK;
+        h->channel = (get_be16(pkt + 30) >> ANTSDR_HDR_CHAN_SHIFT) & ANTSDR_CHAN_MASK;
+        h->frame_total = get_be16(pkt + 32);
+        break;
+    default:
+        return false;
+    }
+
+    h->checksum = get_be32(pkt + 40);  /* Same offset in v1 and v2 */
+    track_sequence(get_be32(pkt + 4));
+    track_missing(get_be32(pkt + 36));
+    return h->size + h->payload_len <= len;
+}
+
+/* RX thread: one datagram */
+static void handle_datagram(const uint8_t *pkt, size_t len)
+{
+    struct rx_header h;
+    struct rx_reasm_slot *slot;
+    struct rx_job *job;
+    bool header_bad = false;
+    int idx;
+
+    atomic_fetch_add_explicit(&stats.packets, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats.bytes, len, memory_order_relaxed);
+
+    if (!parse_header(pkt, len, &h)) {
+        atomic_fetch_add_explicit(&stats.bad_packets, 1, memory_order_relaxed);
+        return;
+    }
+    if (h.csum_mode == ANTSDR_CSUM_HEADER && !header_crc_ok(pkt, h.size)) {
+        atomic_fetch_add_explicit(&stats.crc_errors, 1, memory_order_relaxed);
+        header_bad = true;
+    }
+
+    /* Aggregates are self-contained - the worker verifies and splits them */
+    if (h.aggregate) {
+        idx = job_get();
+        if (idx < 0)
+            return;
+        job = &job_pool[idx];
+        job->type = RX_JOB_AGGREGATE;
+        job->version = h.version;
+        job->csum_mode = h.csum_mode;
+        job->channel = h.channel;
+        job->frame_id = h.frame_id;
+        job->timestamp_ns = h.timestamp_ns;
+        job->header_checksum = h.checksum;
+        job->header_bad = header_bad;
+        job->length = h.size + h.payload_len;
+        memcpy(job->data, pkt, job->length);
+        job_submit(idx);
+        return;
+    }
+
+    if (!h.frag_count || h.frag_count > RX_MAX_FRAGMENTS || h.frag_idx >= h.frag_count ||
+        h.frame_total > RX_MAX_FRAME || h.frag_off + h.payload_len > h.frame_total) {
+        atomic_fetch_add_explicit(&stats.bad_packets, 1, memory_order_relaxed);
+        return;
+    }
+
+    slot = &reasm[h.frame_id % RX_REASM_SLOTS];
+    if (slot->job >= 0 && slot->frame_id != h.frame_id) {
+        /* An older frame still waiting for fragments - give up on it */
+        atomic_fetch_add_explicit(&stats.partial, 1, memory_order_relaxed);
+        reclaimed[nr_reclaimed++] = slot->job;
+        slot->job = -1;
+    }
+    if (slot->job < 0) {
+        idx = job_get();
+        if (idx < 0)
+            return;
+        job = &job_pool[idx];
+        job->type = RX_JOB_FRAME;
+        job->version = h.version;
+        job->csum_mode = h.csum_mode;
+        job->frame_id = h.frame_id;
+        job->frame_counter = h.frame_counter;
+        job->timestamp_ns = h.timestamp_ns;
+        job->lo_tag = h.lo_tag;
+        job->channel = h.channel;
+        job->length = h.frame_total;
+        job->nr_frags = h.frag_count;
+        job->received = 0;
+        job->frag_mask = 0;
+        job->header_bad = 0;
+        slot->job = idx;
+        slot->frame_id = h.frame_id;
+    }
+
+    job = &job_pool[slot->job];
+    if (job->frag_mask & (1ULL << h.frag_idx))
+        return;  /* Duplicate */
+    job->frag_mask |= 1ULL << h.frag_idx;
+    if (header_bad)
+        job->header_bad |= 1ULL << h.frag_idx;
+    job->frag_crc[h.frag_idx] = h.checksum;
+    job->frag_off[h.frag_idx] = h.frag_off;
+    job->frag_len[h.frag_idx] = h.payload_len;
+    memcpy(job->data + h.frag_off, pkt + h.size, h.payload_len);
+
+    if (++job->received == job->nr_frags) {
+        job_submit(slot->job);
+        slot->job = -1;
+    }
+}
+
+static int open_socket(int port, int rcvbuf_mb)
+{
+    struct sockaddr_in addr;
+    struct timeval tv = { 1, 0 };
+    int rcvbuf = rcvbuf_mb * 1024 * 1024;
+    int actual = 0;
+    socklen_t optlen = sizeof(actual);
+    int sock;
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("Failed to create socket");
+        return -1;
+    }
+
+    /* SO_RCVBUFFORCE ignores rmem_max but needs CAP_NET_ADMIN */
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &actual, &optlen);
+    if (actual / 2 < rcvbuf)
+        printf("Warning: receive buffer is %d KB, raise net.core.rmem_max for %d MB\n",
+               actual / 2 / 1024, rcvbuf_mb);
+
+    /* Wake up once a second to notice shutdown */
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Failed to bind socket");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static int open_ring(const char *path, unsigned int slot_size, unsigned int nr_slots)
+{
+    int fd;
+
+    ring_map_size = RX_RING_HEADER_SIZE + (size_t)slot_size * nr_slots;
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Failed to open output file");
+        return -1;
+    }
+    if (ftruncate(fd, ring_map_size) < 0) {
+        perror("Failed to size output file");
+        close(fd);
+        return -1;
+    }
+    ring_map = mmap(NULL, ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring_map == MAP_FAILED) {
+        perror("Failed to map output file");
+        ring_map = NULL;
+        return -1;
+    }
+
+    ring_hdr = (struct rx_ring_header *)ring_map;
+    ring_hdr->magic = RX_RING_MAGIC;
+    ring_hdr->version = RX_RING_VERSION;
+    ring_hdr->slot_size = slot_size;
+    ring_hdr->nr_slots = nr_slots;
+    atomic_store(&ring_hdr->head, 0);
+    return 0;
+}
+
+/* Ask the board's control port for the RF configuration in force */
+static int fetch_rf_config(const char *target, struct antsdr_capture_meta *meta)
+{
+    struct sockaddr_in addr;
+    struct timeval tv = { 2, 0 };
+    char host[64], reply[1024];
+    const char *cmd = "get_rf_config";
+    char *colon;
+    ssize_t n;
+    int sock;
+
+    snprintf(host, sizeof(host), "%s", target);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(DEFAULT_CONTROL_PORT);
+    colon = strchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        addr.sin_port = htons(atoi(colon + 1));
+    }
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Invalid control address: %s\n", target);
+        return -1;
+    }
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("Failed to create control socket");
+        return -1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (sendto(sock, cmd, strlen(cmd), 0, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        (n = recv(sock, reply, sizeof(reply) - 1, 0)) <= 0) {
+        fprintf(stderr, "No get_rf_config reply from %s, capture has no rf_config\n", target);
+        close(sock);
+        return -1;
+    }
+    close(sock);
+    reply[n] = '\0';
+    antsdr_capture_meta_parse(meta, reply);
+    return 0;
+}
+
+static void print_stats(double elapsed, uint64_t last_bytes, double interval)
+{
+    uint64_t bytes = atomic_load(&stats.bytes);
+
+    printf("\rpkts=%" PRIu64 " frames=%" PRIu64 " %.1f Mbit/s | drops: net=%" PRIu64
+           " device=%" PRIu64 " partial=%" PRIu64 " overload=%" PRIu64
+           " | crc_err=%" PRIu64 " bad=%" PRIu64 " reorder=%" PRIu64 " | %.0fs   ",
+           atomic_load(&stats.packets), atomic_load(&stats.frames),
+           interval > 0 ? (bytes - last_bytes) * 8.0 / interval / 1e6 : 0.0,
+           atomic_load(&stats.net_lost), atomic_load(&stats.device_missing),
+           atomic_load(&stats.partial), atomic_load(&stats.overload),
+           atomic_load(&stats.crc_errors), atomic_load(&stats.bad_packets),
+           atomic_load(&stats.reordered), elapsed);
+    fflush(stdout);
+}
+
+static void print_usage(const char *prog)
+{
+    printf("Usage: %s [options]\n", prog);
+    printf("Options:\n");
+    printf("  -p <port>      UDP port to listen on (default: %d)\n", DEFAULT_PORT);
+    printf("  -b <MB>        Socket receive buffer (default: %d MB)\n", DEFAULT_RCVBUF_MB);
+    printf("  -o <file>      Write frames to an mmap'd ring file (/dev/shm/NAME for shared memory)\n");
+    printf("  -s <slots>     Ring slots (default: %d)\n", DEFAULT_RING_SLOTS);
+    printf("  -S <bytes>     Slot size, header included (default: %d)\n", DEFAULT_SLOT_SIZE);
+    printf("  -w <file>      Record frames to an indexed capture file\n");
+    printf("  -c <host[:port]> Board control address, stores its rf_config in the capture (port default: %d)\n",
+           DEFAULT_CONTROL_PORT);
+    printf("  -I <frames>    Capture index interval (default: %d)\n", ANTSDR_CAPTURE_INTERVAL);
+    printf("  -h             Show this help\n");
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t rx_buf[RX_BATCH][RX_DATAGRAM_MAX];
+    struct mmsghdr msgs[RX_BATCH];
+    struct iovec iov[RX_BATCH];
+    const char *output = NULL;
+    const char *capture_path = NULL;
+    const char *control = NULL;
+    struct antsdr_capture_meta meta;
+    unsigned int interval = ANTSDR_CAPTURE_INTERVAL;
+    unsigned int nr_slots = DEFAULT_RING_SLOTS;
+    unsigned int slot_size = DEFAULT_SLOT_SIZE;
+    int port = DEFAULT_PORT;
+    int rcvbuf_mb = DEFAULT_RCVBUF_MB;
+    pthread_t worker;
+    double start, last;
+    uint64_t last_bytes = 0;
+    int opt, sock, i, n;
+
+    while ((opt = getopt(argc, argv, "p:b:o:s:S:w:c:I:h")) != -1) {
+        switch (opt) {
+        case 'p':
+            port = atoi(optarg);
+            if (port <= 0 || port > 65535) {
+                fprintf(stderr, "Invalid port: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'b':
+            rcvbuf_mb = atoi(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 's':
+            nr_slots = strtoul(optarg, NULL, 0);
+            break;
+        case 'S':
+            slot_size = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            capture_path = optarg;
+            break;
+        case 'c':
+            control = optarg;
+            break;
+        case 'I':
+            interval = strtoul(optarg, NULL, 0);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!nr_slots || slot_size < sizeof(struct rx_slot_header) + 4) {
+        fprintf(stderr, "Invalid ring geometry\n");
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    crc32_init();
+
+    job_pool = calloc(RX_POOL_SIZE, sizeof(*job_pool));
+    if (!job_pool) {
+        fprintf(stderr, "Failed to allocate %d receive jobs\n", RX_POOL_SIZE);
+        return 1;
+    }
+    for (i = 0; i < RX_POOL_SIZE; i++)
+        queue_push(&free_queue, i);
+    for (i = 0; i < RX_REASM_SLOTS; i++)
+        reasm[i].job = -1;
+
+    if (output && open_ring(output, slot_size, nr_slots) < 0)
+        return 1;
+
+    if (capture_path) {
+        memset(&meta, 0, sizeof(meta));
+        if (control)
+            fetch_rf_config(control, &meta);
+        if (antsdr_capture_open(&capture, capture_path, &meta, ANTSDR_CAPTURE_SRC_RECEIVER, interval) < 0) {
+            fprintf(stderr, "Failed to open capture %s: %s\n", capture_path, strerror(errno));
+            return 1;
+        }
+        capturing = true;
+    }
+
+    sock = open_socket(port, rcvbuf_mb);
+    if (sock < 0)
+        return 1;
+
+    for (i = 0; i < RX_BATCH; i++) {
+        iov[i].iov_base = rx_buf[i];
+        iov[i].iov_len = RX_DATAGRAM_MAX;
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    if (pthread_create(&worker, NULL, worker_thread_func, NULL) != 0) {
+        fprintf(stderr, "Failed to create worker thread\n");
+        return 1;
+    }
+
+    printf("ANTSDR native receiver on UDP port %d%s%s%s%s\n", port,
+           output ? ", writing to " : "", output ? output : "",
+           capture_path ? ", recording to " : "", capture_path ? capture_path : "");
+    start = last = now_seconds();
+
+    while (keep_running) {
+        double now;
+
+        /* Block for the first datagram, then take whatever else is queued */
+        n = recvmmsg(sock, msgs, RX_BATCH, MSG_WAITFORONE, NULL);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            perror("recvmmsg");
+            break;
+        }
+        for (i = 0; i < n; i++)
+            handle_datagram(rx_buf[i], msgs[i].msg_len);
+
+        now = now_seconds();
+        if (now - last >= 1.0) {
+            print_stats(now - start, last_bytes, now - last);
+            last_bytes = atomic_load(&stats.bytes);
+            last = now;
+        }
+    }
+
+    keep_running = 0;
+    pthread_join(worker, NULL);
+    print_stats(now_seconds() - start, last_bytes, 0);
+    printf("\n");
+
+    close(sock);
+    if (capture_path) {
+        if (antsdr_capture_close(&capture) < 0)
+            fprintf(stderr, "Failed to finish capture %s: %s\n", capture_path, strerror(errno));
+        else
+            printf("Recorded %" PRIu64 " frames to %s\n", capture.hdr.frame_count, capture_path);
+    }
+    if (ring_map)
+        munmap(ring_map, ring_map_size);
+    free(job_pool);
+    return 0;
+}
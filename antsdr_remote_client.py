@@ -15,13 +15,56 @@ Examples:
     python3 antsdr_remote_client.py 192.168.1.12 set_dac_bypass 1
     python3 antsdr_remote_client.py 192.168.1.12 start
     python3 antsdr_remote_client.py 192.168.1.12 get_stats
+    python3 antsdr_remote_client.py 192.168.1.12 retune rx_lo_hz=2400e6 rx_bw_hz=20e6 rx_gain_db=40
+    python3 antsdr_remote_client.py 192.168.1.12 get_rf
 """
 
 import socket
 import sys
 import time
+import errno
+import random
+import struct
 import argparse
 
+# Binary control protocol - must match antsdr_app/antsdr_control.h
+CTRL_MAGIC = 0xA5C7D001
+CTRL_VERSION = 1
+CTRL_F_REPLY = 0x01
+CTRL_ITEM_GET = 0x0001
+CTRL_HEADER = struct.Struct('!IBBHIIi')   # magic, version, flags, count, session, sequence, status
+CTRL_ITEM = struct.Struct('!HHiq')        # param, flags, status, value
+CTRL_MAX_ITEMS = (1472 - CTRL_HEADER.size) // CTRL_ITEM.size
+
+CTRL_GAIN_MODES = ['manual', 'slow_attack', 'fast_attack', 'hybrid']
+CTRL_RX_PORTS = ['A_BALANCED', 'B_BALANCED', 'C_BALANCED', 'A_N', 'A_P', 'B_N', 'B_P', 'C_N', 'C_P']
+CTRL_TX_PORTS = ['A', 'B']
+
+# name: (param id, to wire, from wire)
+_hz = (lambda v: int(round(float(v))), lambda v: v)
+_mdb = (lambda v: int(round(float(v) * 1000)), lambda v: v / 1000.0)
+_int = (int, lambda v: v)
+
+def _names(table):
+    return (lambda v: table.index(v) if isinstance(v, str) else int(v),
+            lambda v: table[v] if 0 <= v < len(table) else v)
+
+CTRL_PARAMS = {
+    'rx_lo_hz': (1,) + _hz,
+    'tx_lo_hz': (2,) + _hz,
+    'rx_bw_hz': (3,) + _hz,
+    'tx_bw_hz': (4,) + _hz,
+    'rx_fs_hz': (5,) + _hz,
+    'tx_fs_hz': (6,) + _hz,
+    'rx_gain_db': (7,) + _mdb,
+    'tx_gain_db': (8,) + _mdb,
+    'rx_gain_mode': (9,) + _names(CTRL_GAIN_MODES),
+    'rx_port': (10,) + _names(CTRL_RX_PORTS),
+    'tx_port': (11,) + _names(CTRL_TX_PORTS),
+    'tx_enable': (12,) + _int,
+}
+CTRL_PARAM_NAMES = {v[0]: k for k, v in CTRL_PARAMS.items()}
+
 class ANTSDRController:
     def __init__(self, board_ip, control_port=12346, timeout=5.0):
         self.board_ip = board_ip
@@ -29,6 +72,9 @@ class ANTSDRController:
         self.timeout = timeout
         self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         self.sock.settimeout(timeout)
+        # Binary control session - the board drops duplicates by (session, sequence)
+        self.session = random.getrandbits(32)
+        self.sequence = 0
         
     def send_command(self, command):
         """Send command to ANTSDR and return response"""
@@ -45,6 +91,72 @@ class ANTSDRController:
         except Exception as e:
             return f"ERROR: {str(e)}"
     
+    def _ctrl_request(self, items, retries=5, retry_timeout=0.2):
+        """Send one binary request, retransmitting it unchanged until its reply arrives"""
+        self.sequence = (self.sequence + 1) & 0xffffffff
+        request = CTRL_HEADER.pack(CTRL_MAGIC, CTRL_VERSION, 0, len(items), self.session, self.sequence, 0)
+        request += b''.join(CTRL_ITEM.pack(param, flags, 0, value) for param, flags, value in items)
+        
+        deadline = time.time() + self.timeout
+        for attempt in range(retries + 1):
+            self.sock.sendto(request, (self.board_ip, self.control_port))
+            try_end = min(time.time() + retry_timeout * (1 << attempt), deadline)
+            while True:
+                remaining = try_end - time.time()
+                if remaining <= 0:
+                    break
+                self.sock.settimeout(remaining)
+                try:
+                    reply, addr = self.sock.recvfrom(2048)
+                except socket.timeout:
+                    break
+                if len(reply) < CTRL_HEADER.size:
+                    continue    # A late text reply
+                magic, version, flags, count, session, sequence, status = CTRL_HEADER.unpack_from(reply)
+                if magic != CTRL_MAGIC or not flags & CTRL_F_REPLY or \
+                   session != self.session or sequence != self.sequence:
+                    continue    # Reply to an earlier attempt or request
+                self.sock.settimeout(self.timeout)
+                results = [CTRL_ITEM.unpack_from(reply, CTRL_HEADER.size + i * CTRL_ITEM.size)
+                           for i in range(count)]
+                return status, results
+            if time.time() >= deadline:
+                break
+        self.sock.settimeout(self.timeout)
+        raise socket.timeout(f"no reply from {self.board_ip}:{self.control_port}")
+    
+    @staticmethod
+    def _ctrl_decode(results):
+        decoded = {}
+        for param, flags, status, value in results:
+            name = CTRL_PARAM_NAMES.get(param, f"param_{param}")
+            value = CTRL_PARAMS[name][2](value) if name in CTRL_PARAMS else value
+            decoded[name] = (value, status)
+        return decoded
+    
+    def apply(self, **params):
+        """Change many RF parameters in one round trip, all or none.
+        
+        Returns (status, {name: (value in force, item status)}); status is
+        0 or a negative errno, e.g. -errno.ERANGE for an out-of-range item.
+        """
+        items = []
+        for name, value in params.items():
+            if name not in CTRL_PARAMS:
+                raise ValueError(f"unknown parameter '{name}'")
+            param, to_wire, _ = CTRL_PARAMS[name]
+            items.append((param, 0, to_wire(value)))
+        if len(items) > CTRL_MAX_ITEMS:
+            raise ValueError(f"at most {CTRL_MAX_ITEMS} items per request")
+        status, results = self._ctrl_request(items)
+        return status, self._ctrl_decode(results)
+    
+    def read_rf(self, *names):
+        """Read RF parameters (all by default) in one round trip"""
+        names = names or tuple(CTRL_PARAMS)
+        status, results = self._ctrl_request([(CTRL_PARAMS[n][0], CTRL_ITEM_GET, 0) for n in names])
+        return status, self._ctrl_decode(results)
+    
     def get_info(self):
         """Get device information"""
         return self.send_command("info")
@@ -198,6 +310,25 @@ def main():
     elif command == 'reset':
         response = controller.reset()
         
+    elif command in ('retune', 'get_rf'):
+        try:
+            if command == 'retune':
+                params = {}
+                for arg in args.args:
+                    name, _, value = arg.partition('=')
+                    params[name] = value if name in ('rx_gain_mode', 'rx_port', 'tx_port') else float(value)
+                status, results = controller.apply(**params)
+            else:
+                status, results = controller.read_rf(*args.args)
+        except (ValueError, socket.timeout) as e:
+            print(f"ERROR: {e}")
+            return
+        lines = [f"{command.upper()}: {'OK' if status == 0 else 'FAILED (' + errno.errorcode.get(-status, str(status)) + ')'}"]
+        for name, (value, item_status) in results.items():
+            note = '' if item_status == 0 else f"  [{errno.errorcode.get(-item_status, item_status)}]"
+            lines.append(f"  {name} = {value}{note}")
+        response = '\n'.join(lines)
+        
     elif command == 'monitor':
         duration = 10
         if args.args:
@@ -249,6 +380,8 @@ def main():
         print("  stats                   - Get statistics")
         print("  reset                   - Reset and stop")
         print("  monitor [duration]      - Monitor stats")
+        print("  retune name=value ...   - Change RF parameters in one binary request (all or none)")
+        print("  get_rf [name ...]       - Read RF parameters in one binary request")
         print("  test_sequence           - Run full test")
     
     print(response)
@@ -14,11 +14,24 @@
 #include <linux/ioctl.h>
 #include <linux/poll.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
 #include <linux/kfifo.h>
 #include <linux/workqueue.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/interrupt.h>
+#include <linux/cpumask.h>
+#include <linux/version.h>
+#include <linux/mutex.h>
+#include <linux/seqlock.h>
 #include <linux/gpio/consumer.h>
 #include <linux/of.h>
 #include <linux/completion.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
 #include <linux/net.h>
 #include <linux/socket.h>
 #include <linux/in.h>
@@ -27,7 +40,20 @@
 #include <linux/errno.h>
 #include <asm/cacheflush.h>
 #include <net/sock.h>
+#include <net/inet_sock.h>
+#include <linux/netdevice.h>
+#include <linux/etherdevice.h>
+#include <linux/if_arp.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+#include <net/ip.h>
+#include <net/route.h>
+#include <net/neighbour.h>
+#include <net/arp.h>
+#include <net/checksum.h>
 #include <linux/crc32.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 /* Boolean defines for kernel compatibility */
 #ifndef bool
@@ -58,7 +84,7 @@
 #endif
 
 /* ANTSDR packet protocol definitions */
-#define ANTSDR_PROTOCOL_VERSION     1
+#define ANTSDR_PROTOCOL_VERSION     1   /* Default header version, see ANTSDR_IOC_SET_HEADER */
 #define ANTSDR_PACKET_START_MARKER  0xABCD1234
 #define ANTSDR_PACKET_END_MARKER    0x5678DCBA
 #define ANTSDR_MAX_PAYLOAD_SIZE     1360  /* 1400 - header size */
@@ -66,7 +92,7 @@
 /* Packet header structure (44 bytes total) */
 struct antsdr_packet_header {
     uint32_t start_marker;      /* 0xABCD1234 - packet start identifier */
-    uint32_t sequence_number;   /* Incremental packet sequence */
+    uint32_t sequence_number;   /* Incremental packet sequence, per destination */
     uint32_t total_length;      /* Total length including header */
     uint32_t payload_length;    /* Data payload length only */
     uint32_t frame_id;          /* DMA frame identifier */
@@ -81,9 +107,312 @@ struct antsdr_packet_header {
 
 #define ANTSDR_PACKET_HEADER_SIZE   sizeof(struct antsdr_packet_header)
 
+/* Packet header version 2 (44 bytes) - adds the capture timestamp and the
+ * FPGA frame counter. The end marker and total length are gone (the datagram
+ * length gives the latter), sizes that never exceed 16 bits are 16 bits.
+ * For aggregates (ANTSDR_AGG_START_MARKER_V2) frame_counter and timestamp_ns
+ * belong to the first frame packed and fragment_count is the number of frames.
+ * All fields big-endian.
+ */
+#define ANTSDR_PACKET_START_MARKER_V2  0xABCD2234
+#define ANTSDR_AGG_START_MARKER_V2     0xABCD2235
+
+struct antsdr_packet_header_v2 {
+    uint32_t start_marker;      /* 0xABCD2234 (0xABCD2235 aggregate) */
+    uint32_t sequence_number;   /* Incremental packet sequence, per destination */
+    uint32_t frame_id;          /* Driver frame identifier */
+    uint32_t frame_counter;     /* FPGA frame counter */
+    uint64_t timestamp_ns;      /* Capture time of the DMA transfer, clock in flags */
+    uint16_t payload_length;    /* Data payload length only */
+    uint16_t fragment_offset;   /* Offset within the frame payload */
+    uint8_t fragment_index;     /* Current fragment index (0-based) */
+    uint8_t fragment_count;     /* Total fragments for this frame */
+    uint16_t flags;             /* ANTSDR_HDR_CLOCK_* | ANTSDR_HDR_CSUM_* | ANTSDR_HDR_INTEG_* | LO | CHAN */
+    uint16_t frame_payload_total; /* Total payload bytes for entire frame */
+    uint16_t integration;       /* Integrated payloads: frames - 1 | (decimation - 1) << 8, else 0 */
+    uint32_t missing_frame_count; /* Number of missing frames detected */
+    uint32_t checksum;          /* CRC32 of payload data */
+} __attribute__((packed));
+
+#define ANTSDR_PACKET_HEADER_V2_SIZE   sizeof(struct antsdr_packet_header_v2)
+
+/* Capture timestamp clock (ANTSDR_IOC_SET_HEADER). REALTIME and TAI follow
+ * a PTP-disciplined system clock when ptp4l/phc2sys keep it in step.
+ */
+#define ANTSDR_CLOCK_MONOTONIC      0
+#define ANTSDR_CLOCK_REALTIME       1
+#define ANTSDR_CLOCK_TAI            2
+#define ANTSDR_HDR_CLOCK_MASK       0x3
+
+/* Payload integrity (ANTSDR_IOC_SET_CHECKSUM), what the checksum field holds.
+ * Version 2 headers advertise the mode in flags bits 2-3; version 1 headers
+ * cannot, so their receivers have to be told out of band.
+ *   PAYLOAD - CRC32 of the datagram payload (default, the original behaviour)
+ *   NONE    - 0, rely on the Ethernet FCS
+ *   HEADER  - CRC32 of the header with sequence_number and checksum taken as 0,
+ *             so it covers the framing fields but not the samples
+ *   FRAME   - CRC32 of the whole frame payload, computed once per frame and
+ *             repeated in every fragment; the same as PAYLOAD for aggregates
+ */
+#define ANTSDR_CSUM_PAYLOAD         0
+#define ANTSDR_CSUM_NONE            1
+#define ANTSDR_CSUM_HEADER          2
+#define ANTSDR_CSUM_FRAME           3
+#define ANTSDR_HDR_CSUM_SHIFT       2
+#define ANTSDR_HDR_CSUM_MASK        (0x3 << ANTSDR_HDR_CSUM_SHIFT)
+
+/* Pulse integration (ANTSDR_IOC_SET_INTEGRATION) - instead of every frame,
+ * one payload per block of N consecutive frames of the same size is queued,
+ * optionally decimated by K (boxcar mean of K neighbouring samples, a trailing
+ * partial group is dropped). Each payload word is one complex sample, I in the
+ * low and Q in the high 16 bits (signed).
+ *   COHERENT   - mean I/Q over the block, same sample format as the input
+ *   INCOHERENT - mean I*I + Q*Q over the block, one uint32 per sample
+ * The result carries the frame counter and timestamp of the block's first
+ * frame. Version 2 headers advertise the mode in flags bits 4-5 and N/K in
+ * the integration field.
+ */
+#define ANTSDR_INTEG_OFF            0
+#define ANTSDR_INTEG_COHERENT       1
+#define ANTSDR_INTEG_INCOHERENT     2
+#define ANTSDR_INTEG_MAX_FRAMES     256
+#define ANTSDR_INTEG_MAX_DECIMATION 50   /* One short-pulse payload; 2^15 * 256 * 50 fits an s32 lane sum */
+#define ANTSDR_HDR_INTEG_SHIFT      4
+#define ANTSDR_HDR_INTEG_MASK       (0x3 << ANTSDR_HDR_INTEG_SHIFT)
+
+struct antsdr_integration {
+    unsigned int mode;              /* ANTSDR_INTEG_* */
+    unsigned int frames;            /* N frames per result, 0 = 1 */
+    unsigned int decimation;        /* K samples per output sample, 0 = 1, up to ANTSDR_INTEG_MAX_DECIMATION */
+    unsigned int reserved;
+};
+
+/* Fastlock LO profiles (ANTSDR_IOC_SET_LO_PROFILE). The AD9361 holds up to
+ * 8 synthesizer profiles and retunes to one without a full relock; userspace
+ * recalls them through the PHY's fastlock_recall attribute and brackets the
+ * recall with BEGIN and END, so each frame can be tagged with the profile it
+ * was captured on. Frames captured before BEGIN keep the previous tag, those
+ * captured while the LO moves (BEGIN to END) carry none, CLEAR ends a retune
+ * that left the LO off any profile.
+ * The tag is ANTSDR_LO_TAG_VALID | profile, in version 2 header flags bits
+ * 6-9 and in aggregate per-frame flags bits 1-4. Version 1 packet headers
+ * have no room for it.
+ */
+#define ANTSDR_LO_PROFILES          8
+#define ANTSDR_LO_TAG_VALID         0x8
+#define ANTSDR_HDR_LO_SHIFT         6
+#define ANTSDR_HDR_LO_MASK          (0xf << ANTSDR_HDR_LO_SHIFT)
+#define ANTSDR_AGG_FRAME_LO_SHIFT   1
+
+#define ANTSDR_LO_QUERY             0
+#define ANTSDR_LO_BEGIN             1
+#define ANTSDR_LO_END               2
+#define ANTSDR_LO_CLEAR             3
+
+/* Channels - one S2MM stream per AD9361 RX path. Every channel has its own
+ * buffers, parse and send threads, ring, sockets and device node
+ * (/dev/antsdr_dma, /dev/antsdr_dma1). Version 2 headers carry the channel
+ * in flags bits 10-11.
+ */
+#define ANTSDR_MAX_CHANNELS         2
+#define ANTSDR_HDR_CHAN_SHIFT       10
+#define ANTSDR_HDR_CHAN_MASK        (0x3 << ANTSDR_HDR_CHAN_SHIFT)
+
+struct antsdr_lo_profile {
+    uint32_t phase;            /* ANTSDR_LO_* */
+    uint32_t profile;          /* END: profile now in force */
+    uint32_t frame_counter;    /* Out: last FPGA frame counter parsed */
+    uint32_t tag;              /* Out: tag for frames captured from now on, 0 = none */
+    uint64_t timestamp_ns;     /* Out: capture clock at the call */
+};
+
+/* Pre-armed mode schedule (ANTSDR_IOC_SET_SCHEDULE) - pulse mode, TDD mode
+ * and LO profile changes the driver applies itself, with no round trip to
+ * userspace, at a frame position (frames delivered since the schedule was
+ * armed, counted as each S2MM transfer completes) or a time (ns since armed,
+ * on a high-resolution timer). Entries are sorted by position; REPEAT starts
+ * the list over every period. A schedule armed while stopped starts with the
+ * stream - at its first frame, or by time when streaming starts - so nothing
+ * fires on an idle stream; stopping the stream disarms it.
+ *   TDD mode   - the GPIO flips at the entry's frame
+ *   pulse mode - the pool has to be re-sliced for the new frame size: the
+ *                switch starts at the entry and the new size takes effect
+ *                once the armed descriptors have drained, a fixed
+ *                queue_depth frames later with a full queue - place
+ *                entries that much early
+ *   LO profile - the driver can't retune the AD9361; userspace follows the
+ *                schedule position (ANTSDR_IOC_GET_SCHEDULE) and recalls
+ *                the profile, bracketed with ANTSDR_IOC_SET_LO_PROFILE
+ */
+#define ANTSDR_SCHED_MAX_ENTRIES    128
+#define ANTSDR_SCHED_KEEP           0xff    /* Field left as it is */
+#define ANTSDR_SCHED_BY_TIME        0x1     /* Positions in ns, else frames */
+#define ANTSDR_SCHED_REPEAT         0x2
+
+struct antsdr_sched_entry {
+    uint64_t at;               /* Frames or ns into the pass */
+    uint8_t pulse_mode;        /* 0, 1 or ANTSDR_SCHED_KEEP */
+    uint8_t tdd_mode;          /* 0, 1 or ANTSDR_SCHED_KEEP */
+    uint8_t lo_profile;        /* 0 - ANTSDR_LO_PROFILES-1 or ANTSDR_SCHED_KEEP */
+    uint8_t reserved[5];
+};
+
+struct antsdr_schedule {
+    uint32_t flags;            /* ANTSDR_SCHED_* */
+    uint32_t count;            /* Entries used, 0 = disarm */
+    uint64_t period;           /* REPEAT: pass length, frames or ns */
+    struct antsdr_sched_entry entries[ANTSDR_SCHED_MAX_ENTRIES];
+};
+
+struct antsdr_sched_status {
+    uint32_t armed;            /* Entries still to come */
+    uint32_t flags;
+    uint32_t count;
+    uint32_t next;             /* Index of the next entry due */
+    uint64_t position;         /* Frames or ns into the current pass */
+    uint64_t passes;           /* Passes completed (REPEAT) */
+    uint64_t applied;          /* Entries applied */
+    uint64_t late;             /* Applied after their position */
+    uint64_t max_late;         /* Worst lateness, frames or ns */
+    uint32_t errors;           /* Pulse switches that failed */
+    uint32_t pulse_mode;       /* In force now */
+    uint32_t lo_profile;       /* Last LO profile reached, ANTSDR_SCHED_KEEP = none */
+    uint32_t queue_depth;      /* Pulse switch offset in frames */
+};
+
+/* Send pacing and backpressure (ANTSDR_IOC_SET_PACING). The send thread caps
+ * egress - every destination's copy of a datagram, headers included - at
+ * rate_kbps with a token bucket burst_bytes deep, so bursts don't overrun the
+ * NIC queue or a slow link. A send that finds the socket buffer or the NIC
+ * queue full (-EAGAIN / -ENOBUFS) is retried with exponential backoff for up
+ * to max_backoff_us before the datagram is dropped; meanwhile the ring
+ * absorbs the stall. Before it overflows, a UDP backlog of overload_high_pct
+ * raises an overload event - counted, and POLLPRI on the device until the
+ * backlog is back under overload_low_pct - so upstream can shed load, e.g. drop
+ * a destination or restart with decimation. The backlog is what the UDP sender
+ * has yet to send: ring arena bytes, or with zero_copy DMA buffers, which run
+ * out long before the arena does. Zero fields take the defaults.
+ */
+#define ANTSDR_PACE_DEFAULT_BURST       (64 * 1024)
+#define ANTSDR_PACE_DEFAULT_BACKOFF_US  5000
+#define ANTSDR_PACE_MAX_BACKOFF_US      1000000
+#define ANTSDR_PACE_MIN_SLEEP_US        20      /* First backoff step */
+#define ANTSDR_PACE_MAX_SLEEP_US        1000    /* Backoff step cap */
+#define ANTSDR_OVERLOAD_DEFAULT_HIGH    75
+#define ANTSDR_OVERLOAD_DEFAULT_LOW     50
+
+struct antsdr_pacing {
+    uint32_t rate_kbps;        /* Egress cap, 0 = unlimited */
+    uint32_t burst_bytes;      /* Token bucket depth */
+    uint32_t max_backoff_us;   /* Retry budget for one datagram */
+    uint32_t overload_high_pct;  /* UDP backlog raising the overload event */
+    uint32_t overload_low_pct;   /* UDP backlog clearing it */
+    uint32_t reserved[3];
+};
+
+struct antsdr_pacing_status {
+    struct antsdr_pacing config;   /* In force, defaults filled in */
+    uint32_t overloaded;       /* Overload event raised and not cleared */
+    uint32_t backlog_pct;      /* UDP backlog now, percent of the arena or DMA pool */
+    uint64_t overload_events;
+    uint64_t paced_ns;         /* Send thread held back by the rate cap */
+    uint64_t backoffs;         /* Retries after a full socket or NIC queue */
+    uint64_t backoff_ns;       /* Time spent in those retries */
+    uint64_t backoff_drops;    /* Datagrams dropped with the retry budget spent */
+};
+
+/* Raw Ethernet transmit (ANTSDR_IOC_SET_RAW_TX) - datagrams skip the UDP/IP
+ * stack. Every destination gets an Ethernet/IPv4/UDP header template built
+ * from its route and ARP entry; per datagram only the lengths, IP id and
+ * checksums are filled in and the frame goes to the MAC driver with
+ * dev_queue_xmit(), or with QDISC_BYPASS straight onto its TX queue. The
+ * datagram itself - packet header and payload - is unchanged, so receivers
+ * see no difference. The send thread refreshes the templates every
+ * ANTSDR_RAW_REFRESH_MS. A destination with no ARP entry yet, or routed to
+ * loopback or a non-Ethernet link, and datagrams that would need IP
+ * fragmentation, still go through the socket.
+ */
+#define ANTSDR_RAW_TX_QDISC_BYPASS  0x1
+#define ANTSDR_RAW_REFRESH_MS       1000
+
+struct antsdr_raw_tx {
+    uint32_t enable;
+    uint32_t flags;            /* ANTSDR_RAW_TX_* */
+};
+
+struct antsdr_raw_tx_status {
+    uint32_t enable;
+    uint32_t flags;
+    uint32_t dests;            /* Destinations on the raw path now */
+    uint32_t reserved;
+    uint64_t packets;          /* Frames handed to the NIC */
+    uint64_t fallbacks;        /* Datagrams sent through the socket instead */
+    uint64_t errors;           /* Frames the NIC driver refused */
+};
+
+/* Header settings */
+struct antsdr_header_config {
+    unsigned int version;           /* 1 or 2, 0 = 1 */
+    unsigned int clock;             /* ANTSDR_CLOCK_* used for timestamps */
+};
+
+/* Frame aggregation (ANTSDR_IOC_SET_AGGREGATION) - one datagram carries several
+ * whole frames. It starts with an antsdr_packet_header using the aggregate start
+ * marker, in which frame_id is the id of the first frame (the others follow
+ * consecutively), fragment_count is the number of frames packed and checksum is
+ * the CRC32 of everything after the header. Each frame is an
+ * antsdr_agg_frame_header followed by its payload. All fields big-endian.
+ */
+#define ANTSDR_AGG_START_MARKER     0xABCD1235
+#define ANTSDR_AGG_DEFAULT_MTU      1500
+#define ANTSDR_AGG_MIN_MTU          576
+#define ANTSDR_AGG_MAX_MTU          9216  /* Jumbo frames */
+#define ANTSDR_AGG_MAX_FLUSH_US     1000000  /* v2 frame offsets are 32-bit ns */
+#define ANTSDR_UDP_IP_OVERHEAD      28    /* IPv4 + UDP headers */
+
+/* Aggregate compression (ANTSDR_IOC_SET_COMPRESSION). Frames of an aggregate
+ * may be stored coded instead of raw, marked by ANTSDR_AGG_FRAME_COMPRESSED;
+ * length is then the coded size. A datagram holding any coded frame uses the
+ * _Z start marker so receivers without a decoder drop it instead of misreading it.
+ * Coded frame (delta + zigzag + bit-packing of the little-endian 16-bit I/Q lanes):
+ *   uint16_t raw length (big-endian), uint8_t predictor
+ *     0 - intra: lane n - lane n-2 (same component of the previous sample)
+ *     1 - inter: lane n - lane n of the previous frame in the same datagram
+ *   then per block of ANTSDR_ZPACK_BLOCK lanes (the last may be shorter):
+ *     uint8_t bit width w (0-16), lanes * w bits of zigzag residuals, LSB first,
+ *     padded to a byte
+ * Each datagram decodes on its own. A frame that would not shrink is stored raw.
+ */
+#define ANTSDR_COMPRESS_OFF         0
+#define ANTSDR_COMPRESS_DELTA       1
+#define ANTSDR_AGG_START_MARKER_Z     0xABCD1236
+#define ANTSDR_AGG_START_MARKER_Z_V2  0xABCD2236
+#define ANTSDR_AGG_FRAME_COMPRESSED 0x1
+#define ANTSDR_ZPACK_BLOCK          32
+#define ANTSDR_ZPACK_HEADER_SIZE    3
+
+struct antsdr_agg_frame_header {
+    uint32_t frame_counter;     /* FPGA frame counter */
+    uint16_t length;            /* Payload bytes following this header */
+    uint16_t flags;             /* ANTSDR_AGG_FRAME_* */
+} __attribute__((packed));
+
+#define ANTSDR_AGG_FRAME_HEADER_SIZE sizeof(struct antsdr_agg_frame_header)
+
+/* Per-frame header inside a version 2 aggregate */
+struct antsdr_agg_frame_header_v2 {
+    uint32_t frame_counter;     /* FPGA frame counter */
+    uint16_t length;            /* Payload bytes following this header */
+    uint16_t flags;             /* ANTSDR_AGG_FRAME_* */
+    uint32_t timestamp_offset_ns; /* Capture time minus the packet header's timestamp_ns */
+} __attribute__((packed));
+
+#define ANTSDR_AGG_FRAME_HEADER_V2_SIZE sizeof(struct antsdr_agg_frame_header_v2)
+
 #define DRIVER_NAME "antsdr_dma"
 #define DEVICE_NAME DRIVER_NAME
-#define NUM_BUFFERS 16                        /* Increased from 4 to 16 for high-speed buffering */
+#define ANTSDR_DEFAULT_QUEUE_DEPTH 16          /* Descriptors kept armed by default */
+#define ANTSDR_MAX_QUEUE_DEPTH     64          /* Upper bound for dma_queue_depth */
 #define LONG_PULSE_TRANSFER_SIZE (403 * 4)   /* Long pulse: 403 words = 1612 bytes */
 #define SHORT_PULSE_TRANSFER_SIZE (53 * 4)   /* Short pulse: 53 words = 212 bytes */
 #define MAX_S2MM_TRANSFER_SIZE (512 * 4)     /* Maximum S2MM transfer: 512 words = 2048 bytes */
@@ -91,7 +420,6 @@ struct antsdr_packet_header {
 #define FPGA_SHORT_TRANSFER_SIZE (FPGA_SHORT_PULSE_WORDS * 4) /* 53 words = 212 bytes */
 #define DEFAULT_BUFFER_SIZE LONG_PULSE_TRANSFER_SIZE  /* Use larger size as default */
 #define UDP_BUFFER_SIZE (1024 * 1024)  /* Increased to 1MB for better buffering */
-#define UDP_HIGH_WATER_MARK (UDP_BUFFER_SIZE / 2)  /* Trigger aggressive sending at 50% full */
 #define UDP_PACKET_SIZE (ANTSDR_PACKET_HEADER_SIZE + ANTSDR_MAX_PAYLOAD_SIZE)  /* Header + payload = 1400 bytes */
 
 /* IOCTL commands */
@@ -99,6 +427,7 @@ struct antsdr_packet_header {
 #define ANTSDR_IOC_START_STREAMING  _IO(ANTSDR_IOC_MAGIC, 1)
 #define ANTSDR_IOC_STOP_STREAMING   _IO(ANTSDR_IOC_MAGIC, 2)
 #define ANTSDR_IOC_SET_UDP_DEST     _IOW(ANTSDR_IOC_MAGIC, 3, struct antsdr_udp_dest)
+#define ANTSDR_IOC_SET_AGGREGATION  _IOW(ANTSDR_IOC_MAGIC, 14, struct antsdr_aggregation)
 #define ANTSDR_IOC_GET_STATS        _IOR(ANTSDR_IOC_MAGIC, 4, struct antsdr_dma_stats)
 #define ANTSDR_IOC_SET_BUFFER_SIZE  _IOW(ANTSDR_IOC_MAGIC, 5, unsigned int)
 #define ANTSDR_IOC_GET_BUFFER_SIZE  _IOR(ANTSDR_IOC_MAGIC, 6, unsigned int)
@@ -109,17 +438,52 @@ struct antsdr_packet_header {
 #define ANTSDR_IOC_SET_MODE         _IOW(ANTSDR_IOC_MAGIC, 11, unsigned int)
 #define ANTSDR_IOC_GET_MODE         _IOR(ANTSDR_IOC_MAGIC, 12, unsigned int)
 #define ANTSDR_IOC_RESET_STATS      _IO(ANTSDR_IOC_MAGIC, 13)
+#define ANTSDR_IOC_SET_POLL_MODE    _IOW(ANTSDR_IOC_MAGIC, 15, struct antsdr_poll_config)
+#define ANTSDR_IOC_SET_GEOMETRY     _IOW(ANTSDR_IOC_MAGIC, 16, struct antsdr_geometry)
+#define ANTSDR_IOC_GET_GEOMETRY     _IOR(ANTSDR_IOC_MAGIC, 17, struct antsdr_geometry)
+#define ANTSDR_IOC_SET_HEADER       _IOW(ANTSDR_IOC_MAGIC, 18, struct antsdr_header_config)
+#define ANTSDR_IOC_ADD_UDP_DEST     _IOW(ANTSDR_IOC_MAGIC, 19, struct antsdr_udp_dest_cfg)
+#define ANTSDR_IOC_DEL_UDP_DEST     _IOW(ANTSDR_IOC_MAGIC, 20, struct antsdr_udp_dest_cfg)
+#define ANTSDR_IOC_GET_UDP_DESTS    _IOR(ANTSDR_IOC_MAGIC, 21, struct antsdr_udp_dest_list)
+#define ANTSDR_IOC_SET_CHECKSUM     _IOW(ANTSDR_IOC_MAGIC, 22, unsigned int)
+#define ANTSDR_IOC_SET_INTEGRATION  _IOW(ANTSDR_IOC_MAGIC, 23, struct antsdr_integration)
+#define ANTSDR_IOC_SET_COMPRESSION  _IOW(ANTSDR_IOC_MAGIC, 24, unsigned int)
+#define ANTSDR_IOC_GET_LATENCY      _IOR(ANTSDR_IOC_MAGIC, 25, struct antsdr_latency_stats)
+#define ANTSDR_IOC_START_BENCH      _IOW(ANTSDR_IOC_MAGIC, 26, struct antsdr_bench_config)
+#define ANTSDR_IOC_GET_BENCH        _IOR(ANTSDR_IOC_MAGIC, 27, struct antsdr_bench_result)
+#define ANTSDR_IOC_SET_LO_PROFILE   _IOWR(ANTSDR_IOC_MAGIC, 28, struct antsdr_lo_profile)
+#define ANTSDR_IOC_SET_SCHEDULE     _IOW(ANTSDR_IOC_MAGIC, 29, struct antsdr_schedule)
+#define ANTSDR_IOC_GET_SCHEDULE     _IOR(ANTSDR_IOC_MAGIC, 30, struct antsdr_sched_status)
+#define ANTSDR_IOC_SET_PACING       _IOW(ANTSDR_IOC_MAGIC, 31, struct antsdr_pacing)
+#define ANTSDR_IOC_GET_PACING       _IOR(ANTSDR_IOC_MAGIC, 32, struct antsdr_pacing_status)
+#define ANTSDR_IOC_SET_RAW_TX       _IOW(ANTSDR_IOC_MAGIC, 33, struct antsdr_raw_tx)
+#define ANTSDR_IOC_GET_RAW_TX       _IOR(ANTSDR_IOC_MAGIC, 34, struct antsdr_raw_tx_status)
+
+/* DMA pool configuration - one coherent allocation (CMA-backed when large),
+ * sliced into slots of the current pulse mode's transfer size
+ */
+#define ANTSDR_DMA_SLOT_ALIGN       64      /* Slots start on cache-line boundaries */
+#define ANTSDR_DEFAULT_POOL_KB      64
+#define ANTSDR_MIN_POOL_KB          16
+#define ANTSDR_MAX_POOL_KB          (64 * 1024)  /* Pools this large need a matching CMA area */
 
 /* Ring buffer configuration */
-#define RING_BUFFER_COUNT           256     /* Increased from 64 to 256 for high-speed buffering */
-#define RING_BUFFER_SIZE            1600    /* Size to accommodate largest payload (long pulse = 1600 bytes) */
+#define ANTSDR_DEFAULT_RING_KB      512     /* Byte-granular record ring, must be a power of two */
+#define ANTSDR_MIN_RING_KB          64
+#define ANTSDR_MAX_RING_KB          (64 * 1024)
+#define RING_BUFFER_SIZE            1600    /* Largest payload a record holds (long pulse = 1600 bytes) */
+#define RING_RECORD_ALIGN           8       /* Records start on 8-byte boundaries */
 
-/* Raw frame FIFO configuration for threaded processing */
-#define RAW_FRAME_FIFO_SIZE         (256 * sizeof(struct antsdr_raw_frame))  /* Increased from 64 to 256 raw frames max */
+/* Raw frame FIFO configuration for threaded processing (depth in frames, power of two) */
+#define ANTSDR_DEFAULT_RAW_FIFO_DEPTH  256
+#define ANTSDR_MIN_RAW_FIFO_DEPTH      16
+#define ANTSDR_MAX_RAW_FIFO_DEPTH      16384
 
-/* Frame detection buffer configuration */
-#define FRAME_DETECTION_BUFFER_SIZE (64 * 1024)  /* 64KB buffer for frame detection */
-#define MAX_FRAME_ACCUMULATION      32            /* Maximum frames to accumulate before giving up */
+/* Resynchronisation state for transfers that don't hold one aligned frame */
+enum antsdr_sync_state {
+    ANTSDR_SYNC_HUNT,     /* Looking for a header marker */
+    ANTSDR_SYNC_COLLECT,  /* Header seen, collecting the rest of the frame */
+};
 
 /* Debug and logging configuration */
 #define ANTSDR_ENABLE_FRAME_EXPORT  0             /* Enable frame export to files */
@@ -144,96 +508,539 @@ struct antsdr_packet_header {
 #define FRAME_HEADER 0xFFFFFFFE
 #define FRAME_FOOTER 0xFFFFFFFF
 
-/* Statistics structure */
+/* Statistics structure (ANTSDR_IOC_GET_STATS) - 64-bit so multi-day runs don't wrap */
 struct antsdr_dma_stats {
-    unsigned long transfers_completed;
-    unsigned long bytes_transferred;
-    unsigned long udp_packets_sent;
-    unsigned long errors;
-    unsigned long valid_frames;
-    unsigned long invalid_frames;
-    unsigned long extracted_frames;
+    uint64_t transfers_completed;
+    uint64_t bytes_transferred;
+    uint64_t udp_packets_sent;
+    uint64_t errors;
+    uint64_t valid_frames;
+    uint64_t invalid_frames;
+    uint64_t extracted_frames;
+    uint64_t fast_path_frames;    /* Frames validated at fixed offsets */
+    uint64_t slow_path_frames;    /* Transfers that needed the marker scan */
+    uint64_t resync_events;       /* Times frame lock was lost (words discarded) */
+    uint64_t resync_frames;       /* Frames reassembled across transfer boundaries */
+    uint64_t resync_dropped_words; /* Words discarded while hunting for a header */
+    uint64_t resync_last_ns;      /* Time-to-resync of the last event */
+    uint64_t resync_max_ns;       /* Longest time-to-resync */
+    uint64_t udp_overruns;        /* Records the UDP sender lost to a full ring */
+    uint64_t read_overruns;       /* Records the read() consumer lost to a full ring */
+    uint64_t mmap_overruns;       /* Records the mmap() reader lost to a full ring */
+    uint64_t irq_mode_ns;         /* Time spent interrupt-driven while streaming */
+    uint64_t poll_mode_ns;        /* Time spent polling while streaming */
+    uint64_t poll_mode_switches;  /* Interrupt <-> polling transitions */
+    uint64_t frame_rate;          /* Last measured transfers per second */
+    uint64_t pulse_switches;      /* Pulse-mode switches made while streaming */
+    uint64_t pulse_switch_last_ns; /* Duration of the last switch */
+    uint64_t pulse_switch_max_ns; /* Longest switch */
+    uint64_t integrated_frames;   /* Frames folded into integration results */
+    uint64_t integrated_outputs;  /* Integration results queued */
+    uint64_t compress_in_bytes;   /* Raw payload bytes offered to the aggregate codec */
+    uint64_t compress_out_bytes;  /* Bytes they took in the datagrams */
+    uint64_t compress_ns;         /* Time spent coding */
+    uint64_t drops_fifo_full;     /* Transfers the raw frame FIFO had no room for */
+    uint64_t drops_ring_full;     /* Payloads the ring had no room for */
+    uint64_t drops_alloc_fail;    /* Transfers lost to a failed copy allocation */
+    uint64_t drops_invalid;       /* Transfers or payloads that failed validation */
+    uint64_t drops_send_error;    /* Datagrams a destination refused */
+    uint64_t fifo_high_water;     /* Most transfers queued in the raw frame FIFO */
+    uint64_t ring_high_water;     /* Most records live in the ring */
+    uint64_t ring_bytes_high_water; /* Most ring arena bytes in use */
+};
+
+/* Why a frame was dropped - counted per reason and traced (antsdr_drop) */
+enum antsdr_drop_reason {
+    ANTSDR_DROP_FIFO_FULL,
+    ANTSDR_DROP_RING_FULL,
+    ANTSDR_DROP_ALLOC_FAIL,
+    ANTSDR_DROP_INVALID,
+    ANTSDR_DROP_SEND_ERROR,
+    ANTSDR_DROP_REASONS,
+};
+
+#define CREATE_TRACE_POINTS
+#include "antsdr_dma_trace.h"
+
+/* Latency histograms (ANTSDR_IOC_GET_LATENCY, debugfs "latency"). Stages are
+ * measured from the capture timestamp of the transfer, so each one includes
+ * the stages before it; SENDMSG is the duration of one datagram's sends.
+ * Bucket i counts samples in [2^i, 2^(i+1)) ns, the last bucket everything
+ * longer.
+ */
+#define ANTSDR_LAT_BUCKETS          32
+
+enum antsdr_lat_stage {
+    ANTSDR_LAT_PARSE,     /* Transfer parsed by the frame worker */
+    ANTSDR_LAT_RING,      /* Payload (or integration result) in the ring */
+    ANTSDR_LAT_SEND,      /* Payload sent - aggregates: their oldest frame */
+    ANTSDR_LAT_SENDMSG,   /* kernel_sendmsg() to every destination */
+    ANTSDR_LAT_STAGES,
 };
 
+struct antsdr_latency_hist {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[ANTSDR_LAT_BUCKETS];
+};
+
+struct antsdr_latency_stats {
+    struct antsdr_latency_hist stage[ANTSDR_LAT_STAGES];
+};
+
+struct antsdr_lat_counters {
+    atomic64_t count;
+    atomic64_t sum_ns;
+    atomic64_t max_ns;
+    atomic64_t buckets[ANTSDR_LAT_BUCKETS];
+};
+
+/* Loopback benchmark (ANTSDR_IOC_START_BENCH) - an hrtimer generates valid
+ * FPGA frames of the current pulse mode and queues them exactly as an S2MM
+ * completion would, so parse, ring and send run unchanged with no FPGA or
+ * DMA channel. Frames are queued with or without a UDP destination, so
+ * the send stage can be left out. The timer runs in softirq context like
+ * the dmaengine completion it replaces. STOP_STREAMING ends a run; GET_BENCH
+ * reports live while it runs and the final numbers after.
+ */
+#define ANTSDR_BENCH_MAX_RATE       2000000   /* Frames per second */
+#define ANTSDR_BENCH_TICK_NS        100000    /* Generator period, frames due are batched */
+
+struct antsdr_bench_config {
+    uint32_t rate;             /* Frames per second, 1 - ANTSDR_BENCH_MAX_RATE */
+    uint32_t duration_ms;      /* Stop generating after this long, 0 = until stopped */
+};
+
+struct antsdr_bench_result {
+    uint32_t running;          /* Generator still producing */
+    uint32_t rate;             /* Requested frames per second */
+    uint64_t elapsed_ns;       /* Generation time */
+    uint64_t frames_generated; /* Frames queued (or dropped) as S2MM completions */
+    uint64_t frames_missed;    /* Due but never generated - the generator fell behind */
+    uint64_t frames_valid;     /* Parsed and queued to the ring */
+    uint64_t packets_sent;     /* Datagrams sent */
+    uint64_t drops[ANTSDR_DROP_REASONS]; /* By enum antsdr_drop_reason */
+    uint64_t udp_overruns;     /* Ring records the send thread lost */
+    uint64_t gen_cpu_ns;       /* CPU time of the generator */
+    uint64_t parse_cpu_ns;     /* CPU time of the antsdr_parse thread */
+    uint64_t send_cpu_ns;      /* CPU time of the antsdr_send thread */
+};
+
+/* Live counters - bumped locklessly from the IRQ path and the workers,
+ * only gathered into a struct antsdr_dma_stats when userspace asks.
+ */
+struct antsdr_dma_counters {
+    atomic64_t transfers_completed;
+    atomic64_t bytes_transferred;
+    atomic64_t udp_packets_sent;
+    atomic64_t errors;
+    atomic64_t valid_frames;
+    atomic64_t invalid_frames;
+    atomic64_t extracted_frames;
+    atomic64_t fast_path_frames;
+    atomic64_t slow_path_frames;
+    atomic64_t resync_events;
+    atomic64_t resync_frames;
+    atomic64_t resync_dropped_words;
+    atomic64_t resync_last_ns;
+    atomic64_t resync_max_ns;
+    atomic64_t irq_mode_ns;
+    atomic64_t poll_mode_ns;
+    atomic64_t poll_mode_switches;
+    atomic64_t frame_rate;
+    atomic64_t pulse_switches;
+    atomic64_t pulse_switch_last_ns;
+    atomic64_t pulse_switch_max_ns;
+    atomic64_t integrated_frames;
+    atomic64_t integrated_outputs;
+    atomic64_t compress_in_bytes;
+    atomic64_t compress_out_bytes;
+    atomic64_t compress_ns;
+    atomic64_t drops[ANTSDR_DROP_REASONS];
+    atomic64_t fifo_high_water;
+    atomic64_t ring_high_water;
+    atomic64_t ring_bytes_high_water;
+    atomic64_t overload_events;
+    atomic64_t paced_ns;
+    atomic64_t send_backoffs;
+    atomic64_t send_backoff_ns;
+    atomic64_t send_backoff_drops;
+    atomic64_t raw_packets;
+    atomic64_t raw_fallbacks;
+    atomic64_t raw_errors;
+    struct antsdr_lat_counters latency[ANTSDR_LAT_STAGES];
+};
+
+#define antsdr_stat_inc(dma_dev, field)     atomic64_inc(&(dma_dev)->stats.field)
+#define antsdr_stat_add(dma_dev, field, n)  atomic64_add((n), &(dma_dev)->stats.field)
+
+/* High-water marks have a single updater each, no cmpxchg needed */
+#define antsdr_stat_max(dma_dev, field, n) \
+    do { \
+        if ((u64)(n) > atomic64_read(&(dma_dev)->stats.field)) \
+            atomic64_set(&(dma_dev)->stats.field, (n)); \
+    } while (0)
+
 /* UDP destination structure */
 struct antsdr_udp_dest {
     unsigned int ip;
     unsigned short port;
 };
 
+/* Fan-out destinations (ANTSDR_IOC_ADD_UDP_DEST / ANTSDR_IOC_DEL_UDP_DEST).
+ * ANTSDR_IOC_SET_UDP_DEST replaces the whole list with one destination.
+ */
+#define ANTSDR_MAX_UDP_DESTS        4
+#define ANTSDR_MCAST_DEFAULT_TTL    1
+
+struct antsdr_udp_dest_cfg {
+    unsigned int ip;                /* IPv4 address, network order - unicast or multicast */
+    unsigned short port;
+    unsigned char ttl;              /* Multicast TTL, 0 = 1 */
+    unsigned char reserved;
+};
+
+struct antsdr_udp_dest_info {
+    unsigned int ip;
+    unsigned short port;
+    unsigned short multicast;
+    uint32_t sequence;              /* Next sequence number for this destination */
+    uint32_t raw;                   /* On the raw Ethernet path */
+    uint64_t packets;               /* Datagrams sent */
+    uint64_t drops;                 /* Datagrams the socket refused */
+};
+
+struct antsdr_udp_dest_list {
+    unsigned int count;
+    unsigned int reserved;
+    struct antsdr_udp_dest_info dests[ANTSDR_MAX_UDP_DESTS];
+};
+
+#define ANTSDR_RAW_HDR_LEN  (ETH_HLEN + sizeof(struct iphdr) + sizeof(struct udphdr))
+
+/* One fan-out destination - own socket, sequence and accounting */
+struct antsdr_udp_target {
+    struct socket *sock;
+    struct sockaddr_in addr;
+    uint32_t sequence;
+    atomic64_t packets;
+    atomic64_t drops;
+    struct net_device *raw_dev;       /* Raw transmit egress, held - NULL = socket */
+    uint8_t raw_hdr[ANTSDR_RAW_HDR_LEN];  /* Ethernet + IPv4 + UDP template */
+    uint16_t raw_ip_id;
+    u64 raw_refresh_ns;               /* Next template refresh */
+};
+
+/* Frame aggregation settings */
+struct antsdr_aggregation {
+    unsigned int enable;            /* 0 = one frame per datagram */
+    unsigned int mtu;               /* Link MTU the datagrams must fit, 0 = 1500 */
+    unsigned int flush_timeout_us;  /* Max time a frame waits for its datagram to fill, 0 = flush per batch, up to 1 s */
+};
+
+/* Adaptive polling settings (ANTSDR_IOC_SET_POLL_MODE) - above enter_fps the
+ * driver stops asking for per-transfer completion callbacks and retires
+ * transfers in batches from the parse thread; below exit_fps it goes back
+ */
+struct antsdr_poll_config {
+    unsigned int enable;            /* 0 = always interrupt-driven */
+    unsigned int enter_fps;         /* Switch to polling at or above this frame rate */
+    unsigned int exit_fps;          /* Switch back to interrupts below this frame rate */
+    unsigned int poll_interval_us;  /* Time between polls, 0 = default */
+};
+
+#define ANTSDR_POLL_DEFAULT_ENTER_FPS    20000
+#define ANTSDR_POLL_DEFAULT_EXIT_FPS     10000
+#define ANTSDR_POLL_DEFAULT_INTERVAL_US  200
+#define ANTSDR_POLL_MIN_INTERVAL_US      20
+#define ANTSDR_POLL_MAX_INTERVAL_US      10000
+#define ANTSDR_POLL_RATE_WINDOW_NS       (10 * NSEC_PER_MSEC)  /* Frame rate measurement window */
+
+/* Hot pulse-mode switch - how long armed transfers get to complete before
+ * the rest of the queue is terminated
+ */
+#define ANTSDR_PULSE_SWITCH_DRAIN_MS     20
+
+/* Buffer geometry (ANTSDR_IOC_SET_GEOMETRY / ANTSDR_IOC_GET_GEOMETRY) - only
+ * changeable while not streaming. A zero field keeps the current value.
+ */
+struct antsdr_geometry {
+    unsigned int dma_pool_kb;       /* DMA pool size in KB */
+    unsigned int ring_kb;           /* Ring arena size in KB, power of two */
+    unsigned int raw_fifo_depth;    /* Raw frame FIFO depth in frames, power of two */
+    unsigned int dma_buffers;       /* GET only: pool slots at the current pulse mode */
+};
+
 /* Raw frame data for FIFO processing - using dynamic allocation to prevent stack overflow */
 struct antsdr_raw_frame {
     size_t data_len;
     uint8_t *data;  /* Dynamically allocated raw DMA data - prevents stack overflow */
+    int dma_index;  /* Zero-copy: DMA buffer that data points into, -1 if data is a kmalloc copy */
+    uint64_t timestamp_ns;  /* Capture time of the transfer */
+};
+
+/* Ring buffer record - the ring is a byte arena of variable-length records so
+ * a 200-byte short-pulse payload only takes ~200 bytes. A record is followed by
+ * its payload, or (zero-copy) by a reference into a held DMA buffer. Records
+ * never wrap: the space left at the end of the arena is filled with a PAD record.
+ */
+#define ANTSDR_RING_REC_PAD      0x1   /* Filler up to the end of the arena */
+#define ANTSDR_RING_REC_DMA_REF  0x2   /* Payload left in a DMA buffer */
+
+struct antsdr_ring_record {
+    uint32_t size;           /* Payload bytes (PAD: filler bytes after this header) */
+    uint32_t flags;          /* ANTSDR_RING_REC_* */
+    uint32_t frame_counter;  /* FPGA frame counter of the payload */
+    uint32_t lo_tag;         /* LO tag at capture time, ANTSDR_LO_TAG_VALID | profile, 0 = none */
+    uint64_t timestamp_ns;   /* Capture time of the payload */
 };
 
-/* Device structure */
+struct antsdr_ring_dma_ref {
+    uint32_t dma_index;  /* DMA buffer held until the record is returned */
+    uint32_t offset;     /* Payload offset inside that buffer */
+};
+
+/* Control page at offset 0 of the device mmap(), the record arena follows at
+ * data_offset. The kernel publishes head after a record is complete; a local
+ * consumer walks records from user_tail (skipping PAD records) and stores its
+ * new user_tail back. A reader that falls a full ring behind is overrun like
+ * any other consumer: the kernel moves tail past the records it reuses, so a
+ * reader re-checks tail after copying a record and restarts from tail if the
+ * record was reclaimed under it.
+ */
+#define ANTSDR_RING_CTRL_MAGIC    0x52494E47  /* "RING" */
+#define ANTSDR_RING_CTRL_VERSION  3   /* 2: records carry timestamp_ns, 3: and lo_tag */
+
+struct antsdr_ring_ctrl {
+    uint32_t magic;          /* ANTSDR_RING_CTRL_MAGIC */
+    uint32_t version;        /* ANTSDR_RING_CTRL_VERSION */
+    uint32_t data_offset;    /* Arena offset in the mapping */
+    uint32_t data_size;      /* Arena size in bytes (power of two) */
+    uint32_t record_align;   /* Record alignment in the arena */
+    uint32_t head;           /* Producer offset, free-running - written by the kernel */
+    uint32_t user_tail;      /* Consumer offset, free-running - written by userspace */
+    uint32_t dropped;        /* Records dropped because the ring was full */
+    uint32_t tail;           /* Oldest live record - anything before it may be overwritten */
+};
+
+/* Ring consumers - each reads the whole stream through its own cursor. The
+ * producer never waits for a consumer: when the ring is full, consumers still
+ * on the oldest record are moved past it and charged an overrun. In zero-copy
+ * mode a record pins a whole DMA buffer, so a read() or mmap() reader is also
+ * overrun once the buffers it holds would leave the DMA queue short.
+ */
+enum antsdr_ring_consumer {
+    ANTSDR_CONSUMER_UDP,   /* UDP sender work */
+    ANTSDR_CONSUMER_READ,  /* read() on the device */
+    ANTSDR_CONSUMER_MMAP,  /* mmap() reader, follows user_tail */
+    ANTSDR_RING_CONSUMERS,
+};
+
+struct antsdr_ring_cursor {
+    unsigned int tail;     /* Next record, free-running */
+    unsigned int count;    /* Records between tail and head */
+    bool active;           /* Attached - holds records until it has read them */
+    bool held;             /* Record at tail handed out by ring_get(), not returned yet */
+    atomic64_t overruns;   /* Records skipped because the ring was full */
+};
+
+struct antsdr_dma_board;
+
+/* Device structure - one per channel */
 struct antsdr_dma_dev {
     struct platform_device *pdev;
     struct device *dev;
+    struct antsdr_dma_board *board;
+    unsigned int channel;         /* Index on the board, 0 = first RX path */
+    char name[24];                /* Device node, debugfs directory */
     struct miscdevice misc_dev;
     struct dma_chan *rx_chan;
     
-    /* Separate DMA buffers for different pulse modes */
-    void *long_dma_buffers[NUM_BUFFERS];    /* 403×4 = 1612 bytes each */
-    dma_addr_t long_dma_handles[NUM_BUFFERS];
-    void *short_dma_buffers[NUM_BUFFERS];   /* 52×4 = 208 bytes each */
-    dma_addr_t short_dma_handles[NUM_BUFFERS];
+    /* DMA pool, re-sliced into dma_nr_buffers slots whenever streaming starts */
+    void *dma_pool;
+    dma_addr_t dma_pool_handle;
+    struct device *dma_pool_dev;  /* Device the pool was allocated for */
+    size_t dma_pool_size;         /* Pool size in bytes */
+    size_t dma_slot_size;         /* Slot stride for the current pulse mode */
+    unsigned int dma_nr_buffers;  /* Slots in use for the current pulse mode */
+    unsigned int dma_max_buffers; /* Slots at the smallest stride - sizes the arrays below */
+    dma_cookie_t *dma_cookies;    /* Cookie of the descriptor armed on each buffer */
+    bool *dma_has_callback;       /* Descriptor on the buffer was armed in interrupt mode */
+    
+    /* DMA buffer queues - buffers are armed in free-list order and complete in armed order */
+    unsigned int *dma_armed;      /* Armed buffer indices, in submission order */
+    unsigned int *dma_free;       /* Buffers ready to be armed (FIFO) */
+    unsigned int dma_free_head;   /* Next free buffer to arm */
+    unsigned int dma_free_count;  /* Number of buffers on the free list */
+    unsigned int raw_fifo_depth;  /* Raw frame FIFO depth in frames */
+    spinlock_t dma_queue_lock;    /* Protects armed/free queues, current_buffer and dma_inflight */
+    bool zero_copy;               /* Payloads stay in the DMA buffers until sent */
     
     size_t buffer_size;
-    int current_buffer;
+    int current_buffer;           /* Consumer position in dma_armed: oldest armed buffer, completes next */
+    unsigned int dma_inflight;    /* Number of descriptors currently armed */
+    unsigned int dma_queue_depth; /* Number of descriptors kept armed while streaming */
+    unsigned int dma_poll_armed;  /* Armed descriptors without a completion callback */
+    bool dma_draining;            /* Pulse-mode switch in progress - arm nothing new */
+    wait_queue_head_t drain_wait; /* Woken when the armed queue runs empty while draining */
+    
+    /* Adaptive interrupt/polling completion (ANTSDR_IOC_SET_POLL_MODE) */
+    struct antsdr_poll_config poll_cfg;
+    bool poll_active;             /* New descriptors are armed without callbacks */
+    bool poll_running;            /* poll_work is queued or running */
+    u64 poll_window_start_ns;     /* Frame rate measurement window */
+    unsigned int poll_window_frames;
+    u64 poll_mode_since_ns;       /* Start of the current mode, for time-in-mode */
+    spinlock_t poll_lock;         /* Protects the poll state above */
+    struct kthread_work poll_work;  /* Runs on frame_worker */
     bool streaming;
     spinlock_t lock;
     wait_queue_head_t wait_queue;
     struct completion dma_complete;
-    struct antsdr_dma_stats stats;
+    struct antsdr_dma_counters stats;
+    struct dentry *debugfs;       /* debugfs directory, stats and latency */
     
     /* Ring buffer for high-performance data buffering */
-    void **ring_buffers;          /* Array of buffer pointers */
-    unsigned int ring_size;       /* Number of buffers in ring */
-    unsigned int ring_head;       /* Write position */
-    unsigned int ring_tail;       /* Read position */
-    unsigned int ring_count;      /* Number of filled buffers */
-    size_t ring_buffer_size;      /* Size of each ring buffer */
+    void *ring_mem;               /* Control page + arena, vmalloc_user() for mmap */
+    struct antsdr_ring_ctrl *ring_ctrl; /* Shared control page */
+    atomic_t ring_mappings;       /* Live mmap() VMAs of the ring */
+    uint8_t *ring_data;           /* Record arena */
+    unsigned int ring_size;       /* Arena size in bytes (power of two) */
+    unsigned int ring_head;       /* Write offset, free-running */
+    unsigned int ring_tail;       /* Oldest live record, free-running */
+    unsigned int ring_count;      /* Number of live records */
+    struct antsdr_ring_cursor cursors[ANTSDR_RING_CONSUMERS];
+    struct mutex read_mutex;      /* Serialises read() and its cursor attachment */
+    struct file *reader_file;     /* File the read() cursor is attached for */
+    size_t ring_buffer_size;      /* Largest payload a record can hold */
     spinlock_t ring_lock;         /* Ring buffer synchronization */
+    bool overloaded;              /* Overload event raised, under ring_lock */
 
     uint32_t operation_mode;  /* 0 or 1 */
     
     /* UDP networking */
-    struct socket *sock;
-    struct sockaddr_in dest_addr;
-    bool dest_set;
-    struct work_struct udp_work;
+    struct antsdr_udp_target dests[ANTSDR_MAX_UDP_DESTS];
+    unsigned int nr_dests;
+    unsigned int dest_gen;        /* Bumped when dests[] is reshuffled, under dest_mutex */
+    struct mutex dest_mutex;      /* Protects dests[] against sends */
+    struct antsdr_pacing pacing;  /* Read locklessly by the send thread */
+    u64 pace_tokens;              /* Token bucket, under dest_mutex */
+    u64 pace_last_ns;
+    bool raw_tx;                  /* Raw Ethernet transmit, under dest_mutex */
+    uint32_t raw_tx_flags;
+    struct notifier_block raw_netdev_nb;  /* Lets go of egress devices going away */
+    bool dest_set;                /* At least one destination */
+    struct kthread_worker *udp_worker;  /* Dedicated send thread */
+    struct kthread_work udp_work;
     bool udp_work_pending;  /* Track if UDP work is already scheduled */
     
+    /* Frame aggregation */
+    bool agg_enable;
+    size_t agg_max_datagram;          /* UDP payload limit derived from the MTU */
+    unsigned int agg_flush_timeout_us;
+    uint8_t *agg_buffer;              /* Datagram being filled, header first */
+    size_t agg_used;                  /* Bytes used in agg_buffer, header included */
+    unsigned int agg_frames;          /* Frames packed in agg_buffer */
+    uint32_t agg_first_frame_id;      /* frame_id of the first packed frame */
+    uint32_t agg_first_counter;       /* FPGA frame counter of the first packed frame */
+    uint64_t agg_first_ts;            /* Capture time of the first packed frame */
+    bool agg_compressed;              /* agg_buffer holds a coded frame */
+    unsigned int compress_mode;       /* ANTSDR_COMPRESS_* */
+    uint8_t *zpack_buf;               /* Coded frame being built */
+    uint8_t *zpack_ref;               /* Raw copy of the previous frame in the datagram */
+    size_t zpack_ref_len;             /* Its length, 0 = none */
+    size_t agg_header_size;           /* Packet header size the datagram was started with */
+    unsigned int header_version;      /* Packet header version sent (1 or 2) */
+    unsigned int ts_clock;            /* ANTSDR_CLOCK_* for capture timestamps */
+    unsigned int csum_mode;           /* ANTSDR_CSUM_* for the checksum field */
+    seqcount_spinlock_t lo_seq;       /* Publishes the lo_* fields to the frame path */
+    uint16_t lo_tag_prev;             /* LO tag before the last recall began, written under lock and lo_seq */
+    uint16_t lo_tag;                  /* LO tag once it settled, written under lock and lo_seq */
+    uint16_t agg_first_lo_tag;        /* LO tag of the first packed frame */
+    uint64_t lo_begin_ns;             /* Capture time the last recall began, written under lock and lo_seq */
+    uint64_t lo_end_ns;               /* ...and settled, U64_MAX while it runs */
+    uint64_t parse_timestamp_ns;      /* Capture time of the transfer being parsed */
+    struct mutex agg_mutex;           /* Protects the datagram being filled */
+    struct kthread_delayed_work agg_flush_work;  /* Runs on udp_worker */
+    
+    /* Pulse integration - block state is only touched by the frame worker */
+    unsigned int integ_mode;          /* ANTSDR_INTEG_* */
+    unsigned int integ_frames;        /* N */
+    unsigned int integ_decimation;    /* K */
+    unsigned int integ_count;         /* Frames in the current block */
+    unsigned int integ_samples;       /* Samples per frame of the current block */
+    uint32_t integ_first_counter;     /* FPGA frame counter of the block's first frame */
+    uint64_t integ_first_ts;          /* Capture time of the block's first frame */
+    void *integ_acc;                  /* s32 I/Q pairs (coherent) or u64 power sums */
+    uint32_t *integ_out;              /* Result payload */
+    
     /* Frame processing thread and buffer */
-    struct workqueue_struct *frame_workqueue;
-    struct work_struct frame_work;
+    struct kthread_worker *frame_worker;  /* Dedicated parse thread */
+    struct kthread_work frame_work;
     struct kfifo raw_frame_fifo;  /* FIFO for raw DMA data */
     spinlock_t raw_fifo_lock;     /* Protect raw frame FIFO */
     bool frame_work_pending;      /* Track if frame work is already scheduled */
     
+    /* Mode schedule, under sched_lock */
+    spinlock_t sched_lock;
+    struct antsdr_schedule *sched;    /* Armed schedule, NULL = none */
+    bool sched_armed;                 /* Entries still to come */
+    bool sched_by_frame;              /* Armed and counting frames - checked locklessly per frame */
+    bool sched_time_pending;          /* Armed by time while stopped, timer starts with the stream */
+    struct hrtimer sched_timer;       /* ANTSDR_SCHED_BY_TIME */
+    struct work_struct sched_work;    /* Pulse mode switch, needs process context */
+    uint32_t sched_pulse_mode;        /* Pulse mode the work switches to */
+    uint32_t sched_lo_profile;
+    uint32_t sched_next;
+    uint64_t sched_position;          /* Frames into the pass (by frame) */
+    uint64_t sched_base_ns;           /* Start of the current pass (by time) */
+    uint64_t sched_passes;
+    uint64_t sched_applied;
+    uint64_t sched_late;
+    uint64_t sched_max_late;
+    uint32_t sched_errors;
+    
+    /* Loopback benchmark - stands in for the FPGA and S2MM while bench_active */
+    struct hrtimer bench_timer;
+    bool bench_active;            /* Streaming from the generator */
+    bool bench_running;           /* Generator still producing */
+    uint32_t bench_rate;
+    uint32_t bench_counter;       /* Next synthetic frame counter */
+    u64 bench_start_ns;
+    u64 bench_end_ns;             /* Stop generating at, 0 = when stopped */
+    u64 bench_stop_ns;            /* When generation actually stopped */
+    atomic64_t bench_generated;
+    atomic64_t bench_missed;
+    atomic64_t bench_cpu_ns;
+    struct antsdr_bench_result bench_base;   /* Counters when the run started */
+    struct antsdr_bench_result bench_final;  /* Result of the last finished run */
+    
     /* Packet protocol tracking */
-    uint32_t packet_sequence_number;  /* Incremental packet sequence */
-    uint32_t frame_id_counter;        /* DMA frame identifier counter */
+    uint32_t frame_id_counter;        /* DMA frame identifier counter, only touched on udp_worker */
     
-    /* GPIO controls */
+    /* GPIO controls - the channel's own rxN-* lines or the board's */
     struct gpio_desc *gpio_enable;
     struct gpio_desc *gpio_pulse_mode;
     struct gpio_desc *gpio_tdd_mode;
     struct gpio_desc *gpio_mode;
+    bool enable_held;                 /* Counted in the board's enable_users */
 
     /* Pulse mode settings */
     unsigned int pulse_mode;
     unsigned int tdd_mode;
     unsigned int mode;
 
-    /* Frame detection buffer for cases where header/footer not found */
-    void *frame_detection_buffer;     /* Large buffer for frame accumulation */
-    size_t frame_buffer_size;         /* Size of frame detection buffer */
-    size_t frame_buffer_used;         /* Current used bytes in buffer */
-    unsigned int frames_accumulated;  /* Number of frames accumulated */
-    spinlock_t frame_buffer_lock;     /* Frame buffer synchronization */
+    /* Resynchronisation - when a transfer doesn't hold one aligned frame, the
+     * partial frame is carried across DMA buffers until its footer arrives
+     */
+    uint32_t *resync_carry;           /* Partial frame, up to FPGA_LONG_PULSE_WORDS */
+    unsigned int resync_words;        /* Words collected in resync_carry */
+    unsigned int resync_frame_words;  /* Frame length the carry was started for */
+    enum antsdr_sync_state sync_state;
+    bool sync_locked;                 /* No words discarded since the last valid frame */
+    u64 sync_lost_ns;                 /* When lock was lost, for time-to-resync */
+    spinlock_t resync_lock;           /* Resync state - parse thread and resets only, never IRQ context */
 
     /* Debug and frame export tracking */
     unsigned int frame_export_count;  /* Number of frames exported */
@@ -250,43 +1057,170 @@ struct antsdr_dma_dev {
     /* Note: Frame reassembly no longer needed since we parse complete DMA transfers */
 };
 
+/* The platform device - the channels and the mode lines they share */
+struct antsdr_dma_board {
+    struct antsdr_dma_dev *channels[ANTSDR_MAX_CHANNELS];
+    unsigned int nr_channels;
+    struct gpio_desc *gpio_enable;
+    struct gpio_desc *gpio_pulse_mode;
+    struct gpio_desc *gpio_tdd_mode;
+    struct gpio_desc *gpio_mode;
+    spinlock_t enable_lock;
+    unsigned int enable_users;        /* Channels holding the shared enable line high */
+};
+
+/* Module parameters */
+static unsigned int dma_queue_depth = ANTSDR_DEFAULT_QUEUE_DEPTH;
+module_param(dma_queue_depth, uint, 0444);
+MODULE_PARM_DESC(dma_queue_depth, "S2MM descriptors kept armed while streaming (1-" __stringify(ANTSDR_MAX_QUEUE_DEPTH) ", 1 = one at a time)");
+
+static unsigned int dma_pool_kb = ANTSDR_DEFAULT_POOL_KB;
+module_param(dma_pool_kb, uint, 0444);
+MODULE_PARM_DESC(dma_pool_kb, "DMA pool size in KB, sliced into per-transfer slots (large pools need CMA)");
+
+static unsigned int ring_kb = ANTSDR_DEFAULT_RING_KB;
+module_param(ring_kb, uint, 0444);
+MODULE_PARM_DESC(ring_kb, "Ring arena size in KB (power of two)");
+
+static unsigned int raw_fifo_depth = ANTSDR_DEFAULT_RAW_FIFO_DEPTH;
+module_param(raw_fifo_depth, uint, 0444);
+MODULE_PARM_DESC(raw_fifo_depth, "Raw frame FIFO depth in frames (power of two)");
+
+static bool zero_copy;
+module_param(zero_copy, bool, 0444);
+MODULE_PARM_DESC(zero_copy, "Send payloads straight from the DMA buffers, re-arming each buffer only after its UDP send (default: copy)");
+
+static int parse_cpu[ANTSDR_MAX_CHANNELS] = { [0 ... ANTSDR_MAX_CHANNELS - 1] = -1 };
+module_param_array(parse_cpu, int, NULL, 0444);
+MODULE_PARM_DESC(parse_cpu, "CPU each channel's frame parse thread is pinned to, comma-separated (-1 = not pinned, spread over the CPUs with several channels)");
+
+static int send_cpu[ANTSDR_MAX_CHANNELS] = { [0 ... ANTSDR_MAX_CHANNELS - 1] = -1 };
+module_param_array(send_cpu, int, NULL, 0444);
+MODULE_PARM_DESC(send_cpu, "CPU each channel's UDP send thread is pinned to, comma-separated (-1 = not pinned, spread over the CPUs with several channels)");
+
+static int stage_priority = 50;
+module_param(stage_priority, int, 0444);
+MODULE_PARM_DESC(stage_priority, "SCHED_FIFO priority of the parse and send threads (1-99, 0 = normal scheduling)");
+
+static int dma_irq[ANTSDR_MAX_CHANNELS] = { [0 ... ANTSDR_MAX_CHANNELS - 1] = -1 };
+module_param_array(dma_irq, int, NULL, 0444);
+MODULE_PARM_DESC(dma_irq, "Linux IRQ number of each channel's S2MM DMA, as in /proc/interrupts, comma-separated (-1 = leave its affinity alone)");
+
+static int dma_irq_cpu[ANTSDR_MAX_CHANNELS] = { [0 ... ANTSDR_MAX_CHANNELS - 1] = -1 };
+module_param_array(dma_irq_cpu, int, NULL, 0444);
+MODULE_PARM_DESC(dma_irq_cpu, "CPU each channel's S2MM DMA IRQ is steered to, comma-separated (-1 = leave its affinity alone)");
+
 /* Function prototypes */
 static int antsdr_submit_dma_transfer(struct antsdr_dma_dev *dma_dev);
+static int antsdr_dma_configure_channel(struct antsdr_dma_dev *dma_dev);
+static void antsdr_dma_release_buffer(struct antsdr_dma_dev *dma_dev, unsigned int index);
 static size_t antsdr_get_transfer_size(struct antsdr_dma_dev *dma_dev);
 /* antsdr_reallocate_buffers removed - buffer sizes now fixed per pulse mode */
 static int antsdr_dma_reset_and_restart(struct antsdr_dma_dev *dma_dev);
-static int antsdr_parse_fpga_frame(struct antsdr_dma_dev *dma_dev, const uint8_t *data, size_t data_len, uint8_t **payload, size_t *payload_len);
-static void antsdr_frame_work(struct work_struct *work);
+static int antsdr_parse_fpga_frame(struct antsdr_dma_dev *dma_dev, const uint8_t *data, size_t data_len, uint8_t **payload, size_t *payload_len, uint32_t *payload_counter);
+static void antsdr_frame_work(struct kthread_work *work);
+static void antsdr_poll_work(struct kthread_work *work);
+static void antsdr_poll_mode_times(struct antsdr_dma_dev *dma_dev, uint64_t *irq_ns, uint64_t *poll_ns);
+static u64 antsdr_capture_time(struct antsdr_dma_dev *dma_dev);
+static int antsdr_set_pulse_mode(struct antsdr_dma_dev *dma_dev, uint32_t pulse_mode);
+static inline uint16_t antsdr_lo_tag(const struct antsdr_dma_dev *dma_dev, uint64_t timestamp_ns);
 
 /* Ring buffer management functions */
 static int antsdr_ring_init(struct antsdr_dma_dev *dma_dev);
 static void antsdr_ring_cleanup(struct antsdr_dma_dev *dma_dev);
-static int antsdr_ring_put(struct antsdr_dma_dev *dma_dev, const void *data, size_t size);
-static int antsdr_ring_get(struct antsdr_dma_dev *dma_dev, void **data, size_t *size);
-static void antsdr_ring_return_buffer(struct antsdr_dma_dev *dma_dev);
+static int antsdr_ring_put(struct antsdr_dma_dev *dma_dev, const void *data, size_t size, uint32_t frame_counter, uint64_t timestamp_ns, int dma_index);
+static int antsdr_ring_get(struct antsdr_dma_dev *dma_dev, enum antsdr_ring_consumer consumer, void **data, size_t *size, uint32_t *frame_counter, uint64_t *timestamp_ns);
+static void antsdr_ring_return_buffer(struct antsdr_dma_dev *dma_dev, enum antsdr_ring_consumer consumer);
+static void antsdr_ring_attach(struct antsdr_dma_dev *dma_dev, enum antsdr_ring_consumer consumer);
+static void antsdr_ring_detach(struct antsdr_dma_dev *dma_dev, enum antsdr_ring_consumer consumer);
+static void antsdr_ring_flush(struct antsdr_dma_dev *dma_dev);
 
-/* Frame detection buffer functions */
-static int antsdr_frame_buffer_init(struct antsdr_dma_dev *dma_dev);
-static void antsdr_frame_buffer_cleanup(struct antsdr_dma_dev *dma_dev);
-static int antsdr_frame_buffer_add(struct antsdr_dma_dev *dma_dev, const void *data, size_t size);
-static int antsdr_frame_buffer_process(struct antsdr_dma_dev *dma_dev);
-static void antsdr_frame_buffer_reset(struct antsdr_dma_dev *dma_dev);
+/* Resynchronisation functions */
+static int antsdr_resync_init(struct antsdr_dma_dev *dma_dev);
+static void antsdr_resync_cleanup(struct antsdr_dma_dev *dma_dev);
+static int antsdr_resync_feed(struct antsdr_dma_dev *dma_dev, const uint32_t *words, size_t word_count, unsigned int frame_words);
+static void antsdr_resync_reset(struct antsdr_dma_dev *dma_dev);
+
+/* Pulse integration */
+static int antsdr_integ_add(struct antsdr_dma_dev *dma_dev, const uint8_t *payload, size_t payload_len, uint32_t frame_counter, uint64_t timestamp_ns);
 
 /* Debug and frame export functions */
 static int antsdr_export_frame_to_file(struct antsdr_dma_dev *dma_dev, const uint8_t *data, size_t data_len, const char *frame_type);
 
+/* Count and trace a dropped frame */
+static void antsdr_drop(struct antsdr_dma_dev *dma_dev, enum antsdr_drop_reason reason, size_t len)
+{
+    atomic64_inc(&dma_dev->stats.drops[reason]);
+    trace_antsdr_drop(reason, len);
+}
+
+static void antsdr_lat_record(struct antsdr_dma_dev *dma_dev, enum antsdr_lat_stage stage, u64 ns)
+{
+    struct antsdr_lat_counters *lat = &dma_dev->stats.latency[stage];
+    unsigned int bucket = fls64(ns);
+    
+    bucket = bucket ? min(bucket - 1, ANTSDR_LAT_BUCKETS - 1) : 0;
+    atomic64_inc(&lat->count);
+    atomic64_add(ns, &lat->sum_ns);
+    atomic64_inc(&lat->buckets[bucket]);
+    /* Every stage is recorded from one thread only */
+    if (ns > atomic64_read(&lat->max_ns))
+        atomic64_set(&lat->max_ns, ns);
+}
+
+/* Record a stage reached now by a transfer captured at timestamp_ns.
+ * Returns the latency, 0 if the capture clock was stepped backwards.
+ */
+static u64 antsdr_lat_since(struct antsdr_dma_dev *dma_dev, enum antsdr_lat_stage stage, u64 timestamp_ns)
+{
+    u64 now = antsdr_capture_time(dma_dev);
+    
+    if (now < timestamp_ns)
+        return 0;
+    antsdr_lat_record(dma_dev, stage, now - timestamp_ns);
+    return now - timestamp_ns;
+}
+
+/* Gap-based missing frame detection */
+static void antsdr_track_frame_counter(struct antsdr_dma_dev *dma_dev, uint32_t frame_counter)
+{
+    if (!dma_dev->first_frame_received) {
+        /* First frame - initialize tracking */
+        dma_dev->last_frame_counter = frame_counter;
+        dma_dev->first_frame_received = true;
+        antsdr_debug_log(dma_dev->dev, "First frame received: counter=%u\n", frame_counter);
+    } else {
+        /* Check for gaps in frame counter sequence */
+        uint32_t expected_counter = dma_dev->last_frame_counter + 1;
+        if (frame_counter > expected_counter) {
+            /* Gap detected - frames were missing */
+            uint32_t missing_frames = frame_counter - expected_counter;
+            dma_dev->missing_frame_count += missing_frames;
+            antsdr_debug_log(dma_dev->dev, "Gap detected: expected=%u, received=%u, missing=%u frames, total_missing=%u\n",
+                   expected_counter, frame_counter, missing_frames, dma_dev->missing_frame_count);
+        } else if (frame_counter < expected_counter) {
+            /* Frame counter wrapped around or out of order */
+            antsdr_debug_log(dma_dev->dev, "Frame counter anomaly: expected=%u, received=%u\n",
+                   expected_counter, frame_counter);
+        }
+        dma_dev->last_frame_counter = frame_counter;
+    }
+}
+
 /* Parse FPGA frame and extract payload 
  * Returns: 0 on success, -1 on invalid frame
- * Sets payload pointer and payload_len for extracted data
+ * Sets payload pointer, payload_len and payload_counter (FPGA frame counter) for extracted data
  */
-static int antsdr_parse_fpga_frame(struct antsdr_dma_dev *dma_dev, const uint8_t *data, size_t data_len, uint8_t **payload, size_t *payload_len)
+static int antsdr_parse_fpga_frame(struct antsdr_dma_dev *dma_dev, const uint8_t *data, size_t data_len, uint8_t **payload, size_t *payload_len, uint32_t *payload_counter)
 {
     const uint32_t *words = (const uint32_t *)data;
     size_t word_count = data_len / 4;
-    int header_pos = -1, footer_pos = -1;
     int expected_frame_words;
     uint32_t frame_counter;
-    int i;
+    
+    *payload = NULL;
+    *payload_len = 0;
+    *payload_counter = 0;
     
     /* Increment DMA callback counter */
     dma_dev->total_frames_processed++;
@@ -300,115 +1234,37 @@ static int antsdr_parse_fpga_frame(struct antsdr_dma_dev *dma_dev, const uint8_t
     /* Determine expected frame size based on pulse mode */
     expected_frame_words = dma_dev->pulse_mode ? FPGA_LONG_PULSE_WORDS : FPGA_SHORT_PULSE_WORDS;
     
-    /* Step 1: Find header and footer positions */
-    for (i = 0; i < word_count; i++) {
-        if (words[i] == FPGA_HEADER_MARKER_1 || words[i] == FPGA_HEADER_MARKER_2) {
-            if (header_pos == -1) {
-                header_pos = i;
-                antsdr_debug_log(dma_dev->dev, "Found header 0x%08x at position %d\n", words[i], i);
-            }
-        }
-        if (words[i] == FPGA_FOOTER_MARKER) {
-            footer_pos = i;
-            antsdr_debug_log(dma_dev->dev, "Found footer 0x%08x at position %d\n", words[i], i);
-        }
-    }
-    
-    /* Step 2: Analyze what we found */
-    if (header_pos != -1 && footer_pos != -1) {
-        /* Both header and footer found - check frame length */
-        int actual_frame_words = footer_pos - header_pos + 1;
+    /* Fast path: the S2MM transfer is sized to exactly one frame, so an aligned
+     * frame has its header at word 0, the frame counter at N-2 and the footer
+     * at N-1. Only scan for markers when that doesn't hold.
+     */
+    if (word_count == expected_frame_words &&
+        (words[0] == FPGA_HEADER_MARKER_1 || words[0] == FPGA_HEADER_MARKER_2) &&
+        words[word_count - 1] == FPGA_FOOTER_MARKER) {
+        frame_counter = words[word_count - 2];
+        antsdr_track_frame_counter(dma_dev, frame_counter);
         
-        antsdr_debug_log(dma_dev->dev, "Complete frame: header@%d, footer@%d, length=%d words (expected %d)\n",
-               header_pos, footer_pos, actual_frame_words, expected_frame_words);
+        *payload = (uint8_t *)&words[1];
+        *payload_len = (expected_frame_words - 3) * 4;  /* Exclude header, frame_counter, footer */
+        *payload_counter = frame_counter;
         
-        if (actual_frame_words == expected_frame_words) {
-            /* Valid frame found! */
-            
-            /* Step 3: Extract frame counter (word before footer) */
-            if (footer_pos > header_pos + 1) {
-                frame_counter = words[footer_pos - 1];
-                
-                /* Gap-based missing frame detection */
-                if (!dma_dev->first_frame_received) {
-                    /* First frame - initialize tracking */
-                    dma_dev->last_frame_counter = frame_counter;
-                    dma_dev->first_frame_received = true;
-                    antsdr_debug_log(dma_dev->dev, "First frame received: counter=%u\n", frame_counter);
-                } else {
-                    /* Check for gaps in frame counter sequence */
-                    uint32_t expected_counter = dma_dev->last_frame_counter + 1;
-                    if (frame_counter > expected_counter) {
-                        /* Gap detected - frames were missing */
-                        uint32_t missing_frames = frame_counter - expected_counter;
-                        dma_dev->missing_frame_count += missing_frames;
-                        antsdr_debug_log(dma_dev->dev, "Gap detected: expected=%u, received=%u, missing=%u frames, total_missing=%u\n",
-                               expected_counter, frame_counter, missing_frames, dma_dev->missing_frame_count);
-                    } else if (frame_counter < expected_counter) {
-                        /* Frame counter wrapped around or out of order */
-                        antsdr_debug_log(dma_dev->dev, "Frame counter anomaly: expected=%u, received=%u\n",
-                               expected_counter, frame_counter);
-                    }
-                    dma_dev->last_frame_counter = frame_counter;
-                }
-                
-                antsdr_debug_log(dma_dev->dev, "Frame counter: %u (DMA callback #%u, total_missing=%u)\n",
-                       frame_counter, dma_dev->total_frames_processed, dma_dev->missing_frame_count);
-            } else {
-                frame_counter = 0;
-                antsdr_debug_log(dma_dev->dev, "No frame counter available\n");
-            }
-            
-            /* Step 4: Extract payload (exclude header, footer, and frame counter) */
-            if (actual_frame_words >= 3) {  /* header + at least 1 payload word + frame_counter + footer */
-                *payload = (uint8_t *)&words[header_pos + 1];  /* Start after header */
-                *payload_len = (actual_frame_words - 3) * 4;   /* Exclude header, frame_counter, footer */
-                
-                antsdr_debug_log(dma_dev->dev, "Valid frame extracted: %zu payload bytes, frame_counter=%u\n", 
-                       *payload_len, frame_counter);
-                       
-                /* Export parsed frame for analysis */
-                antsdr_export_frame_to_file(dma_dev, (uint8_t *)&words[header_pos], actual_frame_words * 4, "parsed_valid");
-                
-                return 0;  /* Success */
-            } else {
-                antsdr_debug_log(dma_dev->dev, "Frame too short for payload extraction\n");
-            }
-        } else {
-            /* Frame length mismatch - invalid frame, don't add to buffer */
-            antsdr_debug_log(dma_dev->dev, "Frame length mismatch: got %d words, expected %d - discarding\n",
-                   actual_frame_words, expected_frame_words);
-            return -1;
-        }
-    } else if (header_pos != -1) {
-        /* Only header found - add to detection buffer for further analysis */
-        antsdr_debug_log(dma_dev->dev, "Only header found at position %d - adding to detection buffer\n", header_pos);
+        antsdr_stat_inc(dma_dev, fast_path_frames);
         
-        int ret = antsdr_frame_buffer_add(dma_dev, data, data_len);
-        if (ret == 0) {
-            /* Check if we should process accumulated buffer */
-            if (dma_dev->frames_accumulated >= 3 || 
-                dma_dev->frame_buffer_used >= (FRAME_DETECTION_BUFFER_SIZE / 2)) {
-                antsdr_debug_log(dma_dev->dev, "Processing accumulated frame buffer (%u frames, %zu bytes)\n",
-                       dma_dev->frames_accumulated, dma_dev->frame_buffer_used);
-                
-                /* Try to find complete frames in accumulated buffer */
-                int found_frames = antsdr_frame_buffer_process(dma_dev);
-                if (found_frames > 0) {
-                    antsdr_debug_log(dma_dev->dev, "Found %d complete frames in accumulated buffer\n", found_frames);
-                    /* Buffer processing might have found valid frames and queued them for UDP */
-                    return 0;
-                }
-            }
-        }
-        return -1;  /* Incomplete frame */
-    } else {
-        /* No header or footer found - skip this frame completely */
-        antsdr_debug_log(dma_dev->dev, "No header or footer found - skipping frame\n");
-        return -1;
+        /* An aligned frame supersedes any partial frame still being carried */
+        if (dma_dev->resync_words)
+            antsdr_resync_reset(dma_dev);
+        return 0;
     }
+    antsdr_stat_inc(dma_dev, slow_path_frames);
     
-    return -1;  /* Should not reach here */
+    /* Slow path: feed the words to the resync state machine, which queues
+     * every frame it completes (possibly one started in an earlier transfer)
+     */
+    if (antsdr_resync_feed(dma_dev, words, word_count, expected_frame_words) > 0)
+        return 0;  /* Frames queued as copies, *payload left NULL */
+    
+    antsdr_debug_log(dma_dev->dev, "No complete frame in transfer #%u\n", dma_dev->total_frames_processed);
+    return -1;  /* Incomplete frame */
 }
 
 /* Get transfer size based on current pulse mode */
@@ -422,313 +1278,861 @@ static size_t antsdr_get_transfer_size(struct antsdr_dma_dev *dma_dev)
     }
 }
 
-/* Get current DMA buffer based on pulse mode */
-static void* antsdr_get_current_buffer(struct antsdr_dma_dev *dma_dev)
+/* Get DMA buffer by index - a slot of the pool at the current stride */
+static void* antsdr_get_dma_buffer(struct antsdr_dma_dev *dma_dev, unsigned int index)
 {
-    /* Use appropriate buffer based on pulse mode for optimal performance */
-    if (dma_dev->pulse_mode) {
-        return dma_dev->long_dma_buffers[dma_dev->current_buffer];
-    } else {
-        return dma_dev->short_dma_buffers[dma_dev->current_buffer];
-    }
+    return (uint8_t *)dma_dev->dma_pool + index * dma_dev->dma_slot_size;
 }
 
-/* Get current DMA handle based on pulse mode */
-static dma_addr_t antsdr_get_current_handle(struct antsdr_dma_dev *dma_dev)
+/* Get DMA handle by index */
+static dma_addr_t antsdr_get_dma_handle(struct antsdr_dma_dev *dma_dev, unsigned int index)
 {
-    /* Use appropriate handle based on pulse mode for optimal performance */
-    if (dma_dev->pulse_mode) {
-        return dma_dev->long_dma_handles[dma_dev->current_buffer];
-    } else {
-        return dma_dev->short_dma_handles[dma_dev->current_buffer];
-    }
+    return dma_dev->dma_pool_handle + index * dma_dev->dma_slot_size;
 }
 
-/* Ring buffer management functions */
-static int antsdr_ring_init(struct antsdr_dma_dev *dma_dev)
+/* Slice the pool for the current pulse mode and put every buffer back on the
+ * free list - nothing armed, nothing held
+ */
+static void antsdr_dma_reset_buffer_queue(struct antsdr_dma_dev *dma_dev)
 {
-    int i;
-    
-    dma_dev->ring_size = RING_BUFFER_COUNT;
-    dma_dev->ring_buffer_size = RING_BUFFER_SIZE;
-    dma_dev->ring_head = 0;
-    dma_dev->ring_tail = 0;
-    dma_dev->ring_count = 0;
-    spin_lock_init(&dma_dev->ring_lock);
-    
-    /* Allocate array of buffer pointers */
-    dma_dev->ring_buffers = kzalloc(dma_dev->ring_size * sizeof(void*), GFP_KERNEL);
-    if (!dma_dev->ring_buffers) {
-        dev_err(dma_dev->dev, "Failed to allocate ring buffer array\n");
-        return -ENOMEM;
-    }
-    
-    /* Allocate individual ring buffers */
-    for (i = 0; i < dma_dev->ring_size; i++) {
-        dma_dev->ring_buffers[i] = kmalloc(dma_dev->ring_buffer_size, GFP_KERNEL);
-        if (!dma_dev->ring_buffers[i]) {
-            dev_err(dma_dev->dev, "Failed to allocate ring buffer %d\n", i);
-            /* Clean up already allocated buffers */
-            while (--i >= 0) {
-                kfree(dma_dev->ring_buffers[i]);
-            }
-            kfree(dma_dev->ring_buffers);
-            return -ENOMEM;
-        }
-    }
-    
-    dev_info(dma_dev->dev, "Ring buffer initialized: %d buffers of %zu bytes each\n", 
-             dma_dev->ring_size, dma_dev->ring_buffer_size);
-    return 0;
+    unsigned long flags;
+    unsigned int i;
+    
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    dma_dev->dma_slot_size = ALIGN(antsdr_get_transfer_size(dma_dev), ANTSDR_DMA_SLOT_ALIGN);
+    dma_dev->dma_nr_buffers = min_t(size_t, dma_dev->dma_pool_size / dma_dev->dma_slot_size,
+                                    dma_dev->dma_max_buffers);
+    for (i = 0; i < dma_dev->dma_nr_buffers; i++)
+        dma_dev->dma_free[i] = i;
+    dma_dev->dma_free_head = 0;
+    dma_dev->dma_free_count = dma_dev->dma_nr_buffers;
+    dma_dev->current_buffer = 0;
+    dma_dev->dma_inflight = 0;
+    dma_dev->dma_poll_armed = 0;
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
 }
 
-static void antsdr_ring_cleanup(struct antsdr_dma_dev *dma_dev)
+/* Append a buffer to the free list. Caller holds dma_dev->dma_queue_lock. */
+static void antsdr_dma_put_free_locked(struct antsdr_dma_dev *dma_dev, unsigned int index)
 {
-    int i;
-    
-    if (dma_dev->ring_buffers) {
-        for (i = 0; i < dma_dev->ring_size; i++) {
-            kfree(dma_dev->ring_buffers[i]);
-        }
-        kfree(dma_dev->ring_buffers);
-        dma_dev->ring_buffers = NULL;
-    }
-    
-    dev_info(dma_dev->dev, "Ring buffer cleaned up\n");
+    dma_dev->dma_free[(dma_dev->dma_free_head + dma_dev->dma_free_count) % dma_dev->dma_nr_buffers] = index;
+    dma_dev->dma_free_count++;
 }
 
-static int antsdr_ring_put(struct antsdr_dma_dev *dma_dev, const void *data, size_t size)
+/* Free the DMA pool - nothing may be armed */
+static void antsdr_dma_pool_free(struct antsdr_dma_dev *dma_dev)
 {
     unsigned long flags;
-    void *ring_buffer;
-    unsigned int next_head;
     
-    if (size > dma_dev->ring_buffer_size) {
-        dev_warn(dma_dev->dev, "Data size %zu exceeds ring buffer size %zu\n", 
-                 size, dma_dev->ring_buffer_size);
-        return -EINVAL;
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    dma_dev->dma_nr_buffers = 0;
+    dma_dev->dma_free_count = 0;
+    dma_dev->dma_max_buffers = 0;
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+    
+    if (dma_dev->dma_pool)
+        dma_free_coherent(dma_dev->dma_pool_dev, dma_dev->dma_pool_size,
+                          dma_dev->dma_pool, dma_dev->dma_pool_handle);
+    dma_dev->dma_pool = NULL;
+    dma_dev->dma_pool_size = 0;
+    kvfree(dma_dev->dma_cookies);
+    kvfree(dma_dev->dma_has_callback);
+    kvfree(dma_dev->dma_armed);
+    kvfree(dma_dev->dma_free);
+    dma_dev->dma_cookies = NULL;
+    dma_dev->dma_has_callback = NULL;
+    dma_dev->dma_armed = NULL;
+    dma_dev->dma_free = NULL;
+}
+/* Allocate a DMA pool of 'size' bytes and swap it in, freeing the old one.
+ * On failure the current pool is kept. Not while streaming.
+ */
+static int antsdr_dma_pool_alloc(struct antsdr_dma_dev *dma_dev, size_t size)
+{
+    struct device *dev = dma_dev->rx_chan->device->dev;
+    unsigned int max_buffers = size / ALIGN(FPGA_SHORT_TRANSFER_SIZE, ANTSDR_DMA_SLOT_ALIGN);
+    dma_cookie_t *cookies;
+    bool *has_callback;
+    unsigned int *armed, *free_list;
+    dma_addr_t handle;
+    unsigned long flags;
+    void *pool;
+    
+    cookies = kvcalloc(max_buffers, sizeof(*cookies), GFP_KERNEL);
+    has_callback = kvcalloc(max_buffers, sizeof(*has_callback), GFP_KERNEL);
+    armed = kvcalloc(max_buffers, sizeof(*armed), GFP_KERNEL);
+    free_list = kvcalloc(max_buffers, sizeof(*free_list), GFP_KERNEL);
+    pool = NULL;
+    if (cookies && has_callback && armed && free_list)
+        pool = dma_alloc_coherent(dev, size, &handle, GFP_KERNEL);
+    if (!pool) {
+        dev_err(dma_dev->dev, "Failed to allocate %zu byte DMA pool (CMA area too small?)\n", size);
+        kvfree(cookies);
+        kvfree(has_callback);
+        kvfree(armed);
+        kvfree(free_list);
+        return -ENOMEM;
     }
     
-    spin_lock_irqsave(&dma_dev->ring_lock, flags);
-    
-    /* Check if ring buffer is full */
-    if (dma_dev->ring_count >= dma_dev->ring_size) {
-        spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
-        dev_warn_ratelimited(dma_dev->dev, "Ring buffer full, dropping data\n");
-        return -ENOSPC;
-    }
+    if (!IS_ALIGNED(handle, ANTSDR_DMA_SLOT_ALIGN))
+        dev_warn(dma_dev->dev, "DMA pool not %d-byte aligned: 0x%pad\n", ANTSDR_DMA_SLOT_ALIGN, &handle);
     
-    /* Get buffer at head position and copy data */
-    ring_buffer = dma_dev->ring_buffers[dma_dev->ring_head];
-    memcpy(ring_buffer, data, size);
+    antsdr_dma_pool_free(dma_dev);
     
-    /* Advance head pointer */
-    next_head = (dma_dev->ring_head + 1) % dma_dev->ring_size;
-    dma_dev->ring_head = next_head;
-    dma_dev->ring_count++;
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    dma_dev->dma_pool = pool;
+    dma_dev->dma_pool_handle = handle;
+    dma_dev->dma_pool_dev = dev;
+    dma_dev->dma_pool_size = size;
+    dma_dev->dma_max_buffers = max_buffers;
+    dma_dev->dma_cookies = cookies;
+    dma_dev->dma_has_callback = has_callback;
+    dma_dev->dma_armed = armed;
+    dma_dev->dma_free = free_list;
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
     
-    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+    antsdr_dma_reset_buffer_queue(dma_dev);
     
-    dev_dbg(dma_dev->dev, "Ring put: %zu bytes, count=%u\n", size, dma_dev->ring_count);
+    dev_info(dma_dev->dev, "DMA pool: %zu bytes at 0x%pad, %u buffers of %zu bytes at the current pulse mode\n",
+             size, &handle, dma_dev->dma_nr_buffers, dma_dev->dma_slot_size);
     return 0;
 }
 
-static int antsdr_ring_get(struct antsdr_dma_dev *dma_dev, void **data, size_t *size)
+
+/* Return the armed buffers to the free list after the channel was terminated */
+static void antsdr_dma_drop_armed(struct antsdr_dma_dev *dma_dev)
 {
     unsigned long flags;
     
-    spin_lock_irqsave(&dma_dev->ring_lock, flags);
-    
-    /* Check if ring buffer is empty */
-    if (dma_dev->ring_count == 0) {
-        spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
-        return -ENODATA;
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    while (dma_dev->dma_inflight > 0) {
+        antsdr_dma_put_free_locked(dma_dev, dma_dev->dma_armed[dma_dev->current_buffer]);
+        dma_dev->current_buffer = (dma_dev->current_buffer + 1) % dma_dev->dma_nr_buffers;
+        dma_dev->dma_inflight--;
     }
-    
-    /* Get buffer at tail position */
-    *data = dma_dev->ring_buffers[dma_dev->ring_tail];
-    *size = dma_dev->ring_buffer_size;
-    
-    /* Don't advance tail yet - will be done in return_buffer */
-    
-    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
-    
-    dev_dbg(dma_dev->dev, "Ring get: buffer at tail %u, count=%u\n", 
-            dma_dev->ring_tail, dma_dev->ring_count);
-    return 0;
+    dma_dev->dma_poll_armed = 0;
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
 }
 
-static void antsdr_ring_return_buffer(struct antsdr_dma_dev *dma_dev)
+/* Zero-copy: a consumer is done with a completed DMA buffer. Put it back on the
+ * free list and, while streaming, re-arm it straight away.
+ */
+static void antsdr_dma_release_buffer(struct antsdr_dma_dev *dma_dev, unsigned int index)
 {
     unsigned long flags;
     
-    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    antsdr_dma_put_free_locked(dma_dev, index);
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
     
-    if (dma_dev->ring_count > 0) {
-        /* Advance tail pointer */
-        dma_dev->ring_tail = (dma_dev->ring_tail + 1) % dma_dev->ring_size;
-        dma_dev->ring_count--;
-        
-        dev_dbg(dma_dev->dev, "Ring buffer returned, count=%u\n", dma_dev->ring_count);
+    if (dma_dev->streaming && dma_dev->rx_chan)
+        antsdr_submit_dma_transfer(dma_dev);
+}
+
+/* Release a raw frame - free the copy, or give its DMA buffer back */
+static void antsdr_raw_frame_release(struct antsdr_dma_dev *dma_dev, struct antsdr_raw_frame *raw_frame)
+{
+    if (raw_frame->dma_index >= 0)
+        antsdr_dma_release_buffer(dma_dev, raw_frame->dma_index);
+    else
+        kfree(raw_frame->data);
+}
+
+/* Ring buffer management functions */
+
+/* Allocate an empty 'size' byte arena (power of two) and swap it in, freeing
+ * the old one. Consumers stay attached and restart at offset 0. The ring must
+ * be empty (flushed) and not mapped.
+ */
+static int antsdr_ring_alloc(struct antsdr_dma_dev *dma_dev, unsigned int size)
+{
+    struct antsdr_ring_ctrl *ctrl;
+    unsigned long flags;
+    void *old_mem;
+    void *mem;
+    int i;
+    
+    /* Allocate the control page and record arena as one mappable area */
+    mem = vmalloc_user(PAGE_SIZE + size);
+    if (!mem) {
+        dev_err(dma_dev->dev, "Failed to allocate %u byte ring buffer arena\n", size);
+        return -ENOMEM;
     }
+    ctrl = mem;
+    ctrl->magic = ANTSDR_RING_CTRL_MAGIC;
+    ctrl->version = ANTSDR_RING_CTRL_VERSION;
+    ctrl->data_offset = PAGE_SIZE;
+    ctrl->data_size = size;
+    ctrl->record_align = RING_RECORD_ALIGN;
     
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    old_mem = dma_dev->ring_mem;
+    dma_dev->ring_mem = mem;
+    dma_dev->ring_ctrl = ctrl;
+    dma_dev->ring_data = (uint8_t *)mem + PAGE_SIZE;
+    dma_dev->ring_size = size;
+    dma_dev->ring_head = 0;
+    dma_dev->ring_tail = 0;
+    dma_dev->ring_count = 0;
+    for (i = 0; i < ANTSDR_RING_CONSUMERS; i++) {
+        dma_dev->cursors[i].tail = 0;
+        dma_dev->cursors[i].count = 0;
+    }
     spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+    
+    vfree(old_mem);
+    return 0;
 }
 
-/* Frame detection buffer management functions */
-static int antsdr_frame_buffer_init(struct antsdr_dma_dev *dma_dev)
+static int antsdr_ring_init(struct antsdr_dma_dev *dma_dev)
 {
-    dma_dev->frame_buffer_size = FRAME_DETECTION_BUFFER_SIZE;
-    dma_dev->frame_buffer_used = 0;
-    dma_dev->frames_accumulated = 0;
-    spin_lock_init(&dma_dev->frame_buffer_lock);
+    int ret;
     
-    dma_dev->frame_detection_buffer = kmalloc(dma_dev->frame_buffer_size, GFP_KERNEL);
-    if (!dma_dev->frame_detection_buffer) {
-        dev_err(dma_dev->dev, "Failed to allocate frame detection buffer\n");
-        return -ENOMEM;
+    dma_dev->ring_buffer_size = RING_BUFFER_SIZE;
+    spin_lock_init(&dma_dev->ring_lock);
+    atomic_set(&dma_dev->ring_mappings, 0);
+    memset(dma_dev->cursors, 0, sizeof(dma_dev->cursors));
+    mutex_init(&dma_dev->read_mutex);
+    dma_dev->reader_file = NULL;
+    
+    ret = antsdr_ring_alloc(dma_dev, dma_dev->ring_size);
+    if (ret)
+        return ret;
+    
+    /* The UDP sender always consumes the stream */
+    antsdr_ring_attach(dma_dev, ANTSDR_CONSUMER_UDP);
+    
+    dev_info(dma_dev->dev, "Ring buffer initialized: %u byte record arena, payloads up to %zu bytes\n", 
+             dma_dev->ring_size, dma_dev->ring_buffer_size);
+    return 0;
+}
+
+static void antsdr_ring_cleanup(struct antsdr_dma_dev *dma_dev)
+{
+    vfree(dma_dev->ring_mem);
+    dma_dev->ring_mem = NULL;
+    dma_dev->ring_ctrl = NULL;
+    dma_dev->ring_data = NULL;
+    
+    dev_info(dma_dev->dev, "Ring buffer cleaned up\n");
+}
+
+/* Arena bytes taken by a record with 'body' bytes after its header */
+static inline unsigned int antsdr_ring_record_len(size_t body)
+{
+    return ALIGN(sizeof(struct antsdr_ring_record) + body, RING_RECORD_ALIGN);
+}
+
+/* Record at free-running offset 'pos' */
+static inline struct antsdr_ring_record *antsdr_ring_record_at(struct antsdr_dma_dev *dma_dev, unsigned int pos)
+{
+    return (struct antsdr_ring_record *)(dma_dev->ring_data + (pos & (dma_dev->ring_size - 1)));
+}
+
+/* Arena bytes from a record to the next one */
+static inline unsigned int antsdr_ring_record_span(const struct antsdr_ring_record *rec)
+{
+    if (rec->flags & ANTSDR_RING_REC_PAD)
+        return sizeof(*rec) + rec->size;
+    if (rec->flags & ANTSDR_RING_REC_DMA_REF)
+        return antsdr_ring_record_len(sizeof(struct antsdr_ring_dma_ref));
+    return antsdr_ring_record_len(rec->size);
+}
+
+/* Record at a cursor, skipping (and consuming) PAD records.
+ * Caller holds ring_lock and has checked cursor->count > 0.
+ */
+static struct antsdr_ring_record *antsdr_ring_cursor_record(struct antsdr_dma_dev *dma_dev, struct antsdr_ring_cursor *cur)
+{
+    struct antsdr_ring_record *rec = antsdr_ring_record_at(dma_dev, cur->tail);
+    
+    while (rec->flags & ANTSDR_RING_REC_PAD) {
+        cur->tail += antsdr_ring_record_span(rec);
+        rec = antsdr_ring_record_at(dma_dev, cur->tail);
+    }
+    return rec;
+}
+
+/* Pick up the mmap() reader's progress. user_tail is only trusted when it
+ * moves the cursor forward without passing head, and only up to the last
+ * record boundary at or below it - the cursor walks whole records, so
+ * ring_tail can never step past it. Caller holds ring_lock.
+ */
+static void antsdr_ring_sync_mmap_locked(struct antsdr_dma_dev *dma_dev)
+{
+    struct antsdr_ring_cursor *cur = &dma_dev->cursors[ANTSDR_CONSUMER_MMAP];
+    struct antsdr_ring_record *rec;
+    unsigned int user_tail, span;
+    
+    if (!cur->active)
+        return;
+    
+    user_tail = READ_ONCE(dma_dev->ring_ctrl->user_tail);
+    if (dma_dev->ring_head - user_tail > dma_dev->ring_head - cur->tail)
+        return;
+    
+    while (cur->tail != user_tail) {
+        rec = antsdr_ring_record_at(dma_dev, cur->tail);
+        span = antsdr_ring_record_span(rec);
+        if ((int)(user_tail - (cur->tail + span)) < 0)
+            break;
+        if (!(rec->flags & ANTSDR_RING_REC_PAD) && cur->count)
+            cur->count--;
+        cur->tail += span;
+    }
+}
+
+/* Free records every active consumer has read, advancing ring_tail. DMA
+ * buffers held by freed records go straight back on the free list; returns
+ * how many, for the caller to re-arm with antsdr_ring_rearm() once ring_lock
+ * is dropped. Caller holds ring_lock.
+ */
+static unsigned int antsdr_ring_reclaim_locked(struct antsdr_dma_dev *dma_dev)
+{
+    struct antsdr_ring_record *rec;
+    unsigned int oldest = 0, used, target;
+    unsigned int nr_release = 0;
+    int i;
+    
+    antsdr_ring_sync_mmap_locked(dma_dev);
+    
+    for (i = 0; i < ANTSDR_RING_CONSUMERS; i++) {
+        if (!dma_dev->cursors[i].active)
+            continue;
+        used = dma_dev->ring_head - dma_dev->cursors[i].tail;
+        if (used > oldest)
+            oldest = used;
+    }
+    target = dma_dev->ring_head - oldest;
+    
+    while ((int)(target - dma_dev->ring_tail) > 0) {
+        rec = antsdr_ring_record_at(dma_dev, dma_dev->ring_tail);
+        if (!(rec->flags & ANTSDR_RING_REC_PAD)) {
+            if (rec->flags & ANTSDR_RING_REC_DMA_REF) {
+                spin_lock(&dma_dev->dma_queue_lock);
+                antsdr_dma_put_free_locked(dma_dev, ((struct antsdr_ring_dma_ref *)(rec + 1))->dma_index);
+                spin_unlock(&dma_dev->dma_queue_lock);
+                nr_release++;
+            }
+            dma_dev->ring_count--;
+        }
+        dma_dev->ring_tail += antsdr_ring_record_span(rec);
+    }
+    
+    /* mmap() readers must see the new tail before its space is reused */
+    WRITE_ONCE(dma_dev->ring_ctrl->tail, dma_dev->ring_tail);
+    smp_wmb();
+    return nr_release;
+}
+
+/* Zero-copy: re-arm DMA buffers freed by reclaiming records */
+static void antsdr_ring_rearm(struct antsdr_dma_dev *dma_dev, unsigned int nr_release)
+{
+    if (nr_release && dma_dev->streaming && dma_dev->rx_chan)
+        antsdr_submit_dma_transfer(dma_dev);
+}
+
+/* What the UDP sender has yet to send, in percent. Other consumers lagging
+ * don't count - they are overrun, the send path is not. With zero_copy each
+ * record holds a DMA buffer, and the pool runs out well before the arena.
+ * Caller holds ring_lock.
+ */
+static unsigned int antsdr_udp_backlog_pct_locked(struct antsdr_dma_dev *dma_dev)
+{
+    struct antsdr_ring_cursor *cur = &dma_dev->cursors[ANTSDR_CONSUMER_UDP];
+    
+    if (dma_dev->zero_copy)
+        return dma_dev->dma_nr_buffers ? cur->count * 100 / dma_dev->dma_nr_buffers : 0;
+    return div_u64((u64)(dma_dev->ring_head - cur->tail) * 100, dma_dev->ring_size);
+}
+
+/* Raise or clear the overload event from the UDP backlog, with hysteresis
+ * between the two marks. Returns true if it changed, for the caller to wake
+ * poll() once ring_lock is dropped. Caller holds ring_lock.
+ */
+static bool antsdr_overload_update_locked(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned int fill = antsdr_udp_backlog_pct_locked(dma_dev);
+    
+    if (!dma_dev->overloaded && fill >= READ_ONCE(dma_dev->pacing.overload_high_pct)) {
+        dma_dev->overloaded = true;
+        antsdr_stat_inc(dma_dev, overload_events);
+        dev_warn_ratelimited(dma_dev->dev, "Send path overloaded, UDP backlog at %u%%\n", fill);
+        return true;
+    }
+    if (dma_dev->overloaded && fill < READ_ONCE(dma_dev->pacing.overload_low_pct)) {
+        dma_dev->overloaded = false;
+        return true;
+    }
+    return false;
+}
+
+/* Ring full - move every consumer still on the oldest record past it and
+ * reclaim it. Fails if a consumer has that record handed out by ring_get(),
+ * with spare_udp if the UDP sender is one of them, or if ring_tail did not
+ * move, so callers can loop on it. Caller holds ring_lock.
+ */
+static bool antsdr_ring_overrun_locked(struct antsdr_dma_dev *dma_dev, unsigned int *nr_release, bool spare_udp)
+{
+    struct antsdr_ring_record *rec = antsdr_ring_record_at(dma_dev, dma_dev->ring_tail);
+    unsigned int tail = dma_dev->ring_tail;
+    unsigned int next = tail + antsdr_ring_record_span(rec);
+    bool pad = rec->flags & ANTSDR_RING_REC_PAD;
+    struct antsdr_ring_cursor *cur;
+    int i;
+    
+    if (!dma_dev->ring_count)
+        return false;
+    
+    for (i = 0; i < ANTSDR_RING_CONSUMERS; i++) {
+        cur = &dma_dev->cursors[i];
+        if (cur->active && cur->tail == dma_dev->ring_tail &&
+            ((cur->held && !pad) || (spare_udp && i == ANTSDR_CONSUMER_UDP)))
+            return false;
+    }
+    
+    for (i = 0; i < ANTSDR_RING_CONSUMERS; i++) {
+        cur = &dma_dev->cursors[i];
+        if (!cur->active || cur->tail != dma_dev->ring_tail)
+            continue;
+        cur->tail = next;
+        if (!pad) {
+            if (cur->count)
+                cur->count--;
+            atomic64_inc(&cur->overruns);
+        }
+    }
+    
+    *nr_release += antsdr_ring_reclaim_locked(dma_dev);
+    return dma_dev->ring_tail != tail;
+}
+
+/* Zero-copy: too few DMA buffers left to keep dma_queue_depth armed.
+ * Caller holds ring_lock.
+ */
+static bool antsdr_ring_dma_short_locked(struct antsdr_dma_dev *dma_dev)
+{
+    bool short_buffers;
+    
+    spin_lock(&dma_dev->dma_queue_lock);
+    short_buffers = dma_dev->dma_free_count + dma_dev->dma_inflight < dma_dev->dma_queue_depth;
+    spin_unlock(&dma_dev->dma_queue_lock);
+    return short_buffers;
+}
+
+/* Queue a payload for every consumer. With dma_index >= 0 the record only
+ * references data inside that DMA buffer and takes over holding it;
+ * otherwise data is copied.
+ */
+static int antsdr_ring_put(struct antsdr_dma_dev *dma_dev, const void *data, size_t size, uint32_t frame_counter, uint64_t timestamp_ns, int dma_index)
+{
+    unsigned long flags;
+    struct antsdr_ring_record *rec;
+    unsigned int rec_len, pos, contig, needed;
+    unsigned int nr_release = 0, count, used;
+    uint16_t lo_tag;
+    int i;
+    
+    if (size > dma_dev->ring_buffer_size) {
+        dev_warn(dma_dev->dev, "Data size %zu exceeds ring buffer size %zu\n", 
+                 size, dma_dev->ring_buffer_size);
+        antsdr_drop(dma_dev, ANTSDR_DROP_INVALID, size);
+        return -EINVAL;
+    }
+    
+    rec_len = antsdr_ring_record_len(dma_index >= 0 ? sizeof(struct antsdr_ring_dma_ref) : size);
+    
+    /* Tag the record with the LO it was captured on, for local readers */
+    lo_tag = antsdr_lo_tag(dma_dev, timestamp_ns);
+    
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    
+    /* A record that does not fit before the end of the arena starts at offset 0 */
+    pos = dma_dev->ring_head & (dma_dev->ring_size - 1);
+    contig = dma_dev->ring_size - pos;
+    needed = rec_len + (contig < rec_len ? contig : 0);
+    
+    /* Make room by overrunning the slowest consumers */
+    while (dma_dev->ring_size - (dma_dev->ring_head - dma_dev->ring_tail) < needed) {
+        if (!antsdr_ring_overrun_locked(dma_dev, &nr_release, false)) {
+            dma_dev->ring_ctrl->dropped++;
+            count = dma_dev->ring_count;
+            spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+            antsdr_ring_rearm(dma_dev, nr_release);
+            dev_warn_ratelimited(dma_dev->dev, "Ring buffer full, dropping data\n");
+            antsdr_drop(dma_dev, ANTSDR_DROP_RING_FULL, size);
+            trace_antsdr_ring_put(frame_counter, size, count, -ENOSPC);
+            return -ENOSPC;
+        }
     }
     
-    dev_info(dma_dev->dev, "Frame detection buffer initialized: %zu bytes\n", 
-             dma_dev->frame_buffer_size);
+    /* A record that is only 32 bytes of arena can still pin the last free
+     * DMA buffer - a read() or mmap() reader must not stall the stream, so
+     * overrun it while the UDP sender is not the one holding the buffers
+     */
+    while (dma_index >= 0 && antsdr_ring_dma_short_locked(dma_dev) &&
+           antsdr_ring_overrun_locked(dma_dev, &nr_release, true))
+        ;
+    
+    if (contig < rec_len) {
+        rec = (struct antsdr_ring_record *)(dma_dev->ring_data + pos);
+        rec->size = contig - sizeof(*rec);
+        rec->flags = ANTSDR_RING_REC_PAD;
+        dma_dev->ring_head += contig;
+        pos = 0;
+    }
+    
+    /* Write record at head position - reference the DMA buffer or copy the data */
+    rec = (struct antsdr_ring_record *)(dma_dev->ring_data + pos);
+    rec->size = size;
+    rec->frame_counter = frame_counter;
+    rec->lo_tag = lo_tag;
+    rec->timestamp_ns = timestamp_ns;
+    if (dma_index >= 0) {
+        struct antsdr_ring_dma_ref *ref = (struct antsdr_ring_dma_ref *)(rec + 1);
+        
+        rec->flags = ANTSDR_RING_REC_DMA_REF;
+        ref->dma_index = dma_index;
+        ref->offset = (const uint8_t *)data - (uint8_t *)antsdr_get_dma_buffer(dma_dev, dma_index);
+    } else {
+        rec->flags = 0;
+        memcpy(rec + 1, data, size);
+    }
+    
+    /* Advance head pointer and publish it to mmap() readers */
+    dma_dev->ring_head += rec_len;
+    dma_dev->ring_count++;
+    for (i = 0; i < ANTSDR_RING_CONSUMERS; i++) {
+        if (dma_dev->cursors[i].active)
+            dma_dev->cursors[i].count++;
+    }
+    smp_store_release(&dma_dev->ring_ctrl->head, dma_dev->ring_head);
+    count = dma_dev->ring_count;
+    used = dma_dev->ring_head - dma_dev->ring_tail;
+    antsdr_overload_update_locked(dma_dev);
+    
+    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+    
+    antsdr_ring_rearm(dma_dev, nr_release);
+    
+    /* Only the frame worker puts records */
+    antsdr_stat_max(dma_dev, ring_high_water, count);
+    antsdr_stat_max(dma_dev, ring_bytes_high_water, used);
+    antsdr_lat_since(dma_dev, ANTSDR_LAT_RING, timestamp_ns);
+    trace_antsdr_ring_put(frame_counter, size, count, 0);
+    
+    /* Wake up read(), poll() and mmap() readers - and overload waiters */
+    wake_up_interruptible(&dma_dev->wait_queue);
+    
+    dev_dbg(dma_dev->dev, "Ring put: %zu bytes, count=%u\n", size, count);
     return 0;
 }
 
-static void antsdr_frame_buffer_cleanup(struct antsdr_dma_dev *dma_dev)
+/* Hand out the next record of a consumer. It stays valid - and is never
+ * overrun - until the consumer returns it with antsdr_ring_return_buffer().
+ */
+static int antsdr_ring_get(struct antsdr_dma_dev *dma_dev, enum antsdr_ring_consumer consumer, void **data, size_t *size, uint32_t *frame_counter, uint64_t *timestamp_ns)
 {
-    kfree(dma_dev->frame_detection_buffer);
-    dma_dev->frame_detection_buffer = NULL;
-    dev_info(dma_dev->dev, "Frame detection buffer cleaned up\n");
+    struct antsdr_ring_cursor *cur = &dma_dev->cursors[consumer];
+    unsigned long flags;
+    struct antsdr_ring_record *rec;
+    
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    
+    /* Check if ring buffer is empty for this consumer */
+    if (cur->count == 0) {
+        spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+        return -ENODATA;
+    }
+    
+    /* Get payload of the record at the cursor */
+    rec = antsdr_ring_cursor_record(dma_dev, cur);
+    if (rec->flags & ANTSDR_RING_REC_DMA_REF) {
+        struct antsdr_ring_dma_ref *ref = (struct antsdr_ring_dma_ref *)(rec + 1);
+        
+        *data = (uint8_t *)antsdr_get_dma_buffer(dma_dev, ref->dma_index) + ref->offset;
+    } else {
+        *data = rec + 1;
+    }
+    *size = rec->size;
+    if (frame_counter)
+        *frame_counter = rec->frame_counter;
+    if (timestamp_ns)
+        *timestamp_ns = rec->timestamp_ns;
+    
+    /* Don't advance the cursor yet - will be done in return_buffer */
+    cur->held = true;
+    
+    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+    
+    dev_dbg(dma_dev->dev, "Ring get: consumer %d record at %u, count=%u\n", 
+            consumer, cur->tail, cur->count);
+    return 0;
 }
 
-static int antsdr_frame_buffer_add(struct antsdr_dma_dev *dma_dev, const void *data, size_t size)
+static void antsdr_ring_return_buffer(struct antsdr_dma_dev *dma_dev, enum antsdr_ring_consumer consumer)
 {
+    struct antsdr_ring_cursor *cur = &dma_dev->cursors[consumer];
     unsigned long flags;
-    int ret = 0;
+    unsigned int nr_release = 0;
+    bool changed = false;
     
-    spin_lock_irqsave(&dma_dev->frame_buffer_lock, flags);
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
     
-    /* Check if we have space */
-    if (dma_dev->frame_buffer_used + size > dma_dev->frame_buffer_size) {
-        dev_warn(dma_dev->dev, "Frame buffer overflow, resetting\n");
-        dma_dev->frame_buffer_used = 0;
-        dma_dev->frames_accumulated = 0;
-        ret = -ENOSPC;
-        goto unlock;
+    if (cur->held) {
+        cur->tail += antsdr_ring_record_span(antsdr_ring_record_at(dma_dev, cur->tail));
+        cur->count--;
+        cur->held = false;
+        
+        /* Free the record once the last consumer is past it */
+        nr_release = antsdr_ring_reclaim_locked(dma_dev);
+        changed = antsdr_overload_update_locked(dma_dev);
+        
+        dev_dbg(dma_dev->dev, "Ring buffer returned by consumer %d, count=%u\n", consumer, cur->count);
     }
     
-    /* Copy data to buffer */
-    memcpy((uint8_t *)dma_dev->frame_detection_buffer + dma_dev->frame_buffer_used, 
-           data, size);
-    dma_dev->frame_buffer_used += size;
-    dma_dev->frames_accumulated++;
+    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+    
+    if (changed)
+        wake_up_interruptible(&dma_dev->wait_queue);
     
-    antsdr_debug_log(dma_dev->dev, "Added %zu bytes to frame buffer (total: %zu bytes, %u frames)\n",
-             size, dma_dev->frame_buffer_used, dma_dev->frames_accumulated);
+    /* Zero-copy: the payload has been consumed, the DMA buffer can be re-armed */
+    antsdr_ring_rearm(dma_dev, nr_release);
+}
 
-unlock:
-    spin_unlock_irqrestore(&dma_dev->frame_buffer_lock, flags);
-    return ret;
+/* Start a consumer at the current head */
+static void antsdr_ring_attach(struct antsdr_dma_dev *dma_dev, enum antsdr_ring_consumer consumer)
+{
+    struct antsdr_ring_cursor *cur = &dma_dev->cursors[consumer];
+    unsigned long flags;
+    
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    cur->tail = dma_dev->ring_head;
+    cur->count = 0;
+    cur->held = false;
+    cur->active = true;
+    if (consumer == ANTSDR_CONSUMER_MMAP)
+        WRITE_ONCE(dma_dev->ring_ctrl->user_tail, dma_dev->ring_head);
+    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
 }
 
-static void antsdr_frame_buffer_reset(struct antsdr_dma_dev *dma_dev)
+/* Stop a consumer - records only it still needed are freed */
+static void antsdr_ring_detach(struct antsdr_dma_dev *dma_dev, enum antsdr_ring_consumer consumer)
 {
     unsigned long flags;
+    unsigned int nr_release;
     
-    spin_lock_irqsave(&dma_dev->frame_buffer_lock, flags);
-    dma_dev->frame_buffer_used = 0;
-    dma_dev->frames_accumulated = 0;
-    spin_unlock_irqrestore(&dma_dev->frame_buffer_lock, flags);
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    dma_dev->cursors[consumer].active = false;
+    dma_dev->cursors[consumer].held = false;
+    nr_release = antsdr_ring_reclaim_locked(dma_dev);
+    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
     
-    dev_info(dma_dev->dev, "Frame detection buffer reset\n");
+    antsdr_ring_rearm(dma_dev, nr_release);
 }
 
-static int antsdr_frame_buffer_process(struct antsdr_dma_dev *dma_dev)
+/* Drop all queued payloads for every consumer, releasing any DMA buffers they
+ * still hold. A record a consumer has handed out stays until it is returned.
+ */
+static void antsdr_ring_flush(struct antsdr_dma_dev *dma_dev)
 {
     unsigned long flags;
-    const uint32_t *words;
-    size_t word_count;
-    int i, j;
-    int frames_found = 0;
-    size_t expected_frame_size;
+    unsigned int nr_release;
+    bool changed;
+    int i;
+    
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    for (i = 0; i < ANTSDR_RING_CONSUMERS; i++) {
+        struct antsdr_ring_cursor *cur = &dma_dev->cursors[i];
+        
+        if (!cur->active || cur->held)
+            continue;
+        cur->tail = dma_dev->ring_head;
+        cur->count = 0;
+    }
+    nr_release = antsdr_ring_reclaim_locked(dma_dev);
+    changed = antsdr_overload_update_locked(dma_dev);
+    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+    
+    if (changed)
+        wake_up_interruptible(&dma_dev->wait_queue);
+    antsdr_ring_rearm(dma_dev, nr_release);
+}
+
+/* Resynchronisation functions */
+static int antsdr_resync_init(struct antsdr_dma_dev *dma_dev)
+{
+    spin_lock_init(&dma_dev->resync_lock);
     
-    spin_lock_irqsave(&dma_dev->frame_buffer_lock, flags);
+    dma_dev->resync_carry = kmalloc(FPGA_LONG_PULSE_BYTES, GFP_KERNEL);
+    if (!dma_dev->resync_carry) {
+        dev_err(dma_dev->dev, "Failed to allocate resync carry buffer\n");
+        return -ENOMEM;
+    }
     
-    if (dma_dev->frame_buffer_used < 8) {
-        spin_unlock_irqrestore(&dma_dev->frame_buffer_lock, flags);
-        return 0; /* Not enough data */
+    antsdr_resync_reset(dma_dev);
+    return 0;
+}
+
+static void antsdr_resync_cleanup(struct antsdr_dma_dev *dma_dev)
+{
+    kfree(dma_dev->resync_carry);
+    dma_dev->resync_carry = NULL;
+}
+
+/* Drop any partial frame and assume the stream is aligned again */
+static void antsdr_resync_reset(struct antsdr_dma_dev *dma_dev)
+{
+    spin_lock(&dma_dev->resync_lock);
+    dma_dev->resync_words = 0;
+    dma_dev->resync_frame_words = 0;
+    dma_dev->sync_state = ANTSDR_SYNC_HUNT;
+    dma_dev->sync_locked = true;
+    dma_dev->sync_lost_ns = 0;
+    spin_unlock(&dma_dev->resync_lock);
+}
+
+/* Words had to be discarded - lock is lost until the next valid frame */
+static void antsdr_resync_discard(struct antsdr_dma_dev *dma_dev, unsigned int words)
+{
+    antsdr_stat_add(dma_dev, resync_dropped_words, words);
+    if (dma_dev->sync_locked) {
+        dma_dev->sync_locked = false;
+        dma_dev->sync_lost_ns = ktime_get_ns();
+        antsdr_stat_inc(dma_dev, resync_events);
+    }
+}
+
+/* A valid frame was collected - lock is back. Caller holds resync_lock. */
+static void antsdr_resync_regained_locked(struct antsdr_dma_dev *dma_dev)
+{
+    if (!dma_dev->sync_locked) {
+        u64 elapsed = ktime_get_ns() - dma_dev->sync_lost_ns;
+        
+        atomic64_set(&dma_dev->stats.resync_last_ns, elapsed);
+        if (elapsed > atomic64_read(&dma_dev->stats.resync_max_ns))
+            atomic64_set(&dma_dev->stats.resync_max_ns, elapsed);
+        dma_dev->sync_locked = true;
+        antsdr_debug_log(dma_dev->dev, "Frame lock regained after %llu ns\n", elapsed);
     }
+}
+
+/* A complete frame was collected in the carry buffer - queue its payload.
+ * Called with resync_lock dropped; only the parse thread writes the carry.
+ */
+static void antsdr_resync_emit(struct antsdr_dma_dev *dma_dev, unsigned int frame_words)
+{
+    const uint32_t *frame = dma_dev->resync_carry;
+    uint32_t frame_counter = frame[frame_words - 2];
+    int ret;
     
-    words = (const uint32_t *)dma_dev->frame_detection_buffer;
-    word_count = dma_dev->frame_buffer_used / 4;
-    expected_frame_size = (dma_dev->pulse_mode == 0) ? FPGA_SHORT_PULSE_WORDS : FPGA_LONG_PULSE_WORDS;
+    antsdr_track_frame_counter(dma_dev, frame_counter);
+    antsdr_stat_inc(dma_dev, resync_frames);
+    
+    /* Exclude header, frame_counter, footer */
+    if (dma_dev->integ_mode != ANTSDR_INTEG_OFF)
+        ret = antsdr_integ_add(dma_dev, (const uint8_t *)&frame[1], (frame_words - 3) * 4,
+                               frame_counter, dma_dev->parse_timestamp_ns);
+    else
+        ret = antsdr_ring_put(dma_dev, &frame[1], (frame_words - 3) * 4, frame_counter,
+                              dma_dev->parse_timestamp_ns, -1);
+    if (ret >= 0) {
+        antsdr_stat_inc(dma_dev, valid_frames);
+        antsdr_stat_inc(dma_dev, extracted_frames);
+        
+        /* Schedule UDP work if not already pending */
+        if (ret == 0 && !dma_dev->udp_work_pending) {
+            dma_dev->udp_work_pending = true;
+            kthread_queue_work(dma_dev->udp_worker, &dma_dev->udp_work);
+        }
+    } else {
+        antsdr_stat_inc(dma_dev, errors);
+    }
+}
 
-    antsdr_debug_log(dma_dev->dev, "Processing frame buffer: %zu bytes (%zu words), looking for %s frames\n",
-             dma_dev->frame_buffer_used, word_count,
-             dma_dev->pulse_mode == 0 ? "short" : "long");
+/* Incremental resync state machine. Hunts for a header, collects exactly one
+ * frame's worth of words - carrying them across transfers as needed - and
+ * accepts the frame if its last word is the footer. On a false header it
+ * re-hunts inside the collected words, so lock comes back within one frame.
+ * Frames are queued with resync_lock dropped, so the copy and integration
+ * don't run under it. Returns the number of frames queued.
+ */
+static int antsdr_resync_feed(struct antsdr_dma_dev *dma_dev, const uint32_t *words, size_t word_count, unsigned int frame_words)
+{
+    uint32_t *carry = dma_dev->resync_carry;
+    size_t i = 0;
+    unsigned int j, n;
+    int emitted = 0;
+    
+    spin_lock(&dma_dev->resync_lock);
+    
+    /* Pulse mode changed - a carried partial frame has the wrong length */
+    if (dma_dev->resync_frame_words != frame_words) {
+        if (dma_dev->resync_words)
+            antsdr_resync_discard(dma_dev, dma_dev->resync_words);
+        dma_dev->resync_words = 0;
+        dma_dev->sync_state = ANTSDR_SYNC_HUNT;
+        dma_dev->resync_frame_words = frame_words;
+    }
     
-    /* Search for valid frame patterns */
-    for (i = 0; i < word_count - 1; i++) {
-        /* Check for header */
-        if (words[i] == FPGA_HEADER_MARKER_1 || words[i] == FPGA_HEADER_MARKER_2) {
-            antsdr_debug_log(dma_dev->dev, "Found header 0x%08x at word offset %d\n", words[i], i);
+    while (i < word_count) {
+        if (dma_dev->sync_state == ANTSDR_SYNC_HUNT) {
+            size_t start = i;
             
-            /* Check if we have enough data for a complete frame */
-            if (i + expected_frame_size <= word_count) {
-                /* Check for footer at expected position */
-                int footer_pos = i + expected_frame_size - 1;
-                if (words[footer_pos] == FPGA_FOOTER_MARKER) {
-                    /* Found complete frame! */
-                    uint8_t *payload = (uint8_t *)&words[i + 1]; /* Skip header */
-                    size_t payload_len = (expected_frame_size - 2) * 4; /* Skip header and footer */
-
-                    antsdr_debug_log(dma_dev->dev, "Found complete frame at offset %d: header=0x%08x, footer=0x%08x, payload=%zu bytes\n",
-                             i, words[i], words[footer_pos], payload_len);
-                    
-                    /* Queue the extracted payload */
-                    int ret = antsdr_ring_put(dma_dev, payload, payload_len);
-                    if (ret == 0) {
-                        frames_found++;
-                        spin_lock_irqsave(&dma_dev->lock, flags);
-                        dma_dev->stats.valid_frames++;
-                        dma_dev->stats.extracted_frames++;
-                        spin_unlock_irqrestore(&dma_dev->lock, flags);
-                        
-                        /* Schedule UDP work if not already pending */
-                        if (!dma_dev->udp_work_pending) {
-                            dma_dev->udp_work_pending = true;
-                            schedule_work(&dma_dev->udp_work);
-                        }
-                    }
-                    
-                    /* Skip past this frame */
-                    i += expected_frame_size - 1;
-                } else {
-                    /* Header found but footer not at expected position, search for footer */
-                    int search_limit = min((size_t)(i + expected_frame_size + 10), word_count);
-                    for (j = i + 1; j < search_limit; j++) {
-                        if (words[j] == FPGA_FOOTER_MARKER) {
-                            antsdr_debug_log(dma_dev->dev, "Found misaligned frame: header at %d, footer at %d, size=%d words (expected %zu)\n",
-                                     i, j, (j - i + 1), expected_frame_size);
-                            break;
-                        }
-                    }
-                }
-            } else {
-                antsdr_debug_log(dma_dev->dev, "Header found at %d but not enough data for complete frame (need %zu words, have %zu)\n",
-                         i, expected_frame_size, word_count - i);
-            }
+            while (i < word_count && words[i] != FPGA_HEADER_MARKER_1 && words[i] != FPGA_HEADER_MARKER_2)
+                i++;
+            if (i > start)
+                antsdr_resync_discard(dma_dev, i - start);
+            if (i == word_count)
+                break;
+            
+            dma_dev->sync_state = ANTSDR_SYNC_COLLECT;
+            dma_dev->resync_words = 0;
+        }
+        
+        /* Collect up to one frame; the rest arrives with the next transfer */
+        n = min_t(size_t, frame_words - dma_dev->resync_words, word_count - i);
+        memcpy(&carry[dma_dev->resync_words], &words[i], n * 4);
+        dma_dev->resync_words += n;
+        i += n;
+        if (dma_dev->resync_words < frame_words)
+            break;
+        
+        if (carry[frame_words - 1] == FPGA_FOOTER_MARKER) {
+            antsdr_resync_regained_locked(dma_dev);
+            dma_dev->resync_words = 0;
+            dma_dev->sync_state = ANTSDR_SYNC_HUNT;
+            spin_unlock(&dma_dev->resync_lock);
+            
+            antsdr_resync_emit(dma_dev, frame_words);
+            emitted++;
+            
+            /* A reset in the meantime started a new session - the rest of
+             * this transfer belongs to the old one
+             */
+            spin_lock(&dma_dev->resync_lock);
+            if (dma_dev->resync_frame_words != frame_words)
+                break;
+            continue;
+        }
+        
+        /* False header - re-hunt inside what was collected */
+        for (j = 1; j < frame_words; j++) {
+            if (carry[j] == FPGA_HEADER_MARKER_1 || carry[j] == FPGA_HEADER_MARKER_2)
+                break;
+        }
+        antsdr_resync_discard(dma_dev, j);
+        if (j < frame_words) {
+            memmove(carry, &carry[j], (frame_words - j) * 4);
+            dma_dev->resync_words = frame_words - j;
+        } else {
+            dma_dev->resync_words = 0;
+            dma_dev->sync_state = ANTSDR_SYNC_HUNT;
         }
     }
     
-    /* Reset buffer after processing */
-    dma_dev->frame_buffer_used = 0;
-    dma_dev->frames_accumulated = 0;
-    
-    spin_unlock_irqrestore(&dma_dev->frame_buffer_lock, flags);
-    
-    antsdr_debug_log(dma_dev->dev, "Frame buffer processing complete: found %d valid frames\n", frames_found);
-    return frames_found;
+    spin_unlock(&dma_dev->resync_lock);
+    return emitted;
 }
 
 /* Debug and frame export functions */
@@ -922,370 +2326,2406 @@ static int antsdr_export_frame_to_file(struct antsdr_dma_dev *dma_dev, const uin
 #endif
 }
 
-/* DMA completion callback - optimized for minimal processing */
-static void antsdr_dma_callback(void *data)
+/* Apply one schedule entry. Caller holds sched_lock - runs from the
+ * completion path or the timer, so only the pulse switch, which sleeps,
+ * is deferred to process context.
+ */
+static void antsdr_sched_apply_locked(struct antsdr_dma_dev *dma_dev, const struct antsdr_sched_entry *entry,
+                                      u64 late)
 {
-    struct antsdr_dma_dev *dma_dev = (struct antsdr_dma_dev *)data;
-    unsigned long flags;
-    int ret;
-    size_t transfer_size = antsdr_get_transfer_size(dma_dev);
-    enum dma_status status;
-    struct antsdr_raw_frame raw_frame;
-    
-    antsdr_debug_log(dma_dev->dev, "DMA callback triggered for buffer %d\n", dma_dev->current_buffer);
+    if (entry->tdd_mode != ANTSDR_SCHED_KEEP && dma_dev->gpio_tdd_mode)
+        gpiod_set_value(dma_dev->gpio_tdd_mode, entry->tdd_mode);
     
-    /* Check DMA transfer status */
-    status = dmaengine_tx_status(dma_dev->rx_chan, 0, NULL);
-    if (status == DMA_ERROR) {
-        dev_err(dma_dev->dev, "DMA transfer completed with error status\n");
-        spin_lock_irqsave(&dma_dev->lock, flags);
-        dma_dev->stats.errors++;
-        spin_unlock_irqrestore(&dma_dev->lock, flags);
-        
-        /* Try to reset and restart */
-        antsdr_dma_reset_and_restart(dma_dev);
-        return;
+    if (entry->pulse_mode != ANTSDR_SCHED_KEEP) {
+        /* A switch not started yet just picks up the newest mode */
+        WRITE_ONCE(dma_dev->sched_pulse_mode, entry->pulse_mode);
+        queue_work(system_highpri_wq, &dma_dev->sched_work);
     }
     
-    antsdr_debug_log(dma_dev->dev, "DMA status check passed, status = %d\n", status);
+    if (entry->lo_profile != ANTSDR_SCHED_KEEP)
+        dma_dev->sched_lo_profile = entry->lo_profile;
     
-    spin_lock_irqsave(&dma_dev->lock, flags);
-    
-    /* Update statistics */
-    dma_dev->stats.transfers_completed++;
-    dma_dev->stats.bytes_transferred += transfer_size;
+    dma_dev->sched_applied++;
+    if (late) {
+        dma_dev->sched_late++;
+        dma_dev->sched_max_late = max(dma_dev->sched_max_late, late);
+    }
+}
+
+/* Apply every entry due at position. Returns false once a one-shot
+ * schedule has run out. Caller holds sched_lock.
+ */
+static bool antsdr_sched_run_locked(struct antsdr_dma_dev *dma_dev, u64 position)
+{
+    const struct antsdr_schedule *sched = dma_dev->sched;
+    
+    while (dma_dev->sched_next < sched->count && sched->entries[dma_dev->sched_next].at <= position) {
+        const struct antsdr_sched_entry *entry = &sched->entries[dma_dev->sched_next++];
+        
+        antsdr_sched_apply_locked(dma_dev, entry, position - entry->at);
+    }
+    
+    return dma_dev->sched_next < sched->count || (sched->flags & ANTSDR_SCHED_REPEAT);
+}
+
+/* Frame schedule tick - one per transfer captured, whether or not it is queued */
+static void antsdr_sched_frame(struct antsdr_dma_dev *dma_dev)
+{
+    const struct antsdr_schedule *sched;
+    unsigned long flags;
+    
+    if (!READ_ONCE(dma_dev->sched_by_frame))
+        return;
+    
+    spin_lock_irqsave(&dma_dev->sched_lock, flags);
+    sched = dma_dev->sched;
+    if (dma_dev->sched_by_frame) {
+        if (!antsdr_sched_run_locked(dma_dev, dma_dev->sched_position)) {
+            dma_dev->sched_armed = false;
+            WRITE_ONCE(dma_dev->sched_by_frame, false);
+        } else if (++dma_dev->sched_position >= sched->period && (sched->flags & ANTSDR_SCHED_REPEAT)) {
+            dma_dev->sched_position = 0;
+            dma_dev->sched_next = 0;
+            dma_dev->sched_passes++;
+        }
+    }
+    spin_unlock_irqrestore(&dma_dev->sched_lock, flags);
+}
+
+/* Time schedule - fires at each entry, re-armed for the next one */
+static enum hrtimer_restart antsdr_sched_timer(struct hrtimer *timer)
+{
+    struct antsdr_dma_dev *dma_dev = container_of(timer, struct antsdr_dma_dev, sched_timer);
+    const struct antsdr_schedule *sched;
+    unsigned long flags;
+    bool more = false;
+    
+    spin_lock_irqsave(&dma_dev->sched_lock, flags);
+    sched = dma_dev->sched;
+    if (sched && dma_dev->sched_armed) {
+        more = antsdr_sched_run_locked(dma_dev, ktime_get_ns() - dma_dev->sched_base_ns);
+        if (more && dma_dev->sched_next == sched->count) {
+            /* REPEAT: on to the next pass. If the timer fell behind, the
+             * catch-up entries fire at once and count as late.
+             */
+            dma_dev->sched_base_ns += sched->period;
+            dma_dev->sched_next = 0;
+            dma_dev->sched_passes++;
+        }
+        if (more)
+            hrtimer_set_expires(timer, ns_to_ktime(dma_dev->sched_base_ns +
+                                                   sched->entries[dma_dev->sched_next].at));
+        else
+            dma_dev->sched_armed = false;
+    }
+    spin_unlock_irqrestore(&dma_dev->sched_lock, flags);
+    
+    return more ? HRTIMER_RESTART : HRTIMER_NORESTART;
+}
+
+/* Scheduled pulse mode change - same path as ANTSDR_IOC_SET_PULSE_MODE */
+static void antsdr_sched_work(struct work_struct *work)
+{
+    struct antsdr_dma_dev *dma_dev = container_of(work, struct antsdr_dma_dev, sched_work);
+    uint32_t pulse_mode = READ_ONCE(dma_dev->sched_pulse_mode);
+    unsigned long flags;
+    int ret;
+    
+    ret = antsdr_set_pulse_mode(dma_dev, pulse_mode);
+    if (ret) {
+        spin_lock_irqsave(&dma_dev->sched_lock, flags);
+        dma_dev->sched_errors++;
+        spin_unlock_irqrestore(&dma_dev->sched_lock, flags);
+        dev_warn_ratelimited(dma_dev->dev, "Scheduled pulse mode %u failed: %d\n", pulse_mode, ret);
+    }
+}
+
+/* Disarm and free the schedule. Process context. */
+static void antsdr_sched_cancel(struct antsdr_dma_dev *dma_dev)
+{
+    struct antsdr_schedule *old;
+    unsigned long flags;
+    
+    spin_lock_irqsave(&dma_dev->sched_lock, flags);
+    dma_dev->sched_armed = false;
+    dma_dev->sched_time_pending = false;
+    WRITE_ONCE(dma_dev->sched_by_frame, false);
+    spin_unlock_irqrestore(&dma_dev->sched_lock, flags);
+    
+    hrtimer_cancel(&dma_dev->sched_timer);
+    cancel_work_sync(&dma_dev->sched_work);
+    
+    spin_lock_irqsave(&dma_dev->sched_lock, flags);
+    old = dma_dev->sched;
+    dma_dev->sched = NULL;
+    spin_unlock_irqrestore(&dma_dev->sched_lock, flags);
+    
+    kfree(old);
+}
+
+/* Start a time schedule's first pass now. Caller holds sched_lock. */
+static void antsdr_sched_start_timer_locked(struct antsdr_dma_dev *dma_dev)
+{
+    dma_dev->sched_time_pending = false;
+    dma_dev->sched_base_ns = ktime_get_ns();
+    hrtimer_start(&dma_dev->sched_timer, ns_to_ktime(dma_dev->sched_base_ns + dma_dev->sched->entries[0].at),
+                  HRTIMER_MODE_ABS_SOFT);
+}
+
+/* Streaming has started - start a time schedule armed while it was stopped */
+static void antsdr_sched_stream_started(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned long flags;
+    
+    spin_lock_irqsave(&dma_dev->sched_lock, flags);
+    if (dma_dev->sched && dma_dev->sched_armed && dma_dev->sched_time_pending)
+        antsdr_sched_start_timer_locked(dma_dev);
+    spin_unlock_irqrestore(&dma_dev->sched_lock, flags);
+}
+
+/* ANTSDR_IOC_SET_SCHEDULE - replaces any armed schedule. Takes ownership of
+ * sched, freed here if it is refused or empty.
+ */
+static int antsdr_set_schedule(struct antsdr_dma_dev *dma_dev, struct antsdr_schedule *sched)
+{
+    unsigned long flags;
+    unsigned int i;
+    
+    if (sched->count > ANTSDR_SCHED_MAX_ENTRIES ||
+        (sched->flags & ~(ANTSDR_SCHED_BY_TIME | ANTSDR_SCHED_REPEAT)) ||
+        ((sched->flags & ANTSDR_SCHED_REPEAT) && !sched->period)) {
+        kfree(sched);
+        return -EINVAL;
+    }
+    
+    for (i = 0; i < sched->count; i++) {
+        const struct antsdr_sched_entry *entry = &sched->entries[i];
+        
+        if ((i && entry->at < sched->entries[i - 1].at) ||
+            (entry->pulse_mode > 1 && entry->pulse_mode != ANTSDR_SCHED_KEEP) ||
+            (entry->tdd_mode > 1 && entry->tdd_mode != ANTSDR_SCHED_KEEP) ||
+            (entry->lo_profile >= ANTSDR_LO_PROFILES && entry->lo_profile != ANTSDR_SCHED_KEEP) ||
+            ((sched->flags & ANTSDR_SCHED_REPEAT) && entry->at >= sched->period)) {
+            dev_err(dma_dev->dev, "Mode schedule: invalid entry %u\n", i);
+            kfree(sched);
+            return -EINVAL;
+        }
+    }
+    
+    antsdr_sched_cancel(dma_dev);
+    if (!sched->count) {
+        kfree(sched);
+        dev_info(dma_dev->dev, "Mode schedule disarmed\n");
+        return 0;
+    }
+    
+    spin_lock_irqsave(&dma_dev->sched_lock, flags);
+    dma_dev->sched = sched;
+    dma_dev->sched_next = 0;
+    dma_dev->sched_position = 0;
+    dma_dev->sched_passes = 0;
+    dma_dev->sched_applied = 0;
+    dma_dev->sched_late = 0;
+    dma_dev->sched_max_late = 0;
+    dma_dev->sched_errors = 0;
+    dma_dev->sched_lo_profile = ANTSDR_SCHED_KEEP;
+    dma_dev->sched_armed = true;
+    dma_dev->sched_time_pending = false;
+    if (!(sched->flags & ANTSDR_SCHED_BY_TIME))
+        WRITE_ONCE(dma_dev->sched_by_frame, true);
+    else if (READ_ONCE(dma_dev->streaming))
+        antsdr_sched_start_timer_locked(dma_dev);
+    else
+        dma_dev->sched_time_pending = true;   /* antsdr_sched_stream_started() */
+    spin_unlock_irqrestore(&dma_dev->sched_lock, flags);
+    
+    dev_info(dma_dev->dev, "Mode schedule armed: %u entries by %s%s\n", sched->count,
+             (sched->flags & ANTSDR_SCHED_BY_TIME) ? "time" : "frame",
+             (sched->flags & ANTSDR_SCHED_REPEAT) ? ", repeating" : "");
+    return 0;
+}
+
+static void antsdr_sched_get(struct antsdr_dma_dev *dma_dev, struct antsdr_sched_status *status)
+{
+    const struct antsdr_schedule *sched;
+    unsigned long flags;
+    
+    memset(status, 0, sizeof(*status));
+    
+    spin_lock_irqsave(&dma_dev->sched_lock, flags);
+    sched = dma_dev->sched;
+    if (sched) {
+        status->armed = dma_dev->sched_armed;
+        status->flags = sched->flags;
+        status->count = sched->count;
+        status->next = dma_dev->sched_next;
+        if (!(sched->flags & ANTSDR_SCHED_BY_TIME))
+            status->position = dma_dev->sched_position;
+        else if (dma_dev->sched_armed && !dma_dev->sched_time_pending)
+            status->position = ktime_get_ns() - dma_dev->sched_base_ns;
+    }
+    status->passes = dma_dev->sched_passes;
+    status->applied = dma_dev->sched_applied;
+    status->late = dma_dev->sched_late;
+    status->max_late = dma_dev->sched_max_late;
+    status->errors = dma_dev->sched_errors;
+    status->lo_profile = dma_dev->sched_lo_profile;
+    spin_unlock_irqrestore(&dma_dev->sched_lock, flags);
+    
+    status->pulse_mode = dma_dev->pulse_mode;
+    status->queue_depth = dma_dev->dma_queue_depth;
+}
+
+/* Timestamp for a completed transfer, on the ANTSDR_IOC_SET_HEADER clock */
+static u64 antsdr_capture_time(struct antsdr_dma_dev *dma_dev)
+{
+    switch (dma_dev->ts_clock) {
+    case ANTSDR_CLOCK_REALTIME:
+        return ktime_get_real_ns();
+    case ANTSDR_CLOCK_TAI:
+        return ktime_get_clocktai_ns();
+    default:
+        return ktime_get_ns();
+    }
+}
+
+/* Queue a raw frame for the parse thread. Returns the FIFO level, or
+ * -ENOSPC if the FIFO is full - a kmalloc copy is freed then, a DMA buffer
+ * is left to the caller.
+ */
+static int antsdr_raw_frame_queue(struct antsdr_dma_dev *dma_dev, struct antsdr_raw_frame *raw_frame)
+{
+    unsigned long flags;
+    unsigned int level;
+    int ret;
+    
+    spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
+    ret = kfifo_in(&dma_dev->raw_frame_fifo, raw_frame, sizeof(*raw_frame));
+    level = kfifo_len(&dma_dev->raw_frame_fifo) / sizeof(*raw_frame);
+    spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
+    
+    if (ret != sizeof(*raw_frame)) {
+        /* Failed to queue - free the allocated memory */
+        if (raw_frame->dma_index < 0)
+            kfree(raw_frame->data);
+        dev_warn_ratelimited(dma_dev->dev, "Raw frame FIFO full, dropping %zu bytes\n", raw_frame->data_len);
+        antsdr_stat_inc(dma_dev, errors);
+        antsdr_drop(dma_dev, ANTSDR_DROP_FIFO_FULL, raw_frame->data_len);
+        return -ENOSPC;
+    }
+    
+    /* A racing reaper can only make the mark read low, never corrupt it */
+    antsdr_stat_max(dma_dev, fifo_high_water, level);
+    
+    /* Successfully queued, schedule frame processing work */
+    if (!dma_dev->frame_work_pending) {
+        dma_dev->frame_work_pending = true;
+        kthread_queue_work(dma_dev->frame_worker, &dma_dev->frame_work);
+    }
+    antsdr_debug_log(dma_dev->dev, "DMA callback: Queued %zu bytes for frame processing\n", raw_frame->data_len);
+    return level;
+}
+
+/* Handle one completed transfer that was just taken off the armed queue:
+ * stats, then hand it to the parse thread.
+ *
+ * In copy mode the buffer goes straight back on the free list once its data
+ * has been copied out. In zero-copy mode the raw frame references the DMA
+ * buffer itself, and the buffer stays off the free list until the frame has
+ * been dropped or its payload sent (antsdr_dma_release_buffer).
+ */
+static void antsdr_dma_complete_buffer(struct antsdr_dma_dev *dma_dev, unsigned int index)
+{
+    unsigned long flags;
+    int ret;
+    size_t transfer_size = antsdr_get_transfer_size(dma_dev);
+    struct antsdr_raw_frame raw_frame;
+    bool held = false;
+    
+    raw_frame.timestamp_ns = antsdr_capture_time(dma_dev);
+    
+    /* Update statistics */
+    antsdr_stat_inc(dma_dev, transfers_completed);
+    antsdr_stat_add(dma_dev, bytes_transferred, transfer_size);
     
     /* Store S2MM transfer lengths for debugging */
     dma_dev->s2mm_requested_length = transfer_size;
     dma_dev->s2mm_actual_length = transfer_size;
     
-    spin_unlock_irqrestore(&dma_dev->lock, flags);
+    antsdr_debug_log(dma_dev->dev, "DMA transfer complete, buffer %u, %zu bytes (pulse_mode %d)\n", 
+            index, transfer_size, dma_dev->pulse_mode);
     
-    antsdr_debug_log(dma_dev->dev, "DMA transfer complete, buffer %d, %zu bytes (pulse_mode %d)\n", 
-            dma_dev->current_buffer, transfer_size, dma_dev->pulse_mode);
+    /* Count the capture for a frame schedule, with or without a destination */
+    antsdr_sched_frame(dma_dev);
     
     /* Quick check: Only queue for processing if UDP destination is set */
     if (dma_dev->dest_set && transfer_size <= MAX_S2MM_TRANSFER_SIZE) {
-        void *current_buffer = antsdr_get_current_buffer(dma_dev);
-        
-        /* Allocate memory for raw DMA data copy - prevents stack overflow */
-        raw_frame.data = kmalloc(transfer_size, GFP_ATOMIC);
-        if (!raw_frame.data) {
-            dev_warn_ratelimited(dma_dev->dev, "Failed to allocate memory for raw frame, dropping %zu bytes\n", transfer_size);
-            spin_lock_irqsave(&dma_dev->lock, flags);
-            dma_dev->stats.errors++;
-            spin_unlock_irqrestore(&dma_dev->lock, flags);
-            goto skip_frame_processing;
-        }
+        void *current_buffer = antsdr_get_dma_buffer(dma_dev, index);
         
-        /* Copy raw DMA data to allocated buffer for threaded processing */
         raw_frame.data_len = transfer_size;
-        memcpy(raw_frame.data, current_buffer, transfer_size);
+        if (dma_dev->zero_copy) {
+            /* Hand the DMA buffer itself to the frame worker */
+            raw_frame.data = current_buffer;
+            raw_frame.dma_index = index;
+        } else {
+            /* Allocate memory for raw DMA data copy - prevents stack overflow */
+            raw_frame.data = kmalloc(transfer_size, GFP_ATOMIC);
+            if (!raw_frame.data) {
+                dev_warn_ratelimited(dma_dev->dev, "Failed to allocate memory for raw frame, dropping %zu bytes\n", transfer_size);
+                antsdr_stat_inc(dma_dev, errors);
+                antsdr_drop(dma_dev, ANTSDR_DROP_ALLOC_FAIL, transfer_size);
+                goto skip_frame_processing;
+            }
+            
+            /* Copy raw DMA data to allocated buffer for threaded processing */
+            raw_frame.dma_index = -1;
+            memcpy(raw_frame.data, current_buffer, transfer_size);
+        }
         
         /* Queue raw frame to FIFO (non-blocking) */
-        spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
-        ret = kfifo_in(&dma_dev->raw_frame_fifo, &raw_frame, sizeof(raw_frame));
-        spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
+        ret = antsdr_raw_frame_queue(dma_dev, &raw_frame);
+        held = ret >= 0 && raw_frame.dma_index >= 0;
+        trace_antsdr_dma_complete(index, transfer_size, raw_frame.timestamp_ns,
+                                  ret >= 0 ? ret : dma_dev->raw_fifo_depth);
+    } else {
+        antsdr_debug_log(dma_dev->dev, "DMA callback: UDP destination not set or invalid size, dropping data\n");
+    }
+    
+skip_frame_processing:
+    /* Buffer no longer needed unless a zero-copy frame holds it */
+    if (!held) {
+        spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+        antsdr_dma_put_free_locked(dma_dev, index);
+        spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+    }
+}
+
+/* Build one synthetic FPGA frame - header, payload, frame counter, footer -
+ * and queue it as a copy-mode S2MM completion
+ */
+static void antsdr_bench_inject(struct antsdr_dma_dev *dma_dev, unsigned int frame_words)
+{
+    struct antsdr_raw_frame raw_frame;
+    uint32_t *words;
+    uint32_t counter = dma_dev->bench_counter++;
+    unsigned int i;
+    
+    raw_frame.timestamp_ns = antsdr_capture_time(dma_dev);
+    raw_frame.data_len = frame_words * 4;
+    raw_frame.dma_index = -1;
+    
+    antsdr_stat_inc(dma_dev, transfers_completed);
+    antsdr_stat_add(dma_dev, bytes_transferred, raw_frame.data_len);
+    antsdr_sched_frame(dma_dev);
+    
+    words = kmalloc(raw_frame.data_len, GFP_ATOMIC);
+    if (!words) {
+        antsdr_stat_inc(dma_dev, errors);
+        antsdr_drop(dma_dev, ANTSDR_DROP_ALLOC_FAIL, raw_frame.data_len);
+        return;
+    }
+    
+    /* Payload word: frame counter (low half) over sample index */
+    words[0] = FRAME_HEADER;
+    for (i = 1; i < frame_words - 2; i++)
+        words[i] = (counter << 16) | (i - 1);
+    words[frame_words - 2] = counter;
+    words[frame_words - 1] = FRAME_FOOTER;
+    raw_frame.data = (uint8_t *)words;
+    
+    antsdr_raw_frame_queue(dma_dev, &raw_frame);
+}
+
+/* Generator tick: inject every frame that became due since the last one.
+ * A tick never injects more than the raw FIFO holds - anything beyond that
+ * means the generator itself is behind and is counted as missed.
+ */
+static enum hrtimer_restart antsdr_bench_timer(struct hrtimer *timer)
+{
+    struct antsdr_dma_dev *dma_dev = container_of(timer, struct antsdr_dma_dev, bench_timer);
+    unsigned int frame_words = dma_dev->pulse_mode ? FPGA_LONG_PULSE_WORDS : FPGA_SHORT_PULSE_WORDS;
+    u64 now = ktime_get_ns(), due;
+    
+    if (dma_dev->bench_end_ns && now >= dma_dev->bench_end_ns)
+        now = dma_dev->bench_end_ns;
+    
+    due = mul_u64_u32_div(now - dma_dev->bench_start_ns, dma_dev->bench_rate, NSEC_PER_SEC) -
+          atomic64_read(&dma_dev->bench_generated) - atomic64_read(&dma_dev->bench_missed);
+    if (due > dma_dev->raw_fifo_depth) {
+        atomic64_add(due - dma_dev->raw_fifo_depth, &dma_dev->bench_missed);
+        due = dma_dev->raw_fifo_depth;
+    }
+    atomic64_add(due, &dma_dev->bench_generated);
+    while (due--)
+        antsdr_bench_inject(dma_dev, frame_words);
+    atomic64_add(ktime_get_ns() - now, &dma_dev->bench_cpu_ns);
+    
+    if (now == dma_dev->bench_end_ns) {
+        dma_dev->bench_stop_ns = now;
+        WRITE_ONCE(dma_dev->bench_running, false);
+        return HRTIMER_NORESTART;
+    }
+    hrtimer_forward_now(timer, ns_to_ktime(ANTSDR_BENCH_TICK_NS));
+    return HRTIMER_RESTART;
+}
+
+static u64 antsdr_worker_runtime(struct kthread_worker *worker)
+{
+    return worker ? READ_ONCE(worker->task->se.sum_exec_runtime) : 0;
+}
+
+/* Pipeline counters a benchmark reports as deltas from its start */
+static void antsdr_bench_sample(struct antsdr_dma_dev *dma_dev, struct antsdr_bench_result *res)
+{
+    int i;
+    
+    res->frames_valid = atomic64_read(&dma_dev->stats.valid_frames);
+    res->packets_sent = atomic64_read(&dma_dev->stats.udp_packets_sent);
+    for (i = 0; i < ANTSDR_DROP_REASONS; i++)
+        res->drops[i] = atomic64_read(&dma_dev->stats.drops[i]);
+    res->udp_overruns = atomic64_read(&dma_dev->cursors[ANTSDR_CONSUMER_UDP].overruns);
+    res->parse_cpu_ns = antsdr_worker_runtime(dma_dev->frame_worker);
+    res->send_cpu_ns = antsdr_worker_runtime(dma_dev->udp_worker);
+}
+
+/* Result of the running benchmark, or of the last one once it was stopped */
+static void antsdr_bench_get(struct antsdr_dma_dev *dma_dev, struct antsdr_bench_result *res)
+{
+    const struct antsdr_bench_result *base = &dma_dev->bench_base;
+    int i;
+    
+    if (!dma_dev->bench_active) {
+        *res = dma_dev->bench_final;
+        return;
+    }
+    
+    antsdr_bench_sample(dma_dev, res);
+    res->frames_valid -= base->frames_valid;
+    res->packets_sent -= base->packets_sent;
+    for (i = 0; i < ANTSDR_DROP_REASONS; i++)
+        res->drops[i] -= base->drops[i];
+    res->udp_overruns -= base->udp_overruns;
+    res->parse_cpu_ns -= base->parse_cpu_ns;
+    res->send_cpu_ns -= base->send_cpu_ns;
+    
+    res->running = READ_ONCE(dma_dev->bench_running);
+    res->rate = dma_dev->bench_rate;
+    res->elapsed_ns = (res->running ? ktime_get_ns() : dma_dev->bench_stop_ns) - dma_dev->bench_start_ns;
+    res->frames_generated = atomic64_read(&dma_dev->bench_generated);
+    res->frames_missed = atomic64_read(&dma_dev->bench_missed);
+    res->gen_cpu_ns = atomic64_read(&dma_dev->bench_cpu_ns);
+}
+
+/* Retire completed transfers, oldest first, up to 'budget' of them.
+ *
+ * Up to dma_queue_depth descriptors are armed at once and the S2MM channel
+ * completes them in submission order, so completed buffers are always at the
+ * consumer index (current_buffer). Both the completion callback and the
+ * poller retire through here, so whichever runs first takes a buffer and the
+ * other finds it gone. Returns the number retired, or -EIO after a DMA error
+ * (the channel has been reset).
+ */
+static int antsdr_dma_reap(struct antsdr_dma_dev *dma_dev, int budget)
+{
+    unsigned long flags;
+    enum dma_status status;
+    unsigned int index;
+    int done = 0;
+    
+    while (done < budget) {
+        spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+        if (dma_dev->dma_inflight == 0) {
+            spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+            break;
+        }
+        
+        index = dma_dev->dma_armed[dma_dev->current_buffer];
+        status = dmaengine_tx_status(dma_dev->rx_chan, dma_dev->dma_cookies[index], NULL);
+        if (status != DMA_COMPLETE && status != DMA_ERROR) {
+            spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+            break;
+        }
+        
+        /* Consume the oldest armed buffer */
+        dma_dev->current_buffer = (dma_dev->current_buffer + 1) % dma_dev->dma_nr_buffers;
+        dma_dev->dma_inflight--;
+        if (!dma_dev->dma_has_callback[index])
+            dma_dev->dma_poll_armed--;
+        if (dma_dev->dma_draining && !dma_dev->dma_inflight)
+            wake_up(&dma_dev->drain_wait);
+        spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+        
+        if (status == DMA_ERROR) {
+            dev_err(dma_dev->dev, "DMA transfer completed with error status\n");
+            antsdr_stat_inc(dma_dev, errors);
+            
+            spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+            antsdr_dma_put_free_locked(dma_dev, index);
+            spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+            
+            /* Try to reset and restart */
+            antsdr_dma_reset_and_restart(dma_dev);
+            return -EIO;
+        }
+        
+        antsdr_debug_log(dma_dev->dev, "DMA reap: buffer %u completed\n", index);
+        antsdr_dma_complete_buffer(dma_dev, index);
+        done++;
+    }
+    
+    return done;
+}
+
+/* Add the time since the last switch to the current mode. Caller holds poll_lock. */
+static void antsdr_poll_account_mode_locked(struct antsdr_dma_dev *dma_dev, u64 now)
+{
+    u64 elapsed = now - dma_dev->poll_mode_since_ns;
+    
+    if (dma_dev->poll_active)
+        atomic64_add(elapsed, &dma_dev->stats.poll_mode_ns);
+    else
+        atomic64_add(elapsed, &dma_dev->stats.irq_mode_ns);
+    dma_dev->poll_mode_since_ns = now;
+}
+
+/* Time spent in each mode, including the running one */
+static void antsdr_poll_mode_times(struct antsdr_dma_dev *dma_dev, uint64_t *irq_ns, uint64_t *poll_ns)
+{
+    unsigned long flags;
+    
+    spin_lock_irqsave(&dma_dev->poll_lock, flags);
+    if (dma_dev->streaming)
+        antsdr_poll_account_mode_locked(dma_dev, ktime_get_ns());
+    *irq_ns = atomic64_read(&dma_dev->stats.irq_mode_ns);
+    *poll_ns = atomic64_read(&dma_dev->stats.poll_mode_ns);
+    spin_unlock_irqrestore(&dma_dev->poll_lock, flags);
+}
+
+/* Count retired transfers and, once per measurement window, switch between
+ * interrupt and polling completion with hysteresis - like NAPI for NICs.
+ */
+static void antsdr_poll_account(struct antsdr_dma_dev *dma_dev, unsigned int frames)
+{
+    unsigned long flags;
+    u64 now, elapsed, rate;
+    bool kick = false;
+    
+    spin_lock_irqsave(&dma_dev->poll_lock, flags);
+    
+    dma_dev->poll_window_frames += frames;
+    now = ktime_get_ns();
+    elapsed = now - dma_dev->poll_window_start_ns;
+    if (elapsed < ANTSDR_POLL_RATE_WINDOW_NS) {
+        spin_unlock_irqrestore(&dma_dev->poll_lock, flags);
+        return;
+    }
+    
+    rate = div64_u64((u64)dma_dev->poll_window_frames * NSEC_PER_SEC, elapsed);
+    atomic64_set(&dma_dev->stats.frame_rate, rate);
+    dma_dev->poll_window_start_ns = now;
+    dma_dev->poll_window_frames = 0;
+    
+    if (!dma_dev->poll_active && dma_dev->poll_cfg.enable && rate >= dma_dev->poll_cfg.enter_fps) {
+        antsdr_poll_account_mode_locked(dma_dev, now);
+        dma_dev->poll_active = true;
+        antsdr_stat_inc(dma_dev, poll_mode_switches);
+        kick = !dma_dev->poll_running;
+        dma_dev->poll_running = true;
+        antsdr_debug_log(dma_dev->dev, "Entering polling mode at %llu frames/s\n", rate);
+    } else if (dma_dev->poll_active && (!dma_dev->poll_cfg.enable || rate < dma_dev->poll_cfg.exit_fps)) {
+        antsdr_poll_account_mode_locked(dma_dev, now);
+        dma_dev->poll_active = false;
+        antsdr_stat_inc(dma_dev, poll_mode_switches);
+        antsdr_debug_log(dma_dev->dev, "Back to interrupt mode at %llu frames/s\n", rate);
+    }
+    
+    spin_unlock_irqrestore(&dma_dev->poll_lock, flags);
+    
+    if (kick)
+        kthread_queue_work(dma_dev->frame_worker, &dma_dev->poll_work);
+}
+
+/* Fresh poll state for a new streaming session - interrupt mode first */
+static void antsdr_poll_reset(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned long flags;
+    u64 now = ktime_get_ns();
+    
+    spin_lock_irqsave(&dma_dev->poll_lock, flags);
+    dma_dev->poll_active = false;
+    dma_dev->poll_window_start_ns = now;
+    dma_dev->poll_window_frames = 0;
+    dma_dev->poll_mode_since_ns = now;
+    spin_unlock_irqrestore(&dma_dev->poll_lock, flags);
+}
+
+/* Top the descriptor queue back up after retiring transfers */
+static void antsdr_dma_refill(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned long flags;
+    int ret;
+    
+    /* Wake up any waiting processes */
+    wake_up_interruptible(&dma_dev->wait_queue);
+    
+    ret = antsdr_submit_dma_transfer(dma_dev);
+    if (ret) {
+        dev_err(dma_dev->dev, "Failed to submit next DMA transfer: %d, performing reset\n", ret);
+        antsdr_stat_inc(dma_dev, errors);
+        spin_lock_irqsave(&dma_dev->lock, flags);
+        /* Check streaming state again before reset - avoid race condition */
+        if (dma_dev->streaming) {
+            spin_unlock_irqrestore(&dma_dev->lock, flags);
+            /* Reset and restart DMA on error */
+            antsdr_dma_reset_and_restart(dma_dev);
+        } else {
+            spin_unlock_irqrestore(&dma_dev->lock, flags);
+            dev_info(dma_dev->dev, "Not performing reset - streaming already stopped\n");
+        }
+    }
+}
+
+/* DMA completion callback - only for descriptors armed in interrupt mode.
+ * Retires every transfer that has completed (not just its own, so a late
+ * callback and the poller can't get out of step) and re-arms the queue, so
+ * the hardware never runs without a free buffer to write into.
+ */
+static void antsdr_dma_callback(void *data)
+{
+    struct antsdr_dma_dev *dma_dev = (struct antsdr_dma_dev *)data;
+    unsigned long flags;
+    int done;
+    
+    done = antsdr_dma_reap(dma_dev, dma_dev->dma_queue_depth);
+    if (done < 0)
+        return;
+    antsdr_poll_account(dma_dev, done);
+    
+    spin_lock_irqsave(&dma_dev->lock, flags);
+    
+    /* Check if we're still streaming before submitting next transfer */
+    if (!dma_dev->streaming) {
+        antsdr_debug_log(dma_dev->dev, "DMA callback: Stopping - streaming=false, completing DMA\n");
+        spin_unlock_irqrestore(&dma_dev->lock, flags);
+        complete(&dma_dev->dma_complete);
+        return;
+    }
+    
+    spin_unlock_irqrestore(&dma_dev->lock, flags);
+    
+    if (done)
+        antsdr_dma_refill(dma_dev);
+    
+    /* Complete the DMA operation */
+    complete(&dma_dev->dma_complete);
+}
+
+/* Polling mode - runs on the parse thread instead of per-transfer callbacks.
+ * Each pass sleeps poll_interval_us, retires everything that completed in the
+ * meantime and re-arms the queue in one go. It keeps going while polling is
+ * active or descriptors armed without a callback are still outstanding.
+ */
+static void antsdr_poll_work(struct kthread_work *work)
+{
+    struct antsdr_dma_dev *dma_dev = container_of(work, struct antsdr_dma_dev, poll_work);
+    unsigned int interval = dma_dev->poll_cfg.poll_interval_us;
+    unsigned long flags;
+    int done;
+    
+    usleep_range(interval, interval + interval / 4);
+    
+    if (!dma_dev->streaming) {
+        spin_lock_irqsave(&dma_dev->poll_lock, flags);
+        dma_dev->poll_running = false;
+        spin_unlock_irqrestore(&dma_dev->poll_lock, flags);
+        complete(&dma_dev->dma_complete);
+        return;
+    }
+    
+    done = antsdr_dma_reap(dma_dev, dma_dev->dma_queue_depth);
+    if (done >= 0) {
+        antsdr_poll_account(dma_dev, done);
+        if (done)
+            antsdr_dma_refill(dma_dev);
+    }
+    
+    spin_lock_irqsave(&dma_dev->poll_lock, flags);
+    if (dma_dev->streaming && (dma_dev->poll_active || READ_ONCE(dma_dev->dma_poll_armed)))
+        kthread_queue_work(dma_dev->frame_worker, &dma_dev->poll_work);
+    else
+        dma_dev->poll_running = false;
+    spin_unlock_irqrestore(&dma_dev->poll_lock, flags);
+}
+
+/* Apply ANTSDR_IOC_SET_POLL_MODE settings */
+static int antsdr_set_poll_mode(struct antsdr_dma_dev *dma_dev, const struct antsdr_poll_config *cfg)
+{
+    struct antsdr_poll_config new_cfg = *cfg;
+    unsigned long flags;
+    
+    if (!new_cfg.poll_interval_us)
+        new_cfg.poll_interval_us = ANTSDR_POLL_DEFAULT_INTERVAL_US;
+    if (!new_cfg.enter_fps)
+        new_cfg.enter_fps = ANTSDR_POLL_DEFAULT_ENTER_FPS;
+    if (!new_cfg.exit_fps)
+        new_cfg.exit_fps = ANTSDR_POLL_DEFAULT_EXIT_FPS;
+    
+    if (new_cfg.poll_interval_us < ANTSDR_POLL_MIN_INTERVAL_US ||
+        new_cfg.poll_interval_us > ANTSDR_POLL_MAX_INTERVAL_US) {
+        dev_err(dma_dev->dev, "Invalid poll interval %u us (%u-%u)\n", new_cfg.poll_interval_us,
+                ANTSDR_POLL_MIN_INTERVAL_US, ANTSDR_POLL_MAX_INTERVAL_US);
+        return -EINVAL;
+    }
+    if (new_cfg.exit_fps >= new_cfg.enter_fps) {
+        dev_err(dma_dev->dev, "Poll exit rate %u must be below enter rate %u\n",
+                new_cfg.exit_fps, new_cfg.enter_fps);
+        return -EINVAL;
+    }
+    
+    /* Leaving polling is picked up at the next rate measurement */
+    spin_lock_irqsave(&dma_dev->poll_lock, flags);
+    dma_dev->poll_cfg = new_cfg;
+    spin_unlock_irqrestore(&dma_dev->poll_lock, flags);
+    
+    if (new_cfg.enable)
+        dev_info(dma_dev->dev, "Adaptive polling enabled: enter %u fps, exit %u fps, interval %u us\n",
+                 new_cfg.enter_fps, new_cfg.exit_fps, new_cfg.poll_interval_us);
+    else
+        dev_info(dma_dev->dev, "Adaptive polling disabled\n");
+    return 0;
+}
+
+/* Check buffer geometry limits. Zero fields are left alone. */
+static int antsdr_check_geometry(struct antsdr_dma_dev *dma_dev, const struct antsdr_geometry *geo)
+{
+    if (geo->dma_pool_kb &&
+        (geo->dma_pool_kb < ANTSDR_MIN_POOL_KB || geo->dma_pool_kb > ANTSDR_MAX_POOL_KB)) {
+        dev_err(dma_dev->dev, "Invalid DMA pool size %u KB (%u-%u)\n", geo->dma_pool_kb,
+                ANTSDR_MIN_POOL_KB, ANTSDR_MAX_POOL_KB);
+        return -EINVAL;
+    }
+    if (geo->ring_kb &&
+        (!is_power_of_2(geo->ring_kb) || geo->ring_kb < ANTSDR_MIN_RING_KB || geo->ring_kb > ANTSDR_MAX_RING_KB)) {
+        dev_err(dma_dev->dev, "Invalid ring size %u KB (power of two, %u-%u)\n", geo->ring_kb,
+                ANTSDR_MIN_RING_KB, ANTSDR_MAX_RING_KB);
+        return -EINVAL;
+    }
+    if (geo->raw_fifo_depth &&
+        (!is_power_of_2(geo->raw_fifo_depth) || geo->raw_fifo_depth < ANTSDR_MIN_RAW_FIFO_DEPTH ||
+         geo->raw_fifo_depth > ANTSDR_MAX_RAW_FIFO_DEPTH)) {
+        dev_err(dma_dev->dev, "Invalid raw frame FIFO depth %u (power of two, %u-%u)\n", geo->raw_fifo_depth,
+                ANTSDR_MIN_RAW_FIFO_DEPTH, ANTSDR_MAX_RAW_FIFO_DEPTH);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/* Report the current buffer geometry */
+static void antsdr_get_geometry(struct antsdr_dma_dev *dma_dev, struct antsdr_geometry *geo)
+{
+    unsigned long flags;
+    
+    memset(geo, 0, sizeof(*geo));
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    geo->dma_pool_kb = dma_dev->dma_pool_size / 1024;
+    geo->dma_buffers = dma_dev->dma_nr_buffers;
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+    geo->ring_kb = dma_dev->ring_size / 1024;
+    geo->raw_fifo_depth = dma_dev->raw_fifo_depth;
+}
+
+/* Apply ANTSDR_IOC_SET_GEOMETRY - resize the DMA pool, ring and raw frame FIFO.
+ * Only while stopped: queued payloads are dropped, and an area that can't be
+ * reallocated keeps its old size.
+ */
+static int antsdr_set_geometry(struct antsdr_dma_dev *dma_dev, const struct antsdr_geometry *geo)
+{
+    size_t pool_size = (size_t)geo->dma_pool_kb * 1024;
+    unsigned int ring_size = geo->ring_kb * 1024;
+    unsigned long flags;
+    int ret;
+    
+    ret = antsdr_check_geometry(dma_dev, geo);
+    if (ret)
+        return ret;
+    
+    if (dma_dev->streaming) {
+        dev_err(dma_dev->dev, "Buffer geometry can only be changed while not streaming\n");
+        return -EBUSY;
+    }
+    if (ring_size && ring_size != dma_dev->ring_size && atomic_read(&dma_dev->ring_mappings)) {
+        dev_err(dma_dev->dev, "Ring is mapped, can't resize it\n");
+        return -EBUSY;
+    }
+    if (pool_size && !dma_dev->rx_chan)
+        return -ENODEV;
+    
+    /* No consumer may be holding a record or DMA buffer across the swap */
+    mutex_lock(&dma_dev->read_mutex);
+    kthread_cancel_work_sync(&dma_dev->udp_work);
+    dma_dev->udp_work_pending = false;
+    antsdr_ring_flush(dma_dev);
+    
+    if (pool_size && pool_size != dma_dev->dma_pool_size) {
+        ret = antsdr_dma_pool_alloc(dma_dev, pool_size);
+        if (ret)
+            goto out;
+    }
+    
+    if (ring_size && ring_size != dma_dev->ring_size) {
+        ret = antsdr_ring_alloc(dma_dev, ring_size);
+        if (ret)
+            goto out;
+    }
+    
+    if (geo->raw_fifo_depth && geo->raw_fifo_depth != dma_dev->raw_fifo_depth) {
+        struct kfifo new_fifo, old_fifo;
+        
+        ret = kfifo_alloc(&new_fifo, geo->raw_fifo_depth * sizeof(struct antsdr_raw_frame), GFP_KERNEL);
+        if (ret) {
+            dev_err(dma_dev->dev, "Failed to allocate raw frame FIFO: %d\n", ret);
+            goto out;
+        }
+        
+        /* stop_streaming drained it, nothing is left to carry over */
+        spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
+        old_fifo = dma_dev->raw_frame_fifo;
+        dma_dev->raw_frame_fifo = new_fifo;
+        dma_dev->raw_fifo_depth = geo->raw_fifo_depth;
+        spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
+        kfifo_free(&old_fifo);
+    }
+    
+    dev_info(dma_dev->dev, "Buffer geometry: DMA pool %zu KB, ring %u KB, raw frame FIFO %u frames\n",
+             dma_dev->dma_pool_size / 1024, dma_dev->ring_size / 1024, dma_dev->raw_fifo_depth);
+out:
+    mutex_unlock(&dma_dev->read_mutex);
+    return ret;
+}
+
+/* Reduce the finished integration block to one payload and queue it */
+static int antsdr_integ_emit(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned int decim = dma_dev->integ_decimation;
+    unsigned int out_samples = dma_dev->integ_samples / decim;
+    unsigned int div = dma_dev->integ_frames * decim;
+    unsigned int i, k;
+    int ret;
+    
+    if (dma_dev->integ_mode == ANTSDR_INTEG_COHERENT) {
+        const s32 *acc = dma_dev->integ_acc;
+        
+        for (i = 0; i < out_samples; i++, acc += 2 * decim) {
+            s32 sum_i = 0, sum_q = 0;
+            
+            for (k = 0; k < decim; k++) {
+                sum_i += acc[2 * k];
+                sum_q += acc[2 * k + 1];
+            }
+            dma_dev->integ_out[i] = (uint16_t)(sum_i / (s32)div) |
+                                    ((uint32_t)(uint16_t)(sum_q / (s32)div) << 16);
+        }
+    } else {
+        const u64 *acc = dma_dev->integ_acc;
+        
+        for (i = 0; i < out_samples; i++, acc += decim) {
+            u64 sum = 0;
+            
+            for (k = 0; k < decim; k++)
+                sum += acc[k];
+            dma_dev->integ_out[i] = div_u64(sum, div);
+        }
+    }
+    
+    dma_dev->integ_count = 0;
+    ret = antsdr_ring_put(dma_dev, dma_dev->integ_out, out_samples * 4,
+                          dma_dev->integ_first_counter, dma_dev->integ_first_ts, -1);
+    if (ret == 0)
+        antsdr_stat_inc(dma_dev, integrated_outputs);
+    return ret;
+}
+
+/* Fold one frame payload into the integration block. A frame of a different
+ * size (pulse-mode switch, resync) abandons the block and starts a new one.
+ * Returns 0 when a result was queued, 1 when the frame was only accumulated,
+ * or a negative error if the ring refused the result.
+ */
+static int antsdr_integ_add(struct antsdr_dma_dev *dma_dev, const uint8_t *payload, size_t payload_len,
+                            uint32_t frame_counter, uint64_t timestamp_ns)
+{
+    const uint32_t *words = (const uint32_t *)payload;
+    unsigned int samples = payload_len / 4;
+    unsigned int i;
+    
+    if (!samples || samples > FPGA_LONG_PULSE_PAYLOAD) {
+        antsdr_drop(dma_dev, ANTSDR_DROP_INVALID, payload_len);
+        return -EINVAL;
+    }
+    
+    if (dma_dev->integ_count && samples != dma_dev->integ_samples)
+        dma_dev->integ_count = 0;
+    
+    if (!dma_dev->integ_count) {
+        dma_dev->integ_samples = samples;
+        dma_dev->integ_first_counter = frame_counter;
+        dma_dev->integ_first_ts = timestamp_ns;
+        memset(dma_dev->integ_acc, 0, FPGA_LONG_PULSE_PAYLOAD * sizeof(u64));
+    }
+    
+    if (dma_dev->integ_mode == ANTSDR_INTEG_COHERENT) {
+        s32 *acc = dma_dev->integ_acc;
+        
+        for (i = 0; i < samples; i++) {
+            acc[2 * i] += (s16)(words[i] & 0xFFFF);
+            acc[2 * i + 1] += (s16)(words[i] >> 16);
+        }
+    } else {
+        u64 *acc = dma_dev->integ_acc;
+        
+        for (i = 0; i < samples; i++) {
+            s32 si = (s16)(words[i] & 0xFFFF);
+            s32 sq = (s16)(words[i] >> 16);
+            
+            acc[i] += (u32)(si * si) + (u32)(sq * sq);
+        }
+    }
+    antsdr_stat_inc(dma_dev, integrated_frames);
+    
+    if (++dma_dev->integ_count < dma_dev->integ_frames)
+        return 1;
+    return antsdr_integ_emit(dma_dev);
+}
+
+/* Version 2 header integration field for the current settings */
+static inline uint16_t antsdr_header_integration(const struct antsdr_dma_dev *dma_dev)
+{
+    if (dma_dev->integ_mode == ANTSDR_INTEG_OFF)
+        return 0;
+    return (dma_dev->integ_frames - 1) | ((dma_dev->integ_decimation - 1) << 8);
+}
+
+/* Apply ANTSDR_IOC_SET_INTEGRATION. Only while stopped, so every payload of a
+ * session - and every header advertising it - has the same processing.
+ */
+static int antsdr_set_integration(struct antsdr_dma_dev *dma_dev, const struct antsdr_integration *cfg)
+{
+    unsigned int frames = cfg->frames ? cfg->frames : 1;
+    unsigned int decim = cfg->decimation ? cfg->decimation : 1;
+    
+    BUILD_BUG_ON(ANTSDR_INTEG_MAX_DECIMATION > FPGA_SHORT_PULSE_PAYLOAD);
+    if (cfg->mode > ANTSDR_INTEG_INCOHERENT || frames > ANTSDR_INTEG_MAX_FRAMES ||
+        decim > ANTSDR_INTEG_MAX_DECIMATION) {
+        dev_err(dma_dev->dev, "Invalid integration mode %u, %u frames, decimation %u\n",
+                cfg->mode, frames, decim);
+        return -EINVAL;
+    }
+    if (dma_dev->streaming) {
+        dev_err(dma_dev->dev, "Integration can only be changed while not streaming\n");
+        return -EBUSY;
+    }
+    
+    if (cfg->mode != ANTSDR_INTEG_OFF && !dma_dev->integ_acc) {
+        dma_dev->integ_acc = kcalloc(FPGA_LONG_PULSE_PAYLOAD, sizeof(u64), GFP_KERNEL);
+        dma_dev->integ_out = kcalloc(FPGA_LONG_PULSE_PAYLOAD, sizeof(uint32_t), GFP_KERNEL);
+        if (!dma_dev->integ_acc || !dma_dev->integ_out) {
+            kfree(dma_dev->integ_acc);
+            kfree(dma_dev->integ_out);
+            dma_dev->integ_acc = NULL;
+            dma_dev->integ_out = NULL;
+            return -ENOMEM;
+        }
+    }
+    
+    dma_dev->integ_mode = cfg->mode;
+    dma_dev->integ_frames = frames;
+    dma_dev->integ_decimation = decim;
+    dma_dev->integ_count = 0;
+    
+    if (cfg->mode == ANTSDR_INTEG_OFF)
+        dev_info(dma_dev->dev, "Pulse integration disabled\n");
+    else
+        dev_info(dma_dev->dev, "Pulse integration: %s over %u frames, decimation %u\n",
+                 cfg->mode == ANTSDR_INTEG_COHERENT ? "coherent" : "incoherent", frames, decim);
+    return 0;
+}
+
+/* Frame processing work function - runs in separate thread context */
+static void antsdr_frame_work(struct kthread_work *work)
+{
+    struct antsdr_dma_dev *dma_dev = container_of(work, struct antsdr_dma_dev, frame_work);
+    struct antsdr_raw_frame raw_frame;
+    unsigned long flags;
+    uint8_t *payload;
+    size_t payload_len;
+    uint32_t payload_counter;
+    u64 latency;
+    int ret;
+    int processed_frames = 0;
+    
+    antsdr_debug_log(dma_dev->dev, "Frame work function started\n");
+    
+    /* Process up to 50 frames per work invocation for high throughput (increased from 10) */
+    while (processed_frames < 50) {
+        /* Get raw frame from FIFO */
+        spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
+        ret = kfifo_out(&dma_dev->raw_frame_fifo, &raw_frame, sizeof(raw_frame));
+        spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
+        
+        if (ret != sizeof(raw_frame)) {
+            /* No more frames to process */
+            break;
+        }
+        
+        processed_frames++;
+        antsdr_debug_log(dma_dev->dev, "Frame work: Processing frame %d (%zu bytes)\n", 
+                processed_frames, raw_frame.data_len);
+        
+        /* Parse the FPGA frame to extract valid payload - frames the resync
+         * path completes from this transfer carry its timestamp
+         */
+        dma_dev->parse_timestamp_ns = raw_frame.timestamp_ns;
+        ret = antsdr_parse_fpga_frame(dma_dev, raw_frame.data, raw_frame.data_len, &payload, &payload_len, &payload_counter);
+        latency = antsdr_lat_since(dma_dev, ANTSDR_LAT_PARSE, raw_frame.timestamp_ns);
+        trace_antsdr_parse_done(ret == 0 && payload ? payload_counter : 0,
+                                ret == 0 && payload ? payload_len : 0, ret, latency);
+        
+        if (ret == 0 && !payload) {
+            /* Frames were reassembled by the resync path and queued as copies */
+            antsdr_raw_frame_release(dma_dev, &raw_frame);
+            continue;
+        }
+        
+        if (ret == 0) {
+            antsdr_debug_log(dma_dev->dev, "Frame work: Valid frame found, extracted %zu payload bytes\n", payload_len);
+            
+            /* Valid frame found - queue the extracted payload for UDP transmission.
+             * Zero-copy: the ring slot takes over the DMA buffer, payload stays in place.
+             * Integration only queues its results, the frame itself is done with.
+             */
+            if (dma_dev->integ_mode != ANTSDR_INTEG_OFF) {
+                ret = antsdr_integ_add(dma_dev, payload, payload_len, payload_counter,
+                                       raw_frame.timestamp_ns);
+                antsdr_raw_frame_release(dma_dev, &raw_frame);
+            } else {
+                ret = antsdr_ring_put(dma_dev, payload, payload_len, payload_counter,
+                                      raw_frame.timestamp_ns, raw_frame.dma_index);
+                if (raw_frame.dma_index < 0 || ret != 0)
+                    antsdr_raw_frame_release(dma_dev, &raw_frame);
+            }
+            if (ret >= 0) {
+                /* Queued (or folded into an integration block), schedule UDP work */
+                if (ret == 0 && !dma_dev->udp_work_pending) {
+                    dma_dev->udp_work_pending = true;
+                    kthread_queue_work(dma_dev->udp_worker, &dma_dev->udp_work);
+                }
+                
+                antsdr_stat_inc(dma_dev, valid_frames);
+                antsdr_stat_inc(dma_dev, extracted_frames);
+                
+                antsdr_debug_log(dma_dev->dev, "Frame work: Queued %zu payload bytes, scheduling UDP work\n", payload_len);
+            } else {
+                dev_warn_ratelimited(dma_dev->dev, "Ring buffer full, dropping valid frame\n");
+                antsdr_stat_inc(dma_dev, errors);
+            }
+        } else {
+            antsdr_debug_log(dma_dev->dev, "Frame work: Invalid FPGA frame detected, dropping %zu bytes\n", raw_frame.data_len);
+            /* Anything worth keeping was copied into the detection buffer */
+            antsdr_raw_frame_release(dma_dev, &raw_frame);
+            
+            /* Invalid frame - update stats but don't queue */
+            antsdr_stat_inc(dma_dev, invalid_frames);
+            antsdr_drop(dma_dev, ANTSDR_DROP_INVALID, raw_frame.data_len);
+        }
+    }
+    
+    /* Check if there are more frames to process */
+    spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
+    if (!kfifo_is_empty(&dma_dev->raw_frame_fifo)) {
+        /* More frames available, reschedule work */
+        kthread_queue_work(dma_dev->frame_worker, &dma_dev->frame_work);
+        antsdr_debug_log(dma_dev->dev, "Frame work: Rescheduling - more frames available\n");
+    } else {
+        /* No more frames, clear pending flag */
+        dma_dev->frame_work_pending = false;
+        antsdr_debug_log(dma_dev->dev, "Frame work: Completed - processed %d frames\n", processed_frames);
+    }
+    spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
+}
+
+/* Take 'bytes' from the rate cap's token bucket. A datagram larger than the
+ * bucket goes out once it is full. Returns 0 once the tokens are taken, or
+ * how many microseconds to wait - with dest_mutex dropped - before asking
+ * again. Caller holds dest_mutex.
+ */
+static unsigned int antsdr_udp_pace_locked(struct antsdr_dma_dev *dma_dev, size_t bytes)
+{
+    u32 rate_kbps = READ_ONCE(dma_dev->pacing.rate_kbps);
+    u64 burst = READ_ONCE(dma_dev->pacing.burst_bytes);
+    u64 need = min_t(u64, bytes, burst);
+    u64 now, elapsed, wait_us;
+    
+    if (!rate_kbps || !dma_dev->streaming)
+        return 0;
+    
+    now = ktime_get_ns();
+    elapsed = min_t(u64, now - dma_dev->pace_last_ns, NSEC_PER_SEC);
+    dma_dev->pace_tokens = min(dma_dev->pace_tokens + div_u64(elapsed * rate_kbps, 8000000), burst);
+    dma_dev->pace_last_ns = now;
+    if (dma_dev->pace_tokens >= need) {
+        dma_dev->pace_tokens -= need;
+        return 0;
+    }
+    
+    /* Only whole bytes are credited - the remainder of 'elapsed' is lost,
+     * so round the wait up
+     */
+    wait_us = div_u64((need - dma_dev->pace_tokens) * 8000 + rate_kbps - 1, rate_kbps);
+    return min_t(u64, wait_us, 10 * ANTSDR_PACE_MAX_SLEEP_US);
+}
+
+/* Raw transmit: drop a destination's egress device. Caller holds dest_mutex. */
+static void antsdr_raw_release_locked(struct antsdr_udp_target *target)
+{
+    if (target->raw_dev) {
+        dev_put(target->raw_dev);
+        target->raw_dev = NULL;
+    }
+}
+
+/* Raw transmit: an egress device going down or away must not stay held -
+ * its destinations fall back to their sockets until the next template
+ * refresh finds a route again
+ */
+static int antsdr_raw_netdev_event(struct notifier_block *nb, unsigned long event, void *ptr)
+{
+    struct antsdr_dma_dev *dma_dev = container_of(nb, struct antsdr_dma_dev, raw_netdev_nb);
+    struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+    struct antsdr_udp_target *target;
+    unsigned int i;
+    
+    if (event != NETDEV_DOWN && event != NETDEV_UNREGISTER)
+        return NOTIFY_DONE;
+    
+    mutex_lock(&dma_dev->dest_mutex);
+    for (i = 0; i < dma_dev->nr_dests; i++) {
+        target = &dma_dev->dests[i];
+        if (target->raw_dev != dev)
+            continue;
+        antsdr_raw_release_locked(target);
+        dev_info(dma_dev->dev, "UDP destination %pI4:%u: socket transmit, %s went down\n",
+                 &target->addr.sin_addr.s_addr, ntohs(target->addr.sin_port), dev->name);
+    }
+    mutex_unlock(&dma_dev->dest_mutex);
+    return NOTIFY_DONE;
+}
+
+/* Raw transmit: (re)build a destination's header template from its route and
+ * ARP entry. On failure the destination stays on its socket. Caller holds
+ * dest_mutex.
+ */
+static int antsdr_raw_resolve_locked(struct antsdr_dma_dev *dma_dev, struct antsdr_udp_target *target)
+{
+    __be32 daddr = target->addr.sin_addr.s_addr;
+    struct flowi4 fl4 = { .daddr = daddr, .flowi4_proto = IPPROTO_UDP };
+    struct sock *sk = target->sock->sk;
+    struct net_device *old = target->raw_dev, *dev;
+    struct ethhdr *eth = (struct ethhdr *)target->raw_hdr;
+    struct iphdr *iph = (struct iphdr *)(eth + 1);
+    struct udphdr *uh = (struct udphdr *)(iph + 1);
+    struct neighbour *n;
+    struct rtable *rt;
+    __be32 nexthop;
+    int ret = 0;
+    
+    target->raw_refresh_ns = ktime_get_ns() + ANTSDR_RAW_REFRESH_MS * NSEC_PER_MSEC;
+    target->raw_dev = NULL;
+    
+    /* The raw frames carry the socket's port, so fallbacks keep the same one */
+    if (!inet_sk(sk)->inet_sport) {
+        struct sockaddr_in any = { .sin_family = AF_INET };
+        
+        ret = kernel_bind(target->sock, (struct sockaddr *)&any, sizeof(any));
+        if (ret)
+            goto out_put;
+    }
+    
+    rt = ip_route_output_key(&init_net, &fl4);
+    if (IS_ERR(rt)) {
+        ret = PTR_ERR(rt);
+        goto out_put;
+    }
+    dev = rt->dst.dev;
+    if (dev->type != ARPHRD_ETHER || (dev->flags & IFF_LOOPBACK) ||
+        (rt->rt_type != RTN_UNICAST && rt->rt_type != RTN_MULTICAST)) {
+        ret = -EOPNOTSUPP;
+        goto out_rt;
+    }
+    
+    if (rt->rt_type == RTN_MULTICAST) {
+        ip_eth_mc_map(daddr, (char *)eth->h_dest);
+    } else {
+        nexthop = rt_nexthop(rt, daddr);
+        n = neigh_lookup(&arp_tbl, &nexthop, dev);
+        if (!n) {
+            ret = -EHOSTUNREACH;
+            goto out_rt;
+        }
+        if (n->nud_state & NUD_VALID)
+            neigh_ha_snapshot((char *)eth->h_dest, n, dev);
+        else
+            ret = -EHOSTUNREACH;
+        neigh_release(n);
+        if (ret)
+            goto out_rt;
+    }
+    ether_addr_copy(eth->h_source, dev->dev_addr);
+    eth->h_proto = htons(ETH_P_IP);
+    
+    iph->version = 4;
+    iph->ihl = sizeof(*iph) / 4;
+    iph->tos = inet_sk(sk)->tos;
+    iph->frag_off = htons(IP_DF);
+    iph->ttl = rt->rt_type == RTN_MULTICAST ? inet_sk(sk)->mc_ttl : IPDEFTTL;
+    iph->protocol = IPPROTO_UDP;
+    iph->saddr = fl4.saddr;
+    iph->daddr = daddr;
+    uh->source = inet_sk(sk)->inet_sport;
+    uh->dest = target->addr.sin_port;
+    
+    dev_hold(dev);
+    target->raw_dev = dev;
+    
+out_rt:
+    ip_rt_put(rt);
+out_put:
+    if (old)
+        dev_put(old);
+    if (!!old != !!target->raw_dev)
+        dev_info(dma_dev->dev, "UDP destination %pI4:%u: %s\n", &daddr, ntohs(target->addr.sin_port),
+                 target->raw_dev ? "raw Ethernet transmit" : "socket transmit");
+    return ret;
+}
+
+/* Raw transmit: one datagram as a ready-made Ethernet frame. Like a send on a
+ * full socket, -ENOBUFS when the NIC queue refuses it. Caller holds dest_mutex.
+ */
+static int antsdr_raw_xmit_locked(struct antsdr_dma_dev *dma_dev, struct antsdr_udp_target *target,
+                                  struct kvec *iov, size_t nr, size_t len)
+{
+    struct net_device *dev = target->raw_dev;
+    unsigned int ulen = sizeof(struct udphdr) + len;
+    struct sk_buff *skb;
+    struct iphdr *iph;
+    struct udphdr *uh;
+    size_t i;
+    int ret;
+    
+    if (!netif_running(dev) || !netif_carrier_ok(dev))
+        return -ENETDOWN;
+    
+    skb = alloc_skb(LL_RESERVED_SPACE(dev) + ANTSDR_RAW_HDR_LEN + len + dev->needed_tailroom, GFP_KERNEL);
+    if (!skb)
+        return -ENOBUFS;
+    skb_reserve(skb, LL_RESERVED_SPACE(dev));
+    skb_reset_mac_header(skb);
+    skb_set_network_header(skb, ETH_HLEN);
+    skb_set_transport_header(skb, ETH_HLEN + sizeof(struct iphdr));
+    skb_put_data(skb, target->raw_hdr, ANTSDR_RAW_HDR_LEN);
+    for (i = 0; i < nr; i++)
+        skb_put_data(skb, iov[i].iov_base, iov[i].iov_len);
+    
+    iph = ip_hdr(skb);
+    iph->tot_len = htons(sizeof(*iph) + ulen);
+    iph->id = htons(target->raw_ip_id++);
+    ip_send_check(iph);
+    
+    uh = udp_hdr(skb);
+    uh->len = htons(ulen);
+    if (dev->features & (NETIF_F_IP_CSUM | NETIF_F_HW_CSUM)) {
+        skb->ip_summed = CHECKSUM_PARTIAL;
+        skb->csum_start = skb_transport_header(skb) - skb->head;
+        skb->csum_offset = offsetof(struct udphdr, check);
+        uh->check = ~csum_tcpudp_magic(iph->saddr, iph->daddr, ulen, IPPROTO_UDP, 0);
+    } else {
+        skb->ip_summed = CHECKSUM_NONE;
+        uh->check = 0;
+        uh->check = csum_tcpudp_magic(iph->saddr, iph->daddr, ulen, IPPROTO_UDP, csum_partial(uh, ulen, 0));
+        if (!uh->check)
+            uh->check = CSUM_MANGLED_0;
+    }
+    
+    skb->dev = dev;
+    skb->protocol = htons(ETH_P_IP);
+    skb->priority = target->sock->sk->sk_priority;
+    
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 20, 0)
+    if (dma_dev->raw_tx_flags & ANTSDR_RAW_TX_QDISC_BYPASS) {
+        skb_set_queue_mapping(skb, 0);
+        ret = dev_direct_xmit(skb, 0);
+    } else
+#endif
+        ret = dev_queue_xmit(skb);
+    
+    /* The skb is gone either way; a queued-but-congested frame counts as sent */
+    ret = net_xmit_eval(ret);
+    if (ret) {
+        antsdr_stat_inc(dma_dev, raw_errors);
+        return ret > 0 ? -ENOBUFS : ret;
+    }
+    antsdr_stat_inc(dma_dev, raw_packets);
+    return len;
+}
+
+/* ANTSDR_IOC_SET_RAW_TX */
+static int antsdr_set_raw_tx(struct antsdr_dma_dev *dma_dev, const struct antsdr_raw_tx *cfg)
+{
+    unsigned int i, resolved = 0;
+    
+    if (cfg->flags & ~ANTSDR_RAW_TX_QDISC_BYPASS)
+        return -EINVAL;
+    
+    mutex_lock(&dma_dev->dest_mutex);
+    dma_dev->raw_tx = cfg->enable;
+    dma_dev->raw_tx_flags = cfg->flags;
+    for (i = 0; i < dma_dev->nr_dests; i++) {
+        if (!cfg->enable)
+            antsdr_raw_release_locked(&dma_dev->dests[i]);
+        else if (!antsdr_raw_resolve_locked(dma_dev, &dma_dev->dests[i]))
+            resolved++;
+    }
+    mutex_unlock(&dma_dev->dest_mutex);
+    
+    if (cfg->enable)
+        dev_info(dma_dev->dev, "Raw Ethernet transmit on%s, %u of %u destinations resolved\n",
+                 (cfg->flags & ANTSDR_RAW_TX_QDISC_BYPASS) ? " (qdisc bypass)" : "", resolved, i);
+    else
+        dev_info(dma_dev->dev, "Raw Ethernet transmit off\n");
+    return 0;
+}
+
+/* ANTSDR_IOC_GET_RAW_TX */
+static void antsdr_raw_tx_get(struct antsdr_dma_dev *dma_dev, struct antsdr_raw_tx_status *status)
+{
+    unsigned int i;
+    
+    memset(status, 0, sizeof(*status));
+    mutex_lock(&dma_dev->dest_mutex);
+    status->enable = dma_dev->raw_tx;
+    status->flags = dma_dev->raw_tx_flags;
+    for (i = 0; i < dma_dev->nr_dests; i++)
+        status->dests += dma_dev->dests[i].raw_dev != NULL;
+    mutex_unlock(&dma_dev->dest_mutex);
+    
+    status->packets = atomic64_read(&dma_dev->stats.raw_packets);
+    status->fallbacks = atomic64_read(&dma_dev->stats.raw_fallbacks);
+    status->errors = atomic64_read(&dma_dev->stats.raw_errors);
+}
+
+/* One non-blocking send to one destination - -EAGAIN / -ENOBUFS if its
+ * socket buffer or NIC queue is full. Caller holds dest_mutex.
+ */
+static int antsdr_udp_sendmsg_locked(struct antsdr_dma_dev *dma_dev, struct antsdr_udp_target *target,
+                                     struct kvec *iov, size_t nr, size_t len)
+{
+    struct msghdr msg;
+    
+    if (target->raw_dev && sizeof(struct iphdr) + sizeof(struct udphdr) + len <= target->raw_dev->mtu)
+        return antsdr_raw_xmit_locked(dma_dev, target, iov, nr, len);
+    
+    if (dma_dev->raw_tx)
+        antsdr_stat_inc(dma_dev, raw_fallbacks);
+    
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &target->addr;
+    msg.msg_namelen = sizeof(target->addr);
+    msg.msg_flags = MSG_DONTWAIT;
+    
+    return kernel_sendmsg(target->sock, &msg, iov, nr, len);
+}
+
+/* Account for one destination's send of a datagram. Caller holds dest_mutex. */
+static void antsdr_udp_account_locked(struct antsdr_dma_dev *dma_dev, struct antsdr_udp_target *target,
+                                      int ret, size_t len, unsigned int *sent, int *err)
+{
+    if (ret > 0) {
+        atomic64_inc(&target->packets);
+        antsdr_stat_inc(dma_dev, udp_packets_sent);
+        (*sent)++;
+    } else {
+        atomic64_inc(&target->drops);
+        antsdr_stat_inc(dma_dev, errors);
+        antsdr_drop(dma_dev, ANTSDR_DROP_SEND_ERROR, len);
+        *err = ret ? ret : -EIO;
+    }
+}
+
+/* Replace the pacing settings, zero fields taking the defaults. The bucket
+ * starts full.
+ */
+static int antsdr_set_pacing(struct antsdr_dma_dev *dma_dev, const struct antsdr_pacing *cfg)
+{
+    struct antsdr_pacing p = *cfg;
+    
+    if (!p.burst_bytes)
+        p.burst_bytes = ANTSDR_PACE_DEFAULT_BURST;
+    if (!p.max_backoff_us)
+        p.max_backoff_us = ANTSDR_PACE_DEFAULT_BACKOFF_US;
+    if (!p.overload_high_pct)
+        p.overload_high_pct = ANTSDR_OVERLOAD_DEFAULT_HIGH;
+    if (!p.overload_low_pct)
+        p.overload_low_pct = p.overload_high_pct > ANTSDR_OVERLOAD_DEFAULT_LOW ?
+                             ANTSDR_OVERLOAD_DEFAULT_LOW : p.overload_high_pct / 2;
+    
+    if (p.max_backoff_us > ANTSDR_PACE_MAX_BACKOFF_US ||
+        p.overload_high_pct < 2 || p.overload_high_pct > 100 || p.overload_low_pct >= p.overload_high_pct)
+        return -EINVAL;
+    memset(p.reserved, 0, sizeof(p.reserved));
+    
+    mutex_lock(&dma_dev->dest_mutex);
+    WRITE_ONCE(dma_dev->pacing.rate_kbps, p.rate_kbps);
+    WRITE_ONCE(dma_dev->pacing.burst_bytes, p.burst_bytes);
+    WRITE_ONCE(dma_dev->pacing.max_backoff_us, p.max_backoff_us);
+    WRITE_ONCE(dma_dev->pacing.overload_high_pct, p.overload_high_pct);
+    WRITE_ONCE(dma_dev->pacing.overload_low_pct, p.overload_low_pct);
+    dma_dev->pace_tokens = p.burst_bytes;
+    dma_dev->pace_last_ns = ktime_get_ns();
+    mutex_unlock(&dma_dev->dest_mutex);
+    
+    if (p.rate_kbps)
+        dev_info(dma_dev->dev, "Send pacing: %u kbit/s, burst %u bytes, overload at %u%%/%u%%\n",
+                 p.rate_kbps, p.burst_bytes, p.overload_high_pct, p.overload_low_pct);
+    return 0;
+}
+
+static void antsdr_pacing_get(struct antsdr_dma_dev *dma_dev, struct antsdr_pacing_status *status)
+{
+    unsigned long flags;
+    
+    memset(status, 0, sizeof(*status));
+    mutex_lock(&dma_dev->dest_mutex);
+    status->config = dma_dev->pacing;
+    mutex_unlock(&dma_dev->dest_mutex);
+    
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    status->overloaded = dma_dev->overloaded;
+    status->backlog_pct = antsdr_udp_backlog_pct_locked(dma_dev);
+    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+    
+    status->overload_events = atomic64_read(&dma_dev->stats.overload_events);
+    status->paced_ns = atomic64_read(&dma_dev->stats.paced_ns);
+    status->backoffs = atomic64_read(&dma_dev->stats.send_backoffs);
+    status->backoff_ns = atomic64_read(&dma_dev->stats.send_backoff_ns);
+    status->backoff_drops = atomic64_read(&dma_dev->stats.send_backoff_drops);
+}
+
+/* Send one datagram to every destination and account for it. All sends
+ * share the same kvecs, iov[0] starting with the packet header; only its
+ * sequence number (same offset in v1 and v2) is rewritten per destination.
+ * Every destination gets one try first. The ones whose socket buffer or NIC
+ * queue was full are retried with exponential backoff, for up to
+ * max_backoff_us, instead of dropping the datagram at once. The rate cap and
+ * backoff sleeps run with dest_mutex dropped, so they never hold up the
+ * destination ioctls. If the destinations change meanwhile, the retries are
+ * dropped. Returns 1 if the datagram went out to any destination, 0 if there
+ * is none, or a negative error.
+ */
+static int antsdr_udp_send_datagram(struct antsdr_dma_dev *dma_dev, struct kvec *iov, size_t nr, size_t len)
+{
+    uint8_t *sequence = (uint8_t *)iov[0].iov_base + offsetof(struct antsdr_packet_header, sequence_number);
+    struct antsdr_udp_target *target;
+    __be32 seqs[ANTSDR_MAX_UDP_DESTS];
+    unsigned int i, sent = 0, nr_dests, gen, wait_us;
+    unsigned int sleep_us = ANTSDR_PACE_MIN_SLEEP_US;
+    unsigned long blocked = 0;
+    u64 start, duration, budget_ns, backoff_start = 0, pace_start = 0;
+    int ret, err = 0;
+    
+    BUILD_BUG_ON(offsetof(struct antsdr_packet_header, sequence_number) !=
+                 offsetof(struct antsdr_packet_header_v2, sequence_number));
+    BUILD_BUG_ON(ANTSDR_MAX_UDP_DESTS > BITS_PER_LONG);
+    
+    mutex_lock(&dma_dev->dest_mutex);
+    while ((wait_us = antsdr_udp_pace_locked(dma_dev, (size_t)len * dma_dev->nr_dests))) {
+        if (!pace_start)
+            pace_start = ktime_get_ns();
+        mutex_unlock(&dma_dev->dest_mutex);
+        usleep_range(wait_us, wait_us + ANTSDR_PACE_MIN_SLEEP_US);
+        mutex_lock(&dma_dev->dest_mutex);
+    }
+    if (pace_start)
+        antsdr_stat_add(dma_dev, paced_ns, ktime_get_ns() - pace_start);
+    
+    start = ktime_get_ns();
+    for (i = 0; i < dma_dev->nr_dests; i++) {
+        target = &dma_dev->dests[i];
+        seqs[i] = cpu_to_be32(target->sequence++);
+        memcpy(sequence, &seqs[i], sizeof(seqs[i]));
+        
+        /* Raw transmit: follow route and ARP changes */
+        if (dma_dev->raw_tx && start >= target->raw_refresh_ns)
+            antsdr_raw_resolve_locked(dma_dev, target);
+        
+        ret = antsdr_udp_sendmsg_locked(dma_dev, target, iov, nr, len);
+        if (ret == -EAGAIN || ret == -ENOBUFS)
+            blocked |= BIT(i);
+        else
+            antsdr_udp_account_locked(dma_dev, target, ret, len, &sent, &err);
+    }
+    
+    /* Back off the blocked destinations only - the others are done */
+    budget_ns = (u64)READ_ONCE(dma_dev->pacing.max_backoff_us) * NSEC_PER_USEC;
+    gen = dma_dev->dest_gen;
+    while (blocked) {
+        u64 now = ktime_get_ns();
+        
+        if (!backoff_start)
+            backoff_start = now;
+        else if (now - backoff_start >= budget_ns || !dma_dev->streaming)
+            break;
+        antsdr_stat_add(dma_dev, send_backoffs, hweight_long(blocked));
+        
+        mutex_unlock(&dma_dev->dest_mutex);
+        usleep_range(sleep_us, sleep_us * 2);
+        sleep_us = min(sleep_us * 2, (unsigned int)ANTSDR_PACE_MAX_SLEEP_US);
+        mutex_lock(&dma_dev->dest_mutex);
+        
+        if (dma_dev->dest_gen != gen) {
+            for_each_set_bit(i, &blocked, ANTSDR_MAX_UDP_DESTS) {
+                antsdr_stat_inc(dma_dev, send_backoff_drops);
+                antsdr_stat_inc(dma_dev, errors);
+                antsdr_drop(dma_dev, ANTSDR_DROP_SEND_ERROR, len);
+            }
+            err = -EAGAIN;
+            blocked = 0;
+            break;
+        }
+        for_each_set_bit(i, &blocked, ANTSDR_MAX_UDP_DESTS) {
+            target = &dma_dev->dests[i];
+            memcpy(sequence, &seqs[i], sizeof(seqs[i]));
+            ret = antsdr_udp_sendmsg_locked(dma_dev, target, iov, nr, len);
+            if (ret == -EAGAIN || ret == -ENOBUFS)
+                continue;
+            blocked &= ~BIT(i);
+            antsdr_udp_account_locked(dma_dev, target, ret, len, &sent, &err);
+        }
+    }
+    for_each_set_bit(i, &blocked, ANTSDR_MAX_UDP_DESTS) {
+        antsdr_stat_inc(dma_dev, send_backoff_drops);
+        antsdr_udp_account_locked(dma_dev, &dma_dev->dests[i], -EAGAIN, len, &sent, &err);
+    }
+    if (backoff_start)
+        antsdr_stat_add(dma_dev, send_backoff_ns, ktime_get_ns() - backoff_start);
+    nr_dests = dma_dev->nr_dests;
+    mutex_unlock(&dma_dev->dest_mutex);
+    
+    duration = ktime_get_ns() - start;
+    if (nr_dests)
+        antsdr_lat_record(dma_dev, ANTSDR_LAT_SENDMSG, duration);
+    trace_antsdr_udp_send(len, sent, nr_dests, err, duration);
+    
+    if (sent)
+        return 1;
+    return err;
+}
+
+/* Add a destination with its own socket. Caller holds dest_mutex. */
+static int antsdr_udp_dest_add_locked(struct antsdr_dma_dev *dma_dev, const struct antsdr_udp_dest_cfg *cfg)
+{
+    struct antsdr_udp_target *target;
+    unsigned int i;
+    int ret;
+    
+    if (!cfg->ip || !cfg->port)
+        return -EINVAL;
+    
+    for (i = 0; i < dma_dev->nr_dests; i++) {
+        if (dma_dev->dests[i].addr.sin_addr.s_addr == cfg->ip &&
+            dma_dev->dests[i].addr.sin_port == htons(cfg->port))
+            return -EEXIST;
+    }
+    if (dma_dev->nr_dests == ANTSDR_MAX_UDP_DESTS)
+        return -ENOSPC;
+    
+    target = &dma_dev->dests[dma_dev->nr_dests];
+    memset(target, 0, sizeof(*target));
+    ret = sock_create_kern(&init_net, AF_INET, SOCK_DGRAM, IPPROTO_UDP, &target->sock);
+    if (ret) {
+        dev_err(dma_dev->dev, "Failed to create UDP socket: %d\n", ret);
+        return ret;
+    }
+    
+    if (ipv4_is_multicast(cfg->ip)) {
+        lock_sock(target->sock->sk);
+        inet_sk(target->sock->sk)->mc_ttl = cfg->ttl ? cfg->ttl : ANTSDR_MCAST_DEFAULT_TTL;
+        release_sock(target->sock->sk);
+    }
+    
+    target->addr.sin_family = AF_INET;
+    target->addr.sin_addr.s_addr = cfg->ip;
+    target->addr.sin_port = htons(cfg->port);
+    dma_dev->nr_dests++;
+    dma_dev->dest_gen++;
+    dma_dev->dest_set = true;
+    if (dma_dev->raw_tx)
+        antsdr_raw_resolve_locked(dma_dev, target);
+    
+    dev_info(dma_dev->dev, "UDP destination %pI4:%u added (%s, %u of %u)\n", &cfg->ip, cfg->port,
+             ipv4_is_multicast(cfg->ip) ? "multicast" : "unicast", dma_dev->nr_dests, ANTSDR_MAX_UDP_DESTS);
+    return 0;
+}
+
+/* Drop destination 'index'. Caller holds dest_mutex. */
+static void antsdr_udp_dest_remove_locked(struct antsdr_dma_dev *dma_dev, unsigned int index)
+{
+    antsdr_raw_release_locked(&dma_dev->dests[index]);
+    sock_release(dma_dev->dests[index].sock);
+    dma_dev->nr_dests--;
+    dma_dev->dest_gen++;
+    memmove(&dma_dev->dests[index], &dma_dev->dests[index + 1],
+            (dma_dev->nr_dests - index) * sizeof(dma_dev->dests[0]));
+    dma_dev->dest_set = dma_dev->nr_dests > 0;
+}
+
+/* Drop every destination. Caller holds dest_mutex. */
+static void antsdr_udp_dests_clear_locked(struct antsdr_dma_dev *dma_dev)
+{
+    while (dma_dev->nr_dests)
+        antsdr_udp_dest_remove_locked(dma_dev, dma_dev->nr_dests - 1);
+}
+
+/* ANTSDR_IOC_DEL_UDP_DEST */
+static int antsdr_udp_dest_del(struct antsdr_dma_dev *dma_dev, const struct antsdr_udp_dest_cfg *cfg)
+{
+    unsigned int i;
+    int ret = -ENOENT;
+    
+    mutex_lock(&dma_dev->dest_mutex);
+    for (i = 0; i < dma_dev->nr_dests; i++) {
+        if (dma_dev->dests[i].addr.sin_addr.s_addr == cfg->ip &&
+            dma_dev->dests[i].addr.sin_port == htons(cfg->port)) {
+            antsdr_udp_dest_remove_locked(dma_dev, i);
+            ret = 0;
+            break;
+        }
+    }
+    mutex_unlock(&dma_dev->dest_mutex);
+    
+    if (!ret)
+        dev_info(dma_dev->dev, "UDP destination %pI4:%u removed\n", &cfg->ip, cfg->port);
+    return ret;
+}
+
+/* ANTSDR_IOC_GET_UDP_DESTS */
+static void antsdr_udp_dests_get(struct antsdr_dma_dev *dma_dev, struct antsdr_udp_dest_list *list)
+{
+    struct antsdr_udp_target *target;
+    unsigned int i;
+    
+    memset(list, 0, sizeof(*list));
+    mutex_lock(&dma_dev->dest_mutex);
+    list->count = dma_dev->nr_dests;
+    for (i = 0; i < dma_dev->nr_dests; i++) {
+        target = &dma_dev->dests[i];
+        list->dests[i].ip = target->addr.sin_addr.s_addr;
+        list->dests[i].port = ntohs(target->addr.sin_port);
+        list->dests[i].multicast = ipv4_is_multicast(target->addr.sin_addr.s_addr);
+        list->dests[i].sequence = target->sequence;
+        list->dests[i].raw = target->raw_dev != NULL;
+        list->dests[i].packets = atomic64_read(&target->packets);
+        list->dests[i].drops = atomic64_read(&target->drops);
+    }
+    mutex_unlock(&dma_dev->dest_mutex);
+}
+
+/* Version 2 header flags for the current clock, checksum and integration
+ * modes, the frame's LO tag and the channel
+ */
+static inline uint16_t antsdr_header_flags(const struct antsdr_dma_dev *dma_dev, unsigned int csum_mode,
+                                           uint16_t lo_tag)
+{
+    return (dma_dev->ts_clock & ANTSDR_HDR_CLOCK_MASK) |
+           ((csum_mode << ANTSDR_HDR_CSUM_SHIFT) & ANTSDR_HDR_CSUM_MASK) |
+           ((dma_dev->integ_mode << ANTSDR_HDR_INTEG_SHIFT) & ANTSDR_HDR_INTEG_MASK) |
+           ((lo_tag << ANTSDR_HDR_LO_SHIFT) & ANTSDR_HDR_LO_MASK) |
+           ((dma_dev->channel << ANTSDR_HDR_CHAN_SHIFT) & ANTSDR_HDR_CHAN_MASK);
+}
+
+/* LO tag of a frame captured at timestamp_ns. Lockless - retries if
+ * antsdr_set_lo_profile() changed the tags while they were being read.
+ */
+static inline uint16_t antsdr_lo_tag(const struct antsdr_dma_dev *dma_dev, uint64_t timestamp_ns)
+{
+    unsigned int seq;
+    uint16_t tag;
+    
+    do {
+        seq = read_seqcount_begin(&dma_dev->lo_seq);
+        if (timestamp_ns < dma_dev->lo_begin_ns)
+            tag = dma_dev->lo_tag_prev;
+        else if (timestamp_ns < dma_dev->lo_end_ns)
+            tag = 0;
+        else
+            tag = dma_dev->lo_tag;
+    } while (read_seqcount_retry(&dma_dev->lo_seq, seq));
+    return tag;
+}
+
+/* ANTSDR_CSUM_HEADER checksum. The sequence number is patched per destination
+ * after the header is built, so it is left out along with the checksum itself.
+ */
+static uint32_t antsdr_header_crc(void *header, size_t header_size)
+{
+    struct antsdr_packet_header *h = header;  /* Both fields sit at the same offset in v1 and v2 */
+    
+    BUILD_BUG_ON(offsetof(struct antsdr_packet_header, checksum) !=
+                 offsetof(struct antsdr_packet_header_v2, checksum));
+    h->sequence_number = 0;
+    h->checksum = 0;
+    return crc32(0, header, header_size);
+}
+
+/* Send one frame payload as regular datagrams, fragmented to ANTSDR_MAX_PAYLOAD_SIZE.
+ * The header is built in its own kvec and the payload is sent straight from
+ * the ring - a DMA buffer in zero-copy mode - so nothing is copied here.
+ * Returns the number of datagrams sent or a negative error.
+ */
+static int antsdr_udp_send_frame(struct antsdr_dma_dev *dma_dev, const uint8_t *payload, size_t payload_len,
+                                 uint32_t frame_counter, uint64_t timestamp_ns)
+{
+    union {
+        struct antsdr_packet_header v1;
+        struct antsdr_packet_header_v2 v2;
+    } header;
+    bool v2 = dma_dev->header_version == 2;
+    size_t header_size = v2 ? ANTSDR_PACKET_HEADER_V2_SIZE : ANTSDR_PACKET_HEADER_SIZE;
+    unsigned int csum_mode = READ_ONCE(dma_dev->csum_mode);
+    struct kvec iov[2];
+    uint32_t current_frame_id, checksum = 0;
+    uint16_t lo_tag;
+    size_t fragments_needed, fragment_offset = 0;
+    int sent = 0;
+    int ret;
+
+    iov[0].iov_base = &header;
+    iov[0].iov_len = header_size;
+
+    /* Fragment the payload if it's larger than max packet size */
+    fragments_needed = (payload_len + ANTSDR_MAX_PAYLOAD_SIZE - 1) / ANTSDR_MAX_PAYLOAD_SIZE;
+
+    current_frame_id = dma_dev->frame_id_counter++;
+    lo_tag = antsdr_lo_tag(dma_dev, timestamp_ns);
+
+    if (csum_mode == ANTSDR_CSUM_FRAME)
+        checksum = crc32(0, payload, payload_len);
+
+    for (size_t fragment_idx = 0; fragment_idx < fragments_needed; fragment_idx++) {
+        size_t current_fragment_size = min(payload_len - fragment_offset,
+                                          (size_t)ANTSDR_MAX_PAYLOAD_SIZE);
+        const uint8_t *fragment = payload + fragment_offset;
+
+        /* Build packet header */
+        if (v2) {
+            header.v2.start_marker = cpu_to_be32(ANTSDR_PACKET_START_MARKER_V2);
+            header.v2.frame_id = cpu_to_be32(current_frame_id);
+            header.v2.frame_counter = cpu_to_be32(frame_counter);
+            header.v2.timestamp_ns = cpu_to_be64(timestamp_ns);
+            header.v2.payload_length = cpu_to_be16(current_fragment_size);
+            header.v2.fragment_offset = cpu_to_be16(fragment_offset);
+            header.v2.fragment_index = fragment_idx;
+            header.v2.fragment_count = fragments_needed;
+            header.v2.flags = cpu_to_be16(antsdr_header_flags(dma_dev, csum_mode, lo_tag));
+            header.v2.frame_payload_total = cpu_to_be16(payload_len);
+            header.v2.integration = cpu_to_be16(antsdr_header_integration(dma_dev));
+            header.v2.missing_frame_count = cpu_to_be32(dma_dev->missing_frame_count);
+        } else {
+            header.v1.start_marker = cpu_to_be32(ANTSDR_PACKET_START_MARKER);
+            header.v1.total_length = cpu_to_be32(ANTSDR_PACKET_HEADER_SIZE + current_fragment_size);
+            header.v1.payload_length = cpu_to_be32(current_fragment_size);
+            header.v1.frame_id = cpu_to_be32(current_frame_id);
+            header.v1.fragment_offset = cpu_to_be32(fragment_offset);
+            header.v1.fragment_count = cpu_to_be32(fragments_needed);
+            header.v1.fragment_index = cpu_to_be32(fragment_idx);
+            header.v1.frame_payload_total = cpu_to_be32(payload_len);
+            header.v1.missing_frame_count = cpu_to_be32(dma_dev->missing_frame_count);
+            header.v1.end_marker = cpu_to_be32(ANTSDR_PACKET_END_MARKER);
+        }
+        
+        switch (csum_mode) {
+        case ANTSDR_CSUM_PAYLOAD:
+            checksum = crc32(0, fragment, current_fragment_size);
+            break;
+        case ANTSDR_CSUM_HEADER:
+            checksum = antsdr_header_crc(&header, header_size);
+            break;
+        case ANTSDR_CSUM_NONE:
+            checksum = 0;
+            break;
+        }
+        header.v1.checksum = cpu_to_be32(checksum);  /* Same offset in v2 */
+
+        /* Send UDP packet */
+        iov[1].iov_base = (void *)fragment;
+        iov[1].iov_len = current_fragment_size;
+        
+        ret = antsdr_udp_send_datagram(dma_dev, iov, 2, header_size + current_fragment_size);
+        if (ret < 0) {
+            dev_err(dma_dev->dev, "UDP send error fragment %zu/%zu ret=%d\n",
+                    fragment_idx + 1, fragments_needed, ret);
+            return ret;
+        }
+        if (ret > 0) {
+            sent++;
+            dev_dbg(dma_dev->dev, "Sent UDP packet: frame_id=%u, fragment=%zu/%zu, size=%zu\n",
+                    current_frame_id, fragment_idx + 1, fragments_needed, current_fragment_size);
+        }
+        fragment_offset += current_fragment_size;
+    }
+
+    if (sent)
+        antsdr_lat_since(dma_dev, ANTSDR_LAT_SEND, timestamp_ns);
+    return sent;
+}
+
+/* Send the aggregated datagram being filled, if any. Caller holds agg_mutex.
+ * Returns the number of datagrams sent or a negative error.
+ */
+static int antsdr_agg_flush_locked(struct antsdr_dma_dev *dma_dev)
+{
+    struct antsdr_packet_header *common = (struct antsdr_packet_header *)dma_dev->agg_buffer;
+    unsigned int csum_mode = READ_ONCE(dma_dev->csum_mode);
+    uint32_t checksum = 0;
+    struct kvec iov;
+    size_t payload_len;
+    int ret;
+    
+    if (!dma_dev->agg_frames)
+        return 0;
+    
+    payload_len = dma_dev->agg_used - dma_dev->agg_header_size;
+    
+    if (dma_dev->agg_header_size == ANTSDR_PACKET_HEADER_V2_SIZE) {
+        struct antsdr_packet_header_v2 *header = (struct antsdr_packet_header_v2 *)dma_dev->agg_buffer;
+        
+        header->start_marker = cpu_to_be32(dma_dev->agg_compressed ? ANTSDR_AGG_START_MARKER_Z_V2 :
+                                                                     ANTSDR_AGG_START_MARKER_V2);
+        header->frame_id = cpu_to_be32(dma_dev->agg_first_frame_id);
+        header->frame_counter = cpu_to_be32(dma_dev->agg_first_counter);
+        header->timestamp_ns = cpu_to_be64(dma_dev->agg_first_ts);
+        header->payload_length = cpu_to_be16(payload_len);
+        header->fragment_offset = 0;
+        header->fragment_index = 0;
+        header->fragment_count = dma_dev->agg_frames;
+        header->flags = cpu_to_be16(antsdr_header_flags(dma_dev, csum_mode, dma_dev->agg_first_lo_tag));
+        header->frame_payload_total = cpu_to_be16(payload_len);
+        header->integration = cpu_to_be16(antsdr_header_integration(dma_dev));
+        header->missing_frame_count = cpu_to_be32(dma_dev->missing_frame_count);
+    } else {
+        struct antsdr_packet_header *header = (struct antsdr_packet_header *)dma_dev->agg_buffer;
+        
+        header->start_marker = cpu_to_be32(dma_dev->agg_compressed ? ANTSDR_AGG_START_MARKER_Z :
+                                                                     ANTSDR_AGG_START_MARKER);
+        header->total_length = cpu_to_be32(dma_dev->agg_used);
+        header->payload_length = cpu_to_be32(payload_len);
+        header->frame_id = cpu_to_be32(dma_dev->agg_first_frame_id);
+        header->fragment_offset = 0;
+        header->fragment_count = cpu_to_be32(dma_dev->agg_frames);
+        header->fragment_index = 0;
+        header->frame_payload_total = cpu_to_be32(payload_len);
+        header->missing_frame_count = cpu_to_be32(dma_dev->missing_frame_count);
+        header->end_marker = cpu_to_be32(ANTSDR_PACKET_END_MARKER);
+    }
+    
+    /* One datagram holds whole frames, so FRAME and PAYLOAD agree here */
+    if (csum_mode == ANTSDR_CSUM_PAYLOAD || csum_mode == ANTSDR_CSUM_FRAME)
+        checksum = crc32(0, dma_dev->agg_buffer + dma_dev->agg_header_size, payload_len);
+    else if (csum_mode == ANTSDR_CSUM_HEADER)
+        checksum = antsdr_header_crc(common, dma_dev->agg_header_size);
+    common->checksum = cpu_to_be32(checksum);
+    
+    iov.iov_base = dma_dev->agg_buffer;
+    iov.iov_len = dma_dev->agg_used;
+    ret = antsdr_udp_send_datagram(dma_dev, &iov, 1, iov.iov_len);
+    if (ret < 0)
+        dev_err(dma_dev->dev, "UDP send error, aggregate of %u frames ret=%d\n",
+                dma_dev->agg_frames, ret);
+    else if (ret > 0)
+        antsdr_lat_since(dma_dev, ANTSDR_LAT_SEND, dma_dev->agg_first_ts);
+    if (ret >= 0)
+        dev_dbg(dma_dev->dev, "Sent aggregate: first frame_id=%u, %u frames, size=%zu\n",
+                dma_dev->agg_first_frame_id, dma_dev->agg_frames, dma_dev->agg_used);
+    
+    dma_dev->agg_frames = 0;
+    dma_dev->agg_used = 0;
+    dma_dev->agg_compressed = false;
+    dma_dev->zpack_ref_len = 0;
+    return ret;
+}
+
+/* Code one frame payload into out (format above), against ref - the previous
+ * frame of the datagram, same length - or intra-frame when ref is NULL.
+ * Returns the coded length, or 0 if it would not be shorter than max.
+ */
+static size_t antsdr_zpack(const uint8_t *payload, size_t len, const uint8_t *ref,
+                           uint8_t *out, size_t max)
+{
+    const __le16 *cur = (const __le16 *)payload;
+    const __le16 *prev = (const __le16 *)ref;
+    unsigned int lanes = len / 2;
+    unsigned int b, i, cnt;
+    size_t o = ANTSDR_ZPACK_HEADER_SIZE;
+    uint16_t z[ANTSDR_ZPACK_BLOCK];
+    
+    if (len & 1 || max <= ANTSDR_ZPACK_HEADER_SIZE)
+        return 0;
+    
+    out[0] = len >> 8;
+    out[1] = len & 0xFF;
+    out[2] = prev ? 1 : 0;
+    
+    for (b = 0; b < lanes; b += cnt) {
+        uint16_t bits_or = 0;
+        unsigned int width, bits = 0;
+        uint32_t acc = 0;
+        
+        cnt = min(lanes - b, (unsigned int)ANTSDR_ZPACK_BLOCK);
+        for (i = 0; i < cnt; i++) {
+            unsigned int n = b + i;
+            uint16_t pred = prev ? le16_to_cpu(prev[n]) : (n >= 2 ? le16_to_cpu(cur[n - 2]) : 0);
+            int16_t r = (int16_t)(le16_to_cpu(cur[n]) - pred);
+            
+            z[i] = ((uint16_t)r << 1) ^ (uint16_t)(r >> 15);
+            bits_or |= z[i];
+        }
+        
+        width = fls(bits_or);
+        if (o + 1 + DIV_ROUND_UP(cnt * width, 8) >= max)
+            return 0;
+        out[o++] = width;
+        for (i = 0; i < cnt; i++) {
+            acc |= (uint32_t)z[i] << bits;
+            bits += width;
+            while (bits >= 8) {
+                out[o++] = acc & 0xFF;
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits)
+            out[o++] = acc & 0xFF;
+    }
+    
+    return o;
+}
+
+/* Code a frame for the aggregate being filled - against the previous frame
+ * when there is one of the same size. Returns the coded length, 0 to send raw.
+ */
+static size_t antsdr_agg_zpack_locked(struct antsdr_dma_dev *dma_dev, const uint8_t *payload, size_t payload_len)
+{
+    const uint8_t *ref = NULL;
+    u64 start = ktime_get_ns();
+    size_t zlen;
+    
+    if (dma_dev->agg_frames && dma_dev->zpack_ref_len == payload_len)
+        ref = dma_dev->zpack_ref;
+    zlen = antsdr_zpack(payload, payload_len, ref, dma_dev->zpack_buf, payload_len);
+    antsdr_stat_add(dma_dev, compress_ns, ktime_get_ns() - start);
+    return zlen;
+}
+
+/* Pack one frame into the aggregated datagram, sending the datagram first if
+ * the frame does not fit. Frames too large for any datagram go out fragmented
+ * as regular packets. Caller holds agg_mutex.
+ * Returns the number of datagrams sent or a negative error.
+ */
+static int antsdr_agg_add_locked(struct antsdr_dma_dev *dma_dev, const uint8_t *payload,
+                                 size_t payload_len, uint32_t frame_counter, uint64_t timestamp_ns)
+{
+    bool v2 = dma_dev->header_version == 2;
+    bool compress = dma_dev->compress_mode != ANTSDR_COMPRESS_OFF && dma_dev->zpack_buf;
+    size_t header_size = v2 ? ANTSDR_PACKET_HEADER_V2_SIZE : ANTSDR_PACKET_HEADER_SIZE;
+    size_t frame_header_size = v2 ? ANTSDR_AGG_FRAME_HEADER_V2_SIZE : ANTSDR_AGG_FRAME_HEADER_SIZE;
+    size_t zlen = 0, needed;
+    const uint8_t *data = payload;
+    uint16_t frame_flags;
+    int sent = 0;
+    int ret;
+    
+    /* Aggregation switched off while this frame was in flight */
+    if (!dma_dev->agg_enable || !dma_dev->agg_buffer)
+        return antsdr_udp_send_frame(dma_dev, payload, payload_len, frame_counter, timestamp_ns);
+    
+    if (compress)
+        zlen = antsdr_agg_zpack_locked(dma_dev, payload, payload_len);
+    needed = frame_header_size + (zlen ? zlen : payload_len);
+    
+    /* Flush whenever the frame won't fit, so frames keep their order on the
+     * wire - or when its v2 timestamp offset would not fit 32 bits
+     */
+    if (dma_dev->agg_frames &&
+        (dma_dev->agg_used + needed > dma_dev->agg_max_datagram ||
+         (v2 && timestamp_ns - dma_dev->agg_first_ts > U32_MAX))) {
+        bool inter = zlen && dma_dev->zpack_buf[2];
+        
+        ret = antsdr_agg_flush_locked(dma_dev);
+        if (ret < 0)
+            return ret;
+        sent += ret;
+        
+        /* It opens the next datagram, where its reference is gone */
+        if (inter) {
+            zlen = antsdr_agg_zpack_locked(dma_dev, payload, payload_len);
+            needed = frame_header_size + (zlen ? zlen : payload_len);
+        }
+    }
+    
+    if (header_size + needed > dma_dev->agg_max_datagram) {
+        ret = antsdr_udp_send_frame(dma_dev, payload, payload_len, frame_counter, timestamp_ns);
+        return ret < 0 ? ret : sent + ret;
+    }
+    
+    if (!dma_dev->agg_frames) {
+        dma_dev->agg_header_size = header_size;
+        dma_dev->agg_used = header_size;
+        dma_dev->agg_first_counter = frame_counter;
+        dma_dev->agg_first_ts = timestamp_ns;
+        dma_dev->agg_first_frame_id = dma_dev->frame_id_counter;
+        
+        /* Bound the latency of the first frame in the datagram */
+        if (dma_dev->agg_flush_timeout_us)
+            kthread_queue_delayed_work(dma_dev->udp_worker, &dma_dev->agg_flush_work,
+                                       usecs_to_jiffies(dma_dev->agg_flush_timeout_us));
+    }
+    
+    dma_dev->frame_id_counter++;
+    frame_flags = antsdr_lo_tag(dma_dev, timestamp_ns);
+    
+    if (!dma_dev->agg_frames)
+        dma_dev->agg_first_lo_tag = frame_flags;
+    frame_flags <<= ANTSDR_AGG_FRAME_LO_SHIFT;
+    if (zlen)
+        frame_flags |= ANTSDR_AGG_FRAME_COMPRESSED;
+    
+    if (v2) {
+        struct antsdr_agg_frame_header_v2 *frame_header =
+            (struct antsdr_agg_frame_header_v2 *)(dma_dev->agg_buffer + dma_dev->agg_used);
         
-        if (ret == sizeof(raw_frame)) {
-            /* Successfully queued, schedule frame processing work */
-            if (!dma_dev->frame_work_pending) {
-                dma_dev->frame_work_pending = true;
-                queue_work(dma_dev->frame_workqueue, &dma_dev->frame_work);
-            }
-            antsdr_debug_log(dma_dev->dev, "DMA callback: Queued %zu bytes for frame processing\n", transfer_size);
-        } else {
-            /* Failed to queue - free the allocated memory */
-            kfree(raw_frame.data);
-            dev_warn_ratelimited(dma_dev->dev, "Raw frame FIFO full, dropping %zu bytes\n", transfer_size);
-            spin_lock_irqsave(&dma_dev->lock, flags);
-            dma_dev->stats.errors++;
-            spin_unlock_irqrestore(&dma_dev->lock, flags);
-        }
+        frame_header->frame_counter = cpu_to_be32(frame_counter);
+        frame_header->length = cpu_to_be16(needed - frame_header_size);
+        frame_header->flags = cpu_to_be16(frame_flags);
+        frame_header->timestamp_offset_ns = cpu_to_be32((uint32_t)(timestamp_ns - dma_dev->agg_first_ts));
     } else {
-        antsdr_debug_log(dma_dev->dev, "DMA callback: UDP destination not set or invalid size, dropping data\n");
+        struct antsdr_agg_frame_header *frame_header =
+            (struct antsdr_agg_frame_header *)(dma_dev->agg_buffer + dma_dev->agg_used);
+        
+        frame_header->frame_counter = cpu_to_be32(frame_counter);
+        frame_header->length = cpu_to_be16(needed - frame_header_size);
+        frame_header->flags = cpu_to_be16(frame_flags);
+    }
+    if (zlen) {
+        data = dma_dev->zpack_buf;
+        dma_dev->agg_compressed = true;
+    }
+    memcpy(dma_dev->agg_buffer + dma_dev->agg_used + frame_header_size, data, needed - frame_header_size);
+    
+    /* The next frame is coded against this one */
+    if (compress) {
+        memcpy(dma_dev->zpack_ref, payload, payload_len);
+        dma_dev->zpack_ref_len = payload_len;
+        antsdr_stat_add(dma_dev, compress_in_bytes, payload_len);
+        antsdr_stat_add(dma_dev, compress_out_bytes, needed - frame_header_size);
     }
     
-skip_frame_processing:
-    spin_lock_irqsave(&dma_dev->lock, flags);
+    dma_dev->agg_used += needed;
+    dma_dev->agg_frames++;
     
-    /* Check if we're still streaming before submitting next transfer */
-    antsdr_debug_log(dma_dev->dev, "DMA callback: Checking streaming state = %s\n", 
-             dma_dev->streaming ? "true" : "false");
+    return sent;
+}
+
+/* Flush timeout expired - send whatever has been aggregated so far */
+static void antsdr_agg_flush_work(struct kthread_work *work)
+{
+    struct antsdr_dma_dev *dma_dev = container_of(work, struct antsdr_dma_dev, agg_flush_work.work);
     
-    if (!dma_dev->streaming) {
-        antsdr_debug_log(dma_dev->dev, "DMA callback: Stopping - streaming=false, completing DMA\n");
-        spin_unlock_irqrestore(&dma_dev->lock, flags);
-        complete(&dma_dev->dma_complete);
-        return;
+    mutex_lock(&dma_dev->agg_mutex);
+    antsdr_agg_flush_locked(dma_dev);
+    mutex_unlock(&dma_dev->agg_mutex);
+}
+
+/* Apply ANTSDR_IOC_SET_AGGREGATION settings, sending any datagram being filled first */
+static int antsdr_set_aggregation(struct antsdr_dma_dev *dma_dev, const struct antsdr_aggregation *agg)
+{
+    unsigned int mtu = agg->mtu ? agg->mtu : ANTSDR_AGG_DEFAULT_MTU;
+    uint8_t *buffer = NULL;
+    uint8_t *old_buffer;
+    
+    if (agg->enable) {
+        if (mtu < ANTSDR_AGG_MIN_MTU || mtu > ANTSDR_AGG_MAX_MTU) {
+            dev_err(dma_dev->dev, "Invalid aggregation MTU %u (%u-%u)\n",
+                    mtu, ANTSDR_AGG_MIN_MTU, ANTSDR_AGG_MAX_MTU);
+            return -EINVAL;
+        }
+        if (agg->flush_timeout_us > ANTSDR_AGG_MAX_FLUSH_US) {
+            dev_err(dma_dev->dev, "Invalid aggregation flush timeout %u us (max %u)\n",
+                    agg->flush_timeout_us, ANTSDR_AGG_MAX_FLUSH_US);
+            return -EINVAL;
+        }
+        
+        buffer = kmalloc(mtu - ANTSDR_UDP_IP_OVERHEAD, GFP_KERNEL);
+        if (!buffer)
+            return -ENOMEM;
     }
     
-    antsdr_debug_log(dma_dev->dev, "DMA callback: Continuing - streaming=true, submitting next transfer\n");
+    mutex_lock(&dma_dev->agg_mutex);
+    antsdr_agg_flush_locked(dma_dev);
+    old_buffer = dma_dev->agg_buffer;
+    dma_dev->agg_buffer = buffer;
+    dma_dev->agg_max_datagram = mtu - ANTSDR_UDP_IP_OVERHEAD;
+    dma_dev->agg_flush_timeout_us = agg->flush_timeout_us;
+    dma_dev->agg_enable = agg->enable ? true : false;
+    mutex_unlock(&dma_dev->agg_mutex);
+    
+    kfree(old_buffer);
+    
+    if (dma_dev->agg_enable)
+        dev_info(dma_dev->dev, "Frame aggregation enabled: MTU %u (%zu byte datagrams), flush timeout %u us\n",
+                 mtu, dma_dev->agg_max_datagram, dma_dev->agg_flush_timeout_us);
+    else
+        dev_info(dma_dev->dev, "Frame aggregation disabled\n");
+    return 0;
+}
+
+/* Apply ANTSDR_IOC_SET_HEADER - the aggregate being filled goes out in the
+ * old format first
+ */
+static int antsdr_set_header(struct antsdr_dma_dev *dma_dev, const struct antsdr_header_config *cfg)
+{
+    unsigned int version = cfg->version ? cfg->version : ANTSDR_PROTOCOL_VERSION;
+    unsigned long flags;
     
-    /* Move to next buffer for continuous streaming */
-    dma_dev->current_buffer = (dma_dev->current_buffer + 1) % NUM_BUFFERS;
+    if (version != 1 && version != 2) {
+        dev_err(dma_dev->dev, "Invalid packet header version %u (1 or 2)\n", version);
+        return -EINVAL;
+    }
+    if (cfg->clock > ANTSDR_CLOCK_TAI) {
+        dev_err(dma_dev->dev, "Invalid timestamp clock %u\n", cfg->clock);
+        return -EINVAL;
+    }
     
+    mutex_lock(&dma_dev->agg_mutex);
+    antsdr_agg_flush_locked(dma_dev);
+    dma_dev->header_version = version;
+    spin_lock_irqsave(&dma_dev->lock, flags);
+    dma_dev->ts_clock = cfg->clock;
+    /* Recall times are on the old clock - keep the settled tag only */
+    write_seqcount_begin(&dma_dev->lo_seq);
+    dma_dev->lo_begin_ns = 0;
+    dma_dev->lo_end_ns = 0;
+    write_seqcount_end(&dma_dev->lo_seq);
     spin_unlock_irqrestore(&dma_dev->lock, flags);
+    mutex_unlock(&dma_dev->agg_mutex);
     
-    /* Wake up any waiting processes */
-    wake_up_interruptible(&dma_dev->wait_queue);
+    dev_info(dma_dev->dev, "Packet header version %u, timestamps from %s\n", version,
+             cfg->clock == ANTSDR_CLOCK_REALTIME ? "CLOCK_REALTIME" :
+             cfg->clock == ANTSDR_CLOCK_TAI ? "CLOCK_TAI" : "CLOCK_MONOTONIC");
+    return 0;
+}
+
+/* Apply ANTSDR_IOC_SET_LO_PROFILE and report where the frame path stands.
+ * An END or CLEAR without a BEGIN switches the tag at the time of the call.
+ */
+static int antsdr_set_lo_profile(struct antsdr_dma_dev *dma_dev, struct antsdr_lo_profile *lp)
+{
+    unsigned long flags;
+    u64 now;
     
-    /* Submit next transfer for continuous streaming */
-    ret = antsdr_submit_dma_transfer(dma_dev);
-    if (ret) {
-        dev_err(dma_dev->dev, "Failed to submit next DMA transfer: %d, performing reset\n", ret);
-        spin_lock_irqsave(&dma_dev->lock, flags);
-        dma_dev->stats.errors++;
-        /* Check streaming state again before reset - avoid race condition */
-        if (dma_dev->streaming) {
-            spin_unlock_irqrestore(&dma_dev->lock, flags);
-            /* Reset and restart DMA on error */
-            antsdr_dma_reset_and_restart(dma_dev);
-        } else {
-            spin_unlock_irqrestore(&dma_dev->lock, flags);
-            dev_info(dma_dev->dev, "Not performing reset - streaming already stopped\n");
+    if (lp->phase > ANTSDR_LO_CLEAR)
+        return -EINVAL;
+    if (lp->phase == ANTSDR_LO_END && lp->profile >= ANTSDR_LO_PROFILES) {
+        dev_err(dma_dev->dev, "Invalid LO profile %u (0-%u)\n", lp->profile, ANTSDR_LO_PROFILES - 1);
+        return -EINVAL;
+    }
+    
+    spin_lock_irqsave(&dma_dev->lock, flags);
+    now = antsdr_capture_time(dma_dev);
+    write_seqcount_begin(&dma_dev->lo_seq);
+    switch (lp->phase) {
+    case ANTSDR_LO_BEGIN:
+        /* A recall that never ended leaves nothing to fall back to */
+        dma_dev->lo_tag_prev = dma_dev->lo_end_ns == U64_MAX ? 0 : dma_dev->lo_tag;
+        dma_dev->lo_begin_ns = now;
+        dma_dev->lo_end_ns = U64_MAX;
+        break;
+    case ANTSDR_LO_END:
+    case ANTSDR_LO_CLEAR:
+        if (dma_dev->lo_end_ns != U64_MAX) {
+            dma_dev->lo_tag_prev = dma_dev->lo_tag;
+            dma_dev->lo_begin_ns = now;
         }
-        return;
+        dma_dev->lo_tag = lp->phase == ANTSDR_LO_END ? ANTSDR_LO_TAG_VALID | lp->profile : 0;
+        dma_dev->lo_end_ns = now;
+        break;
+    default:
+        break;
     }
+    write_seqcount_end(&dma_dev->lo_seq);
+    lp->tag = dma_dev->lo_end_ns == U64_MAX ? 0 : dma_dev->lo_tag;
+    spin_unlock_irqrestore(&dma_dev->lock, flags);
     
-    /* Complete the DMA operation */
-    complete(&dma_dev->dma_complete);
+    lp->frame_counter = READ_ONCE(dma_dev->last_frame_counter);
+    lp->timestamp_ns = now;
+    return 0;
 }
 
-/* Frame processing work function - runs in separate thread context */
-static void antsdr_frame_work(struct work_struct *work)
+/* Apply ANTSDR_IOC_SET_CHECKSUM - like the header version, the aggregate
+ * being filled goes out under the old mode first
+ */
+static int antsdr_set_checksum(struct antsdr_dma_dev *dma_dev, unsigned int mode)
 {
-    struct antsdr_dma_dev *dma_dev = container_of(work, struct antsdr_dma_dev, frame_work);
-    struct antsdr_raw_frame raw_frame;
-    unsigned long flags;
-    uint8_t *payload;
-    size_t payload_len;
-    int ret;
-    int processed_frames = 0;
+    static const char * const names[] = {
+        [ANTSDR_CSUM_PAYLOAD] = "CRC32 per datagram",
+        [ANTSDR_CSUM_NONE] = "none",
+        [ANTSDR_CSUM_HEADER] = "header only",
+        [ANTSDR_CSUM_FRAME] = "CRC32 per frame",
+    };
+    
+    if (mode > ANTSDR_CSUM_FRAME) {
+        dev_err(dma_dev->dev, "Invalid checksum mode %u\n", mode);
+        return -EINVAL;
+    }
     
-    antsdr_debug_log(dma_dev->dev, "Frame work function started\n");
+    mutex_lock(&dma_dev->agg_mutex);
+    antsdr_agg_flush_locked(dma_dev);
+    WRITE_ONCE(dma_dev->csum_mode, mode);
+    mutex_unlock(&dma_dev->agg_mutex);
     
-    /* Process up to 50 frames per work invocation for high throughput (increased from 10) */
-    while (processed_frames < 50) {
-        /* Get raw frame from FIFO */
-        spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
-        ret = kfifo_out(&dma_dev->raw_frame_fifo, &raw_frame, sizeof(raw_frame));
-        spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
-        
-        if (ret != sizeof(raw_frame)) {
-            /* No more frames to process */
-            break;
-        }
-        
-        processed_frames++;
-        antsdr_debug_log(dma_dev->dev, "Frame work: Processing frame %d (%zu bytes)\n", 
-                processed_frames, raw_frame.data_len);
-        
-        /* Parse the FPGA frame to extract valid payload */
-        ret = antsdr_parse_fpga_frame(dma_dev, raw_frame.data, raw_frame.data_len, &payload, &payload_len);
-        
-        /* Free the allocated frame data after processing - prevents memory leak */
-        kfree(raw_frame.data);
-        
-        if (ret == 0) {
-            antsdr_debug_log(dma_dev->dev, "Frame work: Valid frame found, extracted %zu payload bytes\n", payload_len);
-            
-            /* Valid frame found - queue the extracted payload for UDP transmission */
-            ret = antsdr_ring_put(dma_dev, payload, payload_len);
-            if (ret == 0) {
-                /* Successfully queued, schedule UDP work */
-                if (!dma_dev->udp_work_pending) {
-                    dma_dev->udp_work_pending = true;
-                    schedule_work(&dma_dev->udp_work);
-                }
-                
-                spin_lock_irqsave(&dma_dev->lock, flags);
-                dma_dev->stats.valid_frames++;
-                dma_dev->stats.extracted_frames++;
-                spin_unlock_irqrestore(&dma_dev->lock, flags);
-                
-                antsdr_debug_log(dma_dev->dev, "Frame work: Queued %zu payload bytes, scheduling UDP work\n", payload_len);
-            } else {
-                dev_warn_ratelimited(dma_dev->dev, "Ring buffer full, dropping valid frame\n");
-                spin_lock_irqsave(&dma_dev->lock, flags);
-                dma_dev->stats.errors++;
-                spin_unlock_irqrestore(&dma_dev->lock, flags);
-            }
-        } else {
-            antsdr_debug_log(dma_dev->dev, "Frame work: Invalid FPGA frame detected, dropping %zu bytes\n", raw_frame.data_len);
-            /* Invalid frame - update stats but don't queue */
-            spin_lock_irqsave(&dma_dev->lock, flags);
-            dma_dev->stats.invalid_frames++;
-            spin_unlock_irqrestore(&dma_dev->lock, flags);
-        }
+    dev_info(dma_dev->dev, "Payload checksum: %s\n", names[mode]);
+    if (mode != ANTSDR_CSUM_PAYLOAD && dma_dev->header_version == 1)
+        dev_warn(dma_dev->dev, "Version 1 headers do not advertise the checksum mode\n");
+    return 0;
+}
+
+/* Apply ANTSDR_IOC_SET_COMPRESSION - the aggregate being filled goes out
+ * under the old mode first
+ */
+static int antsdr_set_compression(struct antsdr_dma_dev *dma_dev, unsigned int mode)
+{
+    uint8_t *buffer = NULL;
+    
+    if (mode > ANTSDR_COMPRESS_DELTA) {
+        dev_err(dma_dev->dev, "Invalid compression mode %u\n", mode);
+        return -EINVAL;
     }
     
-    /* Check if there are more frames to process */
-    spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
-    if (!kfifo_is_empty(&dma_dev->raw_frame_fifo)) {
-        /* More frames available, reschedule work */
-        queue_work(dma_dev->frame_workqueue, &dma_dev->frame_work);
-        antsdr_debug_log(dma_dev->dev, "Frame work: Rescheduling - more frames available\n");
+    /* Scratch for one coded frame and the reference copy, the largest payload each */
+    if (mode != ANTSDR_COMPRESS_OFF && !dma_dev->zpack_buf) {
+        buffer = kmalloc(2 * FPGA_LONG_PAYLOAD_BYTES, GFP_KERNEL);
+        if (!buffer)
+            return -ENOMEM;
+    }
+    
+    mutex_lock(&dma_dev->agg_mutex);
+    antsdr_agg_flush_locked(dma_dev);
+    if (buffer) {
+        dma_dev->zpack_buf = buffer;
+        dma_dev->zpack_ref = buffer + FPGA_LONG_PAYLOAD_BYTES;
+    }
+    dma_dev->compress_mode = mode;
+    mutex_unlock(&dma_dev->agg_mutex);
+    
+    if (mode == ANTSDR_COMPRESS_OFF) {
+        dev_info(dma_dev->dev, "Aggregate compression disabled\n");
     } else {
-        /* No more frames, clear pending flag */
-        dma_dev->frame_work_pending = false;
-        antsdr_debug_log(dma_dev->dev, "Frame work: Completed - processed %d frames\n", processed_frames);
+        dev_info(dma_dev->dev, "Aggregate compression: delta + bit-packing\n");
+        if (!dma_dev->agg_enable)
+            dev_warn(dma_dev->dev, "Compression only applies to aggregated datagrams, enable aggregation\n");
     }
-    spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
+    return 0;
 }
 
-static void antsdr_udp_work(struct work_struct *work)
+static void antsdr_udp_work(struct kthread_work *work)
 {
     struct antsdr_dma_dev *dma_dev = container_of(work, struct antsdr_dma_dev, udp_work);
-    unsigned char *packet_buffer;
-    struct antsdr_packet_header *header;
-    unsigned char *packet_payload;
-    struct msghdr msg;
-    struct kvec iov;
     int ret;
     unsigned long flags;
     int packets_sent = 0; /* Limit work per invocation */
 
-    packet_buffer = kmalloc(UDP_PACKET_SIZE, GFP_KERNEL);
-    if (!packet_buffer) {
-        dev_err(dma_dev->dev, "Failed to allocate UDP packet buffer\n");
-        goto reset_flag_simple;
-    }
-    header = (struct antsdr_packet_header *)packet_buffer;
-    packet_payload = packet_buffer + ANTSDR_PACKET_HEADER_SIZE;
-
     while (packets_sent < 200) { /* Increased packet limit from 50 to 200 for higher throughput */
         void *ring_data;
         size_t ring_size;
-        size_t payload_len;
-        uint32_t current_frame_id;
-        size_t fragments_needed, fragment_offset = 0;
+        uint32_t frame_counter;
+        uint64_t timestamp_ns;
 
-        ret = antsdr_ring_get(dma_dev, &ring_data, &ring_size);
+        ret = antsdr_ring_get(dma_dev, ANTSDR_CONSUMER_UDP, &ring_data, &ring_size, &frame_counter, &timestamp_ns);
         if (ret != 0)
             break; /* No more payload data */
 
         /* The ring now contains extracted payload data, not raw DMA data */
-        payload_len = ring_size;
-        
-        /* Return ring buffer early */
-        antsdr_ring_return_buffer(dma_dev);
-
-        /* Fragment the payload if it's larger than max packet size */
-        fragments_needed = (payload_len + ANTSDR_MAX_PAYLOAD_SIZE - 1) / ANTSDR_MAX_PAYLOAD_SIZE;
+        if (dma_dev->agg_enable) {
+            mutex_lock(&dma_dev->agg_mutex);
+            ret = antsdr_agg_add_locked(dma_dev, ring_data, ring_size, frame_counter, timestamp_ns);
+            mutex_unlock(&dma_dev->agg_mutex);
+        } else {
+            ret = antsdr_udp_send_frame(dma_dev, ring_data, ring_size, frame_counter, timestamp_ns);
+        }
 
-        spin_lock_irqsave(&dma_dev->lock, flags);
-        current_frame_id = dma_dev->frame_id_counter++;
-        spin_unlock_irqrestore(&dma_dev->lock, flags);
+        /* kernel_sendmsg() has copied the payload into the skb (or it was packed
+         * into the aggregate) - the record, and in zero-copy mode its DMA buffer,
+         * can be recycled now.
+         */
+        antsdr_ring_return_buffer(dma_dev, ANTSDR_CONSUMER_UDP);
 
-        for (size_t fragment_idx = 0; fragment_idx < fragments_needed; fragment_idx++) {
-            size_t current_fragment_size = min(payload_len - fragment_offset,
-                                              (size_t)ANTSDR_MAX_PAYLOAD_SIZE);
-            
-            /* Copy payload fragment to packet buffer */
-            memcpy(packet_payload, (uint8_t *)ring_data + fragment_offset, current_fragment_size);
-
-            /* Build packet header */
-            header->start_marker = cpu_to_be32(ANTSDR_PACKET_START_MARKER);
-            header->sequence_number = cpu_to_be32(dma_dev->packet_sequence_number++);
-            header->total_length = cpu_to_be32(ANTSDR_PACKET_HEADER_SIZE + current_fragment_size);
-            header->payload_length = cpu_to_be32(current_fragment_size);
-            header->frame_id = cpu_to_be32(current_frame_id);
-            header->fragment_offset = cpu_to_be32(fragment_offset);
-            header->fragment_count = cpu_to_be32(fragments_needed);
-            header->fragment_index = cpu_to_be32(fragment_idx);
-            header->frame_payload_total = cpu_to_be32(payload_len);
-            header->missing_frame_count = cpu_to_be32(dma_dev->missing_frame_count);
-            header->checksum = cpu_to_be32(crc32(0, packet_payload, current_fragment_size));
-            header->end_marker = cpu_to_be32(ANTSDR_PACKET_END_MARKER);
-
-            /* Send UDP packet */
-            if (dma_dev->sock && dma_dev->dest_set) {
-                memset(&msg, 0, sizeof(msg));
-                iov.iov_base = packet_buffer;
-                iov.iov_len = ANTSDR_PACKET_HEADER_SIZE + current_fragment_size;
-                msg.msg_name = &dma_dev->dest_addr;
-                msg.msg_namelen = sizeof(dma_dev->dest_addr);
-                
-                ret = kernel_sendmsg(dma_dev->sock, &msg, &iov, 1, iov.iov_len);
-                if (ret > 0) {
-                    spin_lock_irqsave(&dma_dev->lock, flags);
-                    dma_dev->stats.udp_packets_sent++;
-                    spin_unlock_irqrestore(&dma_dev->lock, flags);
-                    packets_sent++;
-                    
-                    dev_dbg(dma_dev->dev, "Sent UDP packet: frame_id=%u, fragment=%zu/%zu, size=%zu\n",
-                            current_frame_id, fragment_idx + 1, fragments_needed, current_fragment_size);
-                } else {
-                    dev_err(dma_dev->dev, "UDP send error fragment %zu/%zu ret=%d\n",
-                            fragment_idx + 1, fragments_needed, ret);
-                    spin_lock_irqsave(&dma_dev->lock, flags);
-                    dma_dev->stats.errors++;
-                    spin_unlock_irqrestore(&dma_dev->lock, flags);
-                    goto loop_end;
-                }
-            }
-            fragment_offset += current_fragment_size;
-        }
+        /* A failed datagram is already accounted as dropped - carry on with
+         * the rest, still counting it against the per-invocation limit
+         */
+        packets_sent += ret > 0 ? ret : 1;
     }
 
-loop_end:
-    kfree(packet_buffer);
+    /* Without a flush timeout the aggregate goes out once the ring is drained */
+    if (dma_dev->agg_enable && !dma_dev->agg_flush_timeout_us) {
+        mutex_lock(&dma_dev->agg_mutex);
+        antsdr_agg_flush_locked(dma_dev);
+        mutex_unlock(&dma_dev->agg_mutex);
+    }
 
     /* Check if more data is available and reschedule if needed */
     spin_lock_irqsave(&dma_dev->lock, flags);
-    if (dma_dev->ring_count > 0) {
-        schedule_work(&dma_dev->udp_work);
+    if (dma_dev->cursors[ANTSDR_CONSUMER_UDP].count > 0) {
+        kthread_queue_work(dma_dev->udp_worker, &dma_dev->udp_work);
     } else {
         dma_dev->udp_work_pending = false;
     }
     spin_unlock_irqrestore(&dma_dev->lock, flags);
-    return;
-
-reset_flag_simple:
-    spin_lock_irqsave(&dma_dev->lock, flags);
-    dma_dev->udp_work_pending = false;
-    spin_unlock_irqrestore(&dma_dev->lock, flags);
 }
 
-static int antsdr_submit_dma_transfer(struct antsdr_dma_dev *dma_dev)
+/* Data generation enable. A line shared by several channels goes high with
+ * the first channel that streams and low again with the last one.
+ */
+static void antsdr_set_enable(struct antsdr_dma_dev *dma_dev, bool on)
 {
-    struct dma_async_tx_descriptor *desc;
-    dma_cookie_t cookie;
-    size_t transfer_size;
-    dma_addr_t dma_handle;
-    enum dma_status status;
-    void *buffer;
-    struct dma_slave_config config;
-    int ret;
+    struct antsdr_dma_board *board = dma_dev->board;
+    unsigned long flags;
     
-    if (!dma_dev->rx_chan) {
-        dev_err(dma_dev->dev, "No DMA channel available\n");
-        return -ENODEV;
+    if (dma_dev->gpio_enable != board->gpio_enable) {
+        gpiod_set_value(dma_dev->gpio_enable, on);
+        return;
     }
     
-    /* Get transfer parameters based on current pulse mode */
-    transfer_size = antsdr_get_transfer_size(dma_dev);
-    buffer = antsdr_get_current_buffer(dma_dev);
-    dma_handle = antsdr_get_current_handle(dma_dev);
-    
-    /* Check current DMA status and terminate any pending operations */
-    status = dmaengine_tx_status(dma_dev->rx_chan, 0, NULL);
-    if (status == DMA_ERROR) {
-        dev_warn(dma_dev->dev, "DMA channel in error state (%d), terminating\n", status);
-        ret = dmaengine_terminate_all(dma_dev->rx_chan);
-        if (ret) {
-            dev_err(dma_dev->dev, "Failed to terminate DMA channel: %d\n", ret);
-        }
-        /* Minimal delay for error recovery */
-        udelay(10);  /* Reduced from 100μs to 10μs for high-speed operation */
+    spin_lock_irqsave(&board->enable_lock, flags);
+    if (on != dma_dev->enable_held) {
+        dma_dev->enable_held = on;
+        if (on ? board->enable_users++ == 0 : --board->enable_users == 0)
+            gpiod_set_value(board->gpio_enable, on);
     }
+    spin_unlock_irqrestore(&board->enable_lock, flags);
+}
+
+/* Configure DMA channel for S2MM (Stream to Memory Mapped) transfers - once per stream start */
+static int antsdr_dma_configure_channel(struct antsdr_dma_dev *dma_dev)
+{
+    struct dma_slave_config config;
+    int ret;
     
-    /* Skip unnecessary DMA resets for performance - only on errors */
-    /* Wait for FIFO flush and DMA engine reset - minimized for speed */
-    /* udelay(20); */ /* Removed 20μs delay to improve throughput */
-    
-    /* Configure DMA channel for S2MM (Stream to Memory Mapped) transfers */
     memset(&config, 0, sizeof(config));
     config.direction = DMA_DEV_TO_MEM;
     config.src_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES;  /* 32-bit transfers */
@@ -1299,14 +4739,28 @@ static int antsdr_submit_dma_transfer(struct antsdr_dma_dev *dma_dev)
         return ret;
     }
     
-    /* Ensure buffer is properly aligned and cleared */
+    return 0;
+}
+
+/* Prepare and submit one S2MM descriptor on buffer 'index' (not issued yet).
+ * Caller holds dma_dev->dma_queue_lock.
+ */
+static int antsdr_queue_dma_buffer(struct antsdr_dma_dev *dma_dev, unsigned int index)
+{
+    struct dma_async_tx_descriptor *desc;
+    dma_cookie_t cookie;
+    size_t transfer_size = antsdr_get_transfer_size(dma_dev);
+    dma_addr_t dma_handle = antsdr_get_dma_handle(dma_dev, index);
+    bool irq = !READ_ONCE(dma_dev->poll_active);
+    
+    /* Ensure buffer is properly aligned */
     if ((unsigned long)dma_handle & 0x3F) {
-        dev_warn(dma_dev->dev, "Buffer %d not 64-byte aligned: 0x%llx\n", 
-                 dma_dev->current_buffer, (unsigned long long)dma_handle);
+        dev_warn(dma_dev->dev, "Buffer %u not 64-byte aligned: 0x%llx\n", 
+                 index, (unsigned long long)dma_handle);
     }
     
-    dev_dbg(dma_dev->dev, "Starting DMA transfer - pulse_mode: %d, size: %zu bytes, buffer: %d\n",
-            dma_dev->pulse_mode, transfer_size, dma_dev->current_buffer);
+    dev_dbg(dma_dev->dev, "Arming DMA transfer - pulse_mode: %d, size: %zu bytes, buffer: %u\n",
+            dma_dev->pulse_mode, transfer_size, index);
     
     /* Ensure cache coherency before DMA transfer */
     dma_sync_single_for_device(dma_dev->rx_chan->device->dev,
@@ -1314,41 +4768,240 @@ static int antsdr_submit_dma_transfer(struct antsdr_dma_dev *dma_dev)
                               transfer_size,
                               DMA_FROM_DEVICE);
     
-    /* Prepare DMA transfer - use DMA_MEM_TO_MEM for simple transfers */
     desc = dmaengine_prep_slave_single(dma_dev->rx_chan,
                                        dma_handle,
                                        transfer_size,
                                        DMA_DEV_TO_MEM,
-                                       DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+                                       irq ? DMA_PREP_INTERRUPT | DMA_CTRL_ACK : DMA_CTRL_ACK);
     if (!desc) {
         dev_err(dma_dev->dev, "Failed to prepare DMA transfer (size=%zu)\n", transfer_size);
         return -ENOMEM;
     }
     
-    /* Set callback */
-    desc->callback = antsdr_dma_callback;
+    /* Set callback - in polling mode the poller retires the transfer instead */
+    desc->callback = irq ? antsdr_dma_callback : NULL;
     desc->callback_param = dma_dev;
     
-    /* Submit transfer */
-    cookie = dmaengine_submit(desc);
-    if (dma_submit_error(cookie)) {
-        dev_err(dma_dev->dev, "Failed to submit DMA transfer\n");
-        return -EIO;
+    /* Submit transfer */
+    cookie = dmaengine_submit(desc);
+    if (dma_submit_error(cookie)) {
+        dev_err(dma_dev->dev, "Failed to submit DMA transfer\n");
+        return -EIO;
+    }
+    dma_dev->dma_cookies[index] = cookie;
+    dma_dev->dma_has_callback[index] = irq;
+    if (!irq)
+        dma_dev->dma_poll_armed++;
+    
+    return 0;
+}
+
+/* Keep dma_queue_depth descriptors armed: submit buffers from the free list
+ * until the queue is full (or no buffer is free), then issue them in one go.
+ */
+static int antsdr_submit_dma_transfer(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned long flags;
+    unsigned int index;
+    int queued = 0;
+    int ret = 0;
+    
+    if (!dma_dev->rx_chan) {
+        dev_err(dma_dev->dev, "No DMA channel available\n");
+        return -ENODEV;
+    }
+    
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    while (!dma_dev->dma_draining && dma_dev->dma_inflight < dma_dev->dma_queue_depth &&
+           dma_dev->dma_free_count > 0) {
+        index = dma_dev->dma_free[dma_dev->dma_free_head];
+        ret = antsdr_queue_dma_buffer(dma_dev, index);
+        if (ret)
+            break;
+        dma_dev->dma_free_head = (dma_dev->dma_free_head + 1) % dma_dev->dma_nr_buffers;
+        dma_dev->dma_free_count--;
+        dma_dev->dma_armed[(dma_dev->current_buffer + dma_dev->dma_inflight) % dma_dev->dma_nr_buffers] = index;
+        dma_dev->dma_inflight++;
+        queued++;
+    }
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+    
+    if (queued) {
+        /* Reinitialize completion */
+        reinit_completion(&dma_dev->dma_complete);
+        /* Start transfer */
+        dma_async_issue_pending(dma_dev->rx_chan);
+    }
+    
+    return ret;
+}
+
+/* Armed queue empty? */
+static bool antsdr_dma_drained(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned long flags;
+    bool drained;
+    
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    drained = dma_dev->dma_inflight == 0;
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+    return drained;
+}
+
+/* Let the parse thread finish every raw frame already queued */
+static void antsdr_frame_work_drain(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned long flags;
+    bool idle;
+    
+    for (;;) {
+        spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
+        idle = !dma_dev->frame_work_pending && kfifo_is_empty(&dma_dev->raw_frame_fifo);
+        spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
+        if (idle)
+            break;
+        kthread_queue_work(dma_dev->frame_worker, &dma_dev->frame_work);
+        kthread_flush_work(&dma_dev->frame_work);
+    }
+}
+
+/* Switch pulse mode at a frame boundary without ending the stream: stop
+ * arming, let the armed transfers complete (terminating what is left after
+ * ANTSDR_PULSE_SWITCH_DRAIN_MS), parse them with the old frame size, then
+ * re-slice the pool, flip the GPIO and re-arm.
+ */
+static int antsdr_dma_switch_pulse_mode(struct antsdr_dma_dev *dma_dev, uint32_t pulse_mode)
+{
+    u64 start_ns = ktime_get_ns();
+    unsigned long flags;
+    bool terminated = false;
+    bool busy = false;
+    u64 elapsed;
+    int i, ret = 0;
+    
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    if (dma_dev->dma_draining)
+        busy = true;
+    dma_dev->dma_draining = true;
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+    if (busy)
+        return -EBUSY;
+    
+    if (!wait_event_timeout(dma_dev->drain_wait, antsdr_dma_drained(dma_dev),
+                            msecs_to_jiffies(ANTSDR_PULSE_SWITCH_DRAIN_MS))) {
+        /* No data arriving (e.g. TDD idle) - abandon the partly filled queue */
+        dmaengine_terminate_sync(dma_dev->rx_chan);
+        antsdr_dma_drop_armed(dma_dev);
+        terminated = true;
+    }
+    
+    /* Everything received so far is parsed with the old frame size, a block
+     * of old-size frames can't be finished
+     */
+    antsdr_frame_work_drain(dma_dev);
+    dma_dev->integ_count = 0;
+    
+    /* Zero-copy: queued payloads still sit in slots of the old layout - send
+     * what the UDP thread gets to, then drop the rest
+     */
+    if (dma_dev->zero_copy) {
+        for (i = 0; i < 8 && dma_dev->cursors[ANTSDR_CONSUMER_UDP].count; i++)
+            kthread_flush_work(&dma_dev->udp_work);
+        kthread_cancel_work_sync(&dma_dev->udp_work);
+        dma_dev->udp_work_pending = false;
+        mutex_lock(&dma_dev->read_mutex);
+        antsdr_ring_flush(dma_dev);
+        mutex_unlock(&dma_dev->read_mutex);
+        
+        spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+        busy = dma_dev->dma_free_count != dma_dev->dma_nr_buffers;
+        spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+        if (busy) {
+            dev_warn(dma_dev->dev, "DMA buffers still held, keeping pulse mode %d\n", dma_dev->pulse_mode);
+            ret = -EBUSY;
+            goto rearm;
+        }
+    }
+    
+    dma_dev->pulse_mode = pulse_mode;
+    antsdr_resync_reset(dma_dev);
+    antsdr_dma_reset_buffer_queue(dma_dev);
+    if (dma_dev->gpio_pulse_mode)
+        gpiod_set_value(dma_dev->gpio_pulse_mode, dma_dev->pulse_mode);
+    
+rearm:
+    spin_lock_irqsave(&dma_dev->dma_queue_lock, flags);
+    dma_dev->dma_draining = false;
+    spin_unlock_irqrestore(&dma_dev->dma_queue_lock, flags);
+    
+    if (dma_dev->streaming) {
+        if (terminated)
+            antsdr_dma_configure_channel(dma_dev);
+        antsdr_submit_dma_transfer(dma_dev);
+    }
+    
+    elapsed = ktime_get_ns() - start_ns;
+    if (!ret) {
+        antsdr_stat_inc(dma_dev, pulse_switches);
+        atomic64_set(&dma_dev->stats.pulse_switch_last_ns, elapsed);
+        if (elapsed > atomic64_read(&dma_dev->stats.pulse_switch_max_ns))
+            atomic64_set(&dma_dev->stats.pulse_switch_max_ns, elapsed);
+        dev_info(dma_dev->dev, "Pulse mode %s while streaming in %llu us (transfer size: %zu bytes, %u buffers)\n",
+                 dma_dev->pulse_mode ? "enabled" : "disabled", elapsed / NSEC_PER_USEC,
+                 antsdr_get_transfer_size(dma_dev), dma_dev->dma_nr_buffers);
     }
+    return ret;
+}
 
-    /* Reinitialize completion */
-    reinit_completion(&dma_dev->dma_complete);
-    /* Start transfer */
-    dma_async_issue_pending(dma_dev->rx_chan);
+/* Pulse mode of one channel - streaming, it switches at a frame boundary and
+ * the stream keeps running
+ */
+static int antsdr_channel_pulse_mode(struct antsdr_dma_dev *dma_dev, uint32_t pulse_mode)
+{
+    unsigned long flags;
+    bool streaming;
+    
+    if (pulse_mode == dma_dev->pulse_mode)
+        return 0;
+    
+    spin_lock_irqsave(&dma_dev->lock, flags);
+    streaming = dma_dev->streaming;
+    spin_unlock_irqrestore(&dma_dev->lock, flags);
     
-    // antsdr_debug_log("DMA transfer submitted (buffer %d, pulse_mode %d, size %zu bytes, addr=0x%pad)\n", 
-    //         dma_dev->current_buffer, dma_dev->pulse_mode, transfer_size, &dma_handle);
-    // antsdr_debug_log("S2MM: Using maximum transfer size %zu bytes (512 words) regardless of pulse mode\n", 
-    //         transfer_size);
+    if (streaming && dma_dev->bench_active)
+        return -EBUSY;
+    if (streaming && dma_dev->rx_chan)
+        return antsdr_dma_switch_pulse_mode(dma_dev, pulse_mode);
     
+    dma_dev->pulse_mode = pulse_mode;
+    if (dma_dev->gpio_pulse_mode) {
+        gpiod_set_value(dma_dev->gpio_pulse_mode, dma_dev->pulse_mode);
+        dev_info(dma_dev->dev, "%s: pulse mode %s (transfer size: %zu bytes)\n", dma_dev->name,
+                 dma_dev->pulse_mode ? "enabled" : "disabled",
+                 antsdr_get_transfer_size(dma_dev));
+    }
     return 0;
 }
 
+/* A pulse-mode line shared by several channels changes the FPGA frame size
+ * of all of them, so every channel on the line follows
+ */
+static int antsdr_set_pulse_mode(struct antsdr_dma_dev *dma_dev, uint32_t pulse_mode)
+{
+    struct antsdr_dma_board *board = dma_dev->board;
+    unsigned int i;
+    int ret;
+    
+    ret = antsdr_channel_pulse_mode(dma_dev, pulse_mode);
+    for (i = 0; !ret && dma_dev->gpio_pulse_mode && i < board->nr_channels; i++) {
+        struct antsdr_dma_dev *other = board->channels[i];
+        
+        if (other && other != dma_dev && other->gpio_pulse_mode == dma_dev->gpio_pulse_mode)
+            ret = antsdr_channel_pulse_mode(other, pulse_mode);
+    }
+    return ret;
+}
+
 static int antsdr_dma_start_streaming(struct antsdr_dma_dev *dma_dev)
 {
     int ret;
@@ -1366,8 +5019,6 @@ static int antsdr_dma_start_streaming(struct antsdr_dma_dev *dma_dev)
         dev_warn(dma_dev->dev, "Streaming already active\n");
         return -EBUSY;
     }
-
-    dma_dev->current_buffer = 0;
     
     /* Reset missing frame tracking for new streaming session */
     dma_dev->missing_frame_count = 0;
@@ -1376,9 +5027,42 @@ static int antsdr_dma_start_streaming(struct antsdr_dma_dev *dma_dev)
     
     spin_unlock_irqrestore(&dma_dev->lock, flags);
     
+    /* Start the new session without a stale partial frame or integration
+     * block, interrupt-driven
+     */
+    antsdr_resync_reset(dma_dev);
+    dma_dev->integ_count = 0;
+    antsdr_poll_reset(dma_dev);
+    
     dev_info(dma_dev->dev, "UDP destination: %s, pulse mode: %d, transfer size: %zu bytes\n",
              dma_dev->dest_set ? "set" : "not set", dma_dev->pulse_mode, transfer_size);
     
+    /* Zero-copy: payloads left over from the last session still hold DMA
+     * buffers - finish with them before every buffer goes back on the free list.
+     */
+    if (dma_dev->zero_copy) {
+        kthread_cancel_work_sync(&dma_dev->udp_work);
+        dma_dev->udp_work_pending = false;
+        mutex_lock(&dma_dev->read_mutex);
+        antsdr_ring_flush(dma_dev);
+        mutex_unlock(&dma_dev->read_mutex);
+    }
+    antsdr_dma_reset_buffer_queue(dma_dev);
+    
+    /* The benchmark generator stands in for the FPGA and S2MM: no GPIO, no DMA */
+    if (dma_dev->bench_active) {
+        spin_lock_irqsave(&dma_dev->lock, flags);
+        dma_dev->streaming = true;
+        spin_unlock_irqrestore(&dma_dev->lock, flags);
+        antsdr_sched_stream_started(dma_dev);
+        dev_info(dma_dev->dev, "Streaming started from the benchmark generator\n");
+        return 0;
+    }
+    
+    if (dma_dev->rx_chan && dma_dev->dma_nr_buffers < dma_dev->dma_queue_depth)
+        dev_warn(dma_dev->dev, "DMA pool holds %u buffers of %zu bytes, fewer than the queue depth %u\n",
+                 dma_dev->dma_nr_buffers, dma_dev->dma_slot_size, dma_dev->dma_queue_depth);
+    
     /* Configure GPIO pins first */
     if (dma_dev->gpio_pulse_mode) {
         gpiod_set_value(dma_dev->gpio_pulse_mode, dma_dev->pulse_mode);
@@ -1400,25 +5084,29 @@ static int antsdr_dma_start_streaming(struct antsdr_dma_dev *dma_dev)
     spin_unlock_irqrestore(&dma_dev->lock, flags);
 
     
-    /* Submit first DMA transfer if DMA is available */
+    /* Arm the initial descriptor queue if DMA is available */
     if (dma_dev->rx_chan) {
-        /* Clear any old completions */
-        // reinit_completion(&dma_dev->dma_complete);
-        
-        ret = antsdr_submit_dma_transfer(dma_dev);
+        ret = antsdr_dma_configure_channel(dma_dev);
+        if (!ret)
+            ret = antsdr_submit_dma_transfer(dma_dev);
         if (ret) {
             spin_lock_irqsave(&dma_dev->lock, flags);
             dev_info(dma_dev->dev, "START_STREAMING failed: Setting streaming=false due to submit failure\n");
             dma_dev->streaming = false;
             spin_unlock_irqrestore(&dma_dev->lock, flags);
             
+            /* Drop whatever part of the queue was armed */
+            dmaengine_terminate_async(dma_dev->rx_chan);
+            antsdr_dma_drop_armed(dma_dev);
+            
             if (dma_dev->gpio_enable)
-                gpiod_set_value(dma_dev->gpio_enable, 0);
+                antsdr_set_enable(dma_dev, false);
             
             dev_err(dma_dev->dev, "Failed to submit initial DMA transfer: %d\n", ret);
             return ret;
         }
-        dev_info(dma_dev->dev, "Streaming started with DMA\n");
+        dev_info(dma_dev->dev, "Streaming started with DMA (%u descriptors armed)\n",
+                 dma_dev->dma_inflight);
     } else {
         dev_info(dma_dev->dev, "Streaming started without DMA (GPIO control only)\n");
     }
@@ -1426,13 +5114,16 @@ static int antsdr_dma_start_streaming(struct antsdr_dma_dev *dma_dev)
     /* Enable GPIO to start data generation after setup DMA to avoid DMA freeze due to data arrival before DMA
     setup */
     if (dma_dev->gpio_enable) {
-        gpiod_set_value(dma_dev->gpio_enable, 1);
+        antsdr_set_enable(dma_dev, true);
         dev_info(dma_dev->dev, "Enabled data generation GPIO\n");
         /* Give hardware time to start generating data */
         udelay(10);  /* 10μs - reduced from 50ms for 500μs packet timing */
     } else {
         dev_warn(dma_dev->dev, "No data generation GPIO available\n");
     }
+    
+    /* A time schedule armed while stopped counts from here */
+    antsdr_sched_stream_started(dma_dev);
 
     dev_info(dma_dev->dev, "IOCTL: DMA start completed successfully\n");
     
@@ -1441,6 +5132,7 @@ static int antsdr_dma_start_streaming(struct antsdr_dma_dev *dma_dev)
 
 static int antsdr_dma_stop_streaming(struct antsdr_dma_dev *dma_dev)
 {
+    struct antsdr_raw_frame raw_frame;
     unsigned long flags;
     unsigned long timeout;
     int ret;
@@ -1454,41 +5146,102 @@ static int antsdr_dma_stop_streaming(struct antsdr_dma_dev *dma_dev)
     dma_dev->streaming = false;
     spin_unlock_irqrestore(&dma_dev->lock, flags);
     
-    /* Disable GPIO */
-    if (dma_dev->gpio_enable) {
-        gpiod_set_value(dma_dev->gpio_enable, 0);
-        dev_info(dma_dev->dev, "Disabled data generation\n");
-    }
-    
-    /* Terminate DMA first to stop any ongoing transfers */
-    if (dma_dev->rx_chan) {
-        dmaengine_terminate_async(dma_dev->rx_chan);
-    }
+    antsdr_sched_cancel(dma_dev);
     
-    /* Wait for current transfer to complete with timeout */
-    timeout = msecs_to_jiffies(1000);  /* 1 second timeout */
-    ret = wait_for_completion_timeout(&dma_dev->dma_complete, timeout);
-    if (ret == 0) {
-        dev_warn(dma_dev->dev, "Timeout waiting for DMA completion, forcing stop\n");
-        /* Reinitialize completion for next use */
-        reinit_completion(&dma_dev->dma_complete);
+    if (dma_dev->bench_active) {
+        /* Benchmark: nothing armed, just stop the generator */
+        hrtimer_cancel(&dma_dev->bench_timer);
+        if (dma_dev->bench_running) {
+            dma_dev->bench_stop_ns = ktime_get_ns();
+            dma_dev->bench_running = false;
+        }
+    } else {
+        /* Disable GPIO */
+        if (dma_dev->gpio_enable) {
+            antsdr_set_enable(dma_dev, false);
+            dev_info(dma_dev->dev, "Disabled data generation\n");
+        }
+        
+        /* Terminate DMA first to stop any ongoing transfers */
+        if (dma_dev->rx_chan) {
+            dmaengine_terminate_async(dma_dev->rx_chan);
+            antsdr_dma_drop_armed(dma_dev);
+        }
+        
+        /* Wait for current transfer to complete with timeout */
+        timeout = msecs_to_jiffies(1000);  /* 1 second timeout */
+        ret = wait_for_completion_timeout(&dma_dev->dma_complete, timeout);
+        if (ret == 0) {
+            dev_warn(dma_dev->dev, "Timeout waiting for DMA completion, forcing stop\n");
+            /* Reinitialize completion for next use */
+            reinit_completion(&dma_dev->dma_complete);
+        }
     }
     
     /* Flush frame processing work to ensure all pending frames are processed */
-    if (dma_dev->frame_workqueue) {
-        flush_workqueue(dma_dev->frame_workqueue);
+    if (dma_dev->frame_worker) {
+        kthread_flush_worker(dma_dev->frame_worker);
     }
     
-    /* Clear any remaining frames in the FIFO */
+    /* Clear any remaining frames in the FIFO, releasing their data */
     spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
-    kfifo_reset(&dma_dev->raw_frame_fifo);
+    while (kfifo_out(&dma_dev->raw_frame_fifo, &raw_frame, sizeof(raw_frame)) == sizeof(raw_frame)) {
+        spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
+        antsdr_raw_frame_release(dma_dev, &raw_frame);
+        spin_lock_irqsave(&dma_dev->raw_fifo_lock, flags);
+    }
     dma_dev->frame_work_pending = false;
     spin_unlock_irqrestore(&dma_dev->raw_fifo_lock, flags);
     
+    /* Let the send thread catch up, then freeze the benchmark result */
+    if (dma_dev->bench_active) {
+        kthread_flush_worker(dma_dev->udp_worker);
+        antsdr_bench_get(dma_dev, &dma_dev->bench_final);
+        dma_dev->bench_active = false;
+        dev_info(dma_dev->dev, "Benchmark: %llu frames generated, %llu valid, %llu packets sent\n",
+                 dma_dev->bench_final.frames_generated, dma_dev->bench_final.frames_valid,
+                 dma_dev->bench_final.packets_sent);
+    }
+    
     dev_info(dma_dev->dev, "Streaming stopped\n");
     return 0;
 }
 
+/* Start a loopback benchmark run - streaming must be stopped */
+static int antsdr_bench_start(struct antsdr_dma_dev *dma_dev, const struct antsdr_bench_config *cfg)
+{
+    int ret;
+    
+    if (!cfg->rate || cfg->rate > ANTSDR_BENCH_MAX_RATE)
+        return -EINVAL;
+    if (dma_dev->streaming)
+        return -EBUSY;
+    
+    dma_dev->bench_rate = cfg->rate;
+    dma_dev->bench_counter = 0;
+    atomic64_set(&dma_dev->bench_generated, 0);
+    atomic64_set(&dma_dev->bench_missed, 0);
+    atomic64_set(&dma_dev->bench_cpu_ns, 0);
+    antsdr_bench_sample(dma_dev, &dma_dev->bench_base);
+    
+    dma_dev->bench_active = true;
+    ret = antsdr_dma_start_streaming(dma_dev);
+    if (ret) {
+        dma_dev->bench_active = false;
+        return ret;
+    }
+    
+    dma_dev->bench_start_ns = ktime_get_ns();
+    dma_dev->bench_end_ns = cfg->duration_ms ?
+        dma_dev->bench_start_ns + (u64)cfg->duration_ms * NSEC_PER_MSEC : 0;
+    dma_dev->bench_running = true;
+    hrtimer_start(&dma_dev->bench_timer, ns_to_ktime(ANTSDR_BENCH_TICK_NS), HRTIMER_MODE_REL_SOFT);
+    
+    dev_info(dma_dev->dev, "Benchmark started: %u frames/s of %u words, %u ms\n", cfg->rate,
+             dma_dev->pulse_mode ? FPGA_LONG_PULSE_WORDS : FPGA_SHORT_PULSE_WORDS, cfg->duration_ms);
+    return 0;
+}
+
 static int antsdr_dma_reset_and_restart(struct antsdr_dma_dev *dma_dev)
 {
     unsigned long flags;
@@ -1510,7 +5263,7 @@ static int antsdr_dma_reset_and_restart(struct antsdr_dma_dev *dma_dev)
     
     /* Reset GPIO to stop data generation */
     if (dma_dev->gpio_enable) {
-        gpiod_set_value(dma_dev->gpio_enable, 0);
+        antsdr_set_enable(dma_dev, false);
         udelay(500);  /* 500μs - reduced from 10ms for hardware reset timing */
         dev_info(dma_dev->dev, "GPIO reset completed\n");
     }
@@ -1521,29 +5274,26 @@ static int antsdr_dma_reset_and_restart(struct antsdr_dma_dev *dma_dev)
         dev_info(dma_dev->dev, "DMA channel terminated\n");
     }
     
-
+    /* All armed descriptors were dropped - their buffers are free again */
+    antsdr_dma_drop_armed(dma_dev);
     
-    /* Clear any pending data in ring buffer */
-    spin_lock_irqsave(&dma_dev->lock, flags);
-    dma_dev->ring_head = 0;
-    dma_dev->ring_tail = 0;
-    dma_dev->ring_count = 0;
-    spin_unlock_irqrestore(&dma_dev->lock, flags);
+    /* Clear any pending data in ring buffer (releases zero-copy buffers) */
+    antsdr_ring_flush(dma_dev);
     dev_info(dma_dev->dev, "Ring buffer reset completed\n");
     
-    /* Clear frame detection buffer */
-    antsdr_frame_buffer_reset(dma_dev);
+    /* Drop any partially reassembled frame */
+    antsdr_resync_reset(dma_dev);
     
     /* Restart with fixed transfer size */
     udelay(1000);  /* 1ms - reduced from 50ms for hardware settling */
     
     /* Re-enable GPIO for data generation */
     if (dma_dev->gpio_enable) {
-        gpiod_set_value(dma_dev->gpio_enable, 1);
+        antsdr_set_enable(dma_dev, true);
         dev_info(dma_dev->dev, "Data generation re-enabled\n");
     }
     
-    /* Submit new DMA transfer with fixed 512-word size */
+    /* Re-arm the full descriptor queue */
     ret = antsdr_submit_dma_transfer(dma_dev);
     if (ret) {
         dev_err(dma_dev->dev, "Failed to restart DMA after reset: %d\n", ret);
@@ -1560,13 +5310,245 @@ static int antsdr_dma_reset_and_restart(struct antsdr_dma_dev *dma_dev)
 
 /* Note: antsdr_reallocate_buffers function removed - buffer sizes are now fixed per pulse mode */
 
+/* Gather the live counters for ANTSDR_IOC_GET_STATS */
+static void antsdr_stats_snapshot(struct antsdr_dma_dev *dma_dev, struct antsdr_dma_stats *stats)
+{
+    stats->transfers_completed = atomic64_read(&dma_dev->stats.transfers_completed);
+    stats->bytes_transferred = atomic64_read(&dma_dev->stats.bytes_transferred);
+    stats->udp_packets_sent = atomic64_read(&dma_dev->stats.udp_packets_sent);
+    stats->errors = atomic64_read(&dma_dev->stats.errors);
+    stats->valid_frames = atomic64_read(&dma_dev->stats.valid_frames);
+    stats->invalid_frames = atomic64_read(&dma_dev->stats.invalid_frames);
+    stats->extracted_frames = atomic64_read(&dma_dev->stats.extracted_frames);
+    stats->fast_path_frames = atomic64_read(&dma_dev->stats.fast_path_frames);
+    stats->slow_path_frames = atomic64_read(&dma_dev->stats.slow_path_frames);
+    stats->resync_events = atomic64_read(&dma_dev->stats.resync_events);
+    stats->resync_frames = atomic64_read(&dma_dev->stats.resync_frames);
+    stats->resync_dropped_words = atomic64_read(&dma_dev->stats.resync_dropped_words);
+    stats->resync_last_ns = atomic64_read(&dma_dev->stats.resync_last_ns);
+    stats->resync_max_ns = atomic64_read(&dma_dev->stats.resync_max_ns);
+    stats->udp_overruns = atomic64_read(&dma_dev->cursors[ANTSDR_CONSUMER_UDP].overruns);
+    stats->read_overruns = atomic64_read(&dma_dev->cursors[ANTSDR_CONSUMER_READ].overruns);
+    stats->mmap_overruns = atomic64_read(&dma_dev->cursors[ANTSDR_CONSUMER_MMAP].overruns);
+    stats->poll_mode_switches = atomic64_read(&dma_dev->stats.poll_mode_switches);
+    stats->frame_rate = atomic64_read(&dma_dev->stats.frame_rate);
+    stats->pulse_switches = atomic64_read(&dma_dev->stats.pulse_switches);
+    stats->pulse_switch_last_ns = atomic64_read(&dma_dev->stats.pulse_switch_last_ns);
+    stats->pulse_switch_max_ns = atomic64_read(&dma_dev->stats.pulse_switch_max_ns);
+    stats->integrated_frames = atomic64_read(&dma_dev->stats.integrated_frames);
+    stats->integrated_outputs = atomic64_read(&dma_dev->stats.integrated_outputs);
+    stats->compress_in_bytes = atomic64_read(&dma_dev->stats.compress_in_bytes);
+    stats->compress_out_bytes = atomic64_read(&dma_dev->stats.compress_out_bytes);
+    stats->compress_ns = atomic64_read(&dma_dev->stats.compress_ns);
+    stats->drops_fifo_full = atomic64_read(&dma_dev->stats.drops[ANTSDR_DROP_FIFO_FULL]);
+    stats->drops_ring_full = atomic64_read(&dma_dev->stats.drops[ANTSDR_DROP_RING_FULL]);
+    stats->drops_alloc_fail = atomic64_read(&dma_dev->stats.drops[ANTSDR_DROP_ALLOC_FAIL]);
+    stats->drops_invalid = atomic64_read(&dma_dev->stats.drops[ANTSDR_DROP_INVALID]);
+    stats->drops_send_error = atomic64_read(&dma_dev->stats.drops[ANTSDR_DROP_SEND_ERROR]);
+    stats->fifo_high_water = atomic64_read(&dma_dev->stats.fifo_high_water);
+    stats->ring_high_water = atomic64_read(&dma_dev->stats.ring_high_water);
+    stats->ring_bytes_high_water = atomic64_read(&dma_dev->stats.ring_bytes_high_water);
+    antsdr_poll_mode_times(dma_dev, &stats->irq_mode_ns, &stats->poll_mode_ns);
+}
+
+/* Gather the latency histograms for ANTSDR_IOC_GET_LATENCY */
+static void antsdr_latency_snapshot(struct antsdr_dma_dev *dma_dev, struct antsdr_latency_stats *lat)
+{
+    int i, b;
+    
+    for (i = 0; i < ANTSDR_LAT_STAGES; i++) {
+        const struct antsdr_lat_counters *c = &dma_dev->stats.latency[i];
+        struct antsdr_latency_hist *h = &lat->stage[i];
+        
+        h->count = atomic64_read(&c->count);
+        h->sum_ns = atomic64_read(&c->sum_ns);
+        h->max_ns = atomic64_read(&c->max_ns);
+        for (b = 0; b < ANTSDR_LAT_BUCKETS; b++)
+            h->buckets[b] = atomic64_read(&c->buckets[b]);
+    }
+}
+
+static void antsdr_stats_reset(struct antsdr_dma_dev *dma_dev)
+{
+    unsigned long flags;
+    int i, b;
+    
+    atomic64_set(&dma_dev->stats.transfers_completed, 0);
+    atomic64_set(&dma_dev->stats.bytes_transferred, 0);
+    atomic64_set(&dma_dev->stats.udp_packets_sent, 0);
+    atomic64_set(&dma_dev->stats.errors, 0);
+    atomic64_set(&dma_dev->stats.valid_frames, 0);
+    atomic64_set(&dma_dev->stats.invalid_frames, 0);
+    atomic64_set(&dma_dev->stats.extracted_frames, 0);
+    atomic64_set(&dma_dev->stats.fast_path_frames, 0);
+    atomic64_set(&dma_dev->stats.slow_path_frames, 0);
+    atomic64_set(&dma_dev->stats.resync_events, 0);
+    atomic64_set(&dma_dev->stats.resync_frames, 0);
+    atomic64_set(&dma_dev->stats.resync_dropped_words, 0);
+    atomic64_set(&dma_dev->stats.resync_last_ns, 0);
+    atomic64_set(&dma_dev->stats.resync_max_ns, 0);
+    for (i = 0; i < ANTSDR_RING_CONSUMERS; i++)
+        atomic64_set(&dma_dev->cursors[i].overruns, 0);
+    atomic64_set(&dma_dev->stats.poll_mode_switches, 0);
+    atomic64_set(&dma_dev->stats.frame_rate, 0);
+    atomic64_set(&dma_dev->stats.pulse_switches, 0);
+    atomic64_set(&dma_dev->stats.pulse_switch_last_ns, 0);
+    atomic64_set(&dma_dev->stats.pulse_switch_max_ns, 0);
+    atomic64_set(&dma_dev->stats.integrated_frames, 0);
+    atomic64_set(&dma_dev->stats.integrated_outputs, 0);
+    atomic64_set(&dma_dev->stats.compress_in_bytes, 0);
+    atomic64_set(&dma_dev->stats.compress_out_bytes, 0);
+    atomic64_set(&dma_dev->stats.compress_ns, 0);
+    for (i = 0; i < ANTSDR_DROP_REASONS; i++)
+        atomic64_set(&dma_dev->stats.drops[i], 0);
+    atomic64_set(&dma_dev->stats.fifo_high_water, 0);
+    atomic64_set(&dma_dev->stats.ring_high_water, 0);
+    atomic64_set(&dma_dev->stats.ring_bytes_high_water, 0);
+    atomic64_set(&dma_dev->stats.overload_events, 0);
+    atomic64_set(&dma_dev->stats.paced_ns, 0);
+    atomic64_set(&dma_dev->stats.send_backoffs, 0);
+    atomic64_set(&dma_dev->stats.send_backoff_ns, 0);
+    atomic64_set(&dma_dev->stats.send_backoff_drops, 0);
+    atomic64_set(&dma_dev->stats.raw_packets, 0);
+    atomic64_set(&dma_dev->stats.raw_fallbacks, 0);
+    atomic64_set(&dma_dev->stats.raw_errors, 0);
+    for (i = 0; i < ANTSDR_LAT_STAGES; i++) {
+        struct antsdr_lat_counters *c = &dma_dev->stats.latency[i];
+        
+        atomic64_set(&c->count, 0);
+        atomic64_set(&c->sum_ns, 0);
+        atomic64_set(&c->max_ns, 0);
+        for (b = 0; b < ANTSDR_LAT_BUCKETS; b++)
+            atomic64_set(&c->buckets[b], 0);
+    }
+    spin_lock_irqsave(&dma_dev->poll_lock, flags);
+    atomic64_set(&dma_dev->stats.irq_mode_ns, 0);
+    atomic64_set(&dma_dev->stats.poll_mode_ns, 0);
+    dma_dev->poll_mode_since_ns = ktime_get_ns();
+    spin_unlock_irqrestore(&dma_dev->poll_lock, flags);
+}
+
+/* Upper bound of the bucket holding the permille-th sample */
+static u64 antsdr_lat_percentile(const struct antsdr_latency_hist *h, unsigned int permille)
+{
+    u64 target = div_u64(h->count * permille + 999, 1000), seen = 0;
+    int b;
+    
+    if (!h->count)
+        return 0;
+    for (b = 0; b < ANTSDR_LAT_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= target)
+            return b == ANTSDR_LAT_BUCKETS - 1 ? h->max_ns : 2ULL << b;
+    }
+    return h->max_ns;
+}
+
+/* debugfs: /sys/kernel/debug/antsdr_dma/{stats,latency}, readable any time
+ * without ANTSDR_DEBUG_CONSOLE
+ */
+static int antsdr_debugfs_stats_show(struct seq_file *s, void *unused)
+{
+    struct antsdr_dma_dev *dma_dev = s->private;
+    struct antsdr_dma_stats st;
+    
+    antsdr_stats_snapshot(dma_dev, &st);
+    seq_printf(s, "transfers_completed: %llu\n", st.transfers_completed);
+    seq_printf(s, "bytes_transferred: %llu\n", st.bytes_transferred);
+    seq_printf(s, "udp_packets_sent: %llu\n", st.udp_packets_sent);
+    seq_printf(s, "errors: %llu\n", st.errors);
+    seq_printf(s, "valid_frames: %llu\n", st.valid_frames);
+    seq_printf(s, "invalid_frames: %llu\n", st.invalid_frames);
+    seq_printf(s, "frame_rate: %llu\n", st.frame_rate);
+    seq_printf(s, "drops_fifo_full: %llu\n", st.drops_fifo_full);
+    seq_printf(s, "drops_ring_full: %llu\n", st.drops_ring_full);
+    seq_printf(s, "drops_alloc_fail: %llu\n", st.drops_alloc_fail);
+    seq_printf(s, "drops_invalid: %llu\n", st.drops_invalid);
+    seq_printf(s, "drops_send_error: %llu\n", st.drops_send_error);
+    seq_printf(s, "overruns_udp: %llu\n", st.udp_overruns);
+    seq_printf(s, "overruns_read: %llu\n", st.read_overruns);
+    seq_printf(s, "overruns_mmap: %llu\n", st.mmap_overruns);
+    seq_printf(s, "fifo_high_water: %llu/%u\n", st.fifo_high_water, dma_dev->raw_fifo_depth);
+    seq_printf(s, "ring_high_water: %llu\n", st.ring_high_water);
+    seq_printf(s, "ring_bytes_high_water: %llu/%u\n", st.ring_bytes_high_water, dma_dev->ring_size);
+    seq_printf(s, "overloaded: %u\n", READ_ONCE(dma_dev->overloaded));
+    seq_printf(s, "overload_events: %lld\n", atomic64_read(&dma_dev->stats.overload_events));
+    seq_printf(s, "paced_ns: %lld\n", atomic64_read(&dma_dev->stats.paced_ns));
+    seq_printf(s, "send_backoffs: %lld\n", atomic64_read(&dma_dev->stats.send_backoffs));
+    seq_printf(s, "send_backoff_ns: %lld\n", atomic64_read(&dma_dev->stats.send_backoff_ns));
+    seq_printf(s, "send_backoff_drops: %lld\n", atomic64_read(&dma_dev->stats.send_backoff_drops));
+    seq_printf(s, "raw_packets: %lld\n", atomic64_read(&dma_dev->stats.raw_packets));
+    seq_printf(s, "raw_fallbacks: %lld\n", atomic64_read(&dma_dev->stats.raw_fallbacks));
+    seq_printf(s, "raw_errors: %lld\n", atomic64_read(&dma_dev->stats.raw_errors));
+    seq_printf(s, "resync_events: %llu\n", st.resync_events);
+    seq_printf(s, "irq_mode_ns: %llu\n", st.irq_mode_ns);
+    seq_printf(s, "poll_mode_ns: %llu\n", st.poll_mode_ns);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(antsdr_debugfs_stats);
+
+static int antsdr_debugfs_latency_show(struct seq_file *s, void *unused)
+{
+    static const char * const names[ANTSDR_LAT_STAGES] = { "parse", "ring", "send", "sendmsg" };
+    struct antsdr_dma_dev *dma_dev = s->private;
+    struct antsdr_latency_stats *lat;
+    int i, b;
+    
+    lat = kmalloc(sizeof(*lat), GFP_KERNEL);
+    if (!lat)
+        return -ENOMEM;
+    antsdr_latency_snapshot(dma_dev, lat);
+    
+    seq_puts(s, "stage       count      avg_ns      p50_ns      p99_ns    p99.9_ns      max_ns\n");
+    for (i = 0; i < ANTSDR_LAT_STAGES; i++) {
+        const struct antsdr_latency_hist *h = &lat->stage[i];
+        
+        seq_printf(s, "%-8s %8llu %11llu %11llu %11llu %11llu %11llu\n", names[i], h->count,
+                   h->count ? div64_u64(h->sum_ns, h->count) : 0,
+                   antsdr_lat_percentile(h, 500), antsdr_lat_percentile(h, 990),
+                   antsdr_lat_percentile(h, 999), h->max_ns);
+    }
+    for (i = 0; i < ANTSDR_LAT_STAGES; i++) {
+        seq_printf(s, "\n%s histogram (ns < bound: count)\n", names[i]);
+        for (b = 0; b < ANTSDR_LAT_BUCKETS; b++) {
+            if (lat->stage[i].buckets[b])
+                seq_printf(s, "  < %llu: %llu\n", 2ULL << b, lat->stage[i].buckets[b]);
+        }
+    }
+    kfree(lat);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(antsdr_debugfs_latency);
+
+static void antsdr_debugfs_init(struct antsdr_dma_dev *dma_dev)
+{
+    /* debugfs is best effort, the driver works without it */
+    dma_dev->debugfs = debugfs_create_dir(dma_dev->name, NULL);
+    debugfs_create_file("stats", 0444, dma_dev->debugfs, dma_dev, &antsdr_debugfs_stats_fops);
+    debugfs_create_file("latency", 0444, dma_dev->debugfs, dma_dev, &antsdr_debugfs_latency_fops);
+}
+
 static long antsdr_dma_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
     struct antsdr_dma_dev *dma_dev = file->private_data;
     int ret = 0;
     unsigned int value;
     struct antsdr_udp_dest udp_dest;
+    struct antsdr_udp_dest_cfg dest_cfg;
+    struct antsdr_aggregation agg;
+    struct antsdr_poll_config poll_cfg;
+    struct antsdr_geometry geo;
+    struct antsdr_header_config hdr_cfg;
+    struct antsdr_integration integ;
     struct antsdr_dma_stats stats;
+    struct antsdr_bench_config bench_cfg;
+    struct antsdr_bench_result bench;
+    struct antsdr_lo_profile lo_profile;
+    struct antsdr_sched_status sched_status;
+    struct antsdr_pacing pacing;
+    struct antsdr_pacing_status pacing_status;
+    struct antsdr_raw_tx raw_tx;
+    struct antsdr_raw_tx_status raw_tx_status;
     unsigned long flags;
     
     switch (cmd) {
@@ -1590,64 +5572,236 @@ static long antsdr_dma_ioctl(struct file *file, unsigned int cmd, unsigned long
         break;
         
     case ANTSDR_IOC_GET_STATS:
-        spin_lock_irqsave(&dma_dev->lock, flags);
-        stats = dma_dev->stats;
-        spin_unlock_irqrestore(&dma_dev->lock, flags);
+        antsdr_stats_snapshot(dma_dev, &stats);
         
         if (copy_to_user((void __user *)arg, &stats, sizeof(stats))) {
             ret = -EFAULT;
         }
         break;
         
+    case ANTSDR_IOC_START_BENCH:
+        if (copy_from_user(&bench_cfg, (void __user *)arg, sizeof(bench_cfg))) {
+            ret = -EFAULT;
+            break;
+        }
+        ret = antsdr_bench_start(dma_dev, &bench_cfg);
+        break;
+        
+    case ANTSDR_IOC_GET_BENCH:
+        antsdr_bench_get(dma_dev, &bench);
+        if (copy_to_user((void __user *)arg, &bench, sizeof(bench)))
+            ret = -EFAULT;
+        break;
+        
+    case ANTSDR_IOC_SET_LO_PROFILE:
+        if (copy_from_user(&lo_profile, (void __user *)arg, sizeof(lo_profile))) {
+            ret = -EFAULT;
+            break;
+        }
+        ret = antsdr_set_lo_profile(dma_dev, &lo_profile);
+        if (!ret && copy_to_user((void __user *)arg, &lo_profile, sizeof(lo_profile)))
+            ret = -EFAULT;
+        break;
+        
+    case ANTSDR_IOC_SET_SCHEDULE: {
+        /* Too big for the stack */
+        struct antsdr_schedule *sched = memdup_user((void __user *)arg, sizeof(*sched));
+        
+        if (IS_ERR(sched)) {
+            ret = PTR_ERR(sched);
+            break;
+        }
+        ret = antsdr_set_schedule(dma_dev, sched);
+        break;
+    }
+        
+    case ANTSDR_IOC_GET_SCHEDULE:
+        antsdr_sched_get(dma_dev, &sched_status);
+        if (copy_to_user((void __user *)arg, &sched_status, sizeof(sched_status)))
+            ret = -EFAULT;
+        break;
+        
+    case ANTSDR_IOC_SET_PACING:
+        if (copy_from_user(&pacing, (void __user *)arg, sizeof(pacing))) {
+            ret = -EFAULT;
+            break;
+        }
+        ret = antsdr_set_pacing(dma_dev, &pacing);
+        break;
+        
+    case ANTSDR_IOC_GET_PACING:
+        antsdr_pacing_get(dma_dev, &pacing_status);
+        if (copy_to_user((void __user *)arg, &pacing_status, sizeof(pacing_status)))
+            ret = -EFAULT;
+        break;
+        
+    case ANTSDR_IOC_SET_RAW_TX:
+        if (copy_from_user(&raw_tx, (void __user *)arg, sizeof(raw_tx))) {
+            ret = -EFAULT;
+            break;
+        }
+        ret = antsdr_set_raw_tx(dma_dev, &raw_tx);
+        break;
+        
+    case ANTSDR_IOC_GET_RAW_TX:
+        antsdr_raw_tx_get(dma_dev, &raw_tx_status);
+        if (copy_to_user((void __user *)arg, &raw_tx_status, sizeof(raw_tx_status)))
+            ret = -EFAULT;
+        break;
+        
+    case ANTSDR_IOC_GET_LATENCY: {
+        /* Too big for the stack */
+        struct antsdr_latency_stats *lat = kmalloc(sizeof(*lat), GFP_KERNEL);
+        
+        if (!lat) {
+            ret = -ENOMEM;
+            break;
+        }
+        antsdr_latency_snapshot(dma_dev, lat);
+        if (copy_to_user((void __user *)arg, lat, sizeof(*lat)))
+            ret = -EFAULT;
+        kfree(lat);
+        break;
+    }
+        
     case ANTSDR_IOC_SET_UDP_DEST:
         if (copy_from_user(&udp_dest, (void __user *)arg, sizeof(udp_dest))) {
             ret = -EFAULT;
             break;
         }
         
-        dma_dev->dest_addr.sin_family = AF_INET;
-        dma_dev->dest_addr.sin_addr.s_addr = udp_dest.ip;
-        dma_dev->dest_addr.sin_port = htons(udp_dest.port);
-        dma_dev->dest_set = true;
+        /* A single destination replaces the fan-out list */
+        dest_cfg.ip = udp_dest.ip;
+        dest_cfg.port = udp_dest.port;
+        dest_cfg.ttl = 0;
+        mutex_lock(&dma_dev->dest_mutex);
+        antsdr_udp_dests_clear_locked(dma_dev);
+        ret = antsdr_udp_dest_add_locked(dma_dev, &dest_cfg);
+        mutex_unlock(&dma_dev->dest_mutex);
         
-        dev_info(dma_dev->dev, "UDP destination set to %pI4:%u\n", 
-                 &udp_dest.ip, udp_dest.port);
+        if (!ret)
+            dev_info(dma_dev->dev, "UDP destination set to %pI4:%u\n", 
+                     &udp_dest.ip, udp_dest.port);
         break;
         
-    case ANTSDR_IOC_RESET_STATS:
-        spin_lock_irqsave(&dma_dev->lock, flags);
-        memset(&dma_dev->stats, 0, sizeof(dma_dev->stats));
-        spin_unlock_irqrestore(&dma_dev->lock, flags);
-        dev_info(dma_dev->dev, "Statistics reset\n");
+    case ANTSDR_IOC_ADD_UDP_DEST:
+        if (copy_from_user(&dest_cfg, (void __user *)arg, sizeof(dest_cfg))) {
+            ret = -EFAULT;
+            break;
+        }
+        
+        mutex_lock(&dma_dev->dest_mutex);
+        ret = antsdr_udp_dest_add_locked(dma_dev, &dest_cfg);
+        mutex_unlock(&dma_dev->dest_mutex);
         break;
         
-    case ANTSDR_IOC_SET_PULSE_MODE:
+    case ANTSDR_IOC_DEL_UDP_DEST:
+        if (copy_from_user(&dest_cfg, (void __user *)arg, sizeof(dest_cfg))) {
+            ret = -EFAULT;
+            break;
+        }
+        
+        ret = antsdr_udp_dest_del(dma_dev, &dest_cfg);
+        break;
+        
+    case ANTSDR_IOC_GET_UDP_DESTS:
+        {
+            struct antsdr_udp_dest_list *list = kmalloc(sizeof(*list), GFP_KERNEL);
+            
+            if (!list) {
+                ret = -ENOMEM;
+                break;
+            }
+            antsdr_udp_dests_get(dma_dev, list);
+            if (copy_to_user((void __user *)arg, list, sizeof(*list)))
+                ret = -EFAULT;
+            kfree(list);
+        }
+        break;
+        
+    case ANTSDR_IOC_SET_AGGREGATION:
+        if (copy_from_user(&agg, (void __user *)arg, sizeof(agg))) {
+            ret = -EFAULT;
+            break;
+        }
+        
+        ret = antsdr_set_aggregation(dma_dev, &agg);
+        break;
+        
+    case ANTSDR_IOC_SET_POLL_MODE:
+        if (copy_from_user(&poll_cfg, (void __user *)arg, sizeof(poll_cfg))) {
+            ret = -EFAULT;
+            break;
+        }
+        
+        ret = antsdr_set_poll_mode(dma_dev, &poll_cfg);
+        break;
+        
+    case ANTSDR_IOC_SET_GEOMETRY:
+        if (copy_from_user(&geo, (void __user *)arg, sizeof(geo))) {
+            ret = -EFAULT;
+            break;
+        }
+        
+        ret = antsdr_set_geometry(dma_dev, &geo);
+        break;
+        
+    case ANTSDR_IOC_SET_HEADER:
+        if (copy_from_user(&hdr_cfg, (void __user *)arg, sizeof(hdr_cfg))) {
+            ret = -EFAULT;
+            break;
+        }
+        
+        ret = antsdr_set_header(dma_dev, &hdr_cfg);
+        break;
+        
+    case ANTSDR_IOC_SET_CHECKSUM:
         if (copy_from_user(&value, (void __user *)arg, sizeof(value))) {
             ret = -EFAULT;
             break;
         }
         
-        /* Check if we need to restart streaming for new transfer size */
-        spin_lock_irqsave(&dma_dev->lock, flags);
-        bool was_streaming = dma_dev->streaming;
-        spin_unlock_irqrestore(&dma_dev->lock, flags);
+        ret = antsdr_set_checksum(dma_dev, value);
+        break;
+        
+    case ANTSDR_IOC_SET_INTEGRATION:
+        if (copy_from_user(&integ, (void __user *)arg, sizeof(integ))) {
+            ret = -EFAULT;
+            break;
+        }
+        
+        ret = antsdr_set_integration(dma_dev, &integ);
+        break;
         
-        if (was_streaming) {
-            antsdr_dma_stop_streaming(dma_dev);
+    case ANTSDR_IOC_SET_COMPRESSION:
+        if (copy_from_user(&value, (void __user *)arg, sizeof(value))) {
+            ret = -EFAULT;
+            break;
         }
         
-        dma_dev->pulse_mode = value ? 1 : 0;
-        if (dma_dev->gpio_pulse_mode) {
-            gpiod_set_value(dma_dev->gpio_pulse_mode, dma_dev->pulse_mode);
-            dev_info(dma_dev->dev, "Pulse mode %s (transfer size: %zu bytes)\n", 
-                     dma_dev->pulse_mode ? "enabled" : "disabled", 
-                     antsdr_get_transfer_size(dma_dev));
+        ret = antsdr_set_compression(dma_dev, value);
+        break;
+        
+    case ANTSDR_IOC_GET_GEOMETRY:
+        antsdr_get_geometry(dma_dev, &geo);
+        
+        if (copy_to_user((void __user *)arg, &geo, sizeof(geo))) {
+            ret = -EFAULT;
         }
+        break;
         
-        /* Restart streaming if it was active */
-        if (was_streaming) {
-            ret = antsdr_dma_start_streaming(dma_dev);
+    case ANTSDR_IOC_RESET_STATS:
+        antsdr_stats_reset(dma_dev);
+        dev_info(dma_dev->dev, "Statistics reset\n");
+        break;
+        
+    case ANTSDR_IOC_SET_PULSE_MODE:
+        if (copy_from_user(&value, (void __user *)arg, sizeof(value))) {
+            ret = -EFAULT;
+            break;
         }
+        
+        ret = antsdr_set_pulse_mode(dma_dev, value ? 1 : 0);
         break;
         
     case ANTSDR_IOC_SET_TDD_MODE:
@@ -1742,45 +5896,54 @@ static int antsdr_dma_release(struct inode *inode, struct file *file)
     /* Stop streaming if active */
     antsdr_dma_stop_streaming(dma_dev);
     
+    /* The read() cursor goes away with its reader */
+    mutex_lock(&dma_dev->read_mutex);
+    if (dma_dev->reader_file == file) {
+        antsdr_ring_detach(dma_dev, ANTSDR_CONSUMER_READ);
+        dma_dev->reader_file = NULL;
+    }
+    mutex_unlock(&dma_dev->read_mutex);
+    
     dev_info(dma_dev->dev, "Device closed\n");
     return 0;
 }
 
+/* Attach the read() cursor for this file; reads from another file take it
+ * over. Caller holds read_mutex.
+ */
+static void antsdr_dma_attach_reader(struct antsdr_dma_dev *dma_dev, struct file *file)
+{
+    if (dma_dev->reader_file == file)
+        return;
+    antsdr_ring_attach(dma_dev, ANTSDR_CONSUMER_READ);
+    dma_dev->reader_file = file;
+}
+
 static ssize_t antsdr_dma_read(struct file *file, char __user *buf,
                                size_t count, loff_t *ppos)
 {
     struct antsdr_dma_dev *dma_dev = file->private_data;
-    unsigned char *kbuf;
-    int ret;
-    unsigned long flags;
-    
-    kbuf = kmalloc(count, GFP_KERNEL);
-    if (!kbuf) {
-        return -ENOMEM;
-    }
-    
-    spin_lock_irqsave(&dma_dev->lock, flags);
-    /* For ring buffer implementation, we need to get a complete buffer */
     void *ring_data;
     size_t ring_size;
-    ret = antsdr_ring_get(dma_dev, &ring_data, &ring_size);
+    ssize_t ret;
+    
+    mutex_lock(&dma_dev->read_mutex);
+    antsdr_dma_attach_reader(dma_dev, file);
+    
+    /* The record stays held until it is returned, so it can be copied
+     * straight to userspace without a bounce buffer or a spinlock
+     */
+    ret = antsdr_ring_get(dma_dev, ANTSDR_CONSUMER_READ, &ring_data, &ring_size, NULL, NULL);
     if (ret == 0) {
         size_t copy_size = min(count, ring_size);
-        memcpy(kbuf, ring_data, copy_size);
-        antsdr_ring_return_buffer(dma_dev);
-        ret = copy_size;
+        
+        ret = copy_to_user(buf, ring_data, copy_size) ? -EFAULT : copy_size;
+        antsdr_ring_return_buffer(dma_dev, ANTSDR_CONSUMER_READ);
     } else {
         ret = 0; /* No data available */
     }
-    spin_unlock_irqrestore(&dma_dev->lock, flags);
-    
-    if (ret > 0) {
-        if (copy_to_user(buf, kbuf, ret)) {
-            ret = -EFAULT;
-        }
-    }
     
-    kfree(kbuf);
+    mutex_unlock(&dma_dev->read_mutex);
     return ret;
 }
 
@@ -1792,28 +5955,254 @@ static unsigned int antsdr_dma_poll(struct file *file, poll_table *wait)
     
     poll_wait(file, &dma_dev->wait_queue, wait);
     
-    spin_lock_irqsave(&dma_dev->lock, flags);
-    if (dma_dev->ring_count > 0) {
+    /* Only read() attaches the read() cursor - a file that just polls (for
+     * POLLPRI, or as an mmap() reader) must not hold records it never reads
+     */
+    spin_lock_irqsave(&dma_dev->ring_lock, flags);
+    if (READ_ONCE(dma_dev->reader_file) == file && dma_dev->cursors[ANTSDR_CONSUMER_READ].count > 0) {
         mask |= POLLIN | POLLRDNORM;
     }
-    spin_unlock_irqrestore(&dma_dev->lock, flags);
+    spin_unlock_irqrestore(&dma_dev->ring_lock, flags);
+    
+    /* mmap() readers wait for records past their own tail */
+    if (atomic_read(&dma_dev->ring_mappings) &&
+        READ_ONCE(dma_dev->ring_ctrl->user_tail) != READ_ONCE(dma_dev->ring_ctrl->head))
+        mask |= POLLIN | POLLRDNORM;
+    
+    /* Send path overloaded - see ANTSDR_IOC_SET_PACING */
+    if (READ_ONCE(dma_dev->overloaded))
+        mask |= POLLPRI;
     
     return mask;
 }
 
+static void antsdr_ring_vm_open(struct vm_area_struct *vma)
+{
+    struct antsdr_dma_dev *dma_dev = vma->vm_private_data;
+    
+    atomic_inc(&dma_dev->ring_mappings);
+}
+
+static void antsdr_ring_vm_close(struct vm_area_struct *vma)
+{
+    struct antsdr_dma_dev *dma_dev = vma->vm_private_data;
+    
+    /* Last mapping gone - the mmap() reader no longer holds records */
+    if (atomic_dec_and_test(&dma_dev->ring_mappings))
+        antsdr_ring_detach(dma_dev, ANTSDR_CONSUMER_MMAP);
+}
+
+static const struct vm_operations_struct antsdr_ring_vm_ops = {
+    .open = antsdr_ring_vm_open,
+    .close = antsdr_ring_vm_close,
+};
+
+/* Map the control page and record arena for in-place local consumers */
+static int antsdr_dma_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct antsdr_dma_dev *dma_dev = file->private_data;
+    unsigned long size = vma->vm_end - vma->vm_start;
+    int ret;
+    
+    /* Zero-copy records only reference DMA buffers, which are not mapped */
+    if (dma_dev->zero_copy) {
+        dev_warn(dma_dev->dev, "Ring mmap not available in zero-copy mode\n");
+        return -EOPNOTSUPP;
+    }
+    
+    if (vma->vm_pgoff || size != PAGE_SIZE + dma_dev->ring_size) {
+        dev_warn(dma_dev->dev, "Ring mmap must cover %lu bytes from offset 0\n",
+                 PAGE_SIZE + dma_dev->ring_size);
+        return -EINVAL;
+    }
+    
+    ret = remap_vmalloc_range(vma, dma_dev->ring_mem, 0);
+    if (ret) {
+        dev_err(dma_dev->dev, "Failed to map ring buffer: %d\n", ret);
+        return ret;
+    }
+    
+    vma->vm_private_data = dma_dev;
+    vma->vm_ops = &antsdr_ring_vm_ops;
+    
+    /* A new reader starts at the current head */
+    if (atomic_inc_return(&dma_dev->ring_mappings) == 1)
+        antsdr_ring_attach(dma_dev, ANTSDR_CONSUMER_MMAP);
+    
+    dev_info(dma_dev->dev, "Ring buffer mapped (%lu bytes)\n", size);
+    return 0;
+}
+
 static const struct file_operations antsdr_dma_fops = {
     .owner = THIS_MODULE,
     .open = antsdr_dma_open,
     .release = antsdr_dma_release,
     .read = antsdr_dma_read,
     .poll = antsdr_dma_poll,
+    .mmap = antsdr_dma_mmap,
     .unlocked_ioctl = antsdr_dma_ioctl,
 };
 
-static int antsdr_dma_probe(struct platform_device *pdev)
+/* Dedicated kthread for a pipeline stage - pinned to 'cpu' if it is online,
+ * and SCHED_FIFO unless stage_priority is 0
+ */
+static struct kthread_worker *antsdr_create_stage_worker(struct antsdr_dma_dev *dma_dev, const char *name, int cpu)
+{
+    struct kthread_worker *worker;
+    
+    worker = kthread_create_worker(0, "%s", name);
+    if (IS_ERR(worker))
+        return worker;
+    
+    if (cpu >= 0) {
+        if (cpu < nr_cpu_ids && cpu_online(cpu))
+            set_cpus_allowed_ptr(worker->task, cpumask_of(cpu));
+        else
+            dev_warn(dma_dev->dev, "%s: CPU %d not online, thread not pinned\n", name, cpu);
+    }
+    
+    if (stage_priority > 0) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+        /* sched_setscheduler() is no longer exported - modules get the default RT priority */
+        sched_set_fifo(worker->task);
+#else
+        struct sched_param param = { .sched_priority = min(stage_priority, MAX_RT_PRIO - 1) };
+        
+        sched_setscheduler_nocheck(worker->task, SCHED_FIFO, &param);
+#endif
+    }
+    
+    dev_info(dma_dev->dev, "%s thread: cpu %d, %s\n", name, cpu,
+             stage_priority > 0 ? "SCHED_FIFO" : "SCHED_NORMAL");
+    return worker;
+}
+
+/* CPU for one of a channel's stage threads: the module parameter, or, with
+ * several channels and no parameter, one parse thread per CPU and each
+ * channel's send thread on the next CPU over
+ */
+static int antsdr_stage_cpu(struct antsdr_dma_dev *dma_dev, const int *param, unsigned int offset)
+{
+    if (param[dma_dev->channel] >= 0 || dma_dev->board->nr_channels < 2)
+        return param[dma_dev->channel];
+    return (dma_dev->channel + offset) % num_online_cpus();
+}
+
+/* Channel 0 keeps the original names, channel N appends N */
+static void antsdr_channel_name(struct antsdr_dma_dev *dma_dev, char *buf, size_t size, const char *base)
+{
+    if (dma_dev->channel)
+        snprintf(buf, size, "%s%u", base, dma_dev->channel);
+    else
+        snprintf(buf, size, "%s", base);
+}
+
+/* Steer the channel's S2MM DMA IRQ (owned by the DMA controller driver) to its dma_irq_cpu */
+static void antsdr_set_dma_irq_affinity(struct antsdr_dma_dev *dma_dev)
+{
+    int irq = dma_irq[dma_dev->channel];
+    int cpu = dma_irq_cpu[dma_dev->channel];
+    int ret;
+    
+    if (irq < 0 || cpu < 0)
+        return;
+    
+    if (cpu >= nr_cpu_ids || !cpu_online(cpu)) {
+        dev_warn(dma_dev->dev, "DMA IRQ %d: CPU %d not online, affinity unchanged\n", irq, cpu);
+        return;
+    }
+    
+    ret = irq_set_affinity_hint(irq, cpumask_of(cpu));
+    if (ret)
+        dev_warn(dma_dev->dev, "Failed to set DMA IRQ %d affinity: %d\n", irq, ret);
+    else
+        dev_info(dma_dev->dev, "DMA IRQ %d steered to CPU %d\n", irq, cpu);
+}
+
+static void antsdr_clear_dma_irq_affinity(struct antsdr_dma_dev *dma_dev)
+{
+    if (dma_irq[dma_dev->channel] >= 0 && dma_irq_cpu[dma_dev->channel] >= 0)
+        irq_set_affinity_hint(dma_irq[dma_dev->channel], NULL);
+}
+
+/* Channel 0 drives the board's mode lines. Another channel uses its own
+ * rxN-<line> GPIO where the device tree has one and shares the board's
+ * otherwise.
+ */
+static int antsdr_channel_gpio(struct antsdr_dma_dev *dma_dev, const char *line, struct gpio_desc *shared,
+                               struct gpio_desc **out)
+{
+    struct gpio_desc *desc;
+    const char *con_id;
+    
+    *out = shared;
+    if (!dma_dev->channel)
+        return 0;
+    
+    /* gpiolib may keep the name as the line's label */
+    con_id = devm_kasprintf(dma_dev->dev, GFP_KERNEL, "rx%u-%s", dma_dev->channel, line);
+    if (!con_id)
+        return -ENOMEM;
+    desc = devm_gpiod_get_optional(dma_dev->dev, con_id, GPIOD_OUT_LOW);
+    if (IS_ERR(desc)) {
+        dev_err(dma_dev->dev, "Failed to get %s GPIO: %ld\n", con_id, PTR_ERR(desc));
+        return PTR_ERR(desc);
+    }
+    if (desc)
+        *out = desc;
+    return 0;
+}
+
+/* S2MM channel rx[N]_channel, or the older s2mm[N]_channel */
+static struct dma_chan *antsdr_request_rx_chan(struct antsdr_dma_dev *dma_dev)
+{
+    static const char * const prefixes[] = { "rx", "s2mm" };
+    struct dma_chan *chan;
+    char name[24];
+    int i;
+    
+    for (i = 0; i < ARRAY_SIZE(prefixes); i++) {
+        if (dma_dev->channel)
+            snprintf(name, sizeof(name), "%s%u_channel", prefixes[i], dma_dev->channel);
+        else
+            snprintf(name, sizeof(name), "%s_channel", prefixes[i]);
+        chan = dma_request_slave_channel(dma_dev->dev, name);
+        if (chan)
+            return chan;
+        dev_warn(dma_dev->dev, "Failed to get DMA channel %s\n", name);
+    }
+    return NULL;
+}
+
+/* Channel N > 0 exists when the device tree names its S2MM channel
+ * rxN_channel (or s2mmN_channel), channel 0 always does
+ */
+static unsigned int antsdr_count_channels(struct platform_device *pdev)
+{
+    struct device_node *np = pdev->dev.of_node;
+    char name[24];
+    unsigned int n;
+    
+    for (n = 1; np && n < ANTSDR_MAX_CHANNELS; n++) {
+        snprintf(name, sizeof(name), "rx%u_channel", n);
+        if (of_property_match_string(np, "dma-names", name) >= 0)
+            continue;
+        snprintf(name, sizeof(name), "s2mm%u_channel", n);
+        if (of_property_match_string(np, "dma-names", name) < 0)
+            break;
+    }
+    return n;
+}
+
+/* Set up one channel's stream and register its device node */
+static int antsdr_channel_probe(struct platform_device *pdev, struct antsdr_dma_board *board, unsigned int channel)
 {
     struct antsdr_dma_dev *dma_dev;
-    int ret, i;
+    struct antsdr_geometry geo;
+    struct antsdr_udp_dest_cfg default_dest = { 0 };
+    struct antsdr_pacing default_pacing = { 0 };
+    char name[24];
+    int ret;
     
     dma_dev = devm_kzalloc(&pdev->dev, sizeof(*dma_dev), GFP_KERNEL);
     if (!dma_dev) {
@@ -1822,8 +6211,31 @@ static int antsdr_dma_probe(struct platform_device *pdev)
     
     dma_dev->pdev = pdev;
     dma_dev->dev = &pdev->dev;
+    dma_dev->board = board;
+    dma_dev->channel = channel;
+    antsdr_channel_name(dma_dev, dma_dev->name, sizeof(dma_dev->name), DEVICE_NAME);
     dma_dev->buffer_size = DEFAULT_BUFFER_SIZE;
     dma_dev->current_buffer = 0;
+    dma_dev->dma_inflight = 0;
+    dma_dev->dma_queue_depth = clamp_t(unsigned int, dma_queue_depth, 1, ANTSDR_MAX_QUEUE_DEPTH);
+    
+    /* Buffer geometry from the module parameters */
+    geo.dma_pool_kb = dma_pool_kb;
+    geo.ring_kb = ring_kb;
+    geo.raw_fifo_depth = raw_fifo_depth;
+    geo.dma_buffers = 0;
+    if (!geo.dma_pool_kb || !geo.ring_kb || !geo.raw_fifo_depth || antsdr_check_geometry(dma_dev, &geo)) {
+        dev_warn(&pdev->dev, "Invalid buffer geometry parameters, using defaults\n");
+        geo.dma_pool_kb = ANTSDR_DEFAULT_POOL_KB;
+        geo.ring_kb = ANTSDR_DEFAULT_RING_KB;
+        geo.raw_fifo_depth = ANTSDR_DEFAULT_RAW_FIFO_DEPTH;
+    }
+    dma_dev->ring_size = geo.ring_kb * 1024;
+    dma_dev->raw_fifo_depth = geo.raw_fifo_depth;
+    dma_dev->zero_copy = zero_copy;
+    dma_dev->header_version = ANTSDR_PROTOCOL_VERSION;
+    dma_dev->ts_clock = ANTSDR_CLOCK_MONOTONIC;
+    dma_dev->csum_mode = ANTSDR_CSUM_PAYLOAD;
     dma_dev->streaming = false;
     dma_dev->dest_set = false;
     dma_dev->pulse_mode = 0;
@@ -1842,11 +6254,13 @@ static int antsdr_dma_probe(struct platform_device *pdev)
     dma_dev->s2mm_requested_length = 0;
     dma_dev->s2mm_actual_length = 0;
     
-    platform_set_drvdata(pdev, dma_dev);
-    
     /* Initialize synchronization objects */
     spin_lock_init(&dma_dev->lock);
+    seqcount_spinlock_init(&dma_dev->lo_seq, &dma_dev->lock);
+    spin_lock_init(&dma_dev->dma_queue_lock);
+    antsdr_dma_reset_buffer_queue(dma_dev);
     init_waitqueue_head(&dma_dev->wait_queue);
+    init_waitqueue_head(&dma_dev->drain_wait);
     init_completion(&dma_dev->dma_complete);
     
     /* Initialize ring buffer */
@@ -1858,75 +6272,94 @@ static int antsdr_dma_probe(struct platform_device *pdev)
     
     /* Initialize raw frame FIFO for threaded processing */
     spin_lock_init(&dma_dev->raw_fifo_lock);
-    ret = kfifo_alloc(&dma_dev->raw_frame_fifo, RAW_FRAME_FIFO_SIZE, GFP_KERNEL);
+    ret = kfifo_alloc(&dma_dev->raw_frame_fifo, dma_dev->raw_fifo_depth * sizeof(struct antsdr_raw_frame), GFP_KERNEL);
     if (ret) {
         dev_err(&pdev->dev, "Failed to allocate raw frame FIFO: %d\n", ret);
         antsdr_ring_cleanup(dma_dev);
         return ret;
     }
     
-    /* Create dedicated workqueue for frame processing */
-    dma_dev->frame_workqueue = create_singlethread_workqueue("antsdr_frame_wq");
-    if (!dma_dev->frame_workqueue) {
-        dev_err(&pdev->dev, "Failed to create frame processing workqueue\n");
+    /* Create dedicated threads for the parse and send stages */
+    antsdr_channel_name(dma_dev, name, sizeof(name), "antsdr_parse");
+    dma_dev->frame_worker = antsdr_create_stage_worker(dma_dev, name, antsdr_stage_cpu(dma_dev, parse_cpu, 0));
+    if (IS_ERR(dma_dev->frame_worker)) {
+        ret = PTR_ERR(dma_dev->frame_worker);
+        dev_err(&pdev->dev, "Failed to create frame processing thread: %d\n", ret);
+        dma_dev->frame_worker = NULL;
         kfifo_free(&dma_dev->raw_frame_fifo);
         antsdr_ring_cleanup(dma_dev);
-        return -ENOMEM;
+        return ret;
+    }
+    
+    antsdr_channel_name(dma_dev, name, sizeof(name), "antsdr_send");
+    dma_dev->udp_worker = antsdr_create_stage_worker(dma_dev, name, antsdr_stage_cpu(dma_dev, send_cpu, 1));
+    if (IS_ERR(dma_dev->udp_worker)) {
+        ret = PTR_ERR(dma_dev->udp_worker);
+        dev_err(&pdev->dev, "Failed to create UDP send thread: %d\n", ret);
+        dma_dev->udp_worker = NULL;
+        kthread_destroy_worker(dma_dev->frame_worker);
+        kfifo_free(&dma_dev->raw_frame_fifo);
+        antsdr_ring_cleanup(dma_dev);
+        return ret;
     }
     
     /* Initialize frame work */
-    INIT_WORK(&dma_dev->frame_work, antsdr_frame_work);
+    kthread_init_work(&dma_dev->frame_work, antsdr_frame_work);
     dma_dev->frame_work_pending = false;
     
-    /* Initialize frame detection buffer */
-    ret = antsdr_frame_buffer_init(dma_dev);
+    /* Benchmark generator, idle until ANTSDR_IOC_START_BENCH */
+    hrtimer_init(&dma_dev->bench_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+    dma_dev->bench_timer.function = antsdr_bench_timer;
+    
+    /* Mode schedule, disarmed until ANTSDR_IOC_SET_SCHEDULE */
+    spin_lock_init(&dma_dev->sched_lock);
+    hrtimer_init(&dma_dev->sched_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS_SOFT);
+    dma_dev->sched_timer.function = antsdr_sched_timer;
+    INIT_WORK(&dma_dev->sched_work, antsdr_sched_work);
+    dma_dev->sched_lo_profile = ANTSDR_SCHED_KEEP;
+    
+    /* Completion polling starts disabled (ANTSDR_IOC_SET_POLL_MODE) */
+    spin_lock_init(&dma_dev->poll_lock);
+    kthread_init_work(&dma_dev->poll_work, antsdr_poll_work);
+    dma_dev->poll_cfg.enable = 0;
+    dma_dev->poll_cfg.enter_fps = ANTSDR_POLL_DEFAULT_ENTER_FPS;
+    dma_dev->poll_cfg.exit_fps = ANTSDR_POLL_DEFAULT_EXIT_FPS;
+    dma_dev->poll_cfg.poll_interval_us = ANTSDR_POLL_DEFAULT_INTERVAL_US;
+    dma_dev->poll_running = false;
+    antsdr_poll_reset(dma_dev);
+    
+    /* Initialize resync state */
+    ret = antsdr_resync_init(dma_dev);
     if (ret) {
-        dev_err(&pdev->dev, "Failed to initialize frame detection buffer: %d\n", ret);
-        destroy_workqueue(dma_dev->frame_workqueue);
+        dev_err(&pdev->dev, "Failed to initialize resync state: %d\n", ret);
+        kthread_destroy_worker(dma_dev->udp_worker);
+        kthread_destroy_worker(dma_dev->frame_worker);
         kfifo_free(&dma_dev->raw_frame_fifo);
         antsdr_ring_cleanup(dma_dev);
         return ret;
     }
     
-    /* Initialize work queue */
-    INIT_WORK(&dma_dev->udp_work, antsdr_udp_work);
+    /* Initialize UDP work */
+    kthread_init_work(&dma_dev->udp_work, antsdr_udp_work);
     dma_dev->udp_work_pending = false;
     
-    /* Debug: Print device tree information */
-    dev_info(&pdev->dev, "Device probe starting - checking DMA resources...\n");
-    if (pdev->dev.of_node) {
-        struct property *prop;
-        const char *name;
-        int index = 0;
-        
-        dev_info(&pdev->dev, "Device tree node found: %s\n", pdev->dev.of_node->name);
-        
-        /* Check dma-names property */
-        of_property_for_each_string(pdev->dev.of_node, "dma-names", prop, name) {
-            dev_info(&pdev->dev, "DMA name[%d]: %s\n", index++, name);
-        }
-        
-        /* Check dmas property */
-        if (of_find_property(pdev->dev.of_node, "dmas", NULL)) {
-            dev_info(&pdev->dev, "dmas property found in device tree\n");
-        } else {
-            dev_warn(&pdev->dev, "No dmas property found in device tree\n");
-        }
-    } else {
-        dev_warn(&pdev->dev, "No device tree node found\n");
-    }
+    /* Frame aggregation starts disabled (ANTSDR_IOC_SET_AGGREGATION) */
+    mutex_init(&dma_dev->agg_mutex);
+    kthread_init_delayed_work(&dma_dev->agg_flush_work, antsdr_agg_flush_work);
+    dma_dev->agg_enable = false;
+    dma_dev->compress_mode = ANTSDR_COMPRESS_OFF;
     
-     /* Get DMA channel - following xilinx_axidma patterns */
-    dma_dev->rx_chan = dma_request_slave_channel(&pdev->dev, "rx_channel");
+    /* Pulse integration starts disabled (ANTSDR_IOC_SET_INTEGRATION) */
+    dma_dev->integ_mode = ANTSDR_INTEG_OFF;
+    dma_dev->integ_frames = 1;
+    dma_dev->integ_decimation = 1;
+    
+    /* Get DMA channel - following xilinx_axidma patterns */
+    dma_dev->rx_chan = antsdr_request_rx_chan(dma_dev);
     if (!dma_dev->rx_chan) {
-        dev_warn(&pdev->dev, "Failed to get RX DMA channel, trying fallback\n");
-        /* Try alternative channel name */
-        dma_dev->rx_chan = dma_request_slave_channel(&pdev->dev, "s2mm_channel");
-        if (!dma_dev->rx_chan) {
-            dev_err(&pdev->dev, "Failed to get any DMA channel\n");
-            ret = -ENODEV;
-            goto err_frame_buffer;
-        }
+        dev_err(&pdev->dev, "Failed to get any DMA channel for %s\n", dma_dev->name);
+        ret = -ENODEV;
+        goto err_resync;
     }
     
     /* Reset DMA channel to ensure clean state */
@@ -1962,93 +6395,44 @@ static int antsdr_dma_probe(struct platform_device *pdev)
     
     /* Allocate DMA buffers only if we have a DMA channel */
     if (dma_dev->rx_chan) {
-        /* Allocate DMA buffers for maximum transfer size (512 words = 2048 bytes) */
-        for (i = 0; i < NUM_BUFFERS; i++) {
-            dma_dev->long_dma_buffers[i] = dma_alloc_coherent(dma_dev->rx_chan->device->dev,
-                                                              MAX_S2MM_TRANSFER_SIZE,
-                                                              &dma_dev->long_dma_handles[i],
-                                                              GFP_KERNEL | GFP_DMA);
-            if (!dma_dev->long_dma_buffers[i]) {
-                dev_err(&pdev->dev, "Failed to allocate DMA buffer %d (%zu bytes)\n", i, MAX_S2MM_TRANSFER_SIZE);
-                ret = -ENOMEM;
-                goto err_buffers;
-            }
-            
-            /* Verify buffer alignment */
-            if (!IS_ALIGNED((unsigned long)dma_dev->long_dma_buffers[i], 64)) {
-                dev_warn(&pdev->dev, "DMA buffer %d not 64-byte aligned: %p\n", 
-                         i, dma_dev->long_dma_buffers[i]);
-            }
-            
-            if (!IS_ALIGNED(dma_dev->long_dma_handles[i], 64)) {
-                dev_warn(&pdev->dev, "DMA handle %d not 64-byte aligned: 0x%pad\n", 
-                         i, &dma_dev->long_dma_handles[i]);
-            }
-            
-            dev_info(&pdev->dev, "DMA buffer %d: virt=%p dma=0x%pad size=%zu bytes\n",
-                     i, dma_dev->long_dma_buffers[i], &dma_dev->long_dma_handles[i], MAX_S2MM_TRANSFER_SIZE);
-        }
+        /* One pool for all transfers - large pools come from CMA */
+        ret = antsdr_dma_pool_alloc(dma_dev, (size_t)geo.dma_pool_kb * 1024);
+        if (ret)
+            goto err_buffers;
         
-        dev_info(&pdev->dev, "Allocated %d DMA buffers of %zu bytes each (total %zu bytes)\n",
-                 NUM_BUFFERS, MAX_S2MM_TRANSFER_SIZE, NUM_BUFFERS * MAX_S2MM_TRANSFER_SIZE);
-        
-        dev_info(&pdev->dev, "DMA buffers allocated successfully (long buffers only)\n");
+        dev_info(&pdev->dev, "DMA buffers allocated successfully (%u descriptors kept armed while streaming)\n",
+                 dma_dev->dma_queue_depth);
+        if (dma_dev->zero_copy)
+            dev_info(&pdev->dev, "Zero-copy UDP path enabled - payloads sent from DMA buffers\n");
     } else {
         dev_info(&pdev->dev, "Skipping DMA buffer allocation (no DMA channel)\n");
-        /* Initialize buffer pointers to NULL */
-        for (i = 0; i < NUM_BUFFERS; i++) {
-            dma_dev->long_dma_buffers[i] = NULL;
-            dma_dev->long_dma_handles[i] = 0;
-        }
-    }
-    
-    /* Get GPIO pins */
-    dma_dev->gpio_enable = devm_gpiod_get_optional(&pdev->dev, "enable", GPIOD_OUT_LOW);
-    if (IS_ERR(dma_dev->gpio_enable)) {
-        ret = PTR_ERR(dma_dev->gpio_enable);
-        dev_err(&pdev->dev, "Failed to get enable GPIO: %d\n", ret);
-        goto err_buffers;
-    }
-    
-    dma_dev->gpio_pulse_mode = devm_gpiod_get_optional(&pdev->dev, "pulse-mode", GPIOD_OUT_LOW);
-    if (IS_ERR(dma_dev->gpio_pulse_mode)) {
-        ret = PTR_ERR(dma_dev->gpio_pulse_mode);
-        dev_err(&pdev->dev, "Failed to get pulse-mode GPIO: %d\n", ret);
-        goto err_buffers;
-    }
-    
-    dma_dev->gpio_tdd_mode = devm_gpiod_get_optional(&pdev->dev, "tdd-mode", GPIOD_OUT_LOW);
-    if (IS_ERR(dma_dev->gpio_tdd_mode)) {
-        ret = PTR_ERR(dma_dev->gpio_tdd_mode);
-        dev_err(&pdev->dev, "Failed to get tdd-mode GPIO: %d\n", ret);
-        goto err_buffers;
-    }
-
-    dma_dev->gpio_mode = devm_gpiod_get_optional(&pdev->dev, "mode", GPIOD_OUT_LOW);
-    if (IS_ERR(dma_dev->gpio_mode)) {
-        ret = PTR_ERR(dma_dev->gpio_mode);
-        dev_err(&pdev->dev, "Failed to get mode GPIO: %d\n", ret);
-        goto err_dma;
     }
     
-    /* Create UDP socket */
-    ret = sock_create_kern(&init_net, AF_INET, SOCK_DGRAM, IPPROTO_UDP, &dma_dev->sock);
-    if (ret) {
-        dev_err(&pdev->dev, "Failed to create UDP socket: %d\n", ret);
-        goto err_buffers;
-    }
+    /* GPIO pins - the board's, or this channel's own */
+    ret = antsdr_channel_gpio(dma_dev, "enable", board->gpio_enable, &dma_dev->gpio_enable);
+    if (!ret)
+        ret = antsdr_channel_gpio(dma_dev, "pulse-mode", board->gpio_pulse_mode, &dma_dev->gpio_pulse_mode);
+    if (!ret)
+        ret = antsdr_channel_gpio(dma_dev, "tdd-mode", board->gpio_tdd_mode, &dma_dev->gpio_tdd_mode);
+    if (!ret)
+        ret = antsdr_channel_gpio(dma_dev, "mode", board->gpio_mode, &dma_dev->gpio_mode);
+    if (ret)
+        goto err_dma_chan;
     
-    /* Set default UDP destination: 192.168.1.125:12288 */
-    dma_dev->dest_addr.sin_family = AF_INET;
-    dma_dev->dest_addr.sin_addr.s_addr = htonl((192 << 24) | (168 << 16) | (1 << 8) | 125); /* 192.168.1.125 */
-    dma_dev->dest_addr.sin_port = htons(12288); /* Port 12288 */
-    dma_dev->dest_set = true;
+    /* Set default UDP destination: 192.168.1.125:12288 (+ channel), with its own socket */
+    mutex_init(&dma_dev->dest_mutex);
+    antsdr_set_pacing(dma_dev, &default_pacing);
+    default_dest.ip = htonl((192 << 24) | (168 << 16) | (1 << 8) | 125); /* 192.168.1.125 */
+    default_dest.port = 12288 + channel; /* Port 12288 */
+    ret = antsdr_udp_dest_add_locked(dma_dev, &default_dest);
+    if (ret)
+        goto err_dma_chan;
     
-    dev_info(&pdev->dev, "Default UDP destination set to 192.168.1.125:12288\n");
+    dev_info(&pdev->dev, "%s: default UDP destination set to 192.168.1.125:%u\n", dma_dev->name, default_dest.port);
     
     /* Register misc device */
     dma_dev->misc_dev.minor = MISC_DYNAMIC_MINOR;
-    dma_dev->misc_dev.name = DEVICE_NAME;
+    dma_dev->misc_dev.name = dma_dev->name;
     dma_dev->misc_dev.fops = &antsdr_dma_fops;
     
     ret = misc_register(&dma_dev->misc_dev);
@@ -2057,81 +6441,82 @@ static int antsdr_dma_probe(struct platform_device *pdev)
         goto err_socket;
     }
     
-    dev_info(&pdev->dev, "ANTSDR DMA driver probed successfully\n");
+    dma_dev->raw_netdev_nb.notifier_call = antsdr_raw_netdev_event;
+    ret = register_netdevice_notifier(&dma_dev->raw_netdev_nb);
+    if (ret) {
+        dev_err(&pdev->dev, "Failed to register netdevice notifier: %d\n", ret);
+        misc_deregister(&dma_dev->misc_dev);
+        goto err_socket;
+    }
+    
+    antsdr_set_dma_irq_affinity(dma_dev);
+    antsdr_debugfs_init(dma_dev);
+    
+    board->channels[channel] = dma_dev;
+    dev_info(&pdev->dev, "%s: channel %u ready\n", dma_dev->name, channel);
     return 0;
     
 err_socket:
-    sock_release(dma_dev->sock);
+    antsdr_udp_dests_clear_locked(dma_dev);
 err_dma_chan:
     dma_release_channel(dma_dev->rx_chan);
-err_frame_buffer:
-    antsdr_frame_buffer_cleanup(dma_dev);
+err_resync:
+    antsdr_resync_cleanup(dma_dev);
 err_buffers:
-    if (dma_dev->rx_chan) {
-        /* Free long pulse buffers only (we no longer use short buffers) */
-        for (i = 0; i < NUM_BUFFERS; i++) {
-            if (dma_dev->long_dma_buffers[i]) {
-                dma_free_coherent(dma_dev->rx_chan->device->dev,
-                                  MAX_S2MM_TRANSFER_SIZE,
-                                  dma_dev->long_dma_buffers[i],
-                                  dma_dev->long_dma_handles[i]);
-            }
-        }
-    }
+    antsdr_dma_pool_free(dma_dev);
     
     /* Clean up frame processing resources */
-    if (dma_dev->frame_workqueue) {
-        destroy_workqueue(dma_dev->frame_workqueue);
+    if (dma_dev->udp_worker) {
+        kthread_destroy_worker(dma_dev->udp_worker);
+    }
+    if (dma_dev->frame_worker) {
+        kthread_destroy_worker(dma_dev->frame_worker);
     }
     kfifo_free(&dma_dev->raw_frame_fifo);
     antsdr_ring_cleanup(dma_dev);
     return ret;
-
-err_dma:
-    if (dma_dev->rx_chan)
-        dma_release_channel(dma_dev->rx_chan);
-    return ret;
 }
 
-
-
-static int antsdr_dma_remove(struct platform_device *pdev)
+static void antsdr_channel_remove(struct antsdr_dma_dev *dma_dev)
 {
-    struct antsdr_dma_dev *dma_dev = platform_get_drvdata(pdev);
-    int i;
+    debugfs_remove_recursive(dma_dev->debugfs);
     
     /* Stop streaming */
     antsdr_dma_stop_streaming(dma_dev);
+    antsdr_sched_cancel(dma_dev);
     
-    /* Stop and destroy frame processing workqueue */
-    if (dma_dev->frame_workqueue) {
-        flush_workqueue(dma_dev->frame_workqueue);
-        destroy_workqueue(dma_dev->frame_workqueue);
+    /* Stop and destroy frame processing thread */
+    if (dma_dev->frame_worker) {
+        kthread_flush_worker(dma_dev->frame_worker);
+        kthread_destroy_worker(dma_dev->frame_worker);
     }
     
     /* Free raw frame FIFO */
     kfifo_free(&dma_dev->raw_frame_fifo);
     
+    /* No UDP send may still reference the ring or the DMA buffers */
+    kthread_cancel_work_sync(&dma_dev->udp_work);
+    kthread_cancel_delayed_work_sync(&dma_dev->agg_flush_work);
+    kthread_destroy_worker(dma_dev->udp_worker);
+    kfree(dma_dev->agg_buffer);
+    kfree(dma_dev->integ_acc);
+    kfree(dma_dev->integ_out);
+    kfree(dma_dev->zpack_buf);
+    
+    antsdr_clear_dma_irq_affinity(dma_dev);
+    
     /* Unregister misc device */
     misc_deregister(&dma_dev->misc_dev);
     
-    /* Release socket */
-    if (dma_dev->sock) {
-        sock_release(dma_dev->sock);
-    }
+    /* Release the destination sockets and egress devices */
+    unregister_netdevice_notifier(&dma_dev->raw_netdev_nb);
+    mutex_lock(&dma_dev->dest_mutex);
+    antsdr_udp_dests_clear_locked(dma_dev);
+    mutex_unlock(&dma_dev->dest_mutex);
     
     /* Free DMA buffers and release channel if available */
+    antsdr_dma_pool_free(dma_dev);
     if (dma_dev->rx_chan) {
-        /* Free long pulse buffers only (we no longer use short buffers) */
-        for (i = 0; i < NUM_BUFFERS; i++) {
-            if (dma_dev->long_dma_buffers[i]) {
-                dma_free_coherent(dma_dev->rx_chan->device->dev,
-                                  MAX_S2MM_TRANSFER_SIZE,
-                                  dma_dev->long_dma_buffers[i],
-                                  dma_dev->long_dma_handles[i]);
-            }
-        }
-        
         /* Release DMA channel */
         dma_release_channel(dma_dev->rx_chan);
     }
@@ -2139,8 +6524,102 @@ static int antsdr_dma_remove(struct platform_device *pdev)
     /* Free ring buffer */
     antsdr_ring_cleanup(dma_dev);
     
-    /* Free frame detection buffer */
-    antsdr_frame_buffer_cleanup(dma_dev);
+    /* Free resync carry buffer */
+    antsdr_resync_cleanup(dma_dev);
+}
+
+static int antsdr_dma_probe(struct platform_device *pdev)
+{
+    struct antsdr_dma_board *board;
+    unsigned int channel;
+    int ret;
+    
+    board = devm_kzalloc(&pdev->dev, sizeof(*board), GFP_KERNEL);
+    if (!board)
+        return -ENOMEM;
+    spin_lock_init(&board->enable_lock);
+    board->nr_channels = antsdr_count_channels(pdev);
+    
+    /* Debug: Print device tree information */
+    dev_info(&pdev->dev, "Device probe starting - checking DMA resources...\n");
+    if (pdev->dev.of_node) {
+        struct property *prop;
+        const char *name;
+        int index = 0;
+        
+        dev_info(&pdev->dev, "Device tree node found: %s\n", pdev->dev.of_node->name);
+        
+        /* Check dma-names property */
+        of_property_for_each_string(pdev->dev.of_node, "dma-names", prop, name) {
+            dev_info(&pdev->dev, "DMA name[%d]: %s\n", index++, name);
+        }
+        
+        /* Check dmas property */
+        if (of_find_property(pdev->dev.of_node, "dmas", NULL)) {
+            dev_info(&pdev->dev, "dmas property found in device tree\n");
+        } else {
+            dev_warn(&pdev->dev, "No dmas property found in device tree\n");
+        }
+    } else {
+        dev_warn(&pdev->dev, "No device tree node found\n");
+    }
+    
+    /* Get GPIO pins */
+    board->gpio_enable = devm_gpiod_get_optional(&pdev->dev, "enable", GPIOD_OUT_LOW);
+    if (IS_ERR(board->gpio_enable)) {
+        ret = PTR_ERR(board->gpio_enable);
+        dev_err(&pdev->dev, "Failed to get enable GPIO: %d\n", ret);
+        return ret;
+    }
+    
+    board->gpio_pulse_mode = devm_gpiod_get_optional(&pdev->dev, "pulse-mode", GPIOD_OUT_LOW);
+    if (IS_ERR(board->gpio_pulse_mode)) {
+        ret = PTR_ERR(board->gpio_pulse_mode);
+        dev_err(&pdev->dev, "Failed to get pulse-mode GPIO: %d\n", ret);
+        return ret;
+    }
+    
+    board->gpio_tdd_mode = devm_gpiod_get_optional(&pdev->dev, "tdd-mode", GPIOD_OUT_LOW);
+    if (IS_ERR(board->gpio_tdd_mode)) {
+        ret = PTR_ERR(board->gpio_tdd_mode);
+        dev_err(&pdev->dev, "Failed to get tdd-mode GPIO: %d\n", ret);
+        return ret;
+    }
+
+    board->gpio_mode = devm_gpiod_get_optional(&pdev->dev, "mode", GPIOD_OUT_LOW);
+    if (IS_ERR(board->gpio_mode)) {
+        ret = PTR_ERR(board->gpio_mode);
+        dev_err(&pdev->dev, "Failed to get mode GPIO: %d\n", ret);
+        return ret;
+    }
+    
+    platform_set_drvdata(pdev, board);
+    
+    for (channel = 0; channel < board->nr_channels; channel++) {
+        ret = antsdr_channel_probe(pdev, board, channel);
+        if (ret) {
+            while (channel--)
+                antsdr_channel_remove(board->channels[channel]);
+            return ret;
+        }
+    }
+    
+    dev_info(&pdev->dev, "ANTSDR DMA driver probed successfully (%u channel%s)\n",
+             board->nr_channels, board->nr_channels == 1 ? "" : "s");
+    return 0;
+}
+
+static int antsdr_dma_remove(struct platform_device *pdev)
+{
+    struct antsdr_dma_board *board = platform_get_drvdata(pdev);
+    unsigned int channel = board->nr_channels;
+    
+    while (channel--) {
+        struct antsdr_dma_dev *dma_dev = board->channels[channel];
+        
+        board->channels[channel] = NULL;
+        antsdr_channel_remove(dma_dev);
+    }
     
     dev_info(&pdev->dev, "ANTSDR DMA driver removed\n");
     return 0;
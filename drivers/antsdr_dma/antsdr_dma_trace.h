@@ -0,0 +1,134 @@
+/**
+ * @file antsdr_dma_trace.h
+ * @brief Tracepoints along the ANTSDR DMA frame path
+ *
+ * One event per stage a frame passes through - S2MM completion, parse,
+ * ring insertion and UDP send - plus one for every dropped frame with the
+ * reason. Enable them at run time, no rebuild needed:
+ *
+ *   echo 1 > /sys/kernel/tracing/events/antsdr_dma/enable
+ *   cat /sys/kernel/tracing/trace_pipe
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM antsdr_dma
+
+#if !defined(_ANTSDR_DMA_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _ANTSDR_DMA_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(antsdr_dma_complete,
+    TP_PROTO(unsigned int index, size_t len, u64 timestamp_ns, unsigned int fifo_level),
+    TP_ARGS(index, len, timestamp_ns, fifo_level),
+    TP_STRUCT__entry(
+        __field(unsigned int, index)
+        __field(size_t, len)
+        __field(u64, timestamp_ns)
+        __field(unsigned int, fifo_level)
+    ),
+    TP_fast_assign(
+        __entry->index = index;
+        __entry->len = len;
+        __entry->timestamp_ns = timestamp_ns;
+        __entry->fifo_level = fifo_level;
+    ),
+    TP_printk("buffer=%u len=%zu ts=%llu fifo=%u",
+              __entry->index, __entry->len, __entry->timestamp_ns, __entry->fifo_level)
+);
+
+TRACE_EVENT(antsdr_parse_done,
+    TP_PROTO(u32 frame_counter, size_t payload_len, int ret, u64 latency_ns),
+    TP_ARGS(frame_counter, payload_len, ret, latency_ns),
+    TP_STRUCT__entry(
+        __field(u32, frame_counter)
+        __field(size_t, payload_len)
+        __field(int, ret)
+        __field(u64, latency_ns)
+    ),
+    TP_fast_assign(
+        __entry->frame_counter = frame_counter;
+        __entry->payload_len = payload_len;
+        __entry->ret = ret;
+        __entry->latency_ns = latency_ns;
+    ),
+    TP_printk("counter=%u len=%zu ret=%d latency_ns=%llu",
+              __entry->frame_counter, __entry->payload_len, __entry->ret, __entry->latency_ns)
+);
+
+TRACE_EVENT(antsdr_ring_put,
+    TP_PROTO(u32 frame_counter, size_t size, unsigned int ring_count, int ret),
+    TP_ARGS(frame_counter, size, ring_count, ret),
+    TP_STRUCT__entry(
+        __field(u32, frame_counter)
+        __field(size_t, size)
+        __field(unsigned int, ring_count)
+        __field(int, ret)
+    ),
+    TP_fast_assign(
+        __entry->frame_counter = frame_counter;
+        __entry->size = size;
+        __entry->ring_count = ring_count;
+        __entry->ret = ret;
+    ),
+    TP_printk("counter=%u size=%zu records=%u ret=%d",
+              __entry->frame_counter, __entry->size, __entry->ring_count, __entry->ret)
+);
+
+TRACE_EVENT(antsdr_udp_send,
+    TP_PROTO(size_t len, unsigned int sent, unsigned int dests, int ret, u64 duration_ns),
+    TP_ARGS(len, sent, dests, ret, duration_ns),
+    TP_STRUCT__entry(
+        __field(size_t, len)
+        __field(unsigned int, sent)
+        __field(unsigned int, dests)
+        __field(int, ret)
+        __field(u64, duration_ns)
+    ),
+    TP_fast_assign(
+        __entry->len = len;
+        __entry->sent = sent;
+        __entry->dests = dests;
+        __entry->ret = ret;
+        __entry->duration_ns = duration_ns;
+    ),
+    TP_printk("len=%zu sent=%u/%u ret=%d duration_ns=%llu",
+              __entry->len, __entry->sent, __entry->dests, __entry->ret, __entry->duration_ns)
+);
+
+/* So perf and trace-cmd can decode the reason names too */
+TRACE_DEFINE_ENUM(ANTSDR_DROP_FIFO_FULL);
+TRACE_DEFINE_ENUM(ANTSDR_DROP_RING_FULL);
+TRACE_DEFINE_ENUM(ANTSDR_DROP_ALLOC_FAIL);
+TRACE_DEFINE_ENUM(ANTSDR_DROP_INVALID);
+TRACE_DEFINE_ENUM(ANTSDR_DROP_SEND_ERROR);
+
+TRACE_EVENT(antsdr_drop,
+    TP_PROTO(unsigned int reason, size_t len),
+    TP_ARGS(reason, len),
+    TP_STRUCT__entry(
+        __field(unsigned int, reason)
+        __field(size_t, len)
+    ),
+    TP_fast_assign(
+        __entry->reason = reason;
+        __entry->len = len;
+    ),
+    TP_printk("reason=%s len=%zu",
+              __print_symbolic(__entry->reason,
+                               { ANTSDR_DROP_FIFO_FULL, "fifo_full" },
+                               { ANTSDR_DROP_RING_FULL, "ring_full" },
+                               { ANTSDR_DROP_ALLOC_FAIL, "alloc_fail" },
+                               { ANTSDR_DROP_INVALID, "invalid" },
+                               { ANTSDR_DROP_SEND_ERROR, "send_error" }),
+              __entry->len)
+);
+
+#endif /* _ANTSDR_DMA_TRACE_H */
+
+/* Out-of-tree module: define_trace.h must find this file next to the driver */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE antsdr_dma_trace
+#include <trace/define_trace.h>
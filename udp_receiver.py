@@ -13,6 +13,91 @@ import argparse
 import signal
 import sys
 
+# Packet header layouts (big-endian), see antsdr_dma.c
+HEADER_V1 = struct.Struct('>12I')
+HEADER_V2 = struct.Struct('>4IQ2H2B3H2I')
+MARKERS_V1 = (0xABCD1234, 0xABCD1235, 0xABCD1236)   # frame, aggregate, compressed aggregate
+MARKERS_V2 = (0xABCD2234, 0xABCD2235, 0xABCD2236)
+AGG_FRAME_V1 = struct.Struct('>I2H')
+AGG_FRAME_V2 = struct.Struct('>I2HI')
+AGG_FRAME_COMPRESSED = 0x1
+ZPACK_BLOCK = 32
+CLOCK_NAMES = {0: 'monotonic', 1: 'realtime', 2: 'tai'}
+CHECKSUM_NAMES = {0: 'payload', 1: 'none', 2: 'header', 3: 'frame'}
+INTEGRATION_NAMES = {0: 'raw', 1: 'coherent', 2: 'incoherent', 3: 'unknown'}
+
+def parse_header(data):
+    """Decode a version 1 or 2 packet header, None if the marker is unknown"""
+    if len(data) < 4:
+        return None
+    marker = struct.unpack_from('>I', data)[0]
+    if marker in MARKERS_V1 and len(data) >= HEADER_V1.size:
+        f = HEADER_V1.unpack_from(data)
+        return {'version': 1, 'aggregate': marker != MARKERS_V1[0], 'sequence': f[1],
+                'frame_id': f[4], 'payload_length': f[3], 'missing_frames': f[9]}
+    if marker in MARKERS_V2 and len(data) >= HEADER_V2.size:
+        f = HEADER_V2.unpack_from(data)
+        return {'version': 2, 'aggregate': marker != MARKERS_V2[0], 'sequence': f[1],
+                'frame_id': f[2], 'frame_counter': f[3], 'timestamp_ns': f[4],
+                'payload_length': f[5], 'clock': CLOCK_NAMES.get(f[9] & 0x3, 'unknown'),
+                'checksum_mode': CHECKSUM_NAMES[(f[9] >> 2) & 0x3], 'checksum': f[13],
+                'integration': INTEGRATION_NAMES[(f[9] >> 4) & 0x3],
+                'frames': (f[11] & 0xFF) + 1, 'decimation': (f[11] >> 8) + 1,
+                'lo_profile': (f[9] >> 6) & 0x7 if f[9] & 0x200 else None,
+                'channel': (f[9] >> 10) & 0x3,
+                'missing_frames': f[12]}
+    return None
+
+def zpack_decode(data, ref=None):
+    """Decode one coded aggregate frame (delta + zigzag + bit-packing, see
+    antsdr_zpack() in antsdr_dma.c). ref is the previous frame's raw payload
+    in the same datagram, needed when the frame was coded against it."""
+    raw_len, predictor = struct.unpack_from('>HB', data)
+    lanes = raw_len // 2
+    if predictor == 1:
+        if ref is None or len(ref) != raw_len:
+            raise ValueError('inter-coded frame without its reference')
+        prev = struct.unpack('<%dH' % lanes, ref)
+    out = [0] * lanes
+    pos = 3
+    for b in range(0, lanes, ZPACK_BLOCK):
+        cnt = min(ZPACK_BLOCK, lanes - b)
+        width = data[pos]
+        pos += 1
+        nbytes = (cnt * width + 7) // 8
+        bits = int.from_bytes(data[pos:pos + nbytes], 'little')
+        pos += nbytes
+        mask = (1 << width) - 1
+        for i in range(cnt):
+            z = (bits >> (i * width)) & mask
+            r = (z >> 1) ^ -(z & 1)
+            n = b + i
+            if predictor == 1:
+                pred = prev[n]
+            else:
+                pred = out[n - 2] if n >= 2 else 0
+            out[n] = (pred + r) & 0xFFFF
+    return struct.pack('<%dH' % lanes, *out)
+
+def split_aggregate(data, header):
+    """Split an aggregate datagram into (frame_counter, payload) pairs,
+    decoding compressed frames"""
+    pos = HEADER_V2.size if header['version'] == 2 else HEADER_V1.size
+    frame = AGG_FRAME_V2 if header['version'] == 2 else AGG_FRAME_V1
+    frames = []
+    prev = None
+    while pos + frame.size <= len(data):
+        f = frame.unpack_from(data, pos)
+        counter, length, flags = f[0], f[1], f[2]
+        pos += frame.size
+        payload = bytes(data[pos:pos + length])
+        pos += length
+        if flags & AGG_FRAME_COMPRESSED:
+            payload = zpack_decode(payload, prev)
+        frames.append((counter, payload))
+        prev = payload
+    return frames
+
 class UDPReceiver:
     def __init__(self, port=12345, buffer_size=4096):
         self.port = port
@@ -86,6 +171,13 @@ class UDPReceiver:
             print(f"First packet received from {addr[0]}:{addr[1]}")
             print(f"Packet size: {len(data)} bytes")
             print(f"First 16 bytes: {data[:16].hex()}")
+            header = parse_header(data)
+            if header:
+                print(f"Header: {header}")
+                if header['aggregate']:
+                    frames = split_aggregate(data, header)
+                    print(f"Aggregate of {len(frames)} frames, "
+                          f"{sum(len(p) for _, p in frames)} payload bytes decoded")
             print()
             
     def print_stats(self):